@@ -0,0 +1,35 @@
+#!/bin/sh
+# Builds the decoder benchmark corpus from one source clip with LAME:
+# bitrates, mono/stereo, 22.05/44.1/48 kHz, CBR and VBR.
+#
+#   host/bench/corpus.sh source.wav corpus/
+#
+# A 5 s source keeps the set under 1 MB, so it also fits on the unit
+# (provision it with a SPIFFS image, then POST /api/bench/decode).
+set -e
+
+if [ $# -ne 2 ]; then
+  echo "usage: $0 SOURCE.wav OUTDIR" >&2
+  exit 2
+fi
+src=$1
+out=$2
+mkdir -p "$out"
+
+enc() {
+  name=$1; shift
+  lame --quiet --noreplaygain "$@" "$src" "$out/$name.mp3"
+  echo "$out/$name.mp3"
+}
+
+# Name: rate_channels_mode
+enc 44s_cbr128 --resample 44.1 -m j -b 128
+enc 44s_cbr192 --resample 44.1 -m j -b 192
+enc 44s_cbr320 --resample 44.1 -m s -b 320
+enc 44m_cbr64  --resample 44.1 -m m -b 64
+enc 44s_vbr2   --resample 44.1 -m j -V 2
+enc 44s_vbr5   --resample 44.1 -m j -V 5
+enc 48s_cbr160 --resample 48   -m j -b 160
+enc 48m_vbr4   --resample 48   -m m -V 4
+enc 22s_cbr64  --resample 22.05 -m j -b 64
+enc 22m_vbr6   --resample 22.05 -m m -V 6
@@ -0,0 +1,71 @@
+// Decoder benchmark on the host: Bench's decode run (as /api/bench/decode
+// on the unit) over a directory of MP3s, printed as a table.
+//
+//   host/bench/corpus.sh source.wav corpus/   # needs lame
+//   host/build/xsbench --fs corpus/
+//
+// Needs the real decoder (make ESP8266AUDIO=<path>): the stand-in only
+// walks frame headers, so xsbench refuses to run with it.
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#include <stdlib.h>
+
+#include "host.h"
+#include "bench.h"
+#include "fs_worker.h"
+
+#ifndef XS_HOST_DECODER
+  #define XS_HOST_DECODER "?"
+#endif
+
+static void usage() {
+  fprintf(stderr,
+    "usage: xsbench [--fs DIR] [--path /FILE.mp3]\n"
+    "  --fs DIR     directory of clips (default ./spiffs)\n"
+    "  --path FILE  decode one file (SPIFFS path, e.g. /boot.mp3)\n");
+}
+
+int main(int argc, char** argv) {
+  if (!strcmp(XS_HOST_DECODER, "stand-in")) {
+    fprintf(stderr, "xsbench: built with the stand-in decoder, which only walks frame headers;\n"
+                    "rebuild with make clean && make ESP8266AUDIO=<path to the library>\n");
+    return 2;
+  }
+  Host::Config cfg;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!v) { usage(); return 2; }
+    if      (!strcmp(a, "--fs"))   cfg.fsRoot = v;
+    else if (!strcmp(a, "--path")) path = v;
+    else { usage(); return 2; }
+    ++i;
+  }
+  Host::begin(cfg);
+  SPIFFS.begin(false);
+  FsWorker::begin();
+
+  if (!Bench::startDecode(path)) { fprintf(stderr, "xsbench: cannot start\n"); return 1; }
+  while (Bench::running()) Bench::loop();
+
+  Bench::DecodeResult r[Bench::kMaxClips];
+  const uint8_t n = Bench::decodeResults(r, Bench::kMaxClips);
+  printf("\ndecoder: %s\n", XS_HOST_DECODER);
+  printf("%-28s %6s %2s %5s %6s %8s %9s %8s %7s %9s\n",
+         "file", "Hz", "ch", "kbps", "frames", "audio_ms", "decode_ms", "fps", "rtf", "peak_heap");
+  int failed = 0;
+  for (uint8_t i = 0; i < n; ++i) {
+    if (!r[i].ok) { printf("%-28s not decoded\n", r[i].path); failed++; continue; }
+    const double sec = r[i].decodeUs / 1e6;
+    printf("%-28s %6u %2u %5u %6u %8u %9.1f %8.0f %7.1f %9u\n",
+           r[i].path, (unsigned)r[i].rate, (unsigned)r[i].channels,
+           r[i].audioMs ? (unsigned)((uint64_t)r[i].bytes * 8 / r[i].audioMs) : 0u,
+           (unsigned)r[i].mp3Frames, (unsigned)r[i].audioMs, r[i].decodeUs / 1000.0,
+           sec > 0 ? r[i].mp3Frames / sec : 0.0, sec > 0 ? r[i].audioMs / 1000.0 / sec : 0.0,
+           (unsigned)r[i].peakHeap);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+// JsonReader accept / reject cases, each fed whole and one byte at a time
+// (as AsyncWebServer may split a body anywhere).
+//
+//   make -C host check
+
+#include <stdio.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include "json_reader.h"
+
+struct Case {
+  const char* json;
+  bool        valid;
+};
+
+static const Case kCases[] = {
+  { "{}",                              true  },
+  { "[]",                              true  },
+  { "[ ]",                             true  },
+  { "[[],[ ]]",                        true  },
+  { "[1,2]",                           true  },
+  { "{\"a\":1,\"b\":[true,null]}",     true  },
+  { "{\"s\":\"x\\u00e9\\\"y\"}",       true  },
+  { "-1.5e3",                          true  },
+  { "[0,-0,0.5,1E+2,2e-3,10]",         true  },
+  { "{\"a_key_longer_than_the_key_buffer\":1}", true },
+  { "[1,]",                            false },
+  { "[,]",                             false },
+  { "[,1]",                            false },
+  { "{\"a\":1,}",                      false },
+  { "{,}",                             false },
+  { "[1 2]",                           false },
+  { "{\"a\" 1}",                       false },
+  { "[1]]",                            false },
+  { "[1",                              false },
+  { "tru",                             false },
+  { "1-2",                             false },
+  { "-",                               false },
+  { "[-]",                             false },
+  { "01",                              false },
+  { "1.",                              false },
+  { "1.e2",                            false },
+  { "1e",                              false },
+  { "[1e+]",                           false },
+  { "+1",                              false },
+  { "--1",                             false },
+};
+
+static void ignore(void*, const JsonReader::Event&) {}
+
+static bool parse(const char* s, size_t chunk) {
+  JsonReader r(ignore, nullptr);
+  const size_t n = strlen(s);
+  for (size_t i = 0; i < n; i += chunk) {
+    if (!r.feed(s + i, n - i < chunk ? n - i : chunk)) return false;
+  }
+  return r.finish();
+}
+
+int main() {
+  int failed = 0;
+  for (const Case& c : kCases) {
+    for (size_t chunk : { strlen(c.json), (size_t)1 }) {
+      if (!chunk || parse(c.json, chunk) == c.valid) continue;
+      printf("FAIL %-28s %s, fed %s\n", c.json, c.valid ? "rejected" : "accepted",
+             chunk == 1 ? "byte by byte" : "whole");
+      failed++;
+    }
+  }
+  printf("jsoncheck: %zu cases, %d failed\n", sizeof(kCases) / sizeof(kCases[0]), failed);
+  return failed ? 1 : 0;
+}
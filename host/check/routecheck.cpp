@@ -0,0 +1,90 @@
+// Route dispatch: registers the firmware's routes as setup() does and checks
+// which handler takes each request. The server uses the first handler that
+// matches, and a route also takes every URL below it, so a route
+// registered after a shorter one can be silently swallowed by it.
+//
+//   make -C host check
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+#include "host.h"
+#include "bench.h"
+#include "fileman.h"
+#include "fs_worker.h"
+#include "led_stat.h"
+#include "wifimgr.h"
+
+struct Case {
+  WebRequestMethodComposite method;
+  const char* url;
+  const char* route;    // the handler that must take it
+};
+
+static const Case kCases[] = {
+  { HTTP_GET,  "/scan",              "/scan"              },
+  { HTTP_GET,  "/scan/events",       "/scan/events"       },
+  { HTTP_GET,  "/ota",               "/ota"               },
+  { HTTP_POST, "/ota",               "/ota"               },
+  { HTTP_POST, "/ota/fs",            "/ota/fs"            },
+  { HTTP_GET,  "/api/wifi",          "/api/wifi"          },
+  { HTTP_POST, "/api/upload",        "/api/upload"        },
+  { HTTP_GET,  "/api/upload/status", "/api/upload/status" },
+  { HTTP_GET,  "/api/bench",         "/api/bench"         },
+  { HTTP_GET,  "/api/bench/decode",  "/api/bench/decode"  },
+  { HTTP_POST, "/api/bench/fs",      "/api/bench/fs"      },
+  { HTTP_POST, "/api/bench/net",     "/api/bench/net"     },
+};
+
+static const char* routeOf(AsyncWebHandler* h) {
+  if (auto* c = dynamic_cast<AsyncCallbackWebHandler*>(h)) return c->_uri.c_str();
+  if (auto* e = dynamic_cast<AsyncEventSource*>(h)) return e->url();
+  return "?";
+}
+
+int main() {
+  char dir[] = "/tmp/routecheck-XXXXXX";
+  if (!mkdtemp(dir)) { perror("mkdtemp"); return 2; }
+  Host::Config cfg;
+  cfg.fsRoot = dir;
+  cfg.serial = false;
+  Host::useVirtualClock();
+  Host::begin(cfg);
+
+  SPIFFS.begin(true);
+  FsWorker::begin();
+  LedStat::begin();
+  FileMan::begin();
+  Bench::begin();
+  WiFiMgr::begin();
+  // No saved network: the setup portal comes up and adds its routes
+  for (int ms = 0; ms < 60000 && strcmp(WiFiMgr::stateName(), "portal") != 0; ++ms) {
+    Host::advanceUs(1000);
+    Host::wifiTick();
+    WiFiMgr::loop();
+  }
+
+  AsyncWebServer& s = WiFiMgr::getServer();
+  int failed = 0;
+  for (const Case& c : kCases) {
+    AsyncWebServerRequest r;
+    r._method = c.method;
+    r._url = c.url;
+    AsyncWebHandler* h = nullptr;
+    for (AsyncWebHandler* x : s._handlers) if (x->canHandle(&r)) { h = x; break; }
+    const char* got = h ? routeOf(h) : "(none)";
+    if (strcmp(got, c.route) == 0) continue;
+    printf("FAIL %-4s %-22s taken by %s\n", c.method == HTTP_GET ? "GET" : "POST", c.url, got);
+    failed++;
+  }
+  printf("routecheck: %zu cases, %d failed\n", sizeof(kCases) / sizeof(kCases[0]), failed);
+  std::string rm = std::string("rm -rf ") + dir;
+  if (system(rm.c_str()) != 0) fprintf(stderr, "routecheck: could not remove %s\n", dir);
+  return failed ? 1 : 0;
+}
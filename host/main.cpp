@@ -0,0 +1,71 @@
+// Host entry point: the Arduino loop task, on Linux.
+//
+//   make -C host && host/build/xsound-host --fs my-spiffs --ms 5000
+//
+// Runs setup() and then loop() until --ms elapses, SIGINT, or the firmware
+// calls ESP.restart().
+
+#include <Arduino.h>
+
+#include <signal.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "wav.h"
+#include "audio_out.h"
+
+void setup();
+void loop();
+
+static volatile sig_atomic_t g_stop = 0;
+static void onSigint(int) { g_stop = 1; }
+
+// The sink backend (the host default) plays into --wav through the tap
+static WavWriter g_wav;
+static void wavTap(void*, const int16_t* lr, size_t frames, uint32_t rate) {
+  if (g_wav.open(Host::config().wavPath, rate)) g_wav.write(lr, frames);
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: xsound-host [--fs DIR] [--wav FILE] [--app IMAGE] [--update FILE] [--ms N]\n"
+    "  --fs DIR       SPIFFS contents (default ./spiffs, created if missing)\n"
+    "  --wav FILE     where the audio output goes (default ./i2s.wav)\n"
+    "  --app IMAGE    running firmware image, base for delta OTA\n"
+    "  --update FILE  where OTA writes (default ./update.bin)\n"
+    "  --ms N         stop after N ms (default: run until Ctrl-C)\n");
+}
+
+int main(int argc, char** argv) {
+  Host::Config cfg;
+  unsigned long runMs = 0;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!v) { usage(); return 2; }
+    if      (!strcmp(a, "--fs"))     cfg.fsRoot = v;
+    else if (!strcmp(a, "--wav"))    cfg.wavPath = v;
+    else if (!strcmp(a, "--app"))    cfg.appImage = v;
+    else if (!strcmp(a, "--update")) cfg.updatePath = v;
+    else if (!strcmp(a, "--ms"))     runMs = strtoul(v, nullptr, 10);
+    else { usage(); return 2; }
+    ++i;
+  }
+  Host::begin(cfg);
+  signal(SIGINT, onSigint);
+  AudioOut::setTap(wavTap, nullptr);
+
+  setup();
+  const unsigned long start = millis();
+  while (!g_stop && !Host::restartRequested() && (!runMs || millis() - start < runMs)) {
+    loop();
+    delay(1);   // the device spins here; keep a host core free
+  }
+  g_wav.close();
+
+  const AudioOut::Stats a = AudioOut::stats();
+  Serial.printf("[Host] audio (%s): %u clips, %llu frames, %u underruns (%u us), last clip %u ms in %u ms\n",
+                AudioOut::name(a.backend), (unsigned)a.clips, (unsigned long long)a.frames,
+                (unsigned)a.underruns, (unsigned)a.underrunUs, (unsigned)a.audioMs, (unsigned)a.wallMs);
+  return 0;
+}
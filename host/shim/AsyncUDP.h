@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <functional>
+class AsyncUDPPacket {
+public:
+  uint8_t* data();
+  size_t length();
+  bool isBroadcast();
+  bool isMulticast();
+  IPAddress localIP();
+  uint16_t localPort();
+  IPAddress remoteIP();
+  uint16_t remotePort();
+  size_t write(const uint8_t* data, size_t len);
+};
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+class AsyncUDP {
+public:
+  bool listen(const IPAddress addr, uint16_t port);
+  bool listen(uint16_t port);
+  void close();
+  bool connected();
+  void onPacket(AuPacketHandlerFunction cb);
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <AudioOutput.h>
+
+#include "wav.h"
+
+// Host: "plays" into a 16-bit stereo WAV file (Host::Config::wavPath).
+// Every clip of the run is appended; the header is fixed up on stop().
+class AudioOutputI2S : public AudioOutput {
+public:
+  AudioOutputI2S(int port = 0, int output_mode = 0, int dma_buf_count = 8, int use_apll = 0);
+  virtual ~AudioOutputI2S() override;
+  bool SetPinout(int bclkPin, int wclkPin, int doutPin);
+  bool SetPinout(int bclkPin, int wclkPin, int doutPin, int mclkPin);
+  virtual bool SetRate(int hz) override;
+  virtual bool SetBitsPerSample(int bits) override;
+  virtual bool SetChannels(int channels) override;
+  virtual bool begin() override;
+  virtual bool ConsumeSample(int16_t sample[2]) override;
+  virtual void flush() override;
+  virtual bool stop() override;
+  bool SetOutputModeMono(bool mono);
+  enum : int { APLL_AUTO = -1, APLL_ENABLE = 1, APLL_DISABLE = 0 };
+  enum : int { EXTERNAL_I2S = 0, INTERNAL_DAC = 1, INTERNAL_PDM = 2 };
+private:
+  WavWriter _wav;
+  bool      _mono = false;
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <Arduino.h>
+class DNSServer {
+public:
+  bool start(const uint16_t& port, const String& domainName, const IPAddress& resolvedIP);
+  void stop();
+  void processNextRequest();
+};
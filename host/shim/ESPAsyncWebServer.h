@@ -0,0 +1,253 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <AsyncTCP.h>
+#include <functional>
+#include <vector>
+#include <list>
+
+typedef enum {
+  HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_DELETE = 0b00000100, HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000, HTTP_HEAD = 0b00100000, HTTP_OPTIONS = 0b01000000, HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+class AsyncResponseStream;
+typedef std::function<void(void)> ArDisconnectHandler;
+typedef std::function<String(const String&)> AwsTemplateProcessor;
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool form = false, bool file = false, size_t size = 0)
+    : _name(name), _value(value), _size(size), _isForm(form), _isFile(file) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  size_t size() const { return _size; }
+  bool isPost() const { return _isForm; }
+  bool isFile() const { return _isFile; }
+private:
+  String _name, _value;
+  size_t _size;
+  bool _isForm, _isFile;
+};
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const String& n, const String& v) : _name(n), _value(v) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  String toString() const { return _name + ": " + _value + "\r\n"; }
+private:
+  String _name, _value;
+};
+
+typedef enum { RESPONSE_SETUP, RESPONSE_HEADERS, RESPONSE_CONTENT, RESPONSE_WAIT_ACK, RESPONSE_END, RESPONSE_FAILED } WebResponseState;
+
+class AsyncWebServerResponse {
+protected:
+  int _code = 0;
+  std::list<AsyncWebHeader> _headers;
+  String _contentType;
+  size_t _contentLength = 0;
+  bool _sendContentLength = true;
+  bool _chunked = false;
+  size_t _headLength = 0;
+  size_t _sentLength = 0;
+  size_t _ackedLength = 0;
+  size_t _writtenLength = 0;
+  WebResponseState _state = RESPONSE_SETUP;
+public:
+  AsyncWebServerResponse() {}
+  virtual ~AsyncWebServerResponse() {}
+  virtual void setCode(int code) { if (_state == RESPONSE_SETUP) _code = code; }
+  virtual void setContentLength(size_t len) { if (_state == RESPONSE_SETUP) _contentLength = len; }
+  virtual void setContentType(const String& type) { if (_state == RESPONSE_SETUP) _contentType = type; }
+  virtual void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+  virtual String _assembleHead(uint8_t version);
+  virtual bool _started() const { return _state > RESPONSE_SETUP; }
+  virtual bool _finished() const { return _state > RESPONSE_WAIT_ACK; }
+  virtual bool _failed() const { return _state == RESPONSE_FAILED; }
+  virtual bool _sourceValid() const { return false; }
+  virtual void _respond(AsyncWebServerRequest* request);
+  virtual size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time);
+  // host-only: what the client would have received so far
+  std::string _body;
+  int code() const { return _code; }
+  const std::string& body() const { return _body; }
+  const String& contentType() const { return _contentType; }
+  const std::list<AsyncWebHeader>& headerList() const { return _headers; }
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+  AsyncBasicResponse(int code, const String& contentType = String(), const String& content = String());
+  bool _sourceValid() const override { return true; }
+  void _respond(AsyncWebServerRequest* request) override;
+  size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override;
+private:
+  String _content;
+};
+
+class AsyncAbstractResponse : public AsyncWebServerResponse {
+protected:
+  AwsTemplateProcessor _callback;
+public:
+  AsyncAbstractResponse(AwsTemplateProcessor callback = nullptr) : _callback(callback) {}
+  void _respond(AsyncWebServerRequest* request) override;
+  size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override;
+  bool _sourceValid() const override { return false; }
+  virtual size_t _fillBuffer(uint8_t* buf __attribute__((unused)), size_t maxLen __attribute__((unused))) { return 0; }
+};
+
+class AsyncResponseStream : public AsyncAbstractResponse, public Print {
+public:
+  AsyncResponseStream(const String& contentType, size_t bufferSize);
+  bool _sourceValid() const override { return true; }
+  size_t _fillBuffer(uint8_t* buf, size_t maxLen) override;
+  size_t write(const uint8_t* data, size_t len) override;
+  size_t write(uint8_t data) override;
+  using Print::write;
+private:
+  std::string _buf;
+  size_t _read = 0;
+};
+
+class AsyncWebServerRequest {
+public:
+  void* _tempObject = nullptr;
+
+  AsyncWebServerRequest();
+  ~AsyncWebServerRequest();
+  AsyncClient* client() { return &_client; }
+  uint8_t version() const { return 1; }
+  WebRequestMethodComposite method() const { return _method; }
+  const String& url() const { return _url; }
+  const String& host() const { return _host; }
+  const String& contentType() const { return _contentType; }
+  size_t contentLength() const { return _contentLength; }
+  bool multipart() const { return _isMultipart; }
+  void onDisconnect(ArDisconnectHandler fn) { _onDisconnectfn = fn; }
+
+  void send(AsyncWebServerResponse* response);
+  void send(int code, const String& contentType = String(), const String& content = String());
+  void send(FS& fs, const String& path, const String& contentType = String(), bool download = false);
+  void send_P(int code, const String& contentType, const uint8_t* content, size_t len, AwsTemplateProcessor callback = nullptr);
+  void send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback = nullptr);
+  void redirect(const String& url);
+
+  AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(), const String& content = String());
+  AsyncWebServerResponse* beginResponse(FS& fs, const String& path, const String& contentType = String(), bool download = false, AwsTemplateProcessor callback = nullptr);
+  AsyncWebServerResponse* beginResponse(const String& contentType, size_t len, AwsResponseFiller callback, AwsTemplateProcessor templateCallback = nullptr);
+  AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller callback, AwsTemplateProcessor templateCallback = nullptr);
+  AsyncResponseStream* beginResponseStream(const String& contentType, size_t bufferSize = 1460);
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, const uint8_t* content, size_t len, AwsTemplateProcessor callback = nullptr);
+  AsyncWebServerResponse* beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback = nullptr);
+
+  size_t headers() const { return _headers.size(); }
+  bool hasHeader(const String& name) const;
+  AsyncWebHeader* getHeader(const String& name) const;
+  size_t params() const { return _params.size(); }
+  bool hasParam(const String& name, bool post = false, bool file = false) const;
+  AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+  AsyncWebParameter* getParam(size_t num) const;
+  bool hasArg(const char* name) const;
+  const String& arg(const String& name) const;
+
+  // host-only: request construction / inspection
+  WebRequestMethodComposite _method = HTTP_GET;
+  String _url, _host, _contentType;
+  size_t _contentLength = 0;
+  bool _isMultipart = false;
+  std::vector<AsyncWebParameter*> _params;
+  std::vector<AsyncWebHeader*> _headers;
+  AsyncWebServerResponse* _response = nullptr;
+  ArDisconnectHandler _onDisconnectfn;
+  AsyncClient _client;
+};
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+  virtual bool canHandle(AsyncWebServerRequest*) { return false; }
+  virtual void handleRequest(AsyncWebServerRequest*) {}
+  virtual void handleUpload(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool) {}
+  virtual void handleBody(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t) {}
+  virtual bool isRequestHandlerTrivial() { return true; }
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+  String _uri;
+  WebRequestMethodComposite _method = HTTP_ANY;
+  ArRequestHandlerFunction _onRequest;
+  ArUploadHandlerFunction _onUpload;
+  ArBodyHandlerFunction _onBody;
+  // As the library: the URI itself or anything below it
+  bool canHandle(AsyncWebServerRequest* r) override {
+    return (r->method() & _method) && (r->url() == _uri || r->url().startsWith(_uri + "/"));
+  }
+  void handleRequest(AsyncWebServerRequest* r) override { if (_onRequest) _onRequest(r); else r->send(500); }
+  void handleUpload(AsyncWebServerRequest* r, const String& fn, size_t i, uint8_t* d, size_t l, bool f) override { if (_onUpload) _onUpload(r, fn, i, d, l, f); }
+  void handleBody(AsyncWebServerRequest* r, uint8_t* d, size_t l, size_t i, size_t t) override { if (_onBody) _onBody(r, d, l, i, t); }
+  bool isRequestHandlerTrivial() override { return !_onRequest; }
+};
+
+class AsyncEventSource;
+class AsyncEventSourceClient {
+public:
+  void send(const char* message, const char* event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+  void close();
+  bool connected() const { return true; }
+  uint32_t lastId() const { return 0; }
+  size_t packetsWaiting() const { return 0; }
+};
+typedef std::function<void(AsyncEventSourceClient* client)> ArEventHandlerFunction;
+class AsyncEventSource : public AsyncWebHandler {
+public:
+  AsyncEventSource(const String& url) : _url(url) {}
+  const char* url() const { return _url.c_str(); }
+  void close();
+  void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+  // As the library: GET on the exact URL only
+  bool canHandle(AsyncWebServerRequest* r) override { return r->method() == HTTP_GET && r->url() == _url; }
+  void handleRequest(AsyncWebServerRequest* r) override;
+  void send(const char* message, const char* event = NULL, uint32_t id = 0, uint32_t reconnect = 0);
+  size_t count() const;
+  size_t avgPacketsWaiting() const;
+  String _url;
+  ArEventHandlerFunction _connectcb;
+};
+
+class AsyncWebServer {
+public:
+  AsyncWebServer(uint16_t port) : _port(port) {}
+  ~AsyncWebServer();
+  void begin() { _begun = true; }
+  void end() { _begun = false; }
+  void reset();
+  AsyncWebHandler& addHandler(AsyncWebHandler* handler) { _handlers.push_back(handler); return *handler; }
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                              ArUploadHandlerFunction onUpload = nullptr, ArBodyHandlerFunction onBody = nullptr);
+  AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest) { return on(uri, HTTP_ANY, onRequest); }
+  void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+  // host-only
+  std::vector<AsyncWebHandler*> _handlers;
+  ArRequestHandlerFunction _notFound;
+  uint16_t _port;
+  bool _begun = false;
+};
+
+class DefaultHeaders {
+public:
+  static DefaultHeaders& Instance() { static DefaultHeaders d; return d; }
+  void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+  std::list<AsyncWebHeader> _headers;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream {
+public:
+  File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+  size_t read(uint8_t* buf, size_t size);
+  size_t readBytes(char* buf, size_t size) { return read((uint8_t*)buf, size); }
+  bool seek(uint32_t pos, SeekMode mode);
+  bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+  size_t position() const;
+  size_t size() const;
+  void close();
+  operator bool() const;
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const;
+  File openNextFile(const char* mode = "r");
+  void rewindDirectory();
+  time_t getLastWrite();
+  FileImplPtr _p;
+};
+
+class FS {
+public:
+  virtual ~FS() {}
+  virtual File open(const char* path, const char* mode = "r", const bool create = false);
+  File open(const String& path, const char* mode = "r", const bool create = false) { return open(path.c_str(), mode, create); }
+  virtual bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  virtual bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  virtual bool rename(const char* a, const char* b);
+  bool rename(const String& a, const String& b) { return rename(a.c_str(), b.c_str()); }
+  virtual bool mkdir(const char*) { return true; }
+  virtual bool rmdir(const char*) { return true; }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include "WString.h"
+class IPAddress {
+public:
+  IPAddress() : _v(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _v((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t v) : _v(v) {}
+  operator uint32_t() const { return _v; }
+  uint8_t operator[](int i) const { return (uint8_t)(_v >> (8 * i)); }
+  bool operator==(const IPAddress& o) const { return _v == o._v; }
+  bool operator!=(const IPAddress& o) const { return _v != o._v; }
+  bool fromString(const char* s) { unsigned a, b, c, d; if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false; *this = IPAddress(a, b, c, d); return true; }
+  bool fromString(const String& s) { return fromString(s.c_str()); }
+  String toString() const { char b[16]; snprintf(b, sizeof b, "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]); return String(b); }
+private:
+  uint32_t _v;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define U_SPIFFS 100
+#define U_AUTH 200
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = LOW, const char* label = NULL);
+  size_t write(uint8_t* data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  void abort();
+  void printError(Print& out);
+  bool hasError();
+  uint8_t getError();
+  const char* errorString();
+  size_t progress();
+  size_t size();
+  size_t remaining();
+  bool isRunning();
+  bool isFinished();
+};
+extern UpdateClass Update;
@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <stdint.h>
+
+class String {
+public:
+  String() {}
+  String(const char* s) : _s(s ? s : "") {}
+  String(const char* s, size_t n) : _s(s ? std::string(s, n) : std::string()) {}
+  String(const String& o) = default;
+  String(String&& o) = default;
+  String& operator=(const String& o) = default;
+  String& operator=(String&& o) = default;
+  String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+  explicit String(char c) : _s(1, c) {}
+  explicit String(int v, unsigned char base = 10) { fmtl(v, base); }
+  explicit String(unsigned int v, unsigned char base = 10) { fmtu(v, base); }
+  explicit String(long v, unsigned char base = 10) { fmtl(v, base); }
+  explicit String(unsigned long v, unsigned char base = 10) { fmtu(v, base); }
+  explicit String(long long v, unsigned char base = 10) { fmtl(v, base); }
+  explicit String(unsigned long long v, unsigned char base = 10) { fmtu(v, base); }
+  explicit String(float v, unsigned int dec = 2) { fmtd(v, dec); }
+  explicit String(double v, unsigned int dec = 2) { fmtd(v, dec); }
+
+  unsigned int length() const { return (unsigned)_s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  const char* c_str() const { return _s.c_str(); }
+  bool reserve(unsigned int n) { _s.reserve(n); return true; }
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char& operator[](unsigned int i) { return _s[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { _s += o._s; return *this; }
+  String& operator+=(const char* o) { if (o) _s += o; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+  String& operator+=(int v) { return *this += String(v); }
+  String& operator+=(unsigned v) { return *this += String(v); }
+  String& operator+=(long v) { return *this += String(v); }
+  String& operator+=(unsigned long v) { return *this += String(v); }
+  bool concat(const char* s, unsigned n) { _s.append(s, n); return true; }
+  bool concat(const String& s) { _s += s._s; return true; }
+  bool concat(const char* s) { if (s) _s += s; return true; }
+  bool concat(char c) { _s += c; return true; }
+
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+  bool operator==(const String& o) const { return _s == o._s; }
+  bool operator==(const char* o) const { return _s == (o ? o : ""); }
+  bool operator!=(const String& o) const { return _s != o._s; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  bool operator<(const String& o) const { return _s < o._s; }
+  bool equals(const String& o) const { return *this == o; }
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(c_str(), o.c_str()) == 0; }
+  int compareTo(const String& o) const { return _s.compare(o._s); }
+  explicit operator bool() const { return true; }
+
+  int indexOf(char c, unsigned from = 0) const { auto p = _s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& s, unsigned from = 0) const { auto p = _s.find(s._s, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const char* s, unsigned from = 0) const { auto p = _s.find(s, from); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(char c) const { auto p = _s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+  String substring(unsigned a) const { return a >= _s.size() ? String() : String(_s.substr(a).c_str()); }
+  String substring(unsigned a, unsigned b) const { if (a > b) std::swap(a, b); if (a >= _s.size()) return String(); return String(_s.substr(a, b - a).c_str()); }
+  bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+  bool endsWith(const String& p) const { return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0; }
+  void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+  void trim() { size_t a = _s.find_first_not_of(" \t\r\n"); size_t b = _s.find_last_not_of(" \t\r\n"); _s = (a == std::string::npos) ? std::string() : _s.substr(a, b - a + 1); }
+  void replace(const String& f, const String& t) { if (f._s.empty()) return; size_t p = 0; while ((p = _s.find(f._s, p)) != std::string::npos) { _s.replace(p, f._s.size(), t._s); p += t._s.size(); } }
+  void remove(unsigned idx) { if (idx < _s.size()) _s.erase(idx); }
+  void remove(unsigned idx, unsigned n) { if (idx < _s.size()) _s.erase(idx, n); }
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(_s.c_str(), nullptr); }
+  void getBytes(unsigned char* buf, unsigned n, unsigned idx = 0) const { if (!n) return; size_t k = 0; for (; k + 1 < n && idx + k < _s.size(); ++k) buf[k] = (unsigned char)_s[idx + k]; buf[k] = 0; }
+  void toCharArray(char* buf, unsigned n, unsigned idx = 0) const { getBytes((unsigned char*)buf, n, idx); }
+
+private:
+  void fmtl(long long v, unsigned char base) { if (base == 10) { char b[32]; snprintf(b, sizeof b, "%lld", v); _s = b; } else fmtu((unsigned long long)v, base); }
+  void fmtu(unsigned long long v, unsigned char base) { char b[72]; int n = 0; do { int d = (int)(v % base); b[n++] = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v); _s.assign(b, n); std::string r(_s.rbegin(), _s.rend()); _s = r; }
+  void fmtd(double v, unsigned dec) { char b[64]; snprintf(b, sizeof b, "%.*f", (int)dec, v); _s = b; }
+  std::string _s;
+};
@@ -0,0 +1,178 @@
+// Arduino core on Linux: time, GPIO, Serial, ESP and heap queries.
+#include <Arduino.h>
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include <mutex>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+
+#include "host.h"
+
+// The ESP32-S3's internal heap, for the numbers Diag reports: what the
+// host process has allocated is charged against this budget.
+#ifndef XS_HOST_HEAP_BYTES
+  #define XS_HOST_HEAP_BYTES (320 * 1024)
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static Host::Config g_cfg;
+static std::atomic<bool> g_restart{false};
+
+// -------------- Time --------------
+static const auto g_t0 = std::chrono::steady_clock::now();
+static std::atomic<bool>     g_virtual{false};
+static std::atomic<uint64_t> g_virtualUs{0};
+
+static uint64_t nowUs() {
+  if (g_virtual.load(std::memory_order_relaxed)) return g_virtualUs.load(std::memory_order_relaxed);
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - g_t0).count();
+}
+
+static void sleepUs(uint64_t us) {
+  if (g_virtual.load(std::memory_order_relaxed)) g_virtualUs.fetch_add(us);
+  else std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+unsigned long millis() { return (unsigned long)(nowUs() / 1000); }
+unsigned long micros() { return (unsigned long)nowUs(); }
+void delay(uint32_t ms) { sleepUs((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { sleepUs(us); }
+void yield() { std::this_thread::yield(); }
+int64_t esp_timer_get_time(void) { return (int64_t)nowUs(); }
+uint32_t getCpuFrequencyMhz() { return 240; }
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) { return (esp_cpu_cycle_count_t)(nowUs() * 240); }
+
+long random(long max) { return max > 0 ? ::random() % max : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+
+// -------------- GPIO --------------
+static const int kPins = 64;
+static std::mutex g_gpioMu;
+static int   g_level[kPins];
+static void (*g_isr[kPins])(void);
+static int   g_isrMode[kPins];
+static uint32_t g_led = 0;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= kPins) return;
+  std::lock_guard<std::mutex> l(g_gpioMu);
+  if (mode == INPUT_PULLUP) g_level[pin] = HIGH;
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin >= kPins) return LOW;
+  std::lock_guard<std::mutex> l(g_gpioMu);
+  return g_level[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) { Host::setPin(pin, val ? HIGH : LOW); }
+
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode) {
+  if (pin >= kPins) return;
+  std::lock_guard<std::mutex> l(g_gpioMu);
+  g_isr[pin] = fn;
+  g_isrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin >= kPins) return;
+  std::lock_guard<std::mutex> l(g_gpioMu);
+  g_isr[pin] = nullptr;
+}
+
+extern "C" void neopixelWrite(uint8_t pin, uint8_t r, uint8_t g, uint8_t b) {
+  (void)pin;
+  g_led = ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+// -------------- Serial --------------
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+size_t HardwareSerial::write(const uint8_t* b, size_t n) { return g_cfg.serial ? fwrite(b, 1, n, stdout) : n; }
+
+size_t Print::printf(const char* fmt, ...) {
+  char small[256];
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, (size_t)n);
+  std::string big((size_t)n + 1, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&big[0], big.size(), fmt, ap);
+  va_end(ap);
+  return write((const uint8_t*)big.data(), (size_t)n);
+}
+
+// -------------- Heap --------------
+static size_t g_minFree = XS_HOST_HEAP_BYTES;
+
+static size_t heapFree() {
+  const struct mallinfo2 mi = mallinfo2();
+  const size_t used = mi.uordblks + mi.hblkhd;
+  const size_t freeb = used < XS_HOST_HEAP_BYTES ? XS_HOST_HEAP_BYTES - used : 0;
+  if (freeb < g_minFree) g_minFree = freeb;
+  return freeb;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return (caps & MALLOC_CAP_SPIRAM) ? 0 : heapFree(); }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { heapFree(); return (caps & MALLOC_CAP_SPIRAM) ? 0 : g_minFree; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_caps_get_free_size(caps); }
+size_t heap_caps_get_total_size(uint32_t caps) { return (caps & MALLOC_CAP_SPIRAM) ? 0 : XS_HOST_HEAP_BYTES; }
+int heap_caps_register_failed_alloc_callback(esp_alloc_failed_hook_t) { return 0; }
+void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+extern "C" uint32_t esp_get_free_heap_size(void) { return (uint32_t)heapFree(); }
+
+void EspClass::restart() {
+  Serial.println("[Host] ESP.restart()");
+  fflush(stdout);
+  g_restart.store(true);
+}
+uint32_t EspClass::getFreeHeap() { return (uint32_t)heapFree(); }
+uint32_t EspClass::getMinFreeHeap() { heapFree(); return (uint32_t)g_minFree; }
+uint32_t EspClass::getMaxAllocHeap() { return (uint32_t)heapFree(); }
+uint32_t EspClass::getHeapSize() { return XS_HOST_HEAP_BYTES; }
+uint32_t EspClass::getCycleCount() { return esp_cpu_get_cycle_count(); }
+
+// -------------- Host controls --------------
+namespace Host {
+
+  void begin(const Config& cfg) {
+    g_cfg = cfg;
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+  }
+
+  const Config& config() { return g_cfg; }
+
+  void useVirtualClock() { g_virtual.store(true); }
+  void advanceUs(uint64_t us) { g_virtualUs.fetch_add(us); }
+
+  void setPin(uint8_t pin, int level) {
+    if (pin >= kPins) return;
+    void (*isr)(void) = nullptr;
+    {
+      std::lock_guard<std::mutex> l(g_gpioMu);
+      const int old = g_level[pin];
+      g_level[pin] = level;
+      const int mode = g_isrMode[pin];
+      const bool fell = old == HIGH && level == LOW, rose = old == LOW && level == HIGH;
+      if (g_isr[pin] && ((mode == FALLING && fell) || (mode == RISING && rose) || (mode == CHANGE && (fell || rose)))) {
+        isr = g_isr[pin];
+      }
+    }
+    if (isr) isr();
+  }
+
+  int pinLevel(uint8_t pin) { return digitalRead(pin); }
+  uint32_t ledRgb() { return g_led; }
+  bool restartRequested() { return g_restart.load(); }
+}
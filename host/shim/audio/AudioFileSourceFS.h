@@ -0,0 +1,19 @@
+#pragma once
+#include "AudioFileSource.h"
+#include <FS.h>
+class AudioFileSourceFS : public AudioFileSource {
+public:
+  AudioFileSourceFS(fs::FS& fs) : filesystem(&fs) {}
+  AudioFileSourceFS(fs::FS& fs, const char* filename) : filesystem(&fs) { open(filename); }
+  virtual ~AudioFileSourceFS() override { if (f) f.close(); }
+  virtual bool open(const char* filename) override { f = filesystem->open(filename, "r"); return (bool)f; }
+  virtual uint32_t read(void* data, uint32_t len) override { return f.read((uint8_t*)data, len); }
+  virtual bool seek(int32_t pos, int dir) override { return f.seek(pos, (dir == SEEK_SET) ? SeekSet : (dir == SEEK_CUR) ? SeekCur : SeekEnd); }
+  virtual bool close() override { f.close(); return true; }
+  virtual bool isOpen() override { return f ? true : false; }
+  virtual uint32_t getSize() override { return f ? f.size() : 0; }
+  virtual uint32_t getPos() override { return f ? f.position() : 0; }
+private:
+  fs::FS* filesystem;
+  fs::File f;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "AudioGenerator.h"
+
+// Host stand-in for ESP8266Audio's libmad decoder (build with
+// ESP8266AUDIO=<path> to use the real one). It walks the same frame chain,
+// sets the output rate/channels from the headers and plays silence of the
+// right length, so timing and control flow match a real playback.
+class AudioGeneratorMP3 : public AudioGenerator {
+public:
+  AudioGeneratorMP3();
+  AudioGeneratorMP3(void* preallocateSpace, int preallocateSize);
+  virtual ~AudioGeneratorMP3() override;
+  virtual bool begin(AudioFileSource* source, AudioOutput* output) override;
+  virtual bool loop() override;
+  virtual bool stop() override;
+  virtual bool isRunning() override;
+  virtual void desync() override;
+
+private:
+  bool nextFrame();
+
+  uint32_t _left = 0;       // samples of the current frame still to output
+  uint32_t _rate = 0;
+  uint8_t  _channels = 0;
+};
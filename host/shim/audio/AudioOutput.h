@@ -0,0 +1,26 @@
+#pragma once
+#include "AudioStatus.h"
+class AudioOutput {
+public:
+  AudioOutput() {}
+  virtual ~AudioOutput() {}
+  virtual bool SetRate(int hz) { hertz = hz; return true; }
+  virtual bool SetBitsPerSample(int bits) { bps = bits; return true; }
+  virtual bool SetChannels(int chan) { channels = chan; return true; }
+  virtual bool SetGain(float f) { if (f > 4.0f) f = 4.0f; if (f < 0.0f) f = 0.0f; gainF2P6 = (uint8_t)(f * (1 << 6)); return true; }
+  virtual bool begin() { return false; }
+  typedef enum { LEFTCHANNEL = 0, RIGHTCHANNEL = 1 } SampleIndex;
+  virtual bool ConsumeSample(int16_t sample[2]) { (void)sample; return false; }
+  virtual uint16_t ConsumeSamples(int16_t* samples, uint16_t count) { for (uint16_t i = 0; i < count; i++) { if (!ConsumeSample(samples)) return i; samples += 2; } return count; }
+  virtual bool stop() { return false; }
+  virtual void flush() {}
+  virtual bool loop() { return true; }
+protected:
+  void MakeSampleStereo16(int16_t sample[2]) { if (bps == 8) { sample[0] = (((int16_t)(sample[0] & 0xff)) - 128) << 8; sample[1] = (((int16_t)(sample[1] & 0xff)) - 128) << 8; } if (channels == 1) sample[1] = sample[0]; }
+  inline int16_t Amplify(int16_t s) { int32_t v = (s * gainF2P6) >> 6; if (v < -32767) return -32767; else if (v > 32767) return 32767; return (int16_t)(v & 0xffff); }
+  uint16_t hertz = 44100;
+  uint8_t bps = 16;
+  uint8_t channels = 2;
+  uint8_t gainF2P6 = 1 << 6;
+  AudioStatus cb;
+};
@@ -0,0 +1,4 @@
+#pragma once
+#include <Arduino.h>
+class AudioStatus { public: typedef void (*metadataCBFn)(void*, const char*, bool, const char*); typedef void (*statusCBFn)(void*, int, const char*);
+  bool RegisterMetadataCB(metadataCBFn, void*) { return true; } bool RegisterStatusCB(statusCBFn, void*) { return true; } };
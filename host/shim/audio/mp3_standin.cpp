@@ -0,0 +1,84 @@
+// Frame-walking stand-in for AudioGeneratorMP3 (see AudioGeneratorMP3.h)
+#include "AudioGeneratorMP3.h"
+
+static const uint16_t kRateV1[] = {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320};
+static const uint16_t kRateV2[] = {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160};
+static const uint32_t kSrate[]  = {44100, 48000, 32000};
+
+AudioGeneratorMP3::AudioGeneratorMP3() {}
+AudioGeneratorMP3::AudioGeneratorMP3(void*, int) {}
+AudioGeneratorMP3::~AudioGeneratorMP3() { stop(); }
+
+bool AudioGeneratorMP3::begin(AudioFileSource* source, AudioOutput* out) {
+  if (!source || !out) return false;
+  file = source;
+  output = out;
+  _left = 0;
+  _rate = 0;
+
+  // ID3v2 in front of the first frame
+  uint8_t h[10];
+  if (file->read(h, sizeof(h)) == sizeof(h) && memcmp(h, "ID3", 3) == 0) {
+    uint32_t skip = ((uint32_t)(h[6] & 0x7F) << 21) | ((uint32_t)(h[7] & 0x7F) << 14) |
+                    ((uint32_t)(h[8] & 0x7F) << 7) | (h[9] & 0x7F);
+    if (h[5] & 0x10) skip += 10;
+    file->seek(10 + skip, SEEK_SET);
+  } else {
+    file->seek(0, SEEK_SET);
+  }
+  if (!nextFrame()) return false;
+
+  output->SetRate(_rate);
+  output->SetBitsPerSample(16);
+  output->SetChannels(_channels);
+  if (!output->begin()) return false;
+  running = true;
+  return true;
+}
+
+// Skips to the next Layer III frame and reads past it; false at EOF
+bool AudioGeneratorMP3::nextFrame() {
+  uint8_t h[4];
+  if (file->read(h, 4) != 4) return false;
+  for (int resync = 0; resync < 4096; ++resync) {
+    const uint8_t ver = (h[1] >> 3) & 3, layer = (h[1] >> 1) & 3;
+    const uint8_t bri = h[2] >> 4, sri = (h[2] >> 2) & 3;
+    if (h[0] == 0xFF && (h[1] & 0xE0) == 0xE0 && ver != 1 && layer == 1 && bri && bri != 15 && sri != 3) {
+      const bool v1 = ver == 3;
+      const uint32_t sr = kSrate[sri] >> (v1 ? 0 : ver == 2 ? 1 : 2);
+      const uint32_t len = (v1 ? 144000u : 72000u) * (v1 ? kRateV1[bri] : kRateV2[bri]) / sr + ((h[2] >> 1) & 1);
+      if (_rate && sr != _rate) return false;
+      _rate = sr;
+      _channels = (h[3] >> 6) == 3 ? 1 : 2;
+      _left = v1 ? 1152 : 576;
+      return file->seek((int32_t)len - 4, SEEK_CUR);
+    }
+    memmove(h, h + 1, 3);
+    if (file->read(h + 3, 1) != 1) return false;
+  }
+  return false;
+}
+
+bool AudioGeneratorMP3::loop() {
+  if (!running) return false;
+  // As libmad's loop: keep going until the output refuses a sample
+  while (true) {
+    if (!_left && !nextFrame()) { stop(); return false; }
+    lastSample[0] = lastSample[1] = 0;
+    if (!output->ConsumeSample(lastSample)) break;
+    _left--;
+  }
+  file->loop();
+  output->loop();
+  return running;
+}
+
+bool AudioGeneratorMP3::stop() {
+  if (!running) return true;
+  running = false;
+  output->stop();
+  return file->close();
+}
+
+bool AudioGeneratorMP3::isRunning() { return running; }
+void AudioGeneratorMP3::desync() {}
@@ -0,0 +1,31 @@
+// AudioOutputI2S on the host: samples go to a WAV file instead of DMA.
+#include <AudioOutputI2S.h>
+
+#include "host.h"
+
+AudioOutputI2S::AudioOutputI2S(int, int, int, int) {}
+AudioOutputI2S::~AudioOutputI2S() {}
+
+bool AudioOutputI2S::SetPinout(int, int, int) { return true; }
+bool AudioOutputI2S::SetPinout(int, int, int, int) { return true; }
+bool AudioOutputI2S::SetRate(int hz) { hertz = (uint16_t)hz; return true; }
+bool AudioOutputI2S::SetBitsPerSample(int bits) { if (bits != 8 && bits != 16) return false; bps = (uint8_t)bits; return true; }
+bool AudioOutputI2S::SetChannels(int ch) { if (ch < 1 || ch > 2) return false; channels = (uint8_t)ch; return true; }
+bool AudioOutputI2S::SetOutputModeMono(bool mono) { _mono = mono; return true; }
+
+bool AudioOutputI2S::begin() { return _wav.open(Host::config().wavPath, hertz); }
+
+bool AudioOutputI2S::ConsumeSample(int16_t sample[2]) {
+  if (!_wav.isOpen()) return false;
+  int16_t s[2] = { sample[0], sample[1] };
+  MakeSampleStereo16(s);
+  if (_mono) s[0] = s[1] = (int16_t)(((int32_t)s[0] + s[1]) / 2);
+  s[0] = Amplify(s[0]);
+  s[1] = Amplify(s[1]);
+  _wav.write(s, 1);
+  return true;
+}
+
+void AudioOutputI2S::flush() { _wav.finish(); }
+
+bool AudioOutputI2S::stop() { _wav.finish(); return true; }
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+typedef struct { int type; int subtype; uint32_t address; uint32_t size; char label[17]; bool encrypted; } esp_partition_t;
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t src_offset, void* dst, size_t size);
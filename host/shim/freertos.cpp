@@ -0,0 +1,156 @@
+// FreeRTOS on std::thread: tasks are threads, queues and semaphores are
+// condition variables, critical sections share one recursive mutex.
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Task {
+  std::string name;
+};
+
+static Task g_loopTask{"loopTask"};
+static thread_local Task* t_self = &g_loopTask;
+static std::recursive_mutex g_critical;
+
+// Deadline for a wait of `ticks` (1 tick = 1 ms), or none for portMAX_DELAY
+template <typename Pred>
+static bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& l, TickType_t ticks, Pred pred) {
+  if (ticks == portMAX_DELAY) { cv.wait(l, pred); return true; }
+  return cv.wait_for(l, std::chrono::milliseconds(ticks), pred);
+}
+
+// -------------- Queues --------------
+struct Queue {
+  std::mutex m;
+  std::condition_variable cv;
+  size_t itemSize, capacity;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+  Queue* q = new Queue();
+  q->capacity = len;
+  q->itemSize = itemSize;
+  return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t itemSize, uint8_t*, StaticQueue_t*) {
+  return xQueueCreate(len, itemSize);
+}
+
+BaseType_t xQueueSend(QueueHandle_t h, const void* item, TickType_t ticks) {
+  Queue& q = *static_cast<Queue*>(h);
+  std::unique_lock<std::mutex> l(q.m);
+  if (!waitFor(q.cv, l, ticks, [&] { return q.items.size() < q.capacity; })) return pdFALSE;
+  const uint8_t* p = static_cast<const uint8_t*>(item);
+  q.items.emplace_back(p, p + q.itemSize);
+  q.cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t h, void* out, TickType_t ticks) {
+  Queue& q = *static_cast<Queue*>(h);
+  std::unique_lock<std::mutex> l(q.m);
+  if (!waitFor(q.cv, l, ticks, [&] { return !q.items.empty(); })) return pdFALSE;
+  memcpy(out, q.items.front().data(), q.itemSize);
+  q.items.pop_front();
+  q.cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t h) {
+  Queue& q = *static_cast<Queue*>(h);
+  std::lock_guard<std::mutex> l(q.m);
+  return (UBaseType_t)q.items.size();
+}
+
+// -------------- Semaphores --------------
+struct Semaphore {
+  enum Kind { Binary, Mutex, Recursive } kind;
+  std::mutex m;
+  std::condition_variable cv;
+  unsigned count = 0;          // Binary: 0/1
+  Task*    owner = nullptr;    // Mutex/Recursive
+  unsigned depth = 0;
+};
+
+static Semaphore* makeSem(Semaphore::Kind k) {
+  Semaphore* s = new Semaphore();
+  s->kind = k;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return makeSem(Semaphore::Mutex); }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return makeSem(Semaphore::Recursive); }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return makeSem(Semaphore::Binary); }
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t*) { return makeSem(Semaphore::Binary); }
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t*) { return makeSem(Semaphore::Mutex); }
+void vSemaphoreDelete(SemaphoreHandle_t h) { delete static_cast<Semaphore*>(h); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t h, TickType_t ticks) {
+  Semaphore& s = *static_cast<Semaphore*>(h);
+  std::unique_lock<std::mutex> l(s.m);
+  if (s.kind == Semaphore::Binary) {
+    if (!waitFor(s.cv, l, ticks, [&] { return s.count > 0; })) return pdFALSE;
+    s.count = 0;
+    return pdTRUE;
+  }
+  if (s.kind == Semaphore::Recursive && s.owner == t_self) { s.depth++; return pdTRUE; }
+  if (!waitFor(s.cv, l, ticks, [&] { return s.owner == nullptr; })) return pdFALSE;
+  s.owner = t_self;
+  s.depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t h) {
+  Semaphore& s = *static_cast<Semaphore*>(h);
+  std::lock_guard<std::mutex> l(s.m);
+  if (s.kind == Semaphore::Binary) {
+    if (s.count) return pdFALSE;
+    s.count = 1;
+  } else {
+    if (s.owner != t_self) return pdFALSE;
+    if (--s.depth == 0) s.owner = nullptr;
+  }
+  s.cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t h, TickType_t ticks) { return xSemaphoreTake(h, ticks); }
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t h) { return xSemaphoreGive(h); }
+
+// -------------- Tasks --------------
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t, void* arg, UBaseType_t, TaskHandle_t* out) {
+  Task* t = new Task{name ? name : ""};
+  if (out) *out = t;
+  std::thread([fn, arg, t] { t_self = t; fn(arg); }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t) {
+  return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return t_self; }
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 4096; }
+void vTaskDelete(TaskHandle_t) {}
+void taskYIELD() { std::this_thread::yield(); }
+char* pcTaskGetName(TaskHandle_t h) { return &static_cast<Task*>(h ? h : t_self)->name[0]; }
+BaseType_t xPortGetCoreID() { return t_self == &g_loopTask ? 1 : 0; }
+BaseType_t xPortInIsrContext() { return pdFALSE; }
+
+void portENTER_CRITICAL(portMUX_TYPE*) { g_critical.lock(); }
+void portEXIT_CRITICAL(portMUX_TYPE*) { g_critical.unlock(); }
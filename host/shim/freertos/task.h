@@ -0,0 +1,13 @@
+#pragma once
+#include "FreeRTOS.h"
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t);
+void vTaskDelete(TaskHandle_t);
+void taskYIELD();
+char* pcTaskGetName(TaskHandle_t);
+BaseType_t xPortGetCoreID();
+BaseType_t xPortInIsrContext();
@@ -0,0 +1,217 @@
+// SPIFFS backed by a directory (Host::Config::fsRoot). Paths map 1:1 below
+// it; the partition size is fixed so free-space checks behave as on flash.
+#include <FS.h>
+#include <SPIFFS.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include "host.h"
+
+#ifndef XS_HOST_FS_BYTES
+  #define XS_HOST_FS_BYTES (1408 * 1024)   // usable bytes of the 1.5 MB partition
+#endif
+
+fs::SPIFFSFS SPIFFS;
+
+static bool g_mounted = false;
+
+static std::string hostPath(const char* path) {
+  std::string p = Host::config().fsRoot;
+  if (!path || path[0] != '/') p += '/';
+  if (path) p += path;
+  return p;
+}
+
+static void makeParents(const std::string& p) {
+  for (size_t i = p.find('/', 1); i != std::string::npos; i = p.find('/', i + 1)) {
+    ::mkdir(p.substr(0, i).c_str(), 0755);
+  }
+}
+
+// Every regular file below dir, as "/a/b" paths (SPIFFS has no directories)
+static void walk(const std::string& base, const std::string& rel, std::vector<std::string>& out) {
+  DIR* d = opendir((base + rel).c_str());
+  if (!d) return;
+  while (dirent* e = readdir(d)) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    const std::string r = rel + "/" + e->d_name;
+    struct stat st;
+    if (stat((base + r).c_str(), &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) walk(base, r, out);
+    else if (S_ISREG(st.st_mode)) out.push_back(r);
+  }
+  closedir(d);
+}
+
+namespace fs {
+
+class FileImpl {
+public:
+  ~FileImpl() { close(); }
+  void close() { if (f) { fclose(f); f = nullptr; } }
+
+  FILE*       f = nullptr;
+  std::string path;
+  std::string name;
+  bool        dir = false;
+  std::vector<std::string> entries;
+  size_t      next = 0;
+};
+
+static FileImplPtr openImpl(const char* path, const char* mode) {
+  if (!g_mounted || !path) return FileImplPtr();
+  const std::string hp = hostPath(path);
+  struct stat st;
+  const bool exists = stat(hp.c_str(), &st) == 0;
+
+  auto impl = std::make_shared<FileImpl>();
+  impl->path = path;
+  const size_t slash = impl->path.rfind('/');
+  impl->name = slash == std::string::npos ? impl->path : impl->path.substr(slash + 1);
+
+  if (exists && S_ISDIR(st.st_mode)) {
+    impl->dir = true;
+    std::string rel = path;
+    if (!rel.empty() && rel.back() == '/') rel.pop_back();
+    walk(Host::config().fsRoot, rel, impl->entries);
+    return impl;
+  }
+  if (mode[0] != 'r' || mode[1] == '+') makeParents(hp);
+  if (mode[0] == 'r' && !exists) return FileImplPtr();
+  std::string m = mode;
+  if (m.find('b') == std::string::npos) m += 'b';
+  impl->f = fopen(hp.c_str(), m.c_str());
+  if (!impl->f) return FileImplPtr();
+  return impl;
+}
+
+// -------------- File --------------
+size_t File::write(uint8_t c) { return write(&c, 1); }
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!_p || !_p->f) return 0;
+  // Full partition: short write, as SPIFFS does
+  const size_t used = SPIFFS.usedBytes();
+  if (used + size > XS_HOST_FS_BYTES) size = used < XS_HOST_FS_BYTES ? XS_HOST_FS_BYTES - used : 0;
+  return fwrite(buf, 1, size, _p->f);
+}
+
+int File::available() {
+  if (!_p || !_p->f) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!_p || !_p->f) return -1;
+  const int c = fgetc(_p->f);
+  if (c != EOF) ungetc(c, _p->f);
+  return c == EOF ? -1 : c;
+}
+
+void File::flush() { if (_p && _p->f) fflush(_p->f); }
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!_p || !_p->f) return 0;
+  return fread(buf, 1, size, _p->f);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!_p || !_p->f) return false;
+  const int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+  return fseek(_p->f, (long)(mode == SeekSet ? pos : (int32_t)pos), whence) == 0;
+}
+
+size_t File::position() const {
+  if (!_p || !_p->f) return 0;
+  const long p = ftell(_p->f);
+  return p < 0 ? 0 : (size_t)p;
+}
+
+size_t File::size() const {
+  if (!_p || !_p->f) return 0;
+  fflush(_p->f);
+  struct stat st;
+  return fstat(fileno(_p->f), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() { if (_p) _p->close(); _p.reset(); }
+File::operator bool() const { return _p && (_p->f || _p->dir); }
+const char* File::path() const { return _p ? _p->path.c_str() : nullptr; }
+const char* File::name() const { return _p ? _p->name.c_str() : nullptr; }
+bool File::isDirectory() const { return _p && _p->dir; }
+
+File File::openNextFile(const char* mode) {
+  if (!_p || !_p->dir || _p->next >= _p->entries.size()) return File();
+  return File(openImpl(_p->entries[_p->next++].c_str(), mode));
+}
+
+void File::rewindDirectory() { if (_p) _p->next = 0; }
+
+time_t File::getLastWrite() {
+  if (!_p) return 0;
+  struct stat st;
+  return stat(hostPath(_p->path.c_str()).c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+// -------------- FS --------------
+File FS::open(const char* path, const char* mode, const bool) { return File(openImpl(path, mode)); }
+
+bool FS::exists(const char* path) {
+  struct stat st;
+  return g_mounted && path && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) { return g_mounted && path && ::remove(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char* a, const char* b) {
+  if (!g_mounted || !a || !b) return false;
+  const std::string hb = hostPath(b);
+  makeParents(hb);
+  return ::rename(hostPath(a).c_str(), hb.c_str()) == 0;
+}
+
+// -------------- SPIFFS --------------
+bool SPIFFSFS::begin(bool formatOnFail, const char*, uint8_t, const char*) {
+  const char* root = Host::config().fsRoot;
+  struct stat st;
+  if (stat(root, &st) != 0) {
+    if (!formatOnFail || ::mkdir(root, 0755) != 0) return false;
+  } else if (!S_ISDIR(st.st_mode)) {
+    return false;
+  }
+  g_mounted = true;
+  return true;
+}
+
+bool SPIFFSFS::format() {
+  std::vector<std::string> all;
+  walk(Host::config().fsRoot, "", all);
+  for (const std::string& p : all) ::remove(hostPath(p.c_str()).c_str());
+  return true;
+}
+
+size_t SPIFFSFS::totalBytes() { return XS_HOST_FS_BYTES; }
+
+size_t SPIFFSFS::usedBytes() {
+  std::vector<std::string> all;
+  walk(Host::config().fsRoot, "", all);
+  size_t used = 0;
+  struct stat st;
+  for (const std::string& p : all) {
+    if (stat(hostPath(p.c_str()).c_str(), &st) == 0) used += (size_t)st.st_size;
+  }
+  return used;
+}
+
+void SPIFFSFS::end() { g_mounted = false; }
+
+} // namespace fs
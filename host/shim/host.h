@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host-only controls for the shims (README: "Host build"). The firmware never
+// includes this; host/main.cpp and the harnesses do.
+namespace Host {
+
+  struct Config {
+    const char* fsRoot  = "spiffs";        // directory behind SPIFFS
+    const char* wavPath = "i2s.wav";       // what AudioOutputI2S plays into
+    const char* appImage = nullptr;        // "running partition" for delta OTA
+    const char* updatePath = "update.bin"; // where Update writes
+    bool        serial = true;             // false: drop Serial output
+  };
+
+  // Before setup()
+  void begin(const Config& cfg);
+  const Config& config();
+
+  // -------- Virtual clock --------
+  // For single-threaded harnesses: millis()/micros()/esp_timer start at 0
+  // and move only through advanceUs(), or delay() on any task. Other
+  // tasks' FreeRTOS waits still run on real time. Call before setup code.
+  void useVirtualClock();
+  void advanceUs(uint64_t us);
+
+  // -------- GPIO --------
+  // Drive an input pin from outside; fires the attached interrupt on a
+  // matching edge, in the caller's thread (as the ISR would preempt loop()).
+  void setPin(uint8_t pin, int level);
+  int  pinLevel(uint8_t pin);
+
+  // Last colour written to the status LED
+  uint32_t ledRgb();
+
+  // -------- Wi-Fi --------
+  // Scripted radio. Nothing is in range until wifiAp(); with access points
+  // set, begin() associates, gets an address or fails after the timings
+  // below. Driver events go out from wifiTick() (the event task's job) or
+  // from the next WiFi call. The core's own auto-reconnect is not modelled.
+  struct WifiTiming {
+    uint32_t scanMs       = 2200;  // async scan, every channel
+    uint32_t findMs       = 2200;  // begin() with no channel sweeps first
+    uint32_t assocMs      = 200;   // auth + association
+    uint32_t dhcpMs       = 1000;  // associated -> IP (0 with a static IP)
+    uint32_t authFailMs   = 3000;  // wrong password: handshake timeout
+    uint32_t noApMs       = 2200;  // SSID not found (or not on the channel)
+    uint32_t beaconLossMs = 6000;  // AP gone -> link down
+    uint32_t modeMs       = 100;   // mode() -> STA_START / AP_START
+    // How long each call holds the caller (rough figures for an S3)
+    uint32_t modeCallMs   = 30;
+    uint32_t apCallMs     = 20;    // softAP()
+    uint32_t beginCallMs  = 2;
+    uint32_t discCallMs   = 5;     // disconnect()
+    uint32_t scanCallMs   = 2;     // async start; a blocking scan takes scanMs
+  };
+  void wifiTiming(const WifiTiming& t);
+  const WifiTiming& wifiTiming();
+
+  // Add or change an access point (up). A new password or channel drops
+  // a unit associated to it, as a router reconfiguring would.
+  void wifiAp(const char* ssid, const char* pass, int8_t rssi, uint8_t channel);
+  // Power it off (the link drops after beaconLossMs) or back on
+  void wifiApUp(const char* ssid, bool up);
+  // Phones on the unit's own setup AP
+  void wifiApClients(uint8_t n);
+  void wifiTick();
+
+  struct WifiStats {
+    uint32_t begins;      // WiFi.begin() calls
+    uint32_t scans;       // scans started
+    uint32_t modeCalls;   // mode changes
+    uint32_t apStarts;    // setup AP brought up
+    uint32_t links;       // times an IP was handed out
+  };
+  WifiStats wifiStats();
+  bool wifiApOn();        // setup AP up
+
+  // -------- Restart --------
+  // ESP.restart() lands here; main() decides what to do
+  bool restartRequested();
+}
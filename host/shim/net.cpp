@@ -0,0 +1,562 @@
+// Network side on the host: no sockets. The web server keeps its handlers
+// and responses keep their bodies, so requests can be run in-process;
+// Wi-Fi is a scripted radio (nothing in range unless a harness adds access
+// points); UDP, DNS and mDNS accept calls and idle.
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <DNSServer.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+#include <WiFi.h>
+
+#include <vector>
+
+#include "host.h"
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+// -------------- Responses --------------
+String AsyncWebServerResponse::_assembleHead(uint8_t) {
+  String h = "HTTP/1.1 " + String(_code) + "\r\n";
+  for (const AsyncWebHeader& x : _headers) h += x.toString();
+  return h + "\r\n";
+}
+
+void AsyncWebServerResponse::_respond(AsyncWebServerRequest*) { _state = RESPONSE_END; }
+size_t AsyncWebServerResponse::_ack(AsyncWebServerRequest*, size_t, uint32_t) { return 0; }
+
+AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, const String& content)
+  : _content(content) {
+  _code = code;
+  _contentType = contentType;
+  _contentLength = content.length();
+}
+
+void AsyncBasicResponse::_respond(AsyncWebServerRequest*) {
+  _body.assign(_content.c_str(), _content.length());
+  _state = RESPONSE_END;
+}
+
+size_t AsyncBasicResponse::_ack(AsyncWebServerRequest*, size_t, uint32_t) { return 0; }
+
+void AsyncAbstractResponse::_respond(AsyncWebServerRequest*) { _state = RESPONSE_CONTENT; }
+
+// One "TCP window" of content per call, as the poll timer would ask for
+size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest*, size_t len, uint32_t) {
+  if (_state != RESPONSE_CONTENT) return 0;
+  if (!_sourceValid()) { _state = RESPONSE_FAILED; return 0; }
+  std::vector<uint8_t> buf(len ? len : 1460);
+  size_t want = buf.size();
+  if (_sendContentLength && _contentLength - _sentLength < want) want = _contentLength - _sentLength;
+  const size_t n = want ? _fillBuffer(buf.data(), want) : 0;
+  if (n == RESPONSE_TRY_AGAIN) return 0;
+  _body.append((const char*)buf.data(), n);
+  _sentLength += n;
+  if ((_sendContentLength && _sentLength >= _contentLength) || (!_sendContentLength && n == 0)) _state = RESPONSE_END;
+  return n;
+}
+
+AsyncResponseStream::AsyncResponseStream(const String& contentType, size_t) {
+  _code = 200;
+  _contentType = contentType;
+  _sendContentLength = false;
+}
+
+size_t AsyncResponseStream::_fillBuffer(uint8_t* buf, size_t maxLen) {
+  size_t n = _buf.size() - _read;
+  if (n > maxLen) n = maxLen;
+  memcpy(buf, _buf.data() + _read, n);
+  _read += n;
+  return n;
+}
+
+size_t AsyncResponseStream::write(const uint8_t* data, size_t len) { _buf.append((const char*)data, len); return len; }
+size_t AsyncResponseStream::write(uint8_t data) { return write(&data, 1); }
+
+// Callback-filled body (sized or chunked)
+class FillerResponse : public AsyncAbstractResponse {
+public:
+  FillerResponse(const String& type, size_t len, AwsResponseFiller fill, bool chunked) : _fill(fill) {
+    _code = 200;
+    _contentType = type;
+    _contentLength = len;
+    _sendContentLength = !chunked;
+    _chunked = chunked;
+  }
+  bool _sourceValid() const override { return (bool)_fill; }
+  size_t _fillBuffer(uint8_t* buf, size_t maxLen) override {
+    const size_t n = _fill(buf, maxLen, _index);
+    if (n != RESPONSE_TRY_AGAIN) _index += n;
+    return n;
+  }
+private:
+  AwsResponseFiller _fill;
+  size_t _index = 0;
+};
+
+// -------------- Requests --------------
+static const String kEmpty;
+
+AsyncWebServerRequest::AsyncWebServerRequest() {}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+  for (auto* p : _params) delete p;
+  for (auto* h : _headers) delete h;
+  delete _response;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+  if (_response) { delete response; return; }   // first reply wins, as on the device
+  _response = response;
+  if (_response) _response->_respond(this);
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+  send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send(FS& fs, const String& path, const String& contentType, bool download) {
+  send(beginResponse(fs, path, contentType, download));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, const uint8_t* content, size_t len, AwsTemplateProcessor cb) {
+  send(beginResponse_P(code, contentType, content, len, cb));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor cb) {
+  send(beginResponse_P(code, contentType, content, cb));
+}
+
+void AsyncWebServerRequest::redirect(const String& url) {
+  AsyncWebServerResponse* r = beginResponse(302);
+  r->addHeader("Location", url);
+  send(r);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& contentType, const String& content) {
+  return new AsyncBasicResponse(code, contentType, content);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(FS& fs, const String& path, const String& contentType, bool, AwsTemplateProcessor) {
+  File f = fs.open(path, "r");
+  if (!f) return new AsyncBasicResponse(404);
+  std::string data(f.size(), '\0');
+  f.read((uint8_t*)&data[0], data.size());
+  return new AsyncBasicResponse(200, contentType, String(data.data(), data.size()));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(const String& contentType, size_t len, AwsResponseFiller cb, AwsTemplateProcessor) {
+  return new FillerResponse(contentType, len, cb, false);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String& contentType, AwsResponseFiller cb, AwsTemplateProcessor) {
+  return new FillerResponse(contentType, 0, cb, true);
+}
+
+AsyncResponseStream* AsyncWebServerRequest::beginResponseStream(const String& contentType, size_t bufferSize) {
+  return new AsyncResponseStream(contentType, bufferSize);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String& contentType, const uint8_t* content, size_t len, AwsTemplateProcessor) {
+  return new AsyncBasicResponse(code, contentType, String((const char*)content, len));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor) {
+  return new AsyncBasicResponse(code, contentType, String(content));
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const { return getHeader(name) != nullptr; }
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
+  for (auto* h : _headers) if (h->name().equalsIgnoreCase(name)) return h;
+  return nullptr;
+}
+
+bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+  return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+  for (auto* p : _params) if (p->name() == name && p->isPost() == post && p->isFile() == file) return p;
+  return nullptr;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const { return num < _params.size() ? _params[num] : nullptr; }
+
+bool AsyncWebServerRequest::hasArg(const char* name) const {
+  for (auto* p : _params) if (p->name() == name) return true;
+  return false;
+}
+
+const String& AsyncWebServerRequest::arg(const String& name) const {
+  for (auto* p : _params) if (p->name() == name) return p->value();
+  return kEmpty;
+}
+
+// -------------- Server --------------
+// Handlers stay alive: the server is a static torn down at exit, and some
+// handlers (AsyncEventSource) are statics themselves
+AsyncWebServer::~AsyncWebServer() {}
+
+void AsyncWebServer::reset() { _handlers.clear(); }
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+  auto* h = new AsyncCallbackWebHandler();
+  h->_uri = uri;
+  h->_method = method;
+  h->_onRequest = onRequest;
+  h->_onUpload = onUpload;
+  h->_onBody = onBody;
+  _handlers.push_back(h);
+  return *h;
+}
+
+// -------------- Server-sent events --------------
+void AsyncEventSourceClient::send(const char*, const char*, uint32_t, uint32_t) {}
+void AsyncEventSourceClient::close() {}
+void AsyncEventSource::close() {}
+// The client is gone again when this returns; count() stays 0
+void AsyncEventSource::handleRequest(AsyncWebServerRequest*) {
+  AsyncEventSourceClient c;
+  if (_connectcb) _connectcb(&c);
+}
+void AsyncEventSource::send(const char*, const char*, uint32_t, uint32_t) {}
+size_t AsyncEventSource::count() const { return 0; }
+size_t AsyncEventSource::avgPacketsWaiting() const { return 0; }
+
+// -------------- Wi-Fi: scripted radio (Host::wifiAp) --------------
+// Single-threaded like the loop task that drives it: pump() advances the
+// association and scan on millis() and delivers queued events.
+struct FakeAp {
+  String  ssid, pass;
+  int8_t  rssi;
+  uint8_t channel;
+  bool    up;
+  uint8_t bssid[6];
+};
+
+// Disconnect reasons as the IDF reports them
+enum : uint8_t { kReasonLeave = 8, kReasonHandshake = 15, kReasonBeacon = 200, kReasonNoAp = 201 };
+
+enum class Sta : uint8_t { Idle, Joining, Assoc, Up, Failing };
+
+static Host::WifiTiming g_wt;
+static Host::WifiStats  g_ws = {};
+static std::vector<FakeAp> g_aps;
+static uint8_t g_apClients = 0;
+
+static int g_mode = WIFI_OFF;
+static wl_status_t g_status = WL_DISCONNECTED;
+static String g_ssid, g_pass;
+static int32_t g_chan = 0;
+static uint32_t g_staticIp = 0;
+static Sta g_sta = Sta::Idle;
+static int g_ap = -1;                    // AP being joined / associated
+static unsigned long g_staAt = 0;        // next STA transition
+static unsigned long g_lossAt = 0;       // beacon loss pending, 0 = none
+static uint8_t g_failReason = 0;
+
+static bool g_scanRunning = false, g_scanned = false;
+static unsigned long g_scanAt = 0;
+static std::vector<FakeAp> g_scanRes;
+
+struct QueuedEvent {
+  unsigned long at;
+  arduino_event_id_t id;
+  arduino_event_info_t info;
+};
+static std::vector<QueuedEvent> g_queue;
+static std::vector<std::pair<WiFiEventFuncCb, arduino_event_id_t>> g_events;
+static bool g_pumping = false;
+
+static void queueEvent(arduino_event_id_t ev, uint32_t afterMs = 0, uint8_t reason = 0) {
+  QueuedEvent q;
+  q.at = millis() + afterMs;
+  q.id = ev;
+  memset(&q.info, 0, sizeof(q.info));
+  if (ev == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) q.info.wifi_sta_disconnected.reason = reason;
+  if (ev == ARDUINO_EVENT_WIFI_SCAN_DONE) q.info.wifi_scan_done.number = (uint8_t)g_scanRes.size();
+  g_queue.push_back(q);
+}
+
+// A call that holds the caller for a while on the device
+static void hold(uint32_t ms) { if (ms) delay(ms); }
+
+static int findAp(const String& ssid) {
+  for (size_t i = 0; i < g_aps.size(); ++i) if (g_aps[i].ssid == ssid) return (int)i;
+  return -1;
+}
+
+static void staFail(uint8_t reason, uint32_t afterMs) {
+  g_sta = Sta::Failing;
+  g_staAt = millis() + afterMs;
+  g_failReason = reason;
+}
+
+// Drop to idle; tells the stack if it was associated or trying
+static void staDrop(uint8_t reason, wl_status_t st) {
+  if (g_sta != Sta::Idle) queueEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, 0, reason);
+  g_sta = Sta::Idle;
+  g_ap = -1;
+  g_lossAt = 0;
+  g_status = st;
+}
+
+static void staStep(unsigned long now) {
+  if (g_lossAt && (long)(now - g_lossAt) >= 0) staDrop(kReasonBeacon, WL_CONNECTION_LOST);
+  while (g_sta != Sta::Idle && g_sta != Sta::Up && (long)(now - g_staAt) >= 0) {
+    const bool there = g_ap >= 0 && g_aps[g_ap].up;
+    switch (g_sta) {
+      case Sta::Joining:
+        if (!there) { staDrop(kReasonNoAp, WL_NO_SSID_AVAIL); break; }
+        queueEvent(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        g_sta = Sta::Assoc;
+        g_staAt += g_staticIp ? 0 : g_wt.dhcpMs;
+        break;
+      case Sta::Assoc:
+        if (!there) { staDrop(kReasonBeacon, WL_CONNECTION_LOST); break; }
+        g_sta = Sta::Up;
+        g_status = WL_CONNECTED;
+        g_ws.links++;
+        queueEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        break;
+      case Sta::Failing:
+        staDrop(g_failReason, g_failReason == kReasonNoAp ? WL_NO_SSID_AVAIL : WL_CONNECT_FAILED);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static void pump() {
+  if (g_pumping) return;
+  g_pumping = true;
+  const unsigned long now = millis();
+  staStep(now);
+  if (g_scanRunning && (long)(now - g_scanAt) >= 0) {
+    g_scanRunning = false;
+    g_scanned = true;
+    g_scanRes.clear();
+    for (const FakeAp& a : g_aps) if (a.up) g_scanRes.push_back(a);
+    queueEvent(ARDUINO_EVENT_WIFI_SCAN_DONE);
+  }
+  // Due events in order; a handler may queue more
+  for (size_t i = 0; i < g_queue.size();) {
+    if ((long)(now - g_queue[i].at) < 0) { ++i; continue; }
+    const QueuedEvent q = g_queue[i];
+    g_queue.erase(g_queue.begin() + i);
+    for (auto& e : g_events) if (e.second == ARDUINO_EVENT_MAX || e.second == q.id) e.first(q.id, q.info);
+  }
+  g_pumping = false;
+}
+
+static void setMode(int m) {
+  if (m == g_mode) return;
+  hold(g_wt.modeCallMs);
+  g_ws.modeCalls++;
+  const int was = g_mode;
+  g_mode = m;
+  if ((m & WIFI_STA) && !(was & WIFI_STA)) queueEvent(ARDUINO_EVENT_WIFI_STA_START, g_wt.modeMs);
+  if (!(m & WIFI_STA) && (was & WIFI_STA)) {
+    staDrop(kReasonLeave, WL_DISCONNECTED);
+    queueEvent(ARDUINO_EVENT_WIFI_STA_STOP);
+  }
+  if ((m & WIFI_AP) && !(was & WIFI_AP)) {
+    g_ws.apStarts++;
+    queueEvent(ARDUINO_EVENT_WIFI_AP_START, g_wt.modeMs);
+  }
+  if (!(m & WIFI_AP) && (was & WIFI_AP)) queueEvent(ARDUINO_EVENT_WIFI_AP_STOP);
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t*, bool) {
+  pump();
+  hold(g_wt.beginCallMs);
+  if (g_sta != Sta::Idle) staDrop(kReasonLeave, WL_DISCONNECTED);
+  setMode(g_mode | WIFI_STA);
+  g_ws.begins++;
+  g_ssid = ssid ? ssid : "";
+  g_pass = passphrase ? passphrase : "";
+  g_chan = channel;
+  g_status = WL_DISCONNECTED;
+
+  // Outcome as things stand now; Joining checks again that the AP is up
+  g_ap = findAp(g_ssid);
+  const FakeAp* a = g_ap >= 0 ? &g_aps[g_ap] : nullptr;
+  if (!a || !a->up || (channel && channel != a->channel)) {
+    staFail(kReasonNoAp, g_wt.noApMs);
+  } else {
+    const uint32_t find = channel ? 0 : g_wt.findMs;
+    if (a->pass != g_pass) {
+      staFail(kReasonHandshake, find + g_wt.authFailMs);
+    } else {
+      g_sta = Sta::Joining;
+      g_staAt = millis() + find + g_wt.assocMs;
+    }
+  }
+  return g_status;
+}
+bool WiFiClass::config(IPAddress local_ip, IPAddress, IPAddress, IPAddress, IPAddress) {
+  g_staticIp = (uint32_t)local_ip;
+  return true;
+}
+bool WiFiClass::disconnect(bool wifioff, bool) {
+  pump();
+  hold(g_wt.discCallMs);
+  staDrop(kReasonLeave, WL_DISCONNECTED);
+  if (wifioff) setMode(g_mode & ~WIFI_STA);
+  return true;
+}
+bool WiFiClass::reconnect() { begin(g_ssid.c_str(), g_pass.c_str(), g_chan); return true; }
+wl_status_t WiFiClass::status() { pump(); return g_status; }
+IPAddress WiFiClass::localIP() {
+  if (g_sta != Sta::Up) return IPAddress();
+  return g_staticIp ? IPAddress(g_staticIp) : IPAddress(192, 168, 1, (uint8_t)(100 + g_ap));
+}
+IPAddress WiFiClass::gatewayIP() { return g_sta == Sta::Up ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { return g_sta == Sta::Up ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t) { return gatewayIP(); }
+String WiFiClass::SSID() const { return g_ssid; }
+int8_t WiFiClass::RSSI() { return g_sta == Sta::Up ? g_aps[g_ap].rssi : 0; }
+uint8_t* WiFiClass::BSSID(uint8_t* bssid) {
+  static uint8_t zero[6];
+  uint8_t* src = g_sta == Sta::Up ? g_aps[g_ap].bssid : zero;
+  if (!bssid) return src;
+  memcpy(bssid, src, 6);
+  return bssid;
+}
+int32_t WiFiClass::channel() { return g_sta == Sta::Up ? g_aps[g_ap].channel : 1; }
+bool WiFiClass::setAutoReconnect(bool) { return true; }
+bool WiFiClass::setSleep(bool) { return true; }
+void WiFiClass::persistent(bool) {}
+bool WiFiClass::setHostname(const char*) { return true; }
+
+bool WiFiClass::mode(int m) { pump(); setMode(m); return true; }
+int WiFiClass::getMode() { return g_mode; }
+
+bool WiFiClass::softAP(const char*, const char*, int, int, int, bool) {
+  pump();
+  hold(g_wt.apCallMs);
+  setMode(g_mode | WIFI_AP);
+  return true;
+}
+bool WiFiClass::softAPConfig(IPAddress, IPAddress, IPAddress, IPAddress) { return true; }
+bool WiFiClass::softAPdisconnect(bool) { setMode(g_mode & ~WIFI_AP); return true; }
+IPAddress WiFiClass::softAPIP() { return (g_mode & WIFI_AP) ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+uint8_t WiFiClass::softAPgetStationNum() { return (g_mode & WIFI_AP) ? g_apClients : 0; }
+
+int16_t WiFiClass::scanNetworks(bool async, bool, bool, uint32_t, uint8_t, const char*, const uint8_t*) {
+  pump();
+  // The driver refuses to scan while it is joining
+  if (g_sta == Sta::Joining || g_sta == Sta::Assoc) return WIFI_SCAN_FAILED;
+  hold(g_wt.scanCallMs);
+  setMode(g_mode | WIFI_STA);
+  g_ws.scans++;
+  g_scanRunning = true;
+  g_scanned = false;
+  g_scanAt = millis() + g_wt.scanMs;
+  if (async) return WIFI_SCAN_RUNNING;
+  hold(g_wt.scanMs);
+  pump();
+  return (int16_t)g_scanRes.size();
+}
+int16_t WiFiClass::scanComplete() {
+  pump();
+  if (g_scanRunning) return WIFI_SCAN_RUNNING;
+  return g_scanned ? (int16_t)g_scanRes.size() : WIFI_SCAN_FAILED;
+}
+void WiFiClass::scanDelete() { g_scanned = false; g_scanRes.clear(); }
+String WiFiClass::SSID(uint8_t i) { return i < g_scanRes.size() ? g_scanRes[i].ssid : String(); }
+int32_t WiFiClass::RSSI(uint8_t i) { return i < g_scanRes.size() ? g_scanRes[i].rssi : 0; }
+uint8_t* WiFiClass::BSSID(uint8_t i) { static uint8_t zero[6]; return i < g_scanRes.size() ? g_scanRes[i].bssid : zero; }
+int32_t WiFiClass::channel(uint8_t i) { return i < g_scanRes.size() ? g_scanRes[i].channel : 0; }
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) {
+  return (i < g_scanRes.size() && g_scanRes[i].pass.length()) ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cb, arduino_event_id_t event) {
+  g_events.emplace_back(cb, event);
+  return (wifi_event_id_t)g_events.size();
+}
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+  if (id && id <= g_events.size()) g_events[id - 1].first = [](arduino_event_id_t, arduino_event_info_t) {};
+}
+
+namespace Host {
+
+  void wifiTiming(const WifiTiming& t) { g_wt = t; }
+  const WifiTiming& wifiTiming() { return g_wt; }
+
+  void wifiAp(const char* ssid, const char* pass, int8_t rssi, uint8_t channel) {
+    pump();
+    int i = findAp(ssid);
+    if (i < 0) {
+      FakeAp a = {};
+      a.ssid = ssid;
+      i = (int)g_aps.size();
+      a.bssid[0] = 0x02;   // locally administered
+      a.bssid[5] = (uint8_t)(i + 1);
+      g_aps.push_back(a);
+    }
+    FakeAp& a = g_aps[i];
+    const bool moved = a.pass != pass || a.channel != channel;
+    a.pass = pass;
+    a.rssi = rssi;
+    a.channel = channel;
+    a.up = true;
+    if (moved && g_ap == i && (g_sta == Sta::Assoc || g_sta == Sta::Up)) staDrop(kReasonLeave, WL_CONNECTION_LOST);
+  }
+
+  void wifiApUp(const char* ssid, bool up) {
+    pump();
+    const int i = findAp(ssid);
+    if (i < 0) return;
+    g_aps[i].up = up;
+    if (g_ap != i || g_sta != Sta::Up) return;
+    if (!up && !g_lossAt) {
+      g_lossAt = millis() + g_wt.beaconLossMs;
+      if (!g_lossAt) g_lossAt = 1;
+    } else if (up) {
+      g_lossAt = 0;   // back before the beacon timeout
+    }
+  }
+
+  void wifiApClients(uint8_t n) { g_apClients = n; }
+  void wifiTick() { pump(); }
+  WifiStats wifiStats() { return g_ws; }
+  bool wifiApOn() { return (g_mode & WIFI_AP) != 0; }
+}
+
+static wifi_config_t g_staConfig;
+esp_err_t esp_wifi_get_config(wifi_interface_t, wifi_config_t* conf) { *conf = g_staConfig; return ESP_OK; }
+esp_err_t esp_wifi_set_config(wifi_interface_t, wifi_config_t* conf) { g_staConfig = *conf; return ESP_OK; }
+esp_err_t esp_wifi_set_max_tx_power(int8_t) { return ESP_OK; }
+
+// -------------- UDP / DNS / mDNS --------------
+uint8_t* AsyncUDPPacket::data() { return nullptr; }
+size_t AsyncUDPPacket::length() { return 0; }
+bool AsyncUDPPacket::isBroadcast() { return false; }
+bool AsyncUDPPacket::isMulticast() { return false; }
+IPAddress AsyncUDPPacket::localIP() { return IPAddress(); }
+uint16_t AsyncUDPPacket::localPort() { return 0; }
+IPAddress AsyncUDPPacket::remoteIP() { return IPAddress(); }
+uint16_t AsyncUDPPacket::remotePort() { return 0; }
+size_t AsyncUDPPacket::write(const uint8_t*, size_t len) { return len; }
+
+static bool g_udpOpen = false;
+bool AsyncUDP::listen(const IPAddress, uint16_t) { g_udpOpen = true; return true; }
+bool AsyncUDP::listen(uint16_t) { g_udpOpen = true; return true; }
+void AsyncUDP::close() { g_udpOpen = false; }
+bool AsyncUDP::connected() { return g_udpOpen; }
+void AsyncUDP::onPacket(AuPacketHandlerFunction) {}
+
+bool DNSServer::start(const uint16_t&, const String&, const IPAddress&) { return true; }
+void DNSServer::stop() {}
+void DNSServer::processNextRequest() {}
+
+bool MDNSResponder::begin(const char*) { return true; }
+void MDNSResponder::end() {}
+bool MDNSResponder::addService(const char*, const char*, uint16_t) { return true; }
+bool MDNSResponder::addServiceTxt(const char*, const char*, const char*, const char*) { return true; }
@@ -0,0 +1,217 @@
+// ESP-IDF pieces the OTA path uses: Update (into a file), the running
+// partition (from a file), ROM CRC32 and tinfl (zlib), mbedTLS SHA-256.
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/sha256.h>
+#include <rom/miniz.h>
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "host.h"
+
+UpdateClass Update;
+
+// -------------- Update --------------
+static FILE*       g_upd = nullptr;
+static size_t      g_updSize = 0, g_updWritten = 0;
+static bool        g_updDone = false;
+static const char* g_updErr = nullptr;
+
+bool UpdateClass::begin(size_t size, int command, int, uint8_t, const char*) {
+  if (g_upd) { g_updErr = "Already Running"; return false; }
+  g_upd = fopen(Host::config().updatePath, "wb");
+  if (!g_upd) { g_updErr = "Could Not Open"; return false; }
+  g_updSize = size;
+  g_updWritten = 0;
+  g_updDone = false;
+  g_updErr = nullptr;
+  Serial.printf("[Host] Update.begin(%s, %s) -> %s\n", size == UPDATE_SIZE_UNKNOWN ? "?" : String((unsigned long)size).c_str(),
+                command == U_SPIFFS ? "spiffs" : "app", Host::config().updatePath);
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+  if (!g_upd) { g_updErr = "Not Running"; return 0; }
+  if (g_updSize != UPDATE_SIZE_UNKNOWN && g_updWritten + len > g_updSize) { g_updErr = "Too Much Data"; return 0; }
+  const size_t n = fwrite(data, 1, len, g_upd);
+  g_updWritten += n;
+  if (n != len) g_updErr = "Flash Write Failed";
+  return n;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  if (!g_upd) { g_updErr = "Not Running"; return false; }
+  if (!evenIfRemaining && g_updSize != UPDATE_SIZE_UNKNOWN && g_updWritten != g_updSize) { g_updErr = "Size Mismatch"; abort(); return false; }
+  fclose(g_upd);
+  g_upd = nullptr;
+  g_updDone = true;
+  return true;
+}
+
+void UpdateClass::abort() {
+  if (g_upd) { fclose(g_upd); g_upd = nullptr; remove(Host::config().updatePath); }
+  if (!g_updErr) g_updErr = "Aborted";
+}
+
+void UpdateClass::printError(Print& out) { out.printf("[Host] Update error: %s\n", errorString()); }
+bool UpdateClass::hasError() { return g_updErr != nullptr; }
+uint8_t UpdateClass::getError() { return g_updErr ? 1 : 0; }
+const char* UpdateClass::errorString() { return g_updErr ? g_updErr : "No Error"; }
+size_t UpdateClass::progress() { return g_updWritten; }
+size_t UpdateClass::size() { return g_updSize; }
+size_t UpdateClass::remaining() { return g_updSize == UPDATE_SIZE_UNKNOWN ? 0 : g_updSize - g_updWritten; }
+bool UpdateClass::isRunning() { return g_upd != nullptr; }
+bool UpdateClass::isFinished() { return g_updDone; }
+
+// -------------- Partitions --------------
+// The running app slot is Host::Config::appImage, padded with erased flash
+static esp_partition_t g_app = { 0, 0x10, 0x10000, 0, "app0", false };
+
+const esp_partition_t* esp_ota_get_running_partition(void) {
+  struct stat st;
+  const char* img = Host::config().appImage;
+  if (!img || stat(img, &st) != 0) return nullptr;
+  g_app.size = ((uint32_t)st.st_size + 0xFFFF) & ~0xFFFFu;
+  return &g_app;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) { return nullptr; }
+
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t off, void* dst, size_t size) {
+  if (p != &g_app || off + size > p->size) return -1;
+  FILE* f = fopen(Host::config().appImage, "rb");
+  if (!f) return -1;
+  memset(dst, 0xFF, size);
+  fseek(f, (long)off, SEEK_SET);
+  const size_t n = fread(dst, 1, size, f);
+  (void)n;
+  fclose(f);
+  return ESP_OK;
+}
+
+// -------------- ROM CRC / inflate --------------
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len) {
+  return (uint32_t)crc32(crc, buf, len);
+}
+
+struct Inflater {
+  z_stream zs;
+  size_t   used;
+  uint8_t  arena[1];
+};
+
+static const size_t kArena = sizeof(((tinfl_decompressor*)0)->m_opaque) - offsetof(Inflater, arena);
+
+// zlib allocates from the decompressor itself; nothing to free
+static voidpf arenaAlloc(voidpf opaque, uInt items, uInt size) {
+  Inflater* s = static_cast<Inflater*>(opaque);
+  const size_t n = ((size_t)items * size + 15) & ~(size_t)15;
+  if (s->used + n > kArena) return Z_NULL;
+  void* p = s->arena + s->used;
+  s->used += n;
+  return p;
+}
+static void arenaFree(voidpf, voidpf) {}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* in, size_t* inSize, mz_uint8*,
+                              mz_uint8* outNext, size_t* outSize, const mz_uint32) {
+  Inflater* s = reinterpret_cast<Inflater*>(r->m_opaque);
+  if (r->m_state == 0) {
+    memset(&s->zs, 0, sizeof(s->zs));
+    s->used = 0;
+    s->zs.zalloc = arenaAlloc;
+    s->zs.zfree = arenaFree;
+    s->zs.opaque = s;
+    if (inflateInit2(&s->zs, -15) != Z_OK) return TINFL_STATUS_FAILED;
+    r->m_state = 1;
+  }
+  if (r->m_state == 2) { *inSize = *outSize = 0; return TINFL_STATUS_DONE; }
+
+  s->zs.next_in = const_cast<mz_uint8*>(in);
+  s->zs.avail_in = (uInt)*inSize;
+  s->zs.next_out = outNext;
+  s->zs.avail_out = (uInt)*outSize;
+  const int rc = inflate(&s->zs, Z_NO_FLUSH);
+  *inSize -= s->zs.avail_in;
+  *outSize -= s->zs.avail_out;
+  if (rc == Z_STREAM_END) { r->m_state = 2; return TINFL_STATUS_DONE; }
+  if (rc != Z_OK && rc != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+  return s->zs.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+// -------------- SHA-256 --------------
+static const uint32_t kK[64] = {
+  0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+  0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+  0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+  0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+  0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+  0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+  0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+  0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2,
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void shaBlock(uint32_t* st, const uint8_t* p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) w[i] = ((uint32_t)p[4*i] << 24) | ((uint32_t)p[4*i+1] << 16) | ((uint32_t)p[4*i+2] << 8) | p[4*i+3];
+  for (int i = 16; i < 64; ++i) {
+    const uint32_t s0 = ror(w[i-15], 7) ^ ror(w[i-15], 18) ^ (w[i-15] >> 3);
+    const uint32_t s1 = ror(w[i-2], 17) ^ ror(w[i-2], 19) ^ (w[i-2] >> 10);
+    w[i] = w[i-16] + s0 + w[i-7] + s1;
+  }
+  uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4], f = st[5], g = st[6], h = st[7];
+  for (int i = 0; i < 64; ++i) {
+    const uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + kK[i] + w[i];
+    const uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+  }
+  st[0] += a; st[1] += b; st[2] += c; st[3] += d; st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+  static const uint32_t kInit[8] = { 0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19 };
+  if (is224) return -1;
+  memcpy(ctx->state, kInit, sizeof(kInit));
+  ctx->total[0] = ctx->total[1] = 0;
+  ctx->is224 = 0;
+  return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* in, size_t len) {
+  size_t fill = ctx->total[0] & 63;
+  const uint32_t lo = ctx->total[0] + (uint32_t)len;
+  if (lo < ctx->total[0]) ctx->total[1]++;
+  ctx->total[0] = lo;
+  while (len) {
+    const size_t k = std::min(len, 64 - fill);
+    memcpy(ctx->buffer + fill, in, k);
+    fill += k; in += k; len -= k;
+    if (fill == 64) { shaBlock(ctx->state, ctx->buffer); fill = 0; }
+  }
+  return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char out[32]) {
+  const uint64_t bits = (((uint64_t)ctx->total[1] << 32) | ctx->total[0]) << 3;
+  size_t fill = ctx->total[0] & 63;
+  ctx->buffer[fill++] = 0x80;
+  if (fill > 56) { memset(ctx->buffer + fill, 0, 64 - fill); shaBlock(ctx->state, ctx->buffer); fill = 0; }
+  memset(ctx->buffer + fill, 0, 56 - fill);
+  for (int i = 0; i < 8; ++i) ctx->buffer[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+  shaBlock(ctx->state, ctx->buffer);
+  for (int i = 0; i < 8; ++i) {
+    out[4*i] = (uint8_t)(ctx->state[i] >> 24); out[4*i+1] = (uint8_t)(ctx->state[i] >> 16);
+    out[4*i+2] = (uint8_t)(ctx->state[i] >> 8); out[4*i+3] = (uint8_t)ctx->state[i];
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+// NVS in memory: one map per namespace, shared by every Preferences object
+// and gone when the process exits (as after an erase_flash).
+#include <Preferences.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Blob;
+static std::map<std::string, std::map<std::string, Blob>> g_nvs;
+static std::mutex g_mu;
+
+static const size_t kKeyMax = 15;   // NVS key length limit
+
+template <typename T>
+static size_t putT(const String& ns, bool ok, const char* key, const T& v) {
+  if (!ok || !key || strlen(key) > kKeyMax) return 0;
+  std::lock_guard<std::mutex> l(g_mu);
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+  g_nvs[ns.c_str()][key] = Blob(p, p + sizeof(T));
+  return sizeof(T);
+}
+
+template <typename T>
+static T getT(const String& ns, bool ok, const char* key, T def) {
+  if (!ok || !key) return def;
+  std::lock_guard<std::mutex> l(g_mu);
+  auto n = g_nvs.find(ns.c_str());
+  if (n == g_nvs.end()) return def;
+  auto k = n->second.find(key);
+  if (k == n->second.end() || k->second.size() != sizeof(T)) return def;
+  T v;
+  memcpy(&v, k->second.data(), sizeof(T));
+  return v;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+  if (!name || strlen(name) > kKeyMax) return false;
+  _ns = name;
+  _ro = readOnly;
+  _open = true;
+  return true;
+}
+
+void Preferences::end() { _open = false; }
+
+bool Preferences::clear() {
+  if (!_open || _ro) return false;
+  std::lock_guard<std::mutex> l(g_mu);
+  g_nvs.erase(_ns.c_str());
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_open || _ro || !key) return false;
+  std::lock_guard<std::mutex> l(g_mu);
+  return g_nvs[_ns.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  if (!_open || !key) return false;
+  std::lock_guard<std::mutex> l(g_mu);
+  auto n = g_nvs.find(_ns.c_str());
+  return n != g_nvs.end() && n->second.count(key);
+}
+
+size_t Preferences::putUChar(const char* k, uint8_t v)   { return putT(_ns, _open && !_ro, k, v); }
+size_t Preferences::putUShort(const char* k, uint16_t v) { return putT(_ns, _open && !_ro, k, v); }
+size_t Preferences::putInt(const char* k, int32_t v)     { return putT(_ns, _open && !_ro, k, v); }
+size_t Preferences::putUInt(const char* k, uint32_t v)   { return putT(_ns, _open && !_ro, k, v); }
+size_t Preferences::putULong(const char* k, uint32_t v)  { return putT(_ns, _open && !_ro, k, v); }
+size_t Preferences::putBool(const char* k, bool v)       { return putT(_ns, _open && !_ro, k, (uint8_t)v); }
+
+uint8_t  Preferences::getUChar(const char* k, uint8_t d)   { return getT(_ns, _open, k, d); }
+uint16_t Preferences::getUShort(const char* k, uint16_t d) { return getT(_ns, _open, k, d); }
+int32_t  Preferences::getInt(const char* k, int32_t d)     { return getT(_ns, _open, k, d); }
+uint32_t Preferences::getUInt(const char* k, uint32_t d)   { return getT(_ns, _open, k, d); }
+uint32_t Preferences::getULong(const char* k, uint32_t d)  { return getT(_ns, _open, k, d); }
+bool     Preferences::getBool(const char* k, bool d)       { return getT(_ns, _open, k, (uint8_t)d) != 0; }
+
+size_t Preferences::putString(const char* key, const char* value) {
+  return putBytes(key, value, value ? strlen(value) + 1 : 0) ? (value ? strlen(value) : 0) : 0;
+}
+
+size_t Preferences::putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!_open || _ro || !key || strlen(key) > kKeyMax || (!value && len)) return 0;
+  std::lock_guard<std::mutex> l(g_mu);
+  const uint8_t* p = static_cast<const uint8_t*>(value);
+  g_nvs[_ns.c_str()][key] = Blob(p, p + len);
+  return len;
+}
+
+String Preferences::getString(const char* key, String defaultValue) {
+  if (!_open || !key) return defaultValue;
+  std::lock_guard<std::mutex> l(g_mu);
+  auto n = g_nvs.find(_ns.c_str());
+  if (n == g_nvs.end()) return defaultValue;
+  auto k = n->second.find(key);
+  if (k == n->second.end() || k->second.empty() || k->second.back() != 0) return defaultValue;
+  return String((const char*)k->second.data());
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!_open || !key) return 0;
+  std::lock_guard<std::mutex> l(g_mu);
+  auto n = g_nvs.find(_ns.c_str());
+  if (n == g_nvs.end()) return 0;
+  auto k = n->second.find(key);
+  return k == n->second.end() ? 0 : k->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (!_open || !key || !buf) return 0;
+  std::lock_guard<std::mutex> l(g_mu);
+  auto n = g_nvs.find(_ns.c_str());
+  if (n == g_nvs.end()) return 0;
+  auto k = n->second.find(key);
+  if (k == n->second.end() || k->second.size() > maxLen) return 0;
+  memcpy(buf, k->second.data(), k->second.size());
+  return k->second.size();
+}
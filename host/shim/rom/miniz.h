@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+typedef unsigned char mz_uint8;
+typedef unsigned int mz_uint32;
+typedef enum { TINFL_STATUS_BAD_PARAM = -3, TINFL_STATUS_ADLER32_MISMATCH = -2, TINFL_STATUS_FAILED = -1, TINFL_STATUS_DONE = 0,
+               TINFL_STATUS_NEEDS_MORE_INPUT = 1, TINFL_STATUS_HAS_MORE_OUTPUT = 2 } tinfl_status;
+enum { TINFL_FLAG_PARSE_ZLIB_HEADER = 1, TINFL_FLAG_HAS_MORE_INPUT = 2, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4, TINFL_FLAG_COMPUTE_ADLER32 = 8 };
+#define TINFL_LZ_DICT_SIZE 32768
+// Host: zlib does the inflating; its state and 32 KB window live in m_opaque
+// (bigger than the ROM's ~11 KB), so free() on the struct releases it all.
+typedef struct tinfl_decompressor_tag { mz_uint32 m_state; alignas(16) uint8_t m_opaque[48 * 1024]; } tinfl_decompressor;
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size, mz_uint8* pOut_buf_start,
+                              mz_uint8* pOut_buf_next, size_t* pOut_buf_size, const mz_uint32 decomp_flags);
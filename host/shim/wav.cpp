@@ -0,0 +1,67 @@
+#include "wav.h"
+
+#include <Arduino.h>
+
+static void put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t* p, uint32_t v) { put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+
+// 44-byte PCM header; sizes are patched by finish()
+static void wavHeader(uint8_t* h, uint32_t rate, uint32_t dataBytes) {
+  memcpy(h, "RIFF", 4);      put32(h + 4, 36 + dataBytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put32(h + 16, 16);         put16(h + 20, 1);  put16(h + 22, 2);
+  put32(h + 24, rate);       put32(h + 28, rate * 4);
+  put16(h + 32, 4);          put16(h + 34, 16);
+  memcpy(h + 36, "data", 4); put32(h + 40, dataBytes);
+}
+
+bool WavWriter::open(const char* path, uint32_t rate) {
+  if (_f) {
+    if (rate != _rate)
+      Serial.printf("[Host] %u Hz clip in a %u Hz WAV: it will play at the wrong speed\n",
+                    (unsigned)rate, (unsigned)_rate);
+    return true;
+  }
+  _f = fopen(path, "wb");
+  if (!_f) { Serial.printf("[Host] cannot write %s\n", path); return false; }
+  uint8_t h[44];
+  wavHeader(h, rate, 0);
+  fwrite(h, 1, sizeof(h), _f);
+  _rate = rate;
+  _dataBytes = 0;
+  return true;
+}
+
+void WavWriter::write(const int16_t* lr, size_t frames) {
+  if (!_f) return;
+  uint8_t b[4 * 128];
+  while (frames) {
+    const size_t n = frames < 128 ? frames : 128;
+    for (size_t i = 0; i < n; ++i) {
+      put16(b + 4 * i, (uint16_t)lr[2 * i]);
+      put16(b + 4 * i + 2, (uint16_t)lr[2 * i + 1]);
+    }
+    fwrite(b, 4, n, _f);
+    _dataBytes += (uint32_t)(4 * n);
+    lr += 2 * n;
+    frames -= n;
+  }
+}
+
+void WavWriter::finish() {
+  if (!_f) return;
+  uint8_t h[44];
+  wavHeader(h, _rate, _dataBytes);
+  const long end = ftell(_f);
+  fseek(_f, 0, SEEK_SET);
+  fwrite(h, 1, sizeof(h), _f);
+  fseek(_f, end, SEEK_SET);
+  fflush(_f);
+}
+
+void WavWriter::close() {
+  if (!_f) return;
+  finish();
+  fclose(_f);
+  _f = nullptr;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// 16-bit stereo PCM WAV file, appended to across clips; the header is
+// patched with the running size on every finish().
+class WavWriter {
+public:
+  ~WavWriter() { close(); }
+
+  // Opens on the first call; later calls only warn on a rate change
+  bool open(const char* path, uint32_t rate);
+  void write(const int16_t* lr, size_t frames);
+  void finish();
+  void close();
+  bool isOpen() const { return _f != nullptr; }
+
+private:
+  FILE*    _f = nullptr;
+  uint32_t _rate = 0;
+  uint32_t _dataBytes = 0;
+};
@@ -0,0 +1,378 @@
+// Eject / playback simulator: replays a GPIO edge trace and API commands
+// through Eject (ISR debounce + refire guard) and AudioPlayer (one pending
+// command) on a virtual clock, and reports what was played or ignored and
+// how long after the edge the eject sound started.
+//
+//   host/build/ejectsim [options] TRACE
+//
+// TRACE lines (# starts a comment):
+//   <ms> low | high          eject line level (the ISR fires on high -> low)
+//   <ms> boot | eject | stop command, as from the web UI / API
+//   expect <key>=<n>         checked after each run; keys: the table's
+//                            columns, plus finished, failed, skipped
+// or a logic-analyzer CSV export: "<seconds>,<0|1>" per line, header
+// lines skipped.
+//
+// Each --debounce / --refire combination runs in its own process, from the
+// same start state, so one trace can be swept to pick the timings.
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host.h"
+#include "audio_player.h"
+#include "eject.h"
+#include "fs_worker.h"
+#include "led_stat.h"
+#include "sound_index.h"
+
+static const uint8_t kPin = 9;
+
+// -------------- Trace --------------
+enum class Kind : uint8_t { Low, High, Boot, EjectCmd, Stop };
+
+struct Ev {
+  uint64_t us;
+  Kind     kind;
+};
+
+struct Expect {
+  std::string key;
+  long        value;
+};
+
+static std::vector<Ev>     g_events;
+static std::vector<Expect> g_expects;
+
+static bool parseTrace(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); return false; }
+  char line[256];
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    if (char* h = strchr(line, '#')) *h = '\0';
+    char* p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p || *p == '\n' || *p == '\r') continue;
+
+    if (!strncmp(p, "expect", 6)) {
+      char key[32];
+      long v;
+      if (sscanf(p + 6, " %31[a-z_]=%ld", key, &v) != 2) {
+        fprintf(stderr, "%s:%d: expected \"expect key=n\"\n", path, lineNo);
+        fclose(f);
+        return false;
+      }
+      g_expects.push_back({ key, v });
+      continue;
+    }
+
+    char* end;
+    const double t = strtod(p, &end);
+    if (end == p) {
+      if (strchr(p, ',')) continue;   // CSV header
+      fprintf(stderr, "%s:%d: expected a time\n", path, lineNo);
+      fclose(f);
+      return false;
+    }
+    Ev ev;
+    if (*end == ',') {
+      ev.us = (uint64_t)(t * 1e6 + 0.5);
+      ev.kind = atoi(end + 1) ? Kind::High : Kind::Low;
+      g_events.push_back(ev);
+      continue;
+    }
+    char word[16] = {0};
+    sscanf(end, " %15s", word);
+    ev.us = (uint64_t)(t * 1000.0 + 0.5);
+    if      (!strcmp(word, "low")   || !strcmp(word, "0")) ev.kind = Kind::Low;
+    else if (!strcmp(word, "high")  || !strcmp(word, "1")) ev.kind = Kind::High;
+    else if (!strcmp(word, "boot"))  ev.kind = Kind::Boot;
+    else if (!strcmp(word, "eject")) ev.kind = Kind::EjectCmd;
+    else if (!strcmp(word, "stop"))  ev.kind = Kind::Stop;
+    else {
+      fprintf(stderr, "%s:%d: unknown event \"%s\"\n", path, lineNo, word);
+      fclose(f);
+      return false;
+    }
+    g_events.push_back(ev);
+  }
+  fclose(f);
+  // Stable: same-time events keep their file order
+  std::stable_sort(g_events.begin(), g_events.end(), [](const Ev& a, const Ev& b){ return a.us < b.us; });
+  return true;
+}
+
+// Silent MPEG-1 Layer III frames (44.1 kHz mono 128 kbps, empty side info):
+// both the stand-in and libmad decode them to the right length of silence
+static bool writeSilentMp3(const std::string& path, uint32_t ms) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) { perror(path.c_str()); return false; }
+  uint8_t frame[417] = { 0xFF, 0xFB, 0x90, 0xC0 };
+  const uint32_t frames = (uint32_t)((uint64_t)ms * 44100 / 1152 / 1000) + 1;
+  for (uint32_t i = 0; i < frames; ++i) fwrite(frame, 1, sizeof(frame), f);
+  fclose(f);
+  return true;
+}
+
+// -------------- Run --------------
+struct Counts {
+  long falls, taken, bounce, high, fires, held;
+  long played, apiPlayed, bootPlayed, cut, finished, dropped, failed, skipped;
+};
+
+static Counts   g_n;
+static uint64_t g_nowUs = 0;
+static bool     g_verbose = false;
+static bool     g_reqOpen = false;     // edge taken, not fired yet
+static bool     g_fireOpen = false;    // fired, eject sound not started yet
+static uint64_t g_reqUs = 0, g_firedReqUs = 0;
+// Eject reports the ISR's decisions on its next loop(); a taken edge is
+// timed from the first fall since the previous pass
+static uint64_t g_passFallUs = 0;
+static bool     g_passFall = false;
+static std::vector<uint64_t> g_latency;
+
+static const char* cmdName(AudioPlayer::Cmd c) {
+  switch (c) {
+    case AudioPlayer::Cmd::PlayBoot:  return "boot";
+    case AudioPlayer::Cmd::PlayEject: return "eject";
+    case AudioPlayer::Cmd::Stop:      return "stop";
+    default:                          return "-";
+  }
+}
+
+static void logEvent(const char* what, const char* detail) {
+  if (g_verbose) printf("  %10.3f  %-12s %s\n", g_nowUs / 1000.0, what, detail);
+}
+
+static void onEject(Eject::Event e) {
+  switch (e) {
+    case Eject::Event::Edge:
+      g_n.taken++;
+      if (!g_reqOpen) { g_reqOpen = true; g_reqUs = g_passFall ? g_passFallUs : g_nowUs; }
+      logEvent("edge", "taken");
+      break;
+    case Eject::Event::Bounce: g_n.bounce++; logEvent("edge", "ignored: debounce"); break;
+    case Eject::Event::High:   g_n.high++;   logEvent("edge", "ignored: line high"); break;
+    case Eject::Event::Held:   g_n.held++;   logEvent("held", "refire window"); break;
+    case Eject::Event::Fire:
+      g_n.fires++;
+      g_reqOpen = false;
+      g_firedReqUs = g_reqUs;
+      g_fireOpen = true;
+      logEvent("fire", "eject command");
+      break;
+  }
+}
+
+static void onAudio(AudioPlayer::Event e, AudioPlayer::Cmd c) {
+  char detail[48];
+  switch (e) {
+    case AudioPlayer::Event::Started:
+      if (c == AudioPlayer::Cmd::PlayEject && !g_fireOpen) {
+        g_n.apiPlayed++;
+        snprintf(detail, sizeof(detail), "eject, from the API");
+      } else if (c == AudioPlayer::Cmd::PlayEject) {
+        g_fireOpen = false;
+        g_n.played++;
+        g_latency.push_back(g_nowUs - g_firedReqUs);
+        snprintf(detail, sizeof(detail), "eject, %.3f ms after the edge", (g_nowUs - g_firedReqUs) / 1000.0);
+      } else {
+        g_n.bootPlayed++;
+        snprintf(detail, sizeof(detail), "%s", cmdName(c));
+      }
+      logEvent("play", detail);
+      break;
+    case AudioPlayer::Event::Interrupted: g_n.cut++;      logEvent("cut", cmdName(c)); break;
+    case AudioPlayer::Event::Finished:    g_n.finished++; logEvent("finished", cmdName(c)); break;
+    case AudioPlayer::Event::Dropped:     g_n.dropped++;  logEvent("dropped", cmdName(c)); break;
+    case AudioPlayer::Event::Failed:      g_n.failed++;   logEvent("failed", cmdName(c)); break;
+    case AudioPlayer::Event::Skipped:     g_n.skipped++;  logEvent("skipped", cmdName(c)); break;
+  }
+}
+
+static void advanceTo(uint64_t us) {
+  if (us > g_nowUs) { Host::advanceUs(us - g_nowUs); g_nowUs = us; }
+}
+
+static long countOf(const std::string& key) {
+  static const struct { const char* k; long Counts::* m; } kKeys[] = {
+    {"falls", &Counts::falls}, {"taken", &Counts::taken}, {"bounce", &Counts::bounce},
+    {"high", &Counts::high}, {"fires", &Counts::fires}, {"held", &Counts::held},
+    {"played", &Counts::played}, {"api", &Counts::apiPlayed}, {"boot", &Counts::bootPlayed}, {"cut", &Counts::cut},
+    {"finished", &Counts::finished}, {"dropped", &Counts::dropped}, {"failed", &Counts::failed},
+    {"skipped", &Counts::skipped},
+  };
+  for (const auto& k : kKeys) if (key == k.k) return g_n.*(k.m);
+  return -1;
+}
+
+struct Options {
+  const char* fsRoot = nullptr;
+  uint32_t loopUs = 1000;
+  uint32_t startMs = 5000;
+  uint32_t tailMs = 3000;
+};
+
+// Child process: one timing combination; exit status 1 if an expect failed
+static int runOne(const Options& o, long debounceMs, long refireMs) {
+  Host::Config cfg;
+  cfg.fsRoot = o.fsRoot;
+  cfg.serial = false;
+  Host::useVirtualClock();
+  Host::begin(cfg);
+  advanceTo((uint64_t)o.startMs * 1000);
+  const uint64_t t0 = g_nowUs;
+
+  SPIFFS.begin(true);
+  FsWorker::begin();
+  LedStat::begin();
+  {
+    FsWorker::Guard g;
+    SoundIndex::begin();
+  }
+  AudioPlayer::begin(12, 11, 10);
+  AudioPlayer::setObserver(onAudio);
+  Host::setPin(kPin, HIGH);
+  Eject::begin(kPin, true);
+  if (debounceMs < 0) debounceMs = Eject::debounceMs();
+  if (refireMs < 0) refireMs = Eject::refireMs();
+  Eject::setTiming(debounceMs, refireMs);
+  Eject::setObserver(onEject);
+
+  if (g_verbose) printf("debounce %ld ms, refire %ld ms:\n", debounceMs, refireMs);
+
+  const uint64_t endUs = t0 + (g_events.empty() ? 0 : g_events.back().us) + (uint64_t)o.tailMs * 1000;
+  uint64_t nextLoop = t0;
+  size_t i = 0;
+  while (true) {
+    const uint64_t nextEv = i < g_events.size() ? t0 + g_events[i].us : UINT64_MAX;
+    if (nextEv <= nextLoop) {
+      advanceTo(nextEv);
+      switch (g_events[i++].kind) {
+        case Kind::Low:
+          if (Host::pinLevel(kPin) == HIGH) {
+            g_n.falls++;
+            if (!g_passFall) { g_passFall = true; g_passFallUs = g_nowUs; }
+          }
+          Host::setPin(kPin, LOW);
+          break;
+        case Kind::High:     Host::setPin(kPin, HIGH); break;
+        case Kind::Boot:     logEvent("cmd", "boot");  AudioPlayer::playBoot();  break;
+        case Kind::EjectCmd: logEvent("cmd", "eject"); AudioPlayer::playEject(); break;
+        case Kind::Stop:     logEvent("cmd", "stop");  AudioPlayer::stop();      break;
+      }
+      continue;
+    }
+    if (nextLoop > endUs) break;
+    advanceTo(nextLoop);
+    AudioPlayer::loop();
+    Eject::loop();
+    g_passFall = false;
+    nextLoop += o.loopUs;
+  }
+
+  uint64_t lo = 0, hi = 0, sum = 0;
+  for (size_t k = 0; k < g_latency.size(); ++k) {
+    const uint64_t l = g_latency[k];
+    if (!k || l < lo) lo = l;
+    if (l > hi) hi = l;
+    sum += l;
+  }
+  printf("%8ld %6ld  %5ld %5ld %6ld %4ld  %5ld %4ld  %6ld %3ld %4ld %3ld %7ld",
+         debounceMs, refireMs, g_n.falls, g_n.taken, g_n.bounce, g_n.high,
+         g_n.fires, g_n.held, g_n.played, g_n.apiPlayed, g_n.bootPlayed, g_n.cut, g_n.dropped);
+  if (g_latency.empty()) printf("  %23s\n", "-");
+  else printf("  %7.3f %7.3f %7.3f\n", lo / 1000.0, sum / 1000.0 / g_latency.size(), hi / 1000.0);
+
+  int rc = 0;
+  for (const Expect& e : g_expects) {
+    const long got = countOf(e.key);
+    if (got == e.value) continue;
+    if (got < 0) printf("    unknown expect key \"%s\"\n", e.key.c_str());
+    else         printf("    FAIL expect %s=%ld, got %ld\n", e.key.c_str(), e.value, got);
+    rc = 1;
+  }
+  fflush(stdout);
+  return rc;
+}
+
+static std::vector<long> parseList(const char* s) {
+  std::vector<long> out;
+  for (char* end; *s; s = *end ? end + 1 : end) {
+    out.push_back(strtol(s, &end, 10));
+    if (end == s) break;
+  }
+  return out;
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: ejectsim [options] TRACE\n"
+    "  --debounce MS[,MS...]  ISR debounce to try (default: EJECT_DEBOUNCE_MS)\n"
+    "  --refire MS[,MS...]    refire window to try (default: EJECT_REFIRE_MS)\n"
+    "  --loop-us N            loop() period (default 1000)\n"
+    "  --boot-ms N            boot sound length (default 2000)\n"
+    "  --eject-ms N           eject sound length (default 1500)\n"
+    "  --start-ms N           uptime when the trace starts (default 5000)\n"
+    "  --tail-ms N            run on after the last event (default 3000)\n"
+    "  -v                     log every decision\n");
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  std::vector<long> debounces = { -1 }, refires = { -1 };
+  uint32_t bootMs = 2000, ejectMs = 1500;
+  const char* trace = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    if (!strcmp(a, "-v")) { g_verbose = true; continue; }
+    if (a[0] != '-') { trace = a; continue; }
+    const char* v = i + 1 < argc ? argv[++i] : nullptr;
+    if (!v) { usage(); return 2; }
+    if      (!strcmp(a, "--debounce")) debounces = parseList(v);
+    else if (!strcmp(a, "--refire"))   refires = parseList(v);
+    else if (!strcmp(a, "--loop-us"))  o.loopUs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--boot-ms"))  bootMs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--eject-ms")) ejectMs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--start-ms")) o.startMs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--tail-ms"))  o.tailMs = strtoul(v, nullptr, 10);
+    else { usage(); return 2; }
+  }
+  if (!trace || !o.loopUs || debounces.empty() || refires.empty()) { usage(); return 2; }
+  if (!parseTrace(trace)) return 2;
+
+  char dir[] = "/tmp/ejectsim-XXXXXX";
+  if (!mkdtemp(dir)) { perror("mkdtemp"); return 2; }
+  o.fsRoot = dir;
+  if (!writeSilentMp3(std::string(dir) + "/boot.mp3", bootMs) ||
+      !writeSilentMp3(std::string(dir) + "/eject.mp3", ejectMs)) return 2;
+
+  printf("%s: %zu events, loop every %u us, sounds %u/%u ms\n\n",
+         trace, g_events.size(), (unsigned)o.loopUs, (unsigned)bootMs, (unsigned)ejectMs);
+  printf("debounce refire  falls taken bounce high  fires held  played api boot cut dropped  latency ms min/avg/max\n");
+  int failed = 0;
+  for (long d : debounces) {
+    for (long r : refires) {
+      fflush(stdout);
+      const pid_t pid = fork();
+      if (pid == 0) _exit(runOne(o, d, r));
+      int st = 0;
+      waitpid(pid, &st, 0);
+      if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) failed++;
+    }
+  }
+  std::string rm = std::string("rm -rf ") + dir;
+  if (system(rm.c_str()) != 0) fprintf(stderr, "ejectsim: could not remove %s\n", dir);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,513 @@
+// Wi-Fi manager simulator: runs WiFiMgr::begin()/loop() against the
+// scripted radio in the shim (Host::wifiAp) on a virtual clock, and reports
+// time to the first IP, reconnect times, time in the setup portal and how
+// long each loop() pass blocked in driver calls.
+//
+//   host/build/wifisim [options] SCENARIO...
+//
+// SCENARIO lines (# starts a comment). Before boot:
+//   saved SSID [PASS]             network in NVS (up to 4, first is newest)
+//   cached SSID CHANNEL           last-link cache with a DHCP lease: boot
+//                                 takes the fast path
+//   ap SSID PASS RSSI CHANNEL     in range at boot ("-" for no password)
+//   ap_after S                    offline seconds before the setup AP
+//   timing key=ms ...             Host::WifiTiming fields, e.g. dhcp=1500
+//   run MS                        length (default: last event + 60 s)
+// Events, <ms> after WiFiMgr::begin():
+//   <ms> ap SSID PASS RSSI CHANNEL  add or change an access point
+//   <ms> down SSID | up SSID        router off / on
+//   <ms> clients N                  phones on the setup AP
+//   <ms> connect SSID [PASS]        as the portal page does (GET /connect)
+//   <ms> forget | portal            WiFiMgr::forgetWiFi() / restartPortal()
+// Checks, after the run (keys as in the table and -v summary):
+//   expect KEY <= | >= | = N
+//
+// Each scenario runs in its own process, so the firmware starts clean.
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <SPIFFS.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "host.h"
+#include "fs_worker.h"
+#include "led_stat.h"
+#include "wifimgr.h"
+
+// -------------- NVS seed --------------
+// Layout of WiFiMgr's "nets" and "fast" blobs (wifimgr.cpp). It ignores
+// blobs of another size; the run checks that the networks were loaded.
+struct SeedNet {
+  char     ssid[33];
+  char     pass[65];
+  uint8_t  okCount;
+  uint8_t  reserved;
+  uint32_t ip, gw, mask, dns;
+};
+struct SeedFast {
+  char     ssid[33];
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint8_t  valid;
+  uint32_t ip, gw, mask, dns;
+};
+
+// -------------- Scenario --------------
+enum class Kind : uint8_t { Ap, Down, Up, Clients, Connect, Forget, Portal };
+
+struct Ev {
+  uint64_t    ms;
+  Kind        kind;
+  std::string ssid, pass;
+  int         a = 0, b = 0;   // rssi, channel / client count
+};
+
+struct Expect {
+  std::string key, op;
+  double      value;
+  int         line;
+};
+
+struct Scenario {
+  std::vector<SeedNet> saved;
+  SeedFast             fast = {};
+  std::vector<Ev>      setupAps;
+  std::vector<Ev>      events;
+  std::vector<Expect>  expects;
+  Host::WifiTiming     timing;
+  long                 apAfterS = -1;
+  uint64_t             runMs = 0;
+};
+
+static const char* g_path = "";
+static int g_line = 0;
+
+static bool bad(const char* what) {
+  fprintf(stderr, "%s:%d: %s\n", g_path, g_line, what);
+  return false;
+}
+
+static bool setTiming(Host::WifiTiming& t, const char* key, uint32_t v) {
+  static const struct { const char* k; uint32_t Host::WifiTiming::* m; } kKeys[] = {
+    {"scan", &Host::WifiTiming::scanMs}, {"find", &Host::WifiTiming::findMs},
+    {"assoc", &Host::WifiTiming::assocMs}, {"dhcp", &Host::WifiTiming::dhcpMs},
+    {"auth_fail", &Host::WifiTiming::authFailMs}, {"no_ap", &Host::WifiTiming::noApMs},
+    {"beacon_loss", &Host::WifiTiming::beaconLossMs}, {"mode", &Host::WifiTiming::modeMs},
+    {"mode_call", &Host::WifiTiming::modeCallMs}, {"ap_call", &Host::WifiTiming::apCallMs},
+    {"begin_call", &Host::WifiTiming::beginCallMs}, {"disc_call", &Host::WifiTiming::discCallMs},
+    {"scan_call", &Host::WifiTiming::scanCallMs},
+  };
+  for (const auto& k : kKeys) if (!strcmp(key, k.k)) { t.*(k.m) = v; return true; }
+  return false;
+}
+
+// "ap SSID PASS RSSI CHANNEL" after the keyword
+static bool parseAp(const char* p, Ev& ev) {
+  char ssid[33], pass[65];
+  int rssi, ch;
+  if (sscanf(p, " %32s %64s %d %d", ssid, pass, &rssi, &ch) != 4) return bad("expected \"ap SSID PASS RSSI CHANNEL\"");
+  ev.kind = Kind::Ap;
+  ev.ssid = ssid;
+  ev.pass = strcmp(pass, "-") ? pass : "";
+  ev.a = rssi;
+  ev.b = ch;
+  return true;
+}
+
+static bool parseScenario(const char* path, Scenario& sc) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); return false; }
+  g_path = path;
+  g_line = 0;
+  char line[256];
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    g_line++;
+    if (char* h = strchr(line, '#')) *h = '\0';
+    char word[16] = {0};
+    int used = 0;
+    if (sscanf(line, " %15s%n", word, &used) != 1) continue;
+    const char* rest = line + used;
+
+    if (!strcmp(word, "saved")) {
+      SeedNet n = {};
+      char ssid[33], pass[65] = "";
+      if (sscanf(rest, " %32s %64s", ssid, pass) < 1) { ok = bad("expected \"saved SSID [PASS]\""); break; }
+      if (sc.saved.size() >= 4) { ok = bad("at most 4 saved networks"); break; }
+      strlcpy(n.ssid, ssid, sizeof(n.ssid));
+      strlcpy(n.pass, pass, sizeof(n.pass));
+      sc.saved.push_back(n);
+    } else if (!strcmp(word, "cached")) {
+      char ssid[33];
+      int ch;
+      if (sscanf(rest, " %32s %d", ssid, &ch) != 2) { ok = bad("expected \"cached SSID CHANNEL\""); break; }
+      strlcpy(sc.fast.ssid, ssid, sizeof(sc.fast.ssid));
+      sc.fast.channel = (uint8_t)ch;
+      sc.fast.valid = 1;
+      sc.fast.ip   = (uint32_t)IPAddress(192, 168, 1, 100);
+      sc.fast.gw   = (uint32_t)IPAddress(192, 168, 1, 1);
+      sc.fast.mask = (uint32_t)IPAddress(255, 255, 255, 0);
+      sc.fast.dns  = sc.fast.gw;
+    } else if (!strcmp(word, "ap")) {
+      Ev ev;
+      if (!(ok = parseAp(rest, ev))) break;
+      sc.setupAps.push_back(ev);
+    } else if (!strcmp(word, "ap_after")) {
+      sc.apAfterS = strtol(rest, nullptr, 10);
+    } else if (!strcmp(word, "run")) {
+      sc.runMs = strtoull(rest, nullptr, 10);
+    } else if (!strcmp(word, "timing")) {
+      char key[24];
+      unsigned v;
+      int n = 0;
+      for (const char* p = rest; sscanf(p, " %23[a-z_]=%u%n", key, &v, &n) == 2; p += n) {
+        if (!setTiming(sc.timing, key, v)) { ok = bad("unknown timing key"); break; }
+      }
+    } else if (!strcmp(word, "expect")) {
+      char key[24], op[3];
+      double v;
+      if (sscanf(rest, " %23[a-z_] %2[<>=] %lf", key, op, &v) != 3 ||
+          (strcmp(op, "<=") && strcmp(op, ">=") && strcmp(op, "="))) {
+        ok = bad("expected \"expect KEY <=|>=|= N\"");
+        break;
+      }
+      sc.expects.push_back({ key, op, v, g_line });
+    } else {
+      char* end;
+      const double t = strtod(word, &end);
+      if (end == word || *end) { ok = bad("unknown line"); break; }
+      char what[16] = {0};
+      int n = 0;
+      sscanf(rest, " %15s%n", what, &n);
+      const char* args = rest + n;
+      Ev ev;
+      ev.ms = (uint64_t)(t + 0.5);
+      char ssid[33] = "", pass[65] = "";
+      if (!strcmp(what, "ap")) {
+        if (!(ok = parseAp(args, ev))) break;
+      } else if (!strcmp(what, "down") || !strcmp(what, "up")) {
+        if (sscanf(args, " %32s", ssid) != 1) { ok = bad("expected an SSID"); break; }
+        ev.kind = what[0] == 'd' ? Kind::Down : Kind::Up;
+        ev.ssid = ssid;
+      } else if (!strcmp(what, "clients")) {
+        ev.kind = Kind::Clients;
+        ev.a = atoi(args);
+      } else if (!strcmp(what, "connect")) {
+        if (sscanf(args, " %32s %64s", ssid, pass) < 1) { ok = bad("expected \"connect SSID [PASS]\""); break; }
+        ev.kind = Kind::Connect;
+        ev.ssid = ssid;
+        ev.pass = pass;
+      } else if (!strcmp(what, "forget")) {
+        ev.kind = Kind::Forget;
+      } else if (!strcmp(what, "portal")) {
+        ev.kind = Kind::Portal;
+      } else {
+        ok = bad("unknown event");
+        break;
+      }
+      sc.events.push_back(ev);
+    }
+  }
+  fclose(f);
+  if (!ok) return false;
+  std::stable_sort(sc.events.begin(), sc.events.end(), [](const Ev& a, const Ev& b){ return a.ms < b.ms; });
+  if (!sc.runMs) sc.runMs = (sc.events.empty() ? 0 : sc.events.back().ms) + 60000;
+  return true;
+}
+
+// -------------- HTTP --------------
+// Runs one request through the registered handlers, as AsyncTCP would
+static int request(const char* url, const std::vector<std::pair<String, String>>& params, String* body) {
+  AsyncWebServer& s = WiFiMgr::getServer();
+  AsyncWebServerRequest r;
+  r._method = HTTP_GET;
+  r._url = url;
+  for (const auto& p : params) r._params.push_back(new AsyncWebParameter(p.first, p.second));
+  AsyncWebHandler* h = nullptr;
+  for (AsyncWebHandler* x : s._handlers) if (x->canHandle(&r)) { h = x; break; }
+  if (!h) return 404;
+  h->handleRequest(&r);
+  AsyncWebServerResponse* resp = r._response;
+  if (!resp) return 500;
+  while (!resp->_finished()) resp->_ack(&r, 1460, 0);
+  if (body) *body = resp->body().c_str();
+  return resp->code();
+}
+
+// -------------- Run --------------
+struct Metrics {
+  int64_t  firstIpMs = -1;      // begin() -> first IP
+  uint32_t links = 0;           // times connected
+  uint32_t drops = 0;           // times the link was lost
+  int64_t  reconnectMs = -1;    // longest link lost -> IP again
+  int64_t  afterUpMs = -1;      // longest router back -> IP
+  uint64_t offlineMs = 0;       // not connected, whole run
+  uint64_t portalMs = 0;        // setup AP up
+  uint32_t portals = 0;         // times it came up
+  uint32_t loops = 0;
+  uint64_t blockMaxUs = 0;      // driver calls inside one loop()
+  uint64_t blockSumUs = 0;
+  uint32_t slowLoops = 0;       // over --slow-ms
+  uint64_t cpuMaxUs = 0;        // host CPU inside one loop(), not device time
+};
+
+static Metrics g_m;
+static bool    g_verbose = false;
+static uint64_t g_t0 = 0;       // virtual us at begin()
+
+static uint64_t nowUs() { return (uint64_t)esp_timer_get_time(); }
+static double sinceBeginMs() { return (nowUs() - g_t0) / 1000.0; }
+
+static void note(const char* what, const char* detail) {
+  if (g_verbose) printf("  %10.1f  %-10s %s\n", sinceBeginMs(), what, detail);
+}
+
+// "-" for never
+static void fmtMs(char (&out)[24], int64_t v) {
+  if (v < 0) strcpy(out, "-");
+  else snprintf(out, sizeof(out), "%lld", (long long)v);
+}
+
+static double metric(const std::string& key, const Host::WifiStats& ws) {
+  if (key == "first_ip_ms")   return (double)g_m.firstIpMs;
+  if (key == "links")         return g_m.links;
+  if (key == "drops")         return g_m.drops;
+  if (key == "reconnect_ms")  return (double)g_m.reconnectMs;
+  if (key == "after_up_ms")   return (double)g_m.afterUpMs;
+  if (key == "offline_ms")    return (double)g_m.offlineMs;
+  if (key == "portal_ms")     return (double)g_m.portalMs;
+  if (key == "portals")       return g_m.portals;
+  if (key == "block_max_ms")  return g_m.blockMaxUs / 1000.0;
+  if (key == "block_sum_ms")  return g_m.blockSumUs / 1000.0;
+  if (key == "slow_loops")    return g_m.slowLoops;
+  if (key == "begins")        return ws.begins;
+  if (key == "scans")         return ws.scans;
+  return NAN;
+}
+
+struct Options {
+  const char* fsRoot = nullptr;
+  uint32_t loopUs = 1000;
+  uint32_t startMs = 1000;
+  uint32_t slowMs = 20;
+};
+
+static void applyEvent(const Ev& ev) {
+  char d[96];
+  switch (ev.kind) {
+    case Kind::Ap:
+      Host::wifiAp(ev.ssid.c_str(), ev.pass.c_str(), (int8_t)ev.a, (uint8_t)ev.b);
+      snprintf(d, sizeof(d), "%s ch %d rssi %d", ev.ssid.c_str(), ev.b, ev.a);
+      note("ap", d);
+      break;
+    case Kind::Down: Host::wifiApUp(ev.ssid.c_str(), false); note("router", (ev.ssid + " off").c_str()); break;
+    case Kind::Up:   Host::wifiApUp(ev.ssid.c_str(), true);  note("router", (ev.ssid + " on").c_str()); break;
+    case Kind::Clients:
+      Host::wifiApClients((uint8_t)ev.a);
+      snprintf(d, sizeof(d), "%d on the setup AP", ev.a);
+      note("clients", d);
+      break;
+    case Kind::Connect: {
+      const int code = request("/connect", { { "ssid", ev.ssid.c_str() }, { "pass", ev.pass.c_str() } }, nullptr);
+      snprintf(d, sizeof(d), "/connect %s -> %d", ev.ssid.c_str(), code);
+      note("portal", d);
+      break;
+    }
+    case Kind::Forget: WiFiMgr::forgetWiFi();   note("api", "forget"); break;
+    case Kind::Portal: WiFiMgr::restartPortal(); note("api", "portal"); break;
+  }
+}
+
+// Child process: one scenario; exit status 1 if an expect failed
+static int runOne(const Options& o, const char* path, const Scenario& sc) {
+  Host::Config cfg;
+  cfg.fsRoot = o.fsRoot;
+  cfg.serial = false;
+  Host::useVirtualClock();
+  Host::begin(cfg);
+  Host::advanceUs((uint64_t)o.startMs * 1000);
+  Host::wifiTiming(sc.timing);
+  for (const Ev& ev : sc.setupAps) Host::wifiAp(ev.ssid.c_str(), ev.pass.c_str(), (int8_t)ev.a, (uint8_t)ev.b);
+
+  Preferences prefs;
+  prefs.begin("wifi", false);
+  if (!sc.saved.empty()) prefs.putBytes("nets", sc.saved.data(), sc.saved.size() * sizeof(SeedNet));
+  if (sc.fast.valid) prefs.putBytes("fast", &sc.fast, sizeof(sc.fast));
+  if (sc.apAfterS >= 0) prefs.putUInt("ap_after", (uint32_t)sc.apAfterS);
+  prefs.end();
+
+  SPIFFS.begin(true);
+  FsWorker::begin();
+  LedStat::begin();
+  g_t0 = nowUs();
+  WiFiMgr::begin();
+
+  String st;
+  request("/api/wifi", {}, &st);
+  size_t loaded = 0;
+  for (int k = st.indexOf("\"ok\":"); k >= 0; k = st.indexOf("\"ok\":", k + 1)) loaded++;
+  if (loaded != sc.saved.size()) {
+    fprintf(stderr, "%s: WiFiMgr loaded %zu of %zu saved networks; the NVS layout in wifisim.cpp is out of date\n",
+            path, loaded, sc.saved.size());
+    return 1;
+  }
+
+  const uint64_t endUs = g_t0 + sc.runMs * 1000;
+  uint64_t nextLoop = g_t0;
+  size_t i = 0;
+  bool up = false, apOn = false;
+  uint64_t lastUs = g_t0, downAt = 0, routerUpAt = 0;
+  std::string state = WiFiMgr::stateName();
+  note("state", state.c_str());
+
+  while (nextLoop <= endUs) {
+    if (nextLoop > nowUs()) Host::advanceUs(nextLoop - nowUs());
+    Host::wifiTick();
+    for (; i < sc.events.size() && g_t0 + sc.events[i].ms * 1000 <= nowUs(); ++i) {
+      const Ev& ev = sc.events[i];
+      if (ev.kind == Kind::Up && !up) routerUpAt = nowUs();
+      applyEvent(ev);
+    }
+
+    const uint64_t v0 = nowUs();
+    const auto c0 = std::chrono::steady_clock::now();
+    WiFiMgr::loop();
+    const uint64_t cpuUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c0).count();
+    const uint64_t now = nowUs();
+    const uint64_t blockUs = now - v0;
+    g_m.loops++;
+    g_m.blockSumUs += blockUs;
+    g_m.blockMaxUs = std::max(g_m.blockMaxUs, blockUs);
+    g_m.cpuMaxUs = std::max(g_m.cpuMaxUs, cpuUs);
+    if (blockUs > (uint64_t)o.slowMs * 1000) {
+      g_m.slowLoops++;
+      char d[48];
+      snprintf(d, sizeof(d), "loop() held %.1f ms", blockUs / 1000.0);
+      note("slow", d);
+    }
+
+    // Time accounting since the last pass
+    if (!up) g_m.offlineMs += (now - lastUs) / 1000;
+    if (apOn) g_m.portalMs += (now - lastUs) / 1000;
+    lastUs = now;
+
+    const bool upNow = WiFiMgr::isConnected();
+    if (upNow && !up) {
+      g_m.links++;
+      if (g_m.firstIpMs < 0) g_m.firstIpMs = (int64_t)((now - g_t0) / 1000);
+      if (downAt) g_m.reconnectMs = std::max<int64_t>(g_m.reconnectMs, (int64_t)((now - downAt) / 1000));
+      if (routerUpAt) g_m.afterUpMs = std::max<int64_t>(g_m.afterUpMs, (int64_t)((now - routerUpAt) / 1000));
+      downAt = routerUpAt = 0;
+      char d[64];
+      snprintf(d, sizeof(d), "%s, %s", WiFi.SSID().c_str(), WiFi.localIP().toString().c_str());
+      note("online", d);
+    } else if (!upNow && up) {
+      g_m.drops++;
+      downAt = now;
+      note("offline", "");
+    }
+    up = upNow;
+
+    const bool apNow = Host::wifiApOn();
+    if (apNow && !apOn) { g_m.portals++; note("setup AP", "up"); }
+    if (!apNow && apOn) note("setup AP", "down");
+    apOn = apNow;
+
+    if (state != WiFiMgr::stateName()) {
+      state = WiFiMgr::stateName();
+      note("state", state.c_str());
+    }
+    nextLoop = std::max(nextLoop + o.loopUs, now);
+  }
+
+  const Host::WifiStats ws = Host::wifiStats();
+  char firstIp[24], reconnect[24], afterUp[24];
+  fmtMs(firstIp, g_m.firstIpMs);
+  fmtMs(reconnect, g_m.reconnectMs);
+  fmtMs(afterUp, g_m.afterUpMs);
+  const char* base = strrchr(path, '/');
+  printf("%-24.24s %8s %5u %5u %9s %8s %8llu %8llu %3u %6u %5u  %7.1f %7.1f %4u %6llu\n",
+         base ? base + 1 : path, firstIp, (unsigned)g_m.links, (unsigned)g_m.drops,
+         reconnect, afterUp, (unsigned long long)g_m.offlineMs,
+         (unsigned long long)g_m.portalMs, (unsigned)g_m.portals, (unsigned)ws.begins, (unsigned)ws.scans,
+         g_m.blockMaxUs / 1000.0, g_m.blockSumUs / 1000.0,
+         (unsigned)g_m.slowLoops, (unsigned long long)g_m.cpuMaxUs);
+
+  int rc = 0;
+  for (const Expect& e : sc.expects) {
+    const double got = metric(e.key, ws);
+    bool pass;
+    if      (std::isnan(got)) pass = false;
+    else if (e.op == "<=")    pass = got <= e.value;
+    else if (e.op == ">=")    pass = got >= e.value;
+    else                      pass = got == e.value;
+    if (pass) continue;
+    if (std::isnan(got)) printf("    %s:%d: unknown expect key \"%s\"\n", path, e.line, e.key.c_str());
+    else printf("    %s:%d: FAIL expect %s %s %g, got %g\n", path, e.line, e.key.c_str(), e.op.c_str(), e.value, got);
+    rc = 1;
+  }
+  fflush(stdout);
+  return rc;
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: wifisim [options] SCENARIO...\n"
+    "  --loop-us N    loop() period (default 1000)\n"
+    "  --start-ms N   uptime when WiFiMgr::begin() runs (default 1000)\n"
+    "  --slow-ms N    count loop() passes held longer (default 20)\n"
+    "  -v             log every transition\n");
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    if (!strcmp(a, "-v")) { g_verbose = true; continue; }
+    if (a[0] != '-') { files.push_back(a); continue; }
+    const char* v = i + 1 < argc ? argv[++i] : nullptr;
+    if (!v) { usage(); return 2; }
+    if      (!strcmp(a, "--loop-us"))  o.loopUs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--start-ms")) o.startMs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--slow-ms"))  o.slowMs = strtoul(v, nullptr, 10);
+    else { usage(); return 2; }
+  }
+  if (files.empty() || !o.loopUs) { usage(); return 2; }
+
+  std::vector<Scenario> scs(files.size());
+  for (size_t k = 0; k < files.size(); ++k) if (!parseScenario(files[k], scs[k])) return 2;
+
+  char dir[] = "/tmp/wifisim-XXXXXX";
+  if (!mkdtemp(dir)) { perror("mkdtemp"); return 2; }
+  o.fsRoot = dir;
+
+  printf("times in ms from WiFiMgr::begin(); loop() every %u us\n\n", (unsigned)o.loopUs);
+  printf("%-24s %8s %5s %5s %9s %8s %8s %8s %3s %6s %5s  %7s %7s %4s %6s\n",
+         "scenario", "first_ip", "links", "drops", "reconnect", "after_up", "offline", "portal", "#", "begins", "scans",
+         "blk_max", "blk_sum", "slow", "cpu_us");
+  int failed = 0;
+  for (size_t k = 0; k < files.size(); ++k) {
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) _exit(runOne(o, files[k], scs[k]));
+    int st = 0;
+    waitpid(pid, &st, 0);
+    if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) failed++;
+  }
+  std::string rm = std::string("rm -rf ") + dir;
+  if (system(rm.c_str()) != 0) fprintf(stderr, "wifisim: could not remove %s\n", dir);
+  return failed ? 1 : 0;
+}
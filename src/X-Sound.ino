@@ -12,6 +12,13 @@
 #include "wifimgr.h"
 #include "fileman.h"
 #include "audio_player.h"
+#include "fs_worker.h"
+#include "diag.h"
+#include "loop_prof.h"
+#include "audio_out.h"
+#include "bench.h"
+#include "eject.h"
+#include "trace.h"
 
 // ======================== Board/Pins ========================
 #ifndef I2S_PIN_BCLK
@@ -29,8 +36,6 @@
 #endif
 
 #define USE_INTERNAL_PULLUP_FOR_EJECT  1
-#define EJECT_DEBOUNCE_MS  120
-#define EJECT_REFIRE_MS    800
 
 // ======================== mDNS ========================
 static const char* HOSTNAME = "xsound";
@@ -72,18 +77,6 @@ static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
   }
 }
 
-// ======================== Eject ISR ========================
-volatile bool g_wantEject = false;
-static unsigned long g_lastEjectEdge = 0;
-static unsigned long g_lastEjectFire = 0;
-
-void IRAM_ATTR onEjectEdge() {
-  const unsigned long now = millis();
-  if (now - g_lastEjectEdge < EJECT_DEBOUNCE_MS) return;
-  g_lastEjectEdge = now;
-  if (digitalRead(PIN_EJECT_SENSE) == LOW) g_wantEject = true;
-}
-
 // ======================== Setup/Loop ========================
 void setup() {
   Serial.begin(115200);
@@ -93,6 +86,7 @@ void setup() {
 
   // ---- Base services ----
   SPIFFS.begin(true);
+  FsWorker::begin();
   LedStat::begin();
 
   // ---- Audio before FileMan ----
@@ -100,14 +94,14 @@ void setup() {
 
   // ---- File manager (routes /files etc.) ----
   FileMan::begin();
+  Diag::begin();
+  LoopProf::begin();
+  AudioOut::begin();
+  Bench::begin();
+  Trace::begin();
 
-  // ---- Eject button ----
-  #if USE_INTERNAL_PULLUP_FOR_EJECT
-    pinMode(PIN_EJECT_SENSE, INPUT_PULLUP);
-  #else
-    pinMode(PIN_EJECT_SENSE, INPUT);
-  #endif
-  attachInterrupt(digitalPinToInterrupt(PIN_EJECT_SENSE), onEjectEdge, FALLING);
+  // ---- Eject button (debounce / refire in eject.cpp) ----
+  Eject::begin(PIN_EJECT_SENSE, USE_INTERNAL_PULLUP_FOR_EJECT);
 
   // ---- Play boot sound before WiFi brings up tasks ----
   delay(150);
@@ -122,17 +116,12 @@ void setup() {
 }
 
 void loop() {
-  AudioPlayer::loop();
-  WiFiMgr::loop();
-  LedStat::loop();
-
-  // EJECT handling with refire guard
-  const unsigned long now = millis();
-  if (g_wantEject && (now - g_lastEjectFire > EJECT_REFIRE_MS)) {
-    g_wantEject = false;
-    g_lastEjectFire = now;
-    AudioPlayer::playEject();
-  }
+  XS_LOOP_FRAME();  // per-subsystem timing at /api/loopstats
+
+  { XS_PROF(Audio); AudioPlayer::loop(); Bench::loop(); }
+  { XS_PROF(WiFi);  WiFiMgr::loop();     }
+  { XS_PROF(Led);   LedStat::loop();     }
+  { XS_PROF(Eject); Eject::loop();       }
 
-  if (!g_mdnsStarted) startMDNSIfNeeded();
+  if (!g_mdnsStarted) { XS_PROF(Mdns); startMDNSIfNeeded(); }
 }
@@ -0,0 +1,270 @@
+#include "audio_out.h"
+
+#include <AudioOutput.h>
+#include <AudioOutputI2S.h>
+#include <ESPAsyncWebServer.h>
+
+#include <atomic>
+#include <new>
+
+#include "wifimgr.h"
+#include "web_json.h"
+#include "trace.h"
+
+// Frames the DMA ring holds: ESP8266Audio's I2S default of 8 buffers x 128
+#ifndef XS_AUDIO_RING_FRAMES
+  #define XS_AUDIO_RING_FRAMES 1024
+#endif
+// Sink: drain at the sample rate (1) or take samples as fast as the
+// decoder makes them (0, for decode-speed runs)
+#ifndef XS_AUDIO_SINK_PACED
+  #define XS_AUDIO_SINK_PACED 1
+#endif
+
+static const size_t  kTapFrames = 128;
+static const uint8_t kClipLog = 8;
+static const uint8_t kUnderrunLog = 16;
+
+struct ClipRec {
+  uint32_t atMs;
+  uint32_t startUs;
+  uint32_t audioMs;
+  uint32_t wallMs;
+  uint16_t underruns;
+  uint32_t underrunUs;
+};
+
+struct UnderrunRec {
+  uint32_t atMs;
+  uint32_t gapUs;
+};
+
+// Written by the loop task, read by the web task: a reply may be one
+// sample stale, as for the loop profiler
+static AudioOut::Stats g_stats = {};
+static ClipRec     g_clips[kClipLog];
+static uint8_t     g_clipNext = 0;
+static UnderrunRec g_under[kUnderrunLog];
+static uint8_t     g_underNext = 0;
+static std::atomic<bool> g_resetReq{false};
+
+static AudioOut::Tap g_tap = nullptr;
+static void*         g_tapCtx = nullptr;
+
+static void resetStats() {
+  const AudioOut::Backend b = g_stats.backend;
+  g_stats = {};
+  g_stats.backend = b;
+  memset(g_clips, 0, sizeof(g_clips));
+  memset(g_under, 0, sizeof(g_under));
+  g_clipNext = g_underNext = 0;
+}
+
+// -------------- Meter --------------
+// Keeps, in 16.16 fixed-point microseconds, the time at which the ring
+// would run dry given every frame accepted since _t0. A sample arriving
+// later than that is an underrun; the sink refuses samples while the ring
+// is more than XS_AUDIO_RING_FRAMES ahead.
+class MeteredOutput : public AudioOutput {
+public:
+  MeteredOutput(AudioOutput* hw) : _hw(hw) {}
+  ~MeteredOutput() override { delete _hw; }
+
+  bool SetRate(int hz) override {
+    hertz = hz;
+    _stepQ = hz > 0 ? (uint32_t)((1000000ULL << 16) / (uint32_t)hz) : 0;
+    return _hw ? _hw->SetRate(hz) : true;
+  }
+  bool SetBitsPerSample(int bits) override { bps = bits; return _hw ? _hw->SetBitsPerSample(bits) : true; }
+  bool SetChannels(int ch) override { channels = ch; return _hw ? _hw->SetChannels(ch) : true; }
+  bool SetGain(float f) override { AudioOutput::SetGain(f); return _hw ? _hw->SetGain(f) : true; }
+
+  bool begin() override {
+    if (g_resetReq.exchange(false)) resetStats();
+    _beginUs = micros();
+    _started = false;
+    _clipFrames = 0;
+    _clipUnder = 0;
+    _clipUnderUs = 0;
+    _tapLen = 0;
+    g_stats.rate = hertz;
+    g_stats.clips++;
+    return _hw ? _hw->begin() : true;
+  }
+
+  bool ConsumeSample(int16_t sample[2]) override {
+    const uint32_t now = micros();
+    if (!_started) {
+      _started = true;
+      _firstUs = _t0 = now;
+      _emptyQ = 0;
+      g_stats.startUs = now - _beginUs;
+    }
+    const uint64_t elQ = (uint64_t)(now - _t0) << 16;
+    if (elQ > _emptyQ + _stepQ) {
+      noteUnderrun(now, (uint32_t)((elQ - _emptyQ) >> 16));
+    } else if (!_hw && XS_AUDIO_SINK_PACED && _emptyQ > elQ + (uint64_t)_stepQ * XS_AUDIO_RING_FRAMES) {
+      g_stats.refused++;
+      TRACE_INSTANT("i2s_full", 0);
+      return false;
+    }
+
+    if (_hw) {
+      if (!_hw->ConsumeSample(sample)) { TRACE_INSTANT("i2s_full", 0); return false; }
+    } else if (g_tap) {
+      int16_t s[2] = { sample[0], sample[1] };
+      MakeSampleStereo16(s);
+      _tapBuf[2 * _tapLen]     = Amplify(s[0]);
+      _tapBuf[2 * _tapLen + 1] = Amplify(s[1]);
+      if (++_tapLen == kTapFrames) flushTap();
+    }
+    _emptyQ += _stepQ;
+    _clipFrames++;
+    g_stats.frames++;
+    return true;
+  }
+
+  void flush() override { if (_hw) _hw->flush(); }
+  bool loop() override { return _hw ? _hw->loop() : true; }
+
+  bool stop() override {
+    flushTap();
+    if (_started) {
+      ClipRec& c = g_clips[g_clipNext];
+      g_clipNext = (g_clipNext + 1) % kClipLog;
+      c.atMs = millis();
+      c.startUs = g_stats.startUs;
+      c.audioMs = hertz ? (uint32_t)(_clipFrames * 1000ULL / hertz) : 0;
+      c.wallMs = (micros() - _firstUs) / 1000;
+      c.underruns = _clipUnder;
+      c.underrunUs = _clipUnderUs;
+      g_stats.audioMs = c.audioMs;
+      g_stats.wallMs = c.wallMs;
+      _started = false;
+    }
+    return _hw ? _hw->stop() : true;
+  }
+
+private:
+  void noteUnderrun(uint32_t now, uint32_t gapUs) {
+    TRACE_INSTANT("audio_underrun", gapUs);
+    g_stats.underruns++;
+    g_stats.underrunUs += gapUs;
+    _clipUnder++;
+    _clipUnderUs += gapUs;
+    UnderrunRec& u = g_under[g_underNext];
+    g_underNext = (g_underNext + 1) % kUnderrunLog;
+    u.atMs = millis();
+    u.gapUs = gapUs;
+    _t0 = now;
+    _emptyQ = 0;
+  }
+
+  void flushTap() {
+    if (_tapLen && g_tap) g_tap(g_tapCtx, _tapBuf, _tapLen, hertz);
+    _tapLen = 0;
+  }
+
+  AudioOutput* _hw;              // nullptr: sink
+  uint32_t _stepQ = 0;           // one frame, 16.16 us
+  uint32_t _beginUs = 0, _firstUs = 0, _t0 = 0;
+  uint64_t _emptyQ = 0;          // ring runs dry at _t0 + this
+  bool     _started = false;
+  uint64_t _clipFrames = 0;
+  uint16_t _clipUnder = 0;
+  uint32_t _clipUnderUs = 0;
+  int16_t  _tapBuf[2 * kTapFrames];
+  size_t   _tapLen = 0;
+};
+
+// -------------- REST --------------
+static void handleStats(AsyncWebServerRequest* req) {
+  const AudioOut::Stats s = g_stats;
+  WebJson::Reply j;
+  j.beginObject()
+   .kv("backend", AudioOut::name(s.backend))
+   .kv("rate", s.rate)
+   .kv("ring_frames", (uint32_t)XS_AUDIO_RING_FRAMES)
+   .kv("clips", s.clips)
+   .kv("frames", s.frames)
+   .kv("underruns", s.underruns)
+   .kv("underrun_us", s.underrunUs)
+   .kv("refused", s.refused);
+  j.key("last").beginObject()
+   .kv("start_us", s.startUs)
+   .kv("audio_ms", s.audioMs)
+   .kv("wall_ms", s.wallMs)
+   .kv("rtf", s.wallMs ? (double)s.audioMs / (double)s.wallMs : 0.0, 3)
+   .endObject();
+
+  // Oldest first
+  j.key("history").beginArray();
+  for (uint8_t k = 0; k < kClipLog; ++k) {
+    const ClipRec& c = g_clips[(g_clipNext + k) % kClipLog];
+    if (!c.atMs) continue;
+    j.beginObject()
+     .kv("at_ms", c.atMs)
+     .kv("start_us", c.startUs)
+     .kv("audio_ms", c.audioMs)
+     .kv("wall_ms", c.wallMs)
+     .kv("underruns", c.underruns)
+     .kv("underrun_us", c.underrunUs)
+     .endObject();
+  }
+  j.endArray();
+  j.key("underrun_log").beginArray();
+  for (uint8_t k = 0; k < kUnderrunLog; ++k) {
+    const UnderrunRec& u = g_under[(g_underNext + k) % kUnderrunLog];
+    if (!u.atMs) continue;
+    j.beginObject().kv("at_ms", u.atMs).kv("gap_us", u.gapUs).endObject();
+  }
+  j.endArray();
+  j.endObject();
+  j.send(req);
+
+  if (req->hasParam("reset")) g_resetReq.store(true);
+}
+
+// -------------- Public --------------
+namespace AudioOut {
+
+  AudioOutput* create(Backend b, const Pins& pins) {
+    AudioOutputI2S* hw = nullptr;
+    switch (b) {
+      case Backend::I2S: hw = new (std::nothrow) AudioOutputI2S(); break;
+      // The I2S peripheral's own PDM TX modulates; nothing extra on the CPU
+      case Backend::Pdm: hw = new (std::nothrow) AudioOutputI2S(0, AudioOutputI2S::INTERNAL_PDM); break;
+      case Backend::Sink: break;
+    }
+    if (b != Backend::Sink) {
+      if (!hw) return nullptr;
+      hw->SetPinout(pins.bclk, pins.lrck, pins.dout);
+    }
+    MeteredOutput* m = new (std::nothrow) MeteredOutput(hw);
+    if (!m) { delete hw; return nullptr; }
+    g_stats.backend = b;
+    Serial.printf("[AudioOut] %s output\n", name(b));
+    return m;
+  }
+
+  const char* name(Backend b) {
+    switch (b) {
+      case Backend::I2S:  return "i2s";
+      case Backend::Pdm:  return "pdm";
+      case Backend::Sink: return "sink";
+    }
+    return "?";
+  }
+
+  void setTap(Tap tap, void* ctx) {
+    g_tapCtx = ctx;
+    g_tap = tap;
+  }
+
+  Stats stats() { return g_stats; }
+
+  void begin() {
+    AsyncWebServer& server = WiFiMgr::getServer();
+    server.on("/api/audio/out", HTTP_GET, [](AsyncWebServerRequest* r){ handleStats(r); });
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+
+class AudioOutput;
+
+// Audio output backends for AudioPlayer. Each one is an ESP8266Audio
+// AudioOutput wrapped in a meter that models the DMA ring: it counts
+// underruns (the ring ran dry mid-clip) and times every clip, so real-time
+// factor and glitches can be measured on any backend. GET /api/audio/out
+// reports it; ?reset=1 clears after reporting.
+//   I2S   external I2S DAC/amplifier on BCLK/LRCK/DOUT
+//   Pdm   I2S peripheral in PDM TX mode: 1-bit stream on DOUT, clock on
+//         LRCK, for boards with only an RC filter and a transistor, no amp
+//   Sink  no hardware: samples drain at the sample rate as the DMA would
+//         and go to the tap (host WAV file) or nowhere
+namespace AudioOut {
+
+  enum class Backend : uint8_t { I2S = 0, Pdm, Sink };
+
+  struct Pins {
+    int bclk;
+    int lrck;
+    int dout;
+  };
+
+  // nullptr if out of memory
+  AudioOutput* create(Backend b, const Pins& pins);
+  const char* name(Backend b);
+
+  // Sink only: receives each block of 16-bit stereo samples as played
+  // (after gain), from the loop task
+  typedef void (*Tap)(void* ctx, const int16_t* lr, size_t frames, uint32_t rate);
+  void setTap(Tap tap, void* ctx);
+
+  struct Stats {
+    Backend  backend;
+    uint32_t rate;
+    uint32_t clips;          // begin() calls
+    uint64_t frames;         // frames accepted, all clips
+    uint32_t underruns;      // times the ring ran dry mid-clip
+    uint32_t underrunUs;     // total silence they caused
+    uint32_t refused;        // samples refused because the ring was full
+    // Latest clip
+    uint32_t startUs;        // begin() to first sample (decoder start-up)
+    uint32_t audioMs;        // audio length written
+    uint32_t wallMs;         // first sample to stop()
+  };
+  Stats stats();
+
+  // Registers the route on the shared server
+  void begin();
+}
@@ -5,19 +5,42 @@
 #include <SPIFFS.h>
 #include <AudioFileSourceFS.h>
 #include <AudioGeneratorMP3.h>
-#include <AudioOutputI2S.h>
+#include <AudioOutput.h>
 
 #include "led_stat.h"
 #include "wifimgr.h"   // NEW: query WiFiMgr::isConnected() for LED idle state
+#include "fs_worker.h"
+#include "sound_index.h"
+#include "diag.h"
+#include "trace.h"
+#include "audio_out.h"
+
+// Output backend (AudioOut::Backend): 0 I2S DAC, 1 PDM on DOUT, 2 sink
+#ifndef XS_AUDIO_OUT
+  #define XS_AUDIO_OUT 0
+#endif
 
 // Default sound paths (match FileMan)
 static const char* kBootPath  = "/boot.mp3";
 static const char* kEjectPath = "/eject.mp3";
 
+// SPIFFS source that takes the FS worker's flash lock around each access,
+// so playback reads never interleave with a web upload/delete mid-operation.
+class LockedFileSource : public AudioFileSourceFS {
+public:
+  LockedFileSource() : AudioFileSourceFS(SPIFFS) {}
+  ~LockedFileSource() override { close(); }
+
+  bool open(const char* filename) override { FsWorker::Guard g; return AudioFileSourceFS::open(filename); }
+  uint32_t read(void* data, uint32_t len) override { FsWorker::Guard g; return AudioFileSourceFS::read(data, len); }
+  bool seek(int32_t pos, int dir) override { FsWorker::Guard g; return AudioFileSourceFS::seek(pos, dir); }
+  bool close() override { FsWorker::Guard g; return AudioFileSourceFS::close(); }
+};
+
 // Audio objects (owned by the main loop only)
-static AudioFileSourceFS* fileSrc = nullptr;
+static LockedFileSource*  fileSrc = nullptr;
 static AudioGeneratorMP3* mp3     = nullptr;
-static AudioOutputI2S*    out     = nullptr;
+static AudioOutput*       out     = nullptr;
 
 // I2S pin config (from begin)
 static int g_bclk = -1, g_lrck = -1, g_dout = -1;
@@ -32,6 +55,14 @@ static bool g_ejectEnabled = true;
 // --- Single-threaded command handoff ---
 static volatile AudioPlayer::Cmd g_pendingCmd = AudioPlayer::Cmd::None;
 
+// Command whose clip is playing (None when idle)
+static AudioPlayer::Cmd g_currentCmd = AudioPlayer::Cmd::None;
+static AudioPlayer::Observer g_observer = nullptr;
+
+static void notify(AudioPlayer::Event e, AudioPlayer::Cmd c) {
+  if (g_observer) g_observer(e, c);
+}
+
 // Map 0..255 -> a linear-ish gain (0.0 .. ~1.0)
 static float volToGain(uint8_t v) {
   return (float)v * (1.0f / 255.0f);
@@ -48,6 +79,11 @@ static void setIdleLedByWifi() {
 
 // Internal: cleanup after stop/end/error (loop-thread only)
 static void cleanupPlayer() {
+  XS_HEAP_SCOPE(Audio);
+  if (g_currentCmd != AudioPlayer::Cmd::None) {
+    notify(AudioPlayer::Event::Interrupted, g_currentCmd);
+    g_currentCmd = AudioPlayer::Cmd::None;
+  }
   if (mp3) {
     mp3->stop();
     delete mp3; mp3 = nullptr;
@@ -61,14 +97,21 @@ static void cleanupPlayer() {
 // Internal: start playback of a path (loop-thread only)
 static bool startPlayPath(const char* path) {
   cleanupPlayer();
+  XS_HEAP_SCOPE(Audio);  // decoder buffers are allocated inside the library
 
-  if (!SPIFFS.exists(path)) {
+  // Index lookup: no flash access for a missing slot
+  if (!SoundIndex::exists(path)) {
     LedStat::setStatus(LedStatus::Error);
     return false;
   }
 
-  fileSrc = new AudioFileSourceFS(SPIFFS, path);
+  fileSrc = new LockedFileSource();
   if (!fileSrc) { LedStat::setStatus(LedStatus::Error); return false; }
+  if (!fileSrc->open(path)) {
+    delete fileSrc; fileSrc = nullptr;
+    LedStat::setStatus(LedStatus::Error);
+    return false;
+  }
 
   mp3 = new AudioGeneratorMP3();
   if (!mp3) { delete fileSrc; fileSrc = nullptr; LedStat::setStatus(LedStatus::Error); return false; }
@@ -84,6 +127,15 @@ static bool startPlayPath(const char* path) {
   return true;
 }
 
+static void startClip(const char* path, AudioPlayer::Cmd c) {
+  if (startPlayPath(path)) {
+    g_currentCmd = c;
+    notify(AudioPlayer::Event::Started, c);
+  } else {
+    notify(AudioPlayer::Event::Failed, c);
+  }
+}
+
 // ---- Public API ----
 namespace AudioPlayer {
 
@@ -92,9 +144,9 @@ void begin(int bclkPin, int lrclkPin, int doutPin) {
 
   SPIFFS.begin(true);
 
-  out = new AudioOutputI2S();
+  XS_HEAP_SCOPE(Audio);
+  out = AudioOut::create((AudioOut::Backend)XS_AUDIO_OUT, AudioOut::Pins{ g_bclk, g_lrck, g_dout });
   if (out) {
-    out->SetPinout(g_bclk, g_lrck, g_dout);
     out->SetChannels(1);
     out->SetGain(volToGain(g_vol));
   }
@@ -128,10 +180,15 @@ void setEjectEnabled(bool enabled) {
 
 // --- Command helpers: enqueue only; loop() does the work ---
 bool enqueue(Cmd c) {
+  TRACE_INSTANT("audio_enqueue", (uint8_t)c);
+  const Cmd prev = g_pendingCmd;
   g_pendingCmd = c;
+  if (prev != Cmd::None) notify(Event::Dropped, prev);
   return true;
 }
 
+void setObserver(Observer fn) { g_observer = fn; }
+
 bool playBoot()  { return enqueue(Cmd::PlayBoot); }
 bool playEject() { return enqueue(Cmd::PlayEject); }
 bool stop()      { return enqueue(Cmd::Stop);     }
@@ -140,7 +197,14 @@ bool stop()      { return enqueue(Cmd::Stop);     }
 void loop() {
   // 1) If currently playing, drive the decoder
   if (mp3 && out && fileSrc) {
-    if (!mp3->loop()) {
+    bool running;
+    {
+      TRACE_SCOPE("mp3_loop");
+      running = mp3->loop();
+    }
+    if (!running) {
+      notify(Event::Finished, g_currentCmd);
+      g_currentCmd = Cmd::None;
       cleanupPlayer();
       setIdleLedByWifi();  // ✔ when playback ends, reflect current Wi-Fi status
     }
@@ -150,6 +214,7 @@ void loop() {
   AudioPlayer::Cmd cmd = g_pendingCmd;
   if (cmd != Cmd::None) {
     g_pendingCmd = Cmd::None;
+    TRACE_SCOPE_ARG("audio_cmd", (uint8_t)cmd);
 
     switch (cmd) {
       case Cmd::Stop: {
@@ -159,23 +224,25 @@ void loop() {
       }
       case Cmd::PlayBoot: {
         if (!g_bootEnabled) {
+          notify(Event::Skipped, cmd);
           Serial.println("[AudioPlayer] Boot sound disabled, skipping playback");
           break;
         }
         if (mp3) cleanupPlayer();
         if (out) {
-          (void)startPlayPath(kBootPath);
+          startClip(kBootPath, cmd);
         }
         break;
       }
       case Cmd::PlayEject: {
         if (!g_ejectEnabled) {
+          notify(Event::Skipped, cmd);
           Serial.println("[AudioPlayer] Eject sound disabled, skipping playback");
           break;
         }
         if (mp3) cleanupPlayer();
         if (out) {
-          (void)startPlayPath(kEjectPath);
+          startClip(kEjectPath, cmd);
         }
         break;
       }
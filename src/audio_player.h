@@ -30,4 +30,17 @@ bool stop();
 // Explicit enqueue if you prefer to call with a Cmd
 bool enqueue(Cmd c);
 
+// Playback decisions, for host harnesses (host/sim); from the loop task,
+// except Dropped, which comes from whoever enqueued the replacing command.
+enum class Event : uint8_t {
+  Dropped,      // a pending command was replaced before loop() took it
+  Started,      // clip for the command is playing
+  Failed,       // missing file or decoder error
+  Skipped,      // sound disabled
+  Finished,     // clip played to the end
+  Interrupted   // clip cut short by a new command or Stop
+};
+typedef void (*Observer)(Event e, Cmd c);
+void setObserver(Observer fn);
+
 } // namespace AudioPlayer
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "bank_install.h"
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <atomic>
+#include <new>
+#include <time.h>
+
+#include "fs_worker.h"
+#include "fileman.h"
+#include "sound_bank.h"
+#include "sound_index.h"
+#include "sha256.h"
+#include "json_reader.h"
+#include "trace.h"
+
+#ifndef XS_UPLOAD_BUF
+  #define XS_UPLOAD_BUF 4096
+#endif
+
+static const uint32_t kPostWaitMs = 2000;   // worker queue back-pressure, as for slot uploads
+static const size_t   kSpareBytes = 4096;   // SPIFFS headroom per entry
+
+struct Block {
+  std::atomic<bool> busy{false};  // queued or being written
+  size_t  len = 0;
+  uint8_t data[XS_UPLOAD_BUF];
+};
+
+// Lives from begin() until the close job has run. Jobs for it run in the
+// order posted (blocks, result, close).
+struct Bank {
+  // AsyncTCP side
+  Block   blocks[2];
+  uint8_t cur = 0;
+  BankInstall::Transfer xfer{0, 0, false};
+
+  // Worker side
+  SoundBank parser;
+  File      out;
+  Sha256    hash;
+  char      curPath[SoundBank::kPathMax] = {0};   // entry being written
+  uint8_t   count = 0;                            // entries complete and verified
+  char      paths[SoundBank::kMaxEntries][SoundBank::kPathMax];
+  uint32_t  sizes[SoundBank::kMaxEntries];
+  uint8_t   sha[SoundBank::kMaxEntries][Sha256::kSize];
+  // settings entry: kept in RAM, applied after the slots are in
+  bool      inSettings = false;
+  bool      hasSettings = false;
+  size_t    settingsLen = 0;
+  char      settings[SoundBank::kSettingsMax];
+  long      volume = -1;
+  int       bootEnabled = -1, ejectEnabled = -1;
+
+  // Either side; the first failure wins
+  std::atomic<bool> ok{true};
+  int         code = 400;
+  const char* err = nullptr;
+};
+
+static Bank* g_bank = nullptr;
+static std::atomic<bool> g_busy{false};
+static SemaphoreHandle_t g_freed = nullptr;
+
+static void failBank(Bank& b, int code, const char* err) {
+  bool expected = true;
+  if (b.ok.compare_exchange_strong(expected, false)) { b.code = code; b.err = err; }
+}
+
+static void partPath(const char* slotPath, char* out, size_t n) {
+  snprintf(out, n, "%s.part", slotPath);
+}
+
+// {"volume":N,"boot_enabled":bool,"eject_enabled":bool}
+static void onSettingsField(void* ctx, const JsonReader::Event& ev) {
+  Bank& b = *static_cast<Bank*>(ctx);
+  if (ev.depth != 1) return;
+  bool v;
+  if (ev.keyIs("volume")) ev.toInt(b.volume);
+  else if (ev.keyIs("boot_enabled") && ev.toBool(v))  b.bootEnabled = v;
+  else if (ev.keyIs("eject_enabled") && ev.toBool(v)) b.ejectEnabled = v;
+}
+
+// -------------- Worker: parser callbacks --------------
+static bool onEntry(void* ctx, const SoundBank::Entry& e) {
+  Bank& b = *static_cast<Bank*>(ctx);
+  if (strcmp(e.path, SoundBank::kSettingsPath) == 0) {
+    if (b.hasSettings || e.size > sizeof(b.settings)) { failBank(b, 400, "bad settings entry"); return false; }
+    b.inSettings = true;
+    b.settingsLen = 0;
+    b.hash.reset();
+    return true;
+  }
+  if (!SoundIndex::isSlot(e.path)) { failBank(b, 400, "unknown slot in bank"); return false; }
+  for (uint8_t i = 0; i < b.count; ++i) {
+    if (strcmp(b.paths[i], e.path) == 0) { failBank(b, 400, "slot twice in bank"); return false; }
+  }
+  // The new file sits beside the old one until the swap
+  const uint64_t freeb = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+  if (freeb < (uint64_t)e.size + kSpareBytes) { failBank(b, 400, "not enough space"); return false; }
+
+  char part[32];
+  partPath(e.path, part, sizeof(part));
+  strlcpy(b.curPath, e.path, sizeof(b.curPath));
+  b.out = SPIFFS.open(part, "w");
+  if (!b.out) { failBank(b, 500, "failed to create file"); return false; }
+  b.hash.reset();
+  return true;
+}
+
+static bool onData(void* ctx, const uint8_t* data, size_t len) {
+  Bank& b = *static_cast<Bank*>(ctx);
+  b.hash.update(data, len);
+  if (b.inSettings) {
+    memcpy(b.settings + b.settingsLen, data, len);   // size checked in onEntry
+    b.settingsLen += len;
+    return true;
+  }
+  TRACE_SCOPE_ARG("flash_write", len);
+  if (b.out.write(data, len) != len) { failBank(b, 500, "write failed"); return false; }
+  return true;
+}
+
+static bool onEnd(void* ctx, const SoundBank::Entry& e) {
+  Bank& b = *static_cast<Bank*>(ctx);
+  uint8_t digest[Sha256::kSize];
+  b.hash.finish(digest);
+  if (b.inSettings) {
+    b.inSettings = false;
+    if (memcmp(digest, e.sha, sizeof(digest)) != 0) { failBank(b, 400, "checksum mismatch"); return false; }
+    JsonReader r(onSettingsField, &b);
+    if (!r.feed(b.settings, b.settingsLen) || !r.finish()) { failBank(b, 400, "bad settings json"); return false; }
+    b.hasSettings = true;
+    return true;
+  }
+  b.out.close();
+  if (memcmp(digest, e.sha, sizeof(digest)) != 0) { failBank(b, 400, "checksum mismatch"); return false; }
+  strlcpy(b.paths[b.count], e.path, sizeof(b.paths[0]));
+  b.sizes[b.count] = e.size;
+  memcpy(b.sha[b.count], digest, sizeof(digest));
+  b.count++;
+  b.curPath[0] = '\0';
+  Serial.printf("[Bank] %s: %u bytes verified\n", e.path, (unsigned)e.size);
+  return true;
+}
+
+// -------------- Worker: jobs --------------
+static void blockJob(void* arg) {
+  Block& blk = *static_cast<Block*>(arg);
+  Bank& b = *g_bank;
+  if (b.ok && !b.parser.feed(blk.data, blk.len)) failBank(b, 400, b.parser.error());
+  blk.len = 0;
+  blk.busy.store(false);
+  xSemaphoreGive(g_freed);
+}
+
+static int resultJson(JsonWriter& j, const char*, void* ctx) {
+  Bank& b = *static_cast<Bank*>(ctx);
+  if (b.ok && !b.parser.done()) failBank(b, 400, "truncated bank");
+
+  // All entries are verified on flash: only now do slots change
+  if (b.ok) {
+    const time_t now = time(nullptr);
+    for (uint8_t i = 0; i < b.count; ++i) {
+      char part[32];
+      partPath(b.paths[i], part, sizeof(part));
+      if (!FileMan::commitPart(b.paths[i], part)) { failBank(b, 500, "swap failed"); break; }
+      SoundIndex::update(b.paths[i], b.sha[i], now > 1600000000 ? (uint32_t)now : 0);
+    }
+  }
+  if (b.ok && b.hasSettings) FileMan::applySettings((int)b.volume, b.bootEnabled, b.ejectEnabled);
+
+  j.beginObject().kv("ok", b.ok.load());
+  if (b.ok) {
+    const uint32_t ms = b.xfer.ms ? b.xfer.ms : 1;
+    j.key("files").beginArray();
+    for (uint8_t i = 0; i < b.count; ++i) {
+      j.beginObject().kv("path", (const char*)b.paths[i]).kv("bytes", b.sizes[i]).endObject();
+    }
+    j.endArray();
+    j.kv("settings", b.hasSettings)
+     .kv("received", b.xfer.received)
+     .kv("gzip", b.xfer.gzip)
+     .kv("ms", b.xfer.ms)
+     .kv("kBps", (uint32_t)((uint64_t)b.xfer.received / ms));   // bytes per ms, as /api/bench
+  } else {
+    j.kv("err", b.err ? b.err : "fail");
+  }
+  j.endObject();
+  if (b.ok) Serial.printf("[Bank] Installed %u sound(s)\n", (unsigned)b.count);
+  return b.ok ? 200 : b.code;
+}
+
+// Drops whatever a failed bank left behind and frees the context
+static void closeJob(void* arg) {
+  Bank* b = static_cast<Bank*>(arg);
+  if (b->out) b->out.close();
+  if (!b->ok) {
+    char part[32];
+    for (uint8_t i = 0; i < b->count; ++i) {
+      partPath(b->paths[i], part, sizeof(part));
+      SPIFFS.remove(part);
+    }
+    if (b->curPath[0]) {
+      partPath(b->curPath, part, sizeof(part));
+      SPIFFS.remove(part);
+    }
+    Serial.printf("[Bank] Failed: %s\n", b->err ? b->err : "fail");
+  }
+  SoundIndex::refreshUsage();
+  delete b;
+  g_bank = nullptr;
+  g_busy.store(false);
+}
+
+// -------------- AsyncTCP side --------------
+static bool postBlock(Bank& b) {
+  Block& blk = b.blocks[b.cur];
+  if (!blk.len) return true;
+  blk.busy.store(true);
+  if (!FsWorker::post(blockJob, &blk, kPostWaitMs)) {
+    blk.busy.store(false);
+    failBank(b, 503, "fs busy");
+    return false;
+  }
+  b.cur ^= 1;
+  return true;
+}
+
+static void postClose(Bank* b) {
+  if (!FsWorker::post(closeJob, b, portMAX_DELAY)) {
+    FsWorker::Guard g;  // worker not running: nothing else is queued
+    closeJob(b);
+  }
+}
+
+namespace BankInstall {
+
+  bool begin() {
+    bool expected = false;
+    if (!g_busy.compare_exchange_strong(expected, true)) return false;
+    if (!g_freed) g_freed = xSemaphoreCreateBinary();
+    g_bank = new (std::nothrow) Bank();
+    if (!g_bank || !g_freed) {
+      delete g_bank; g_bank = nullptr;
+      g_busy.store(false);
+      return false;
+    }
+    g_bank->parser.reset(onEntry, onData, onEnd, g_bank);
+    return true;
+  }
+
+  bool write(const uint8_t* data, size_t len) {
+    Bank& b = *g_bank;
+    while (len) {
+      if (!b.ok) return false;
+      Block& blk = b.blocks[b.cur];
+      const unsigned long start = millis();
+      while (blk.busy.load()) {
+        if (millis() - start > kPostWaitMs) { failBank(b, 503, "fs busy"); return false; }
+        xSemaphoreTake(g_freed, pdMS_TO_TICKS(50));
+      }
+      size_t take = XS_UPLOAD_BUF - blk.len;
+      if (take > len) take = len;
+      memcpy(blk.data + blk.len, data, take);
+      blk.len += take;
+      data += take;
+      len -= take;
+      if (blk.len == XS_UPLOAD_BUF && !postBlock(b)) return false;
+    }
+    return b.ok;
+  }
+
+  void commit(AsyncWebServerRequest* req, const Transfer& t) {
+    Bank* b = g_bank;
+    b->xfer = t;
+    if (b->ok) postBlock(*b);
+    FsWorker::replyJson(req, resultJson, nullptr, b);
+    postClose(b);
+  }
+
+  void abort() {
+    Bank* b = g_bank;
+    failBank(*b, 400, "aborted");
+    postClose(b);
+  }
+
+  bool active() { return g_busy.load(); }
+
+  bool failure(int& code, const char*& err) {
+    if (!g_bank || g_bank->ok) return false;
+    code = g_bank->code;
+    err = g_bank->err;
+    return true;
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Installs an "XSB1" sound bank (sound_bank.h) streamed in over HTTP.
+// The AsyncTCP side only copies bytes into two blocks; parsing, writing
+// each entry to "<slot>.part", hashing and the final swap run as FsWorker
+// jobs. Nothing replaces a slot until every entry has arrived and matched
+// its SHA-256; then all of them are swapped in and the index updated.
+// One bank at a time.
+namespace BankInstall {
+
+  // Upload numbers echoed in the reply
+  struct Transfer {
+    uint32_t received;
+    uint32_t ms;
+    bool     gzip;
+  };
+
+  // -------- AsyncTCP side --------
+  // False if a previous bank is still being finished, or no memory
+  bool begin();
+  // False once the bank failed (see failure()) or the worker fell behind
+  bool write(const uint8_t* data, size_t len);
+  // Answer req once the worker has verified and swapped everything in
+  void commit(AsyncWebServerRequest* req, const Transfer& t);
+  // Drop the bank: its .part files are removed on the worker
+  void abort();
+
+  bool active();
+  // First failure so far (HTTP status + message), false if none
+  bool failure(int& code, const char*& err);
+}
@@ -0,0 +1,454 @@
+#include "bench.h"
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <AudioFileSourceFS.h>
+#include <AudioGeneratorMP3.h>
+#include <AudioOutput.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_heap_caps.h>
+
+#include <atomic>
+
+#include "audio_player.h"
+#include "bank_install.h"
+#include "fileman.h"
+#include "fs_worker.h"
+#include "ota.h"
+#include "wifimgr.h"
+#include "web_json.h"
+#include "trace.h"
+
+// Output frames per decoder pass: two MPEG-1 frames, a few ms of work
+static const uint16_t kPassFrames = 2 * 1152;
+
+// Flash benchmark: scratch file, block size (one SPIFFS logical block, as
+// uploads use) and size limits in KB
+static const char*    kScratch  = "/bench.tmp";
+static const size_t   kFsBlock  = 4096;
+static const uint32_t kFsDefKb  = 64;
+static const uint32_t kFsMaxKb  = 512;
+
+enum class State : uint8_t { Idle = 0, Pending, Running, Done };
+static const char* kStateNames[] = { "idle", "pending", "running", "done" };
+
+// Takes everything the decoder makes, kPassFrames per loop() pass
+class CountingOutput : public AudioOutput {
+public:
+  bool begin() override { return true; }
+  bool ConsumeSample(int16_t sample[2]) override {
+    if (_pass == kPassFrames) return false;
+    _pass++;
+    frames++;
+    return true;
+  }
+  bool stop() override { return true; }
+
+  void nextPass() { _pass = 0; }
+  uint32_t rate() const { return hertz; }
+  uint8_t chans() const { return channels; }
+
+  uint32_t frames = 0;
+
+private:
+  uint16_t _pass = 0;
+};
+
+static std::atomic<uint8_t> g_state{(uint8_t)State::Idle};
+static char g_reqPath[sizeof(Bench::DecodeResult::path)];   // "" = all
+
+// Loop task writes, web task reads up to g_done
+static char    g_queue[Bench::kMaxClips][sizeof(Bench::DecodeResult::path)];
+static uint8_t g_queued = 0, g_next = 0;
+static Bench::DecodeResult g_results[Bench::kMaxClips];
+static std::atomic<uint8_t> g_done{0};
+
+// Clip in progress (loop task only)
+static AudioFileSourceFS* g_src = nullptr;
+static AudioGeneratorMP3* g_mp3 = nullptr;
+static CountingOutput*    g_out = nullptr;
+static Bench::DecodeResult g_cur;
+static size_t g_heapBefore = 0, g_heapMin = 0;
+
+static void sampleHeap() {
+  const size_t f = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  if (f < g_heapMin) g_heapMin = f;
+}
+
+// Last flash and network results, for GET /api/bench
+struct FsResult {
+  bool     ok;
+  uint32_t bytes;
+  uint32_t writeUs;
+  uint32_t readUs;
+};
+struct NetResult {
+  bool     ok;
+  uint32_t bytes;
+  uint32_t us;
+};
+static FsResult  g_lastFs  = {};
+static NetResult g_lastNet = {};
+static std::atomic<bool> g_fsRunning{false};
+
+// Why a benchmark may not start now, or nullptr when the unit is idle
+static const char* busyReason() {
+  if (AudioPlayer::isPlaying()) return "playing";
+  if (Bench::running() || g_fsRunning.load()) return "bench running";
+  if (Ota::busy() || BankInstall::active()) return "update running";
+  if (FileMan::uploading()) return "upload running";
+  return nullptr;
+}
+
+static uint32_t kBps(uint32_t bytes, uint32_t us) {
+  return us ? (uint32_t)((uint64_t)bytes * 1000 / us) : 0;   // bytes per ms = kB/s
+}
+
+static bool endsWithMp3(const char* p) {
+  const size_t n = strlen(p);
+  return n > 4 && strcasecmp(p + n - 4, ".mp3") == 0;
+}
+
+// -------------- Decode --------------
+static void finishClip() {
+  if (g_mp3) g_mp3->stop();
+  if (g_out) {
+    g_cur.ok = g_out->frames > 0;
+    g_cur.rate = g_out->rate();
+    g_cur.channels = g_out->chans();
+    g_cur.mp3Frames = g_out->frames / (g_cur.rate >= 32000 ? 1152 : 576);
+    g_cur.audioMs = g_cur.rate ? (uint32_t)((uint64_t)g_out->frames * 1000 / g_cur.rate) : 0;
+  }
+  g_cur.peakHeap = (uint32_t)(g_heapBefore - g_heapMin);
+  delete g_mp3; g_mp3 = nullptr;
+  if (g_src) { FsWorker::Guard g; g_src->close(); }
+  delete g_src; g_src = nullptr;
+  delete g_out; g_out = nullptr;
+
+  const uint8_t i = g_done.load();
+  g_results[i] = g_cur;
+  g_done.store(i + 1);
+
+  const Bench::DecodeResult& r = g_cur;
+  if (r.ok && r.decodeUs) {
+    Serial.printf("[Bench] %s: %u Hz %u ch, %u frames in %u ms (%u fps, %.1fx real time), heap %u\n",
+                  r.path, (unsigned)r.rate, (unsigned)r.channels, (unsigned)r.mp3Frames,
+                  (unsigned)(r.decodeUs / 1000), (unsigned)((uint64_t)r.mp3Frames * 1000000 / r.decodeUs),
+                  (double)r.audioMs * 1000.0 / r.decodeUs, (unsigned)r.peakHeap);
+  } else {
+    Serial.printf("[Bench] %s: not decoded\n", r.path);
+  }
+}
+
+static void startClip(const char* path) {
+  TRACE_INSTANT("bench_clip", g_next);
+  memset(&g_cur, 0, sizeof(g_cur));
+  strlcpy(g_cur.path, path, sizeof(g_cur.path));
+  g_heapBefore = g_heapMin = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+  g_src = new AudioFileSourceFS(SPIFFS);
+  g_out = new CountingOutput();
+  g_mp3 = new AudioGeneratorMP3();
+  if (!g_src || !g_out || !g_mp3) { finishClip(); return; }
+  {
+    FsWorker::Guard g;
+    if (!g_src->open(path)) { finishClip(); return; }
+    g_cur.bytes = g_src->getSize();
+  }
+
+  const uint32_t t0 = micros();
+  bool ok;
+  {
+    FsWorker::Guard g;
+    ok = g_mp3->begin(g_src, g_out);
+  }
+  g_cur.decodeUs += micros() - t0;
+  sampleHeap();
+  if (!ok) finishClip();
+}
+
+static void decodePass() {
+  g_out->nextPass();
+  const uint32_t t0 = micros();
+  bool more;
+  {
+    FsWorker::Guard g;
+    more = g_mp3->loop();
+  }
+  g_cur.decodeUs += micros() - t0;
+  sampleHeap();
+  if (!more) finishClip();
+}
+
+// Builds the file list; flash lock held
+static void queueFiles() {
+  g_queued = g_next = 0;
+  if (g_reqPath[0]) {
+    strlcpy(g_queue[g_queued++], g_reqPath, sizeof(g_queue[0]));
+    return;
+  }
+  File root = SPIFFS.open("/");
+  if (!root) return;
+  for (File f = root.openNextFile(); f && g_queued < Bench::kMaxClips; f = root.openNextFile()) {
+    const char* p = f.path();
+    if (p && endsWithMp3(p) && strlen(p) < sizeof(g_queue[0])) strlcpy(g_queue[g_queued++], p, sizeof(g_queue[0]));
+  }
+}
+
+// -------------- Flash --------------
+// FS worker job (flash lock held). ctx = size in bytes.
+static int fsBenchJson(JsonWriter& out, const char*, void* ctx) {
+  const uint32_t bytes = (uint32_t)(uintptr_t)ctx;
+  if (Bench::running() || AudioPlayer::isPlaying()) {
+    out.beginObject().kv("ok", false).kv("err", "busy").endObject();
+    return 409;
+  }
+  const size_t total = SPIFFS.totalBytes(), used = SPIFFS.usedBytes();
+  if (used + bytes + 2 * kFsBlock > total) {
+    out.beginObject().kv("ok", false).kv("err", "not enough space").endObject();
+    return 400;
+  }
+  uint8_t* buf = (uint8_t*)malloc(kFsBlock);
+  if (!buf) {
+    out.beginObject().kv("ok", false).kv("err", "no memory").endObject();
+    return 500;
+  }
+  g_fsRunning.store(true);
+  TRACE_SCOPE("bench_fs");
+  for (size_t i = 0; i < kFsBlock; ++i) buf[i] = (uint8_t)(i * 7 + 1);
+
+  FsResult r = {};
+  bool ok = true;
+  uint32_t t0 = micros();
+  File f = SPIFFS.open(kScratch, "w");
+  if (!f) ok = false;
+  for (uint32_t n = 0; ok && n < bytes; n += kFsBlock) {
+    ok = f.write(buf, kFsBlock) == kFsBlock;
+    FsWorker::yieldLock();
+  }
+  if (f) f.close();
+  r.writeUs = micros() - t0;
+
+  // Read back and check, so a short or corrupt write is not timed as fast
+  t0 = micros();
+  if (ok) f = SPIFFS.open(kScratch, "r");
+  if (ok && !f) ok = false;
+  uint32_t got = 0;
+  while (ok && got < bytes) {
+    if (f.read(buf, kFsBlock) != kFsBlock) { ok = false; break; }
+    for (size_t i = 0; i < kFsBlock; i += 512) if (buf[i] != (uint8_t)(i * 7 + 1)) ok = false;
+    got += kFsBlock;
+    FsWorker::yieldLock();
+  }
+  if (f) f.close();
+  r.readUs = micros() - t0;
+
+  SPIFFS.remove(kScratch);
+  free(buf);
+  r.ok = ok;
+  r.bytes = bytes;
+  g_lastFs = r;
+  g_fsRunning.store(false);
+
+  Serial.printf("[Bench] flash %u KB: write %u KB/s, read %u KB/s%s\n", (unsigned)(bytes / 1024),
+                (unsigned)kBps(bytes, r.writeUs), (unsigned)kBps(bytes, r.readUs), ok ? "" : " (failed)");
+  out.beginObject()
+     .kv("ok", ok)
+     .kv("bytes", bytes)
+     .kv("write_us", r.writeUs)
+     .kv("read_us", r.readUs)
+     .kv("write_kBps", kBps(bytes, r.writeUs))
+     .kv("read_kBps", kBps(bytes, r.readUs))
+     .endObject();
+  return ok ? 200 : 500;
+}
+
+// -------------- Network --------------
+// Kept in _tempObject across body chunks (AsyncWebServer free()s it)
+struct NetSink {
+  const char* refused;   // busy reason at the first chunk
+  uint32_t    bytes;     // after the first chunk
+  uint32_t    firstUs;
+  uint32_t    lastUs;
+};
+
+static void netBody(AsyncWebServerRequest* req, uint8_t*, size_t len, size_t index, size_t) {
+  if (index == 0) {
+    if (req->_tempObject) { free(req->_tempObject); req->_tempObject = nullptr; }
+    NetSink* s = (NetSink*)malloc(sizeof(NetSink));
+    if (!s) return;
+    s->refused = busyReason();
+    s->bytes = 0;
+    // Timing starts when the first chunk is in, so it is not counted
+    s->firstUs = s->lastUs = micros();
+    req->_tempObject = s;
+    return;
+  }
+  NetSink* s = (NetSink*)req->_tempObject;
+  if (!s) return;
+  s->bytes += len;
+  s->lastUs = micros();
+}
+
+static void handleNet(AsyncWebServerRequest* req) {
+  const NetSink* s = (const NetSink*)req->_tempObject;
+  if (!s) { WebJson::sendError(req, 400, "no body"); return; }
+  if (s->refused) { WebJson::sendError(req, 409, s->refused); return; }
+  NetResult r = { true, s->bytes, s->lastUs - s->firstUs };
+  g_lastNet = r;
+  Serial.printf("[Bench] network %u bytes: %u KB/s\n", (unsigned)r.bytes, (unsigned)kBps(r.bytes, r.us));
+  WebJson::Reply j;
+  j.beginObject()
+   .kv("ok", true)
+   .kv("bytes", r.bytes)
+   .kv("us", r.us)
+   .kv("kBps", kBps(r.bytes, r.us))
+   .endObject();
+  j.send(req);
+}
+
+// -------------- REST --------------
+static void handleDecodeGet(AsyncWebServerRequest* req) {
+  const State st = (State)g_state.load();
+  const uint8_t done = g_done.load();
+  WebJson::Reply j;
+  j.beginObject()
+   .kv("state", kStateNames[(uint8_t)st])
+   .kv("done", done)
+   .kv("total", st == State::Pending ? 0 : g_queued);
+  j.key("results").beginArray();
+  for (uint8_t i = 0; i < done; ++i) {
+    const Bench::DecodeResult& r = g_results[i];
+    const double sec = r.decodeUs / 1e6;
+    j.beginObject()
+     .kv("path", (const char*)r.path)
+     .kv("ok", r.ok)
+     .kv("bytes", r.bytes)
+     .kv("rate", r.rate)
+     .kv("channels", r.channels)
+     .kv("kbps", r.audioMs ? (uint32_t)((uint64_t)r.bytes * 8 / r.audioMs) : 0)
+     .kv("frames", r.mp3Frames)
+     .kv("audio_ms", r.audioMs)
+     .kv("decode_us", r.decodeUs)
+     .kv("fps", sec > 0 ? r.mp3Frames / sec : 0.0, 1)
+     .kv("rtf", sec > 0 ? r.audioMs / 1000.0 / sec : 0.0, 2)
+     .kv("peak_heap", r.peakHeap)
+     .endObject();
+  }
+  j.endArray();
+  j.endObject();
+  j.send(req);
+}
+
+static void handleFs(AsyncWebServerRequest* req) {
+  uint32_t kb = kFsDefKb;
+  if (req->hasParam("kb")) kb = (uint32_t)req->getParam("kb")->value().toInt();
+  if (kb < 4 || kb > kFsMaxKb) { WebJson::sendError(req, 400, "bad kb"); return; }
+  if (const char* why = busyReason()) { WebJson::sendError(req, 409, why); return; }
+  FsWorker::replyJson(req, fsBenchJson, nullptr, (void*)(uintptr_t)(kb * 1024));
+}
+
+static void handleSummary(AsyncWebServerRequest* req) {
+  const char* why = busyReason();
+  const FsResult fs = g_lastFs;
+  const NetResult net = g_lastNet;
+  WebJson::Reply j;
+  j.beginObject().kv("idle", why == nullptr);
+  if (why) j.kv("busy", why);
+  j.key("fs").beginObject();
+  if (fs.bytes) {
+    j.kv("ok", fs.ok).kv("bytes", fs.bytes)
+     .kv("write_kBps", kBps(fs.bytes, fs.writeUs)).kv("read_kBps", kBps(fs.bytes, fs.readUs));
+  }
+  j.endObject();
+  j.key("net").beginObject();
+  if (net.bytes) j.kv("bytes", net.bytes).kv("kBps", kBps(net.bytes, net.us));
+  j.endObject();
+  j.key("decode").beginObject()
+   .kv("state", kStateNames[g_state.load()])
+   .kv("done", g_done.load());
+  // Slowest clip: the one that limits playback
+  double worst = 0;
+  const uint8_t done = g_done.load();
+  for (uint8_t i = 0; i < done; ++i) {
+    const Bench::DecodeResult& r = g_results[i];
+    if (!r.ok || !r.decodeUs) continue;
+    const double rtf = r.audioMs * 1000.0 / r.decodeUs;
+    if (worst == 0 || rtf < worst) worst = rtf;
+  }
+  if (worst > 0) j.kv("min_rtf", worst, 2);
+  j.endObject();
+  j.endObject();
+  j.send(req);
+}
+
+static void handleDecodePost(AsyncWebServerRequest* req) {
+  const char* path = nullptr;
+  String p;
+  if (req->hasParam("path")) {
+    p = req->getParam("path")->value();
+    if (!p.startsWith("/") || p.length() >= sizeof(g_reqPath)) { WebJson::sendError(req, 400, "bad path"); return; }
+    path = p.c_str();
+  }
+  if (const char* why = busyReason()) { WebJson::sendError(req, 409, why); return; }
+  if (!Bench::startDecode(path)) { WebJson::sendError(req, 409, "bench running"); return; }
+  WebJson::sendStatic(req, 202, "{\"ok\":true}");
+}
+
+// -------------- Public --------------
+namespace Bench {
+
+  void begin() {
+    AsyncWebServer& server = WiFiMgr::getServer();
+    server.on("/api/bench/fs",     HTTP_POST, [](AsyncWebServerRequest* r){ handleFs(r);         });
+    server.on("/api/bench/net",    HTTP_POST, [](AsyncWebServerRequest* r){ handleNet(r);        },
+              nullptr, netBody);
+    server.on("/api/bench/decode", HTTP_GET,  [](AsyncWebServerRequest* r){ handleDecodeGet(r);  });
+    server.on("/api/bench/decode", HTTP_POST, [](AsyncWebServerRequest* r){ handleDecodePost(r); });
+    // Last: "/api/bench" also matches every "/api/bench/..." URL
+    server.on("/api/bench",        HTTP_GET,  [](AsyncWebServerRequest* r){ handleSummary(r);    });
+  }
+
+  void loop() {
+    const State st = (State)g_state.load();
+    if (st == State::Pending) {
+      {
+        FsWorker::Guard g;
+        queueFiles();
+      }
+      Serial.printf("[Bench] decoding %u file(s)\n", (unsigned)g_queued);
+      g_state.store((uint8_t)State::Running);
+      return;
+    }
+    if (st != State::Running) return;
+
+    // Playback has the decoder budget; resume when it ends
+    if (AudioPlayer::isPlaying()) return;
+
+    if (g_mp3) { decodePass(); return; }
+    if (g_next < g_queued) { startClip(g_queue[g_next++]); return; }
+    g_state.store((uint8_t)State::Done);
+  }
+
+  bool startDecode(const char* path) {
+    const State st = (State)g_state.load();
+    if (st == State::Pending || st == State::Running || AudioPlayer::isPlaying()) return false;
+    if (path) strlcpy(g_reqPath, path, sizeof(g_reqPath));
+    else      g_reqPath[0] = '\0';
+    g_done.store(0);
+    g_state.store((uint8_t)State::Pending);
+    return true;
+  }
+
+  bool running() {
+    const State st = (State)g_state.load();
+    return st == State::Pending || st == State::Running;
+  }
+
+  uint8_t decodeResults(DecodeResult* out, uint8_t max) {
+    uint8_t n = g_done.load();
+    if (n > max) n = max;
+    memcpy(out, g_results, n * sizeof(DecodeResult));
+    return n;
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Self-benchmarks, to tell whether flash, Wi-Fi or CPU limits a unit.
+// Each one refuses to start (409, with the reason) unless the unit is idle:
+// no sound playing, no upload or update, no other benchmark.
+// - GET  /api/bench            last result of each, and what is busy
+// - POST /api/bench/fs[?kb=N]  SPIFFS sequential write then read of an
+//   N KB scratch file (default 64), removed afterwards; runs on the FS
+//   worker, which lets playback reads in between blocks
+// - POST /api/bench/net        discards the request body and reports how
+//   fast it arrived (send it as application/octet-stream), so Wi-Fi is
+//   measured without flash in the way
+// - POST /api/bench/decode[?path=/x.mp3] decodes one file or every .mp3
+//   on SPIFFS through AudioGeneratorMP3 into a counting output, as
+//   playback does but without the DMA pacing; GET reports progress and
+//   results. Runs on the loop task a couple of MP3 frames per loop() pass
+//   and waits while a sound plays. Timings include the SPIFFS reads, as
+//   they do for playback. Peak heap is approximate: other tasks allocate.
+namespace Bench {
+
+  static const uint8_t kMaxClips = 10;
+
+  struct DecodeResult {
+    char     path[40];
+    bool     ok;           // decoded to the end
+    uint32_t bytes;
+    uint32_t rate;         // Hz
+    uint8_t  channels;
+    uint32_t mp3Frames;
+    uint32_t audioMs;      // length of the decoded audio
+    uint32_t decodeUs;     // time inside the decoder
+    uint32_t peakHeap;     // bytes, most the decoder held at once
+  };
+
+  // Registers the routes on the shared server
+  void begin();
+
+  // Loop task: advances a running benchmark
+  void loop();
+
+  // path = nullptr: every .mp3 on SPIFFS (first kMaxClips). False if a run
+  // is already going or a sound is playing.
+  bool startDecode(const char* path);
+  bool running();
+
+  // Results of the current or last run; returns the count
+  uint8_t decodeResults(DecodeResult* out, uint8_t max);
+}
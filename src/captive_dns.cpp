@@ -0,0 +1,109 @@
+#include "captive_dns.h"
+
+#include <AsyncUDP.h>
+
+#include <atomic>
+
+static AsyncUDP g_udp;
+static std::atomic<bool> g_running{false};
+static std::atomic<uint32_t> g_ip{0};
+
+static std::atomic<uint32_t> g_queries{0};
+static std::atomic<uint32_t> g_answered{0};
+static std::atomic<uint32_t> g_empty{0};
+static std::atomic<uint32_t> g_dropped{0};
+static std::atomic<uint32_t> g_sendFail{0};
+
+static const size_t   kHeader   = 12;
+static const size_t   kMaxReply = 512;   // classic DNS over UDP
+static const uint16_t kTypeA    = 1;
+static const uint16_t kClassIn  = 1;
+static const uint32_t kTtl      = 60;
+
+static uint16_t rd16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+static void wr16(uint8_t* p, uint16_t v) { p[0] = v >> 8; p[1] = v & 0xFF; }
+
+// End of the first question's QNAME (uncompressed labels), or 0 if malformed
+static size_t skipName(const uint8_t* d, size_t len, size_t off) {
+  while (off < len) {
+    const uint8_t l = d[off];
+    if (l == 0) return off + 1;
+    if (l & 0xC0) return 0;        // pointers don't appear in queries
+    off += 1 + l;
+  }
+  return 0;
+}
+
+// Runs on the lwIP/AsyncUDP task: no heap, no locks, bounded work
+static void onPacket(AsyncUDPPacket& pkt) {
+  const uint8_t* q = pkt.data();
+  const size_t len = pkt.length();
+  if (len < kHeader + 5 || len > kMaxReply) { g_dropped++; return; }
+
+  const uint16_t flags = rd16(q + 2);
+  const bool isQuery   = !(flags & 0x8000);
+  const uint8_t opcode = (flags >> 11) & 0x0F;
+  if (!isQuery || opcode != 0 || rd16(q + 4) == 0) { g_dropped++; return; }
+
+  // Only the first question is answered (that's all resolvers send)
+  const size_t nameEnd = skipName(q, len, kHeader);
+  if (!nameEnd || nameEnd + 4 > len) { g_dropped++; return; }
+  const size_t qEnd = nameEnd + 4;
+  const uint16_t qtype  = rd16(q + nameEnd);
+  const uint16_t qclass = rd16(q + nameEnd + 2);
+  g_queries++;
+
+  const bool answerA = qtype == kTypeA && qclass == kClassIn;
+  uint8_t r[kMaxReply];
+  const size_t rlen = qEnd + (answerA ? 16 : 0);
+  if (rlen > sizeof(r)) { g_dropped++; return; }
+
+  memcpy(r, q, qEnd);                                     // id + question
+  wr16(r + 2, 0x8000 | 0x0400 | (flags & 0x0100) | 0x0080); // QR AA RD(copied) RA, NOERROR
+  wr16(r + 4, 1);                                         // QDCOUNT
+  wr16(r + 6, answerA ? 1 : 0);                           // ANCOUNT
+  wr16(r + 8, 0);
+  wr16(r + 10, 0);
+  if (answerA) {
+    uint8_t* a = r + qEnd;
+    wr16(a, 0xC000 | kHeader);                            // name: pointer to the question
+    wr16(a + 2, kTypeA);
+    wr16(a + 4, kClassIn);
+    wr16(a + 6, kTtl >> 16);
+    wr16(a + 8, kTtl & 0xFFFF);
+    wr16(a + 10, 4);
+    const uint32_t ip = g_ip.load();                      // network order as stored by IPAddress
+    memcpy(a + 12, &ip, 4);
+  }
+
+  if (pkt.write(r, rlen) != rlen) { g_sendFail++; return; }
+  if (answerA) g_answered++; else g_empty++;
+}
+
+namespace CaptiveDns {
+
+  bool start(IPAddress ip, uint16_t port) {
+    stop();
+    g_ip = (uint32_t)ip;
+    if (!g_udp.listen(port)) {
+      Serial.printf("[DNS] listen on :%u failed\n", (unsigned)port);
+      return false;
+    }
+    g_udp.onPacket(onPacket);
+    g_running = true;
+    Serial.printf("[DNS] Captive DNS on :%u -> %s\n", (unsigned)port, ip.toString().c_str());
+    return true;
+  }
+
+  void stop() {
+    if (!g_running) return;
+    g_udp.close();
+    g_running = false;
+  }
+
+  bool running() { return g_running; }
+
+  Stats stats() {
+    return Stats{ g_queries, g_answered, g_empty, g_dropped, g_sendFail };
+  }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// Captive-portal DNS: answers every A query with the soft-AP address,
+// straight from the AsyncUDP receive callback (lwIP task), so replies go
+// out immediately no matter what loop() is busy with. Other query types
+// get an empty NOERROR answer, which makes phones fall back to IPv4.
+namespace CaptiveDns {
+
+  struct Stats {
+    uint32_t queries;    // well-formed queries received
+    uint32_t answered;   // A answers sent
+    uint32_t empty;      // non-A queries answered without records
+    uint32_t dropped;    // malformed / responses / unsupported opcodes
+    uint32_t sendFail;
+  };
+
+  bool start(IPAddress ip, uint16_t port = 53);
+  void stop();
+  bool running();
+  Stats stats();
+}
@@ -0,0 +1,120 @@
+#include "diag.h"
+
+#include <ESPAsyncWebServer.h>
+#include <esp_heap_caps.h>
+
+#include <atomic>
+
+#include "wifimgr.h"
+#include "web_json.h"
+
+// -------------- Failed allocations --------------
+// Called by the heap on any failed malloc, from whatever task made it.
+static std::atomic<uint32_t> g_allocFailures{0};
+static std::atomic<uint32_t> g_lastFailSize{0};
+static std::atomic<uint32_t> g_lastFailCaps{0};
+static std::atomic<uint32_t> g_lastFailMs{0};
+
+static void onAllocFailed(size_t size, uint32_t caps, const char* fn) {
+  g_allocFailures++;
+  g_lastFailSize = (uint32_t)size;
+  g_lastFailCaps = caps;
+  g_lastFailMs   = millis();
+}
+
+// -------------- Per-module counters --------------
+#if XS_ALLOC_STATS
+struct ModStats {
+  std::atomic<uint32_t> allocs{0};
+  std::atomic<uint32_t> frees{0};
+  std::atomic<uint32_t> bytes{0};    // cumulative allocated
+  std::atomic<int32_t>  net{0};      // allocated - freed
+  std::atomic<int32_t>  peak{0};
+};
+
+static ModStats g_mods[(size_t)Diag::Mod::Count];
+static const char* kModNames[] = { "audio", "web", "wifi" };
+
+namespace Diag {
+  void noteAlloc(Mod m, size_t bytes) {
+    ModStats& s = g_mods[(size_t)m];
+    s.allocs++;
+    s.bytes += (uint32_t)bytes;
+    const int32_t now = (s.net += (int32_t)bytes);
+    int32_t peak = s.peak.load();
+    while (now > peak && !s.peak.compare_exchange_weak(peak, now)) {}
+  }
+
+  void noteFree(Mod m, size_t bytes) {
+    ModStats& s = g_mods[(size_t)m];
+    s.frees++;
+    s.net -= (int32_t)bytes;
+  }
+
+  HeapScope::HeapScope(Mod m) : _mod(m), _before(heap_caps_get_free_size(MALLOC_CAP_8BIT)) {}
+
+  HeapScope::~HeapScope() {
+    const size_t after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    if (after < _before)      noteAlloc(_mod, _before - after);
+    else if (after > _before) noteFree(_mod, after - _before);
+  }
+}
+#endif
+
+// -------------- REST: heap --------------
+static void putHeap(JsonWriter& j, const char* key, uint32_t caps) {
+  const size_t freeb   = heap_caps_get_free_size(caps);
+  const size_t largest = heap_caps_get_largest_free_block(caps);
+  // 0 = one contiguous block, 100 = fully fragmented
+  const double frag = freeb ? 100.0 * (1.0 - (double)largest / (double)freeb) : 0.0;
+  j.key(key).beginObject()
+   .kv("total", (uint32_t)heap_caps_get_total_size(caps))
+   .kv("free", (uint32_t)freeb)
+   .kv("min_free", (uint32_t)heap_caps_get_minimum_free_size(caps))
+   .kv("largest", (uint32_t)largest)
+   .kv("frag", frag, 1)
+   .endObject();
+}
+
+static void handleHeap(AsyncWebServerRequest* req) {
+  WebJson::Reply j;
+  j.beginObject();
+  j.kv("uptime_ms", (uint32_t)millis());
+  putHeap(j, "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  putHeap(j, "dma", MALLOC_CAP_DMA);
+  if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM)) putHeap(j, "psram", MALLOC_CAP_SPIRAM);
+
+  j.key("alloc_failed").beginObject()
+   .kv("count", g_allocFailures.load())
+   .kv("last_size", g_lastFailSize.load())
+   .kv("last_caps", g_lastFailCaps.load())
+   .kv("last_ms", g_lastFailMs.load())
+   .endObject();
+  j.kv("json_fallbacks", WebJson::fallbacks());
+
+#if XS_ALLOC_STATS
+  j.key("modules").beginObject();
+  for (size_t i = 0; i < (size_t)Diag::Mod::Count; ++i) {
+    const ModStats& s = g_mods[i];
+    j.key(kModNames[i]).beginObject()
+     .kv("allocs", s.allocs.load())
+     .kv("frees", s.frees.load())
+     .kv("bytes", s.bytes.load())
+     .kv("net", s.net.load())
+     .kv("peak", s.peak.load())
+     .endObject();
+  }
+  j.endObject();
+#endif
+  j.endObject();
+  j.send(req);
+}
+
+namespace Diag {
+  void begin() {
+    heap_caps_register_failed_alloc_callback(onAllocFailed);
+
+    AsyncWebServer& server = WiFiMgr::getServer();
+    server.on("/api/heap", HTTP_GET, [](AsyncWebServerRequest* r){ handleHeap(r); });
+  }
+}
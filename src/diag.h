@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Runtime diagnostics. GET /api/heap reports free / minimum-ever free /
+// largest block and fragmentation for internal and DMA-capable RAM, plus
+// failed allocations. With XS_ALLOC_STATS=1 it also reports per-module
+// allocation counters fed by the XS_* macros below.
+#ifndef XS_ALLOC_STATS
+  #define XS_ALLOC_STATS 0
+#endif
+
+namespace Diag {
+
+  // Registers the diagnostics routes on the shared server
+  void begin();
+
+  enum class Mod : uint8_t { Audio = 0, Web, WiFi, Count };
+
+#if XS_ALLOC_STATS
+  void noteAlloc(Mod m, size_t bytes);
+  void noteFree(Mod m, size_t bytes);
+
+  // Charges the net heap change across a scope to a module. Catches
+  // allocations made inside libraries (decoder buffers, scan results);
+  // approximate, as other tasks may allocate in the same window.
+  class HeapScope {
+  public:
+    explicit HeapScope(Mod m);
+    ~HeapScope();
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+  private:
+    Mod    _mod;
+    size_t _before;
+  };
+#endif
+}
+
+#if XS_ALLOC_STATS
+  #define XS_ALLOC_NOTE(mod, bytes) Diag::noteAlloc(Diag::Mod::mod, (bytes))
+  #define XS_FREE_NOTE(mod, bytes)  Diag::noteFree(Diag::Mod::mod, (bytes))
+  #define XS_HEAP_SCOPE(mod)        Diag::HeapScope _xsHeapScope(Diag::Mod::mod)
+#else
+  #define XS_ALLOC_NOTE(mod, bytes) ((void)0)
+  #define XS_FREE_NOTE(mod, bytes)  ((void)0)
+  #define XS_HEAP_SCOPE(mod)        ((void)0)
+#endif
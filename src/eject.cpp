@@ -0,0 +1,94 @@
+#include "eject.h"
+
+#include "audio_player.h"
+#include "trace.h"
+
+#ifndef EJECT_DEBOUNCE_MS
+  #define EJECT_DEBOUNCE_MS  120
+#endif
+#ifndef EJECT_REFIRE_MS
+  #define EJECT_REFIRE_MS    800
+#endif
+
+static uint8_t  g_pin = 0;
+static uint32_t g_debounceMs = EJECT_DEBOUNCE_MS;
+static uint32_t g_refireMs = EJECT_REFIRE_MS;
+
+static volatile bool g_wantEject = false;
+static unsigned long g_lastEjectEdge = 0;
+static unsigned long g_lastEjectFire = 0;
+static bool g_held = false;
+
+// ISR decisions, counted there and reported from loop(): observers are
+// ordinary flash code and must not run with the cache disabled
+static volatile uint32_t g_isrEdges = 0, g_isrBounces = 0, g_isrHighs = 0;
+static uint32_t g_seenEdges = 0, g_seenBounces = 0, g_seenHighs = 0;
+
+static Eject::Observer g_observer = nullptr;
+
+static inline void notify(Eject::Event e) {
+  if (g_observer) g_observer(e);
+}
+
+static void report(volatile uint32_t& count, uint32_t& seen, Eject::Event e) {
+  const uint32_t n = count;
+  for (; seen != n; ++seen) notify(e);
+}
+
+static void IRAM_ATTR onEjectEdge() {
+  const unsigned long now = millis();
+  if (now - g_lastEjectEdge < g_debounceMs) { g_isrBounces++; return; }
+  g_lastEjectEdge = now;
+  if (digitalRead(g_pin) == LOW) {
+    g_wantEject = true;
+    g_isrEdges++;
+    TRACE_INSTANT("eject_isr", 0);
+  } else {
+    g_isrHighs++;
+  }
+}
+
+namespace Eject {
+
+  void begin(uint8_t pin, bool pullup) {
+    g_pin = pin;
+    g_wantEject = false;
+    g_held = false;
+    g_lastEjectEdge = g_lastEjectFire = 0;
+    g_seenEdges = g_isrEdges;
+    g_seenBounces = g_isrBounces;
+    g_seenHighs = g_isrHighs;
+    pinMode(pin, pullup ? INPUT_PULLUP : INPUT);
+    attachInterrupt(digitalPinToInterrupt(pin), onEjectEdge, FALLING);
+  }
+
+  // Refire guard: at most one eject sound per window
+  void loop() {
+    report(g_isrEdges, g_seenEdges, Event::Edge);
+    report(g_isrBounces, g_seenBounces, Event::Bounce);
+    report(g_isrHighs, g_seenHighs, Event::High);
+    if (!g_wantEject) return;
+    const unsigned long now = millis();
+    if (now - g_lastEjectFire > g_refireMs) {
+      g_wantEject = false;
+      g_held = false;
+      g_lastEjectFire = now;
+      TRACE_INSTANT("eject_fire", 0);
+      notify(Event::Fire);
+      AudioPlayer::playEject();
+    } else if (!g_held) {
+      g_held = true;
+      notify(Event::Held);
+    }
+  }
+
+  void setTiming(uint32_t debounceMs, uint32_t refireMs) {
+    g_debounceMs = debounceMs;
+    g_refireMs = refireMs;
+  }
+
+  uint32_t debounceMs() { return g_debounceMs; }
+  uint32_t refireMs() { return g_refireMs; }
+
+  void setObserver(Observer fn) { g_observer = fn; }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Eject line from the Xbox (active LOW): a falling edge asks for the eject
+// sound.
+// - The ISR takes an edge only if the last one it took is more than the
+//   debounce time ago, and only if the line still reads LOW (a bounce
+//   back to HIGH is dropped, but restarts the debounce window).
+// - loop() plays at most once per refire time; a request inside that
+//   window is held and plays when it ends.
+// host/sim/ejectsim replays recorded edge traces through this on a
+// virtual clock.
+namespace Eject {
+
+  void begin(uint8_t pin, bool pullup);
+  void loop();
+
+  // Defaults EJECT_DEBOUNCE_MS / EJECT_REFIRE_MS
+  void setTiming(uint32_t debounceMs, uint32_t refireMs);
+  uint32_t debounceMs();
+  uint32_t refireMs();
+
+  // Decisions, for host harnesses. All are reported from loop(); the ISR
+  // only counts Edge/Bounce/High.
+  enum class Event : uint8_t {
+    Edge,     // taken: eject requested
+    Bounce,   // inside the debounce window
+    High,     // past the window but the line was HIGH again
+    Fire,     // loop() sent the eject command
+    Held      // a request waits for the refire window (once per request)
+  };
+  typedef void (*Observer)(Event e);
+  void setObserver(Observer fn);
+}
@@ -9,11 +9,35 @@
 #include "wifimgr.h"
 #include "audio_player.h"
 #include "led_stat.h"
+#include "web_json.h"
+#include "sha256.h"
+#include "fs_worker.h"
+#include "sound_index.h"
+#include "trace.h"
+
+#include <atomic>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // -------- Settings --------
 static const char* kBootPath  = "/boot.mp3";
 static const char* kEjectPath = "/eject.mp3";
 static const size_t kMaxUploadBytes = 6 * 1024 * 1024; // safety cap
+static const uint32_t kPostWaitMs = 2000;               // worker queue back-pressure
+
+// Concurrent uploads (one per slot is the useful maximum)
+#ifndef XS_MAX_UPLOADS
+  #define XS_MAX_UPLOADS 2
+#endif
+
+// Upload write buffer. Incoming chunks (~1 TCP segment each) are gathered
+// and written in blocks that end on multiples of this size in the file, so
+// SPIFFS sees whole, aligned pages instead of one small write per segment.
+// 4096 = one SPIFFS logical block on ESP32.
+#ifndef XS_UPLOAD_BUF
+  #define XS_UPLOAD_BUF 4096
+#endif
 
 // -------- Persistent prefs (xsound namespace) --------
 // Cached settings to reduce NVS wear
@@ -37,6 +61,7 @@ static void fmBootSoundWrite(bool en) {
   if (g_bootEnabled == en) return;
   g_bootEnabled = en;
   AudioPlayer::setBootEnabled(en);  // Sync with audio player
+  TRACE_SCOPE("nvs_write");
   Preferences p;
   if (p.begin("xsound", /*ro=*/false)) {
     p.putBool("boot_enabled", en);
@@ -48,6 +73,7 @@ static void fmEjectSoundWrite(bool en) {
   if (g_ejectEnabled == en) return;
   g_ejectEnabled = en;
   AudioPlayer::setEjectEnabled(en);  // Sync with audio player
+  TRACE_SCOPE("nvs_write");
   Preferences p;
   if (p.begin("xsound", /*ro=*/false)) {
     p.putBool("eject_enabled", en);
@@ -62,6 +88,7 @@ static void fmVolumeWrite(uint8_t vol) {
   unsigned long now = millis();
   if (now - g_lastVolWriteMs < 250) return; // soft throttle
   g_lastVolWriteMs = now;
+  TRACE_SCOPE("nvs_write");
   Preferences p;
   if (p.begin("xsound", /*ro=*/false)) {
     p.putUChar("volume", vol);
@@ -69,61 +96,36 @@ static void fmVolumeWrite(uint8_t vol) {
   }
 }
 
-// Parse an integer JSON field like {"val":123} without pulling in ArduinoJson
-static int parseJsonIntField(const String& body, const char* key, int fallback = -1) {
-  // Look for "key"
-  String needle = String("\"") + key + "\"";
-  int k = body.indexOf(needle);
-  if (k < 0) return fallback;
-  // Find the colon after "key"
-  int colon = body.indexOf(':', k + needle.length());
-  if (colon < 0) return fallback;
-
-  // Skip whitespace
-  int i = colon + 1;
-  while (i < (int)body.length() && (body[i]==' '||body[i]=='\t'||body[i]=='\r'||body[i]=='\n')) i++;
-
-  // Optional sign
-  bool neg = false;
-  if (i < (int)body.length() && (body[i]=='+' || body[i]=='-')) { neg = (body[i]=='-'); i++; }
+// JSON body for POST /api/vol: {"val":N}
+struct VolBody {
+  long val;
+  bool has;
+};
 
-  // Read digits
-  if (i >= (int)body.length() || body[i]<'0' || body[i]>'9') return fallback;
-  long v = 0;
-  while (i < (int)body.length() && body[i] >= '0' && body[i] <= '9') {
-    v = v*10 + (body[i]-'0');
-    i++;
-    if (v > 1000000) break; // sanity
-  }
-  if (neg) v = -v;
-  return (int)v;
+static void onVolField(VolBody& b, const JsonReader::Event& ev) {
+  if (ev.depth == 1 && ev.keyIs("val")) b.has = ev.toInt(b.val);
 }
 
 // -------------- Utils --------------
-static String humanSize(uint64_t b) {
+// Formats into a caller buffer with integer math (no String / float printf).
+static void humanSize(uint64_t b, char* out, size_t n) {
   const char* units[] = {"B","KB","MB","GB"};
-  double s = (double)b;
+  uint64_t div = 1;
   int u = 0;
-  while (s >= 1024.0 && u < 3) { s /= 1024.0; u++; }
-  char buf[32];
-  snprintf(buf, sizeof(buf), (u==0) ? "%.0f %s" : "%.2f %s", s, units[u]);
-  return String(buf);
-}
-
-static String jsonEscape(const String& in) {
-  String out; out.reserve(in.length()+8);
-  for (size_t i=0;i<in.length();++i) {
-    char c=in[i];
-    switch(c){
-      case '\\': out += "\\\\"; break;
-      case '"':  out += "\\\""; break;
-      case '\n': out += "\\n";  break;
-      case '\r': out += "\\r";  break;
-      case '\t': out += "\\t";  break;
-      default:   out += c;      break;
-    }
+  while (b >= div * 1024 && u < 3) { div *= 1024; u++; }
+  if (u == 0) {
+    snprintf(out, n, "%u %s", (unsigned)b, units[0]);
+  } else {
+    const uint64_t centi = (b * 100 + div / 2) / div;
+    snprintf(out, n, "%u.%02u %s", (unsigned)(centi / 100), (unsigned)(centi % 100), units[u]);
   }
-  return out;
+}
+
+static int volToPercent(int v) {
+  int percent = (int)round((v / 255.0f) * 100.0f);
+  if (percent < 0) percent = 0;
+  if (percent > 100) percent = 100;
+  return percent;
 }
 
 static void addNoStore(AsyncWebServerResponse* resp) {
@@ -241,12 +243,20 @@ hr{border:none;height:1px;background:#333;margin:.8rem 0}
 <script>
 function setStatus(t){document.getElementById('status').textContent=t;}
 
+function slotInfo(s){
+  if (!s.exists) return 'missing';
+  let t = s.size_h;
+  if (s.duration_ms) t += ' · ' + (s.duration_ms/1000).toFixed(1) + ' s';
+  if (s.bitrate) t += ' · ' + s.bitrate + ' kbps' + (s.vbr ? ' VBR' : '');
+  return t;
+}
+
 function refresh(){
   fetch('/api/files',{cache:'no-store'}).then(r=>r.json()).then(j=>{
     document.getElementById('used').textContent = j.used_h;
     document.getElementById('free').textContent = j.free_h;
-    document.getElementById('bootInfo').textContent  = j.boot.exists ? (j.boot.size_h) : 'missing';
-    document.getElementById('ejectInfo').textContent = j.eject.exists ? (j.eject.size_h): 'missing';
+    document.getElementById('bootInfo').textContent  = slotInfo(j.boot);
+    document.getElementById('ejectInfo').textContent = slotInfo(j.eject);
   }).catch(()=>setStatus('Failed to query storage.'));
 
   fetch('/api/vol',{cache:'no-store'}).then(r=>r.json()).then(j=>{
@@ -293,24 +303,84 @@ function commitVol(v){
   }, 120);
 }
 
-function upload(slot){
+// Uploads resume after a dropped connection: the device keeps the partial
+// file and reports its length at /api/upload/status.
+const UP_RETRIES = 5;
+
+async function sha256Hex(f){
+  // crypto.subtle only exists on secure origins; skip verification otherwise
+  if(!(window.crypto && crypto.subtle)) return '';
+  try{
+    const d = await crypto.subtle.digest('SHA-256', await f.arrayBuffer());
+    return Array.from(new Uint8Array(d)).map(b=>b.toString(16).padStart(2,'0')).join('');
+  }catch(e){ return ''; }
+}
+
+function uploadStatus(slot){
+  return fetch('/api/upload/status?slot='+encodeURIComponent(slot),{cache:'no-store'}).then(r=>r.json());
+}
+
+function sendPart(slot, f, offset, sha){
+  return new Promise(resolve=>{
+    let q = 'slot='+encodeURIComponent(slot)+'&offset='+offset+'&size='+f.size+'&t='+Math.floor(Date.now()/1000);
+    if (sha) q += '&sha256='+sha;
+    const xhr = new XMLHttpRequest();
+    xhr.open('POST','/api/upload?'+q,true);
+    xhr.upload.onprogress = function(ev){
+      if (!ev.lengthComputable || !f.size) return;
+      const done = offset + ev.loaded * (f.size - offset) / ev.total;
+      setStatus('Uploading '+f.name+' … '+Math.floor(done*100/f.size)+'%');
+    };
+    xhr.onload = function(){
+      let j = {};
+      try{ j = JSON.parse(xhr.responseText||'{}'); }catch(e){}
+      resolve({net:true, j:j});
+    };
+    xhr.onerror = xhr.ontimeout = function(){ resolve({net:false, j:{}}); };
+    const form = new FormData();
+    form.append('file', f.slice(offset), f.name);
+    xhr.send(form);
+  });
+}
+
+async function upload(slot){
   const inp = document.getElementById(slot==='boot'?'bootFile':'ejectFile');
   if(!inp.files || !inp.files[0]) { setStatus('Please choose an MP3 file.'); return; }
   const f = inp.files[0];
   if(!f.name.toLowerCase().endsWith('.mp3')){ setStatus('Only .mp3 files are allowed.'); return; }
-  setStatus('Uploading '+f.name+' …');
-  const xhr = new XMLHttpRequest();
-  xhr.open('POST','/api/upload?slot='+encodeURIComponent(slot),true);
-  xhr.onload = function(){
-    try{
-      const j = JSON.parse(xhr.responseText||'{}');
-      setStatus(j.ok ? 'Upload complete.' : ('Upload failed: '+(j.err||'unknown')));
-    }catch(e){ setStatus('Upload status unknown.'); }
-    refresh();
-  };
-  const form = new FormData();
-  form.append('file', f, f.name);
-  xhr.send(form);
+
+  setStatus('Preparing '+f.name+' …');
+  const sha = await sha256Hex(f);
+  const key = 'xs_up_'+slot, id = f.name+':'+f.size+':'+f.lastModified;
+
+  // Same file as an earlier interrupted attempt? Continue where it stopped.
+  let offset = 0;
+  if (localStorage.getItem(key) === id) {
+    try{ const s = await uploadStatus(slot); if (s.ok && s.offset < f.size) offset = s.offset; }catch(e){}
+  }
+  localStorage.setItem(key, id);
+
+  for (let attempt = 0; attempt <= UP_RETRIES; attempt++) {
+    const r = await sendPart(slot, f, offset, sha);
+    if (r.net && r.j.ok) {
+      localStorage.removeItem(key);
+      setStatus('Upload complete.');
+      refresh();
+      return;
+    }
+    if (r.net && r.j.err && r.j.err !== 'incomplete' && r.j.err !== 'offset mismatch') {
+      localStorage.removeItem(key);
+      setStatus('Upload failed: '+r.j.err);
+      refresh();
+      return;
+    }
+    // Dropped connection or short transfer: ask the device where to resume
+    await new Promise(res=>setTimeout(res, 1000));
+    try{ const s = await uploadStatus(slot); offset = (s.ok && s.offset <= f.size) ? s.offset : 0; }catch(e){}
+    setStatus('Connection lost, resuming at '+Math.floor(offset/1024)+' KB …');
+  }
+  setStatus('Upload interrupted. Press Upload again to resume.');
+  refresh();
 }
 
 function delFile(slot){
@@ -363,187 +433,561 @@ refresh();
 )HTML";
 
 // -------------- Helpers --------------
-static String slotToPath(const String& slot) {
-  if (slot == "boot")  return String(kBootPath);
-  if (slot == "eject") return String(kEjectPath);
-  return String();
+static const char* slotToPath(const String& slot) {
+  if (slot == "boot")  return kBootPath;
+  if (slot == "eject") return kEjectPath;
+  return nullptr;
 }
 
+static void putSizeField(JsonWriter& w, const char* key, uint64_t b) {
+  char tmp[24];
+  humanSize(b, tmp, sizeof(tmp));
+  w.kv(key, (const char*)tmp);
+}
+
+// Handlers below only validate parameters; anything that touches SPIFFS
+// runs as an FsWorker job and the reply is sent when it has finished.
+
 // -------------- REST: list --------------
+// Answered from the sound index: no filesystem access.
+static void putSlot(JsonWriter& j, const char* key, const char* path) {
+  SoundIndex::Info s;
+  SoundIndex::get(path, s);
+  j.key(key).beginObject().kv("exists", s.exists).kv("size", s.size);
+  putSizeField(j, "size_h", s.size);
+  if (s.exists) {
+    j.kv("duration_ms", s.durationMs)
+     .kv("bitrate", s.bitrate)
+     .kv("sample_rate", s.sampleRate)
+     .kv("channels", s.channels)
+     .kv("vbr", s.vbr)
+     .kv("uploaded", s.uploaded);
+    if (s.hasSha) {
+      char hex[Sha256::kSize * 2 + 1];
+      Sha256::toHex(s.sha, hex);
+      j.kv("sha256", (const char*)hex);
+    }
+  }
+  j.endObject();
+}
+
 static void handleList(AsyncWebServerRequest* req) {
-  uint64_t total = SPIFFS.totalBytes();
-  uint64_t used  = SPIFFS.usedBytes();
-  uint64_t freeb = (total > used) ? (total - used) : 0;
-
-  struct Info { bool exists; uint64_t size; };
-  Info boot{false,0}, eject{false,0};
-
-  File f;
-  if ((f = SPIFFS.open(kBootPath, "r"))) { boot.exists = true; boot.size = f.size(); f.close(); }
-  if ((f = SPIFFS.open(kEjectPath,"r"))) { eject.exists = true; eject.size= f.size(); f.close(); }
-
-  String j = "{";
-  j += "\"used\":" + String((uint32_t)used) + ",";
-  j += "\"free\":" + String((uint32_t)freeb) + ",";
-  j += "\"used_h\":\"" + jsonEscape(humanSize(used)) + "\",";
-  j += "\"free_h\":\"" + jsonEscape(humanSize(freeb)) + "\",";
-  j += "\"boot\":{\"exists\":" + String(boot.exists?"true":"false") + ",\"size\":" + String((uint32_t)boot.size) + ",\"size_h\":\"" + jsonEscape(humanSize(boot.size)) + "\"},";
-  j += "\"eject\":{\"exists\":" + String((eject.exists?"true":"false")) + ",\"size\":" + String((uint32_t)eject.size) + ",\"size_h\":\"" + jsonEscape(humanSize(eject.size)) + "\"}";
-  j += "}";
-  auto* resp = req->beginResponse(200, "application/json", j);
-  addNoStore(resp);
-  req->send(resp);
+  const SoundIndex::Usage u = SoundIndex::usage();
+  const uint64_t freeb = (u.total > u.used) ? (u.total - u.used) : 0;
+
+  WebJson::Reply j;
+  j.beginObject();
+  j.kv("used", (uint32_t)u.used);
+  j.kv("free", (uint32_t)freeb);
+  putSizeField(j, "used_h", u.used);
+  putSizeField(j, "free_h", freeb);
+  putSlot(j, "boot", kBootPath);
+  putSlot(j, "eject", kEjectPath);
+  j.endObject();
+  j.send(req);
 }
 
 // -------------- REST: download --------------
 static void handleDownload(AsyncWebServerRequest* req) {
   if (!req->hasParam("slot")) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"slot param\"}");
+    WebJson::sendError(req, 400, "slot param");
     return;
   }
-  String p = slotToPath(req->getParam("slot")->value());
-  if (!p.length() || !SPIFFS.exists(p)) {
-    req->send(404, "application/json", "{\"ok\":false,\"err\":\"not found\"}");
+  const char* p = slotToPath(req->getParam("slot")->value());
+  if (!p) {
+    WebJson::sendError(req, 404, "not found");
     return;
   }
 
-  AsyncWebServerResponse* resp = req->beginResponse(SPIFFS, p, "audio/mpeg", /*download*/ true);
-  const char* fname = (p == String("/boot.mp3")) ? "boot.mp3" : "eject.mp3";
-  resp->addHeader("Content-Disposition", String("attachment; filename=\"") + fname + "\"");
-  addNoStore(resp);
-  req->send(resp);
+  const char* disp = (p == kBootPath) ? "attachment; filename=\"boot.mp3\""
+                                      : "attachment; filename=\"eject.mp3\"";
+  FsWorker::sendFile(req, p, "audio/mpeg", disp);
 }
 
 // -------------- REST: delete --------------
-static void handleDelete(AsyncWebServerRequest* req) {
-  if (!req->hasParam("slot")) { req->send(400, "application/json", "{\"ok\":false,\"err\":\"slot param\"}"); return; }
-  String p = slotToPath(req->getParam("slot")->value());
-  if (!p.length()) { req->send(400, "application/json", "{\"ok\":false,\"err\":\"bad slot\"}"); return; }
+static int deleteJson(JsonWriter& j, const char* p, void*) {
   bool ok = SPIFFS.exists(p) ? SPIFFS.remove(p) : true;
-  req->send(ok ? 200 : 500, "application/json", ok ? "{\"ok\":true}" : "{\"ok\":false}");
+  // Drop any half-finished upload for this slot as well
+  char part[24];
+  snprintf(part, sizeof(part), "%s.part", p);
+  if (SPIFFS.exists(part)) SPIFFS.remove(part);
+  SoundIndex::remove(p);
+  j.beginObject().kv("ok", ok).endObject();
+  return ok ? 200 : 500;
 }
 
-// -------------- REST: upload (multipart) --------------
-static void handleUploadCompleted(AsyncWebServerRequest* request, bool ok, const char* errMsg) {
-  String body = ok ? "{\"ok\":true}" : (String("{\"ok\":false,\"err\":\"") + (errMsg?errMsg:"fail") + "\"}");
-  auto* resp = request->beginResponse(ok?200:400, "application/json", body);
-  resp->addHeader("Cache-Control", "no-store");
-  request->send(resp);
+static void handleDelete(AsyncWebServerRequest* req) {
+  if (!req->hasParam("slot")) { WebJson::sendError(req, 400, "slot param"); return; }
+  const char* p = slotToPath(req->getParam("slot")->value());
+  if (!p) { WebJson::sendError(req, 400, "bad slot"); return; }
+  FsWorker::replyJson(req, deleteJson, p);
 }
 
-static void handleUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
-  static File out;
-  static String targetPath;
-  static size_t written = 0;
-  static bool ok = true;
-  static String err;
-
-  if (index == 0) {
-    ok = true; err = ""; written = 0; targetPath = "";
-    
-    // Get the slot (boot or eject)
-    if (!request->hasParam("slot")) { 
-      ok = false; 
-      err = "slot param"; 
+// -------------- REST: upload (multipart, resumable) --------------
+// Data is written to "<slot>.part" and only swapped into the slot once it is
+// complete (and matches ?sha256= if the client sent one), so a dropped
+// transfer never leaves the slot empty. The client asks /api/upload/status
+// for the byte count already on flash and re-posts the rest with ?offset=.
+//
+// Swap order: .part -> .new, remove slot, .new -> slot. A .new left behind
+// by a power cut mid-swap is finished by recoverSlotSwaps() at boot.
+
+static void sidePath(const char* slotPath, const char* suffix, char* out, size_t n) {
+  snprintf(out, n, "%s%s", slotPath, suffix);
+}
+
+static size_t fileSize(const char* path) {
+  File f = SPIFFS.open(path, "r");
+  if (!f) return 0;
+  size_t n = f.size();
+  f.close();
+  return n;
+}
+
+bool FileMan::commitPart(const char* slotPath, const char* partPath) {
+  char newPath[24];
+  sidePath(slotPath, ".new", newPath, sizeof(newPath));
+  if (SPIFFS.exists(newPath)) SPIFFS.remove(newPath);
+  if (!SPIFFS.rename(partPath, newPath)) return false;
+  if (SPIFFS.exists(slotPath) && !SPIFFS.remove(slotPath)) return false;
+  return SPIFFS.rename(newPath, slotPath);
+}
+
+static void recoverSlotSwaps() {
+  const char* slots[] = { kBootPath, kEjectPath };
+  for (const char* slotPath : slots) {
+    char newPath[24];
+    sidePath(slotPath, ".new", newPath, sizeof(newPath));
+    if (!SPIFFS.exists(newPath)) continue;
+    if (SPIFFS.exists(slotPath)) SPIFFS.remove(slotPath);
+    const bool ok = SPIFFS.rename(newPath, slotPath);
+    Serial.printf("[FileMan] Finished interrupted swap for %s: %s\n", slotPath, ok ? "ok" : "FAILED");
+  }
+}
+
+// Re-hash what is already in the .part so the digest covers the whole file.
+// Runs on the worker; lets playback at the flash between reads.
+static bool hashExisting(const char* path, size_t len, Sha256& hash) {
+  File f = SPIFFS.open(path, "r");
+  if (!f) return false;
+  uint8_t buf[1024];
+  size_t left = len;
+  while (left) {
+    const size_t n = f.read(buf, left < sizeof(buf) ? left : sizeof(buf));
+    if (!n) break;
+    hash.update(buf, n);
+    left -= n;
+    FsWorker::yieldLock();
+  }
+  f.close();
+  return left == 0;
+}
+
+// One context per upload in flight, keyed by the request that owns it, so
+// uploads to different slots (e.g. a tool pushing boot + eject at once)
+// each get their own file, hash and progress. Beyond XS_MAX_UPLOADS the
+// request is answered 503; a second upload to a busy slot gets 409.
+//
+// The AsyncTCP callbacks only validate and copy data into one of two
+// blocks; opening, writing, hashing and the final swap are FsWorker jobs.
+// Jobs for one upload run in the order posted (begin, blocks, result,
+// close) and a context is reused only after its close job has run.
+struct UploadCtx;
+
+struct UploadBlock {
+  UploadCtx*        owner = nullptr;
+  std::atomic<bool> busy{false};  // queued or being written
+  size_t            len = 0;
+  uint8_t           data[XS_UPLOAD_BUF];
+};
+
+struct UploadCtx {
+  // AsyncTCP side
+  AsyncWebServerRequest* req = nullptr;
+  const char* slotPath = nullptr;
+  char        partPath[24] = {0};
+  bool        ownsSlot = false;   // passed the busy check
+  size_t      offset = 0;         // bytes already in .part when this request started
+  size_t      written = 0;        // bytes accepted by this request (incl. buffered)
+  size_t      expected = 0;       // ?size= (whole file), 0 = unknown
+  size_t      contentLength = 0;
+  bool        hasSha = false;
+  uint8_t     sha[Sha256::kSize];
+  uint32_t    clientTime = 0;     // ?t= (unix seconds) for the index if we have no clock
+  bool        done = false;       // final chunk seen
+  UploadBlock blocks[2];
+  uint8_t     cur = 0;            // block being filled
+  unsigned long startMs = 0;
+  SemaphoreHandle_t blockFreed = nullptr;
+  std::atomic<bool> inUse{false}; // until the close job has run
+
+  // Worker side
+  File        out;
+  Sha256      hash;               // always kept: the index stores it
+  uint8_t     digest[Sha256::kSize];
+  uint32_t    writes = 0;         // flash write calls
+  unsigned long elapsedMs = 0;
+
+  // Either side; the first failure wins
+  std::atomic<bool> ok{true};
+  int         code = 400;         // HTTP status when !ok
+  const char* err = nullptr;
+};
+
+static UploadCtx g_uploads[XS_MAX_UPLOADS];
+
+static void failUpload(UploadCtx& u, int code, const char* err) {
+  bool expected = true;
+  if (u.ok.compare_exchange_strong(expected, false)) { u.code = code; u.err = err; }
+}
+
+static UploadCtx* findUpload(AsyncWebServerRequest* request) {
+  for (auto& u : g_uploads) if (u.req == request) return &u;
+  return nullptr;
+}
+
+static UploadCtx* claimUpload(AsyncWebServerRequest* request) {
+  for (auto& u : g_uploads) {
+    bool expected = false;
+    if (!u.inUse.compare_exchange_strong(expected, true)) continue;
+    u.req = request;
+    u.ok.store(true); u.code = 400; u.err = nullptr; u.done = false;
+    u.slotPath = nullptr; u.partPath[0] = '\0'; u.ownsSlot = false;
+    u.offset = 0; u.written = 0; u.expected = 0; u.contentLength = 0;
+    u.cur = 0; u.blocks[0].len = 0; u.blocks[1].len = 0;
+    u.writes = 0; u.startMs = millis(); u.elapsedMs = 0;
+    u.hasSha = false; u.clientTime = 0;
+    u.hash.reset();
+    return &u;
+  }
+  return nullptr;
+}
+
+static bool slotBusy(const char* slotPath, const UploadCtx* self) {
+  for (auto& u : g_uploads) {
+    if (&u != self && u.req && u.slotPath == slotPath) return true;
+  }
+  return false;
+}
+
+static bool hasFilePart(AsyncWebServerRequest* request) {
+  for (size_t i = 0; i < request->params(); ++i) {
+    if (request->getParam(i)->isFile()) return true;
+  }
+  return false;
+}
+
+// ---- Worker jobs ----
+static void beginUploadJob(void* arg) {
+  UploadCtx& u = *static_cast<UploadCtx*>(arg);
+  if (!u.ok) return;
+
+  // Resume only from exactly what is on flash
+  const size_t partSize = fileSize(u.partPath);
+  if (u.offset && u.offset != partSize) {
+    failUpload(u, 400, "offset mismatch"); return;
+  }
+
+  // Space check against the whole request, not the first chunk. Content-Length
+  // includes the multipart framing, so this errs on the safe side.
+  uint64_t freeb = SPIFFS.totalBytes() - SPIFFS.usedBytes();
+  if (!u.offset) freeb += partSize;  // will be truncated
+  const uint64_t need = (uint64_t)u.contentLength + 4096;
+  if (freeb < need) {
+    // Not enough room to hold old + new side by side: give up atomicity
+    // rather than refusing an upload that fits once the old file is gone.
+    const size_t oldSize = fileSize(u.slotPath);
+    if (oldSize && freeb + oldSize >= need) {
+      Serial.printf("[FileMan] Low space: removing %s before upload\n", u.slotPath);
+      SPIFFS.remove(u.slotPath);
+      SoundIndex::remove(u.slotPath);
     } else {
-      String slot = request->getParam("slot")->value();
-      targetPath = slotToPath(slot);
-      if (!targetPath.length()) { 
-        ok = false; 
-        err = "bad slot"; 
-      }
-    }
-    
-    // Check file extension - must be .mp3
-    String lower = filename; 
-    lower.toLowerCase();
-    if (ok && !lower.endsWith(".mp3")) { 
-      ok = false; 
-      err = "only .mp3 files allowed"; 
+      failUpload(u, 400, "not enough space"); return;
     }
+  }
 
-    // Check available space
-    if (ok) {
-      uint64_t total = SPIFFS.totalBytes();
-      uint64_t used = SPIFFS.usedBytes();
-      if (total - used < (uint64_t)len + 4096) { 
-        ok = false; 
-        err = "not enough space"; 
-      }
-    }
-    
-    if (ok) {
-      // Remove existing file at target path
-      if (SPIFFS.exists(targetPath)) {
-        SPIFFS.remove(targetPath);
-      }
-      
-      // Open file at TARGET path (e.g. /boot.mp3 or /eject.mp3)
-      // This automatically renames any uploaded file to the correct name
-      out = SPIFFS.open(targetPath, "w");
-      if (!out) { 
-        ok = false; 
-        err = "failed to create file"; 
-      } else {
-        Serial.printf("[FileMan] Uploading to: %s (original: %s)\n", 
-                     targetPath.c_str(), filename.c_str());
-      }
+  if (u.offset && !hashExisting(u.partPath, u.offset, u.hash)) {
+    failUpload(u, 400, "read failed"); return;
+  }
+
+  u.out = SPIFFS.open(u.partPath, u.offset ? "a" : "w");
+  if (!u.out) {
+    failUpload(u, 400, "failed to create file"); return;
+  }
+  Serial.printf("[FileMan] Uploading to: %s at offset %u\n", u.partPath, (unsigned)u.offset);
+}
+
+static void writeBlockJob(void* arg) {
+  UploadBlock& b = *static_cast<UploadBlock*>(arg);
+  UploadCtx& u = *b.owner;
+  TRACE_SCOPE_ARG("flash_write", b.len);
+  if (u.ok && u.out) {
+    u.hash.update(b.data, b.len);
+    if (u.out.write(b.data, b.len) != b.len) failUpload(u, 400, "write failed");
+    u.writes++;
+  }
+  b.len = 0;
+  b.busy.store(false);
+  xSemaphoreGive(u.blockFreed);
+}
+
+static void finishUpload(UploadCtx& u) {
+  if (u.out) u.out.close();
+  u.elapsedMs = millis() - u.startMs;
+  if (!u.ok) return;
+
+  const size_t total = u.offset + u.written;
+  if (u.expected && total != u.expected) {
+    failUpload(u, 400, "incomplete"); return;  // keep .part for resume
+  }
+
+  u.hash.finish(u.digest);
+  if (u.hasSha && memcmp(u.digest, u.sha, sizeof(u.digest)) != 0) {
+    SPIFFS.remove(u.partPath);
+    failUpload(u, 400, "checksum mismatch"); return;
+  }
+
+  if (!FileMan::commitPart(u.slotPath, u.partPath)) {
+    failUpload(u, 500, "swap failed"); return;
+  }
+  // Prefer our own clock (if SNTP ever set it) over the client's
+  const time_t now = time(nullptr);
+  SoundIndex::update(u.slotPath, u.digest, now > 1600000000 ? (uint32_t)now : u.clientTime);
+  Serial.printf("[FileMan] Upload complete: %u bytes written to %s (%lu ms, %u writes)\n",
+                (unsigned)total, u.slotPath, (unsigned long)u.elapsedMs, (unsigned)u.writes);
+}
+
+static int uploadResultJson(JsonWriter& j, const char*, void* ctx) {
+  UploadCtx& u = *static_cast<UploadCtx*>(ctx);
+  finishUpload(u);
+
+  const bool ok = u.ok.load();
+  j.beginObject().kv("ok", ok);
+  if (ok) {
+    j.kv("bytes", (uint32_t)(u.offset + u.written));
+    char hex[Sha256::kSize * 2 + 1];
+    Sha256::toHex(u.digest, hex);
+    j.kv("sha256", (const char*)hex);
+    // Throughput of this request (resumed bytes excluded)
+    const unsigned long ms = u.elapsedMs ? u.elapsedMs : 1;
+    j.kv("ms", (uint32_t)u.elapsedMs)
+     .kv("kBps", (uint32_t)((uint64_t)u.written / ms))   // bytes per ms, as /api/bench
+     .kv("writes", u.writes)
+     .kv("buf", (uint32_t)XS_UPLOAD_BUF);
+  } else {
+    j.kv("err", u.err ? u.err : "fail");
+    // Where the client should resume from (not while another upload owns the slot)
+    j.kv("offset", (uint32_t)(u.ownsSlot ? fileSize(u.partPath) : 0));
+  }
+  j.endObject();
+  return ok ? 200 : u.code;
+}
+
+// Closing keeps the .part bytes on flash for a later resume
+static void closeUploadJob(void* arg) {
+  UploadCtx& u = *static_cast<UploadCtx*>(arg);
+  if (u.out) u.out.close();
+  SoundIndex::refreshUsage();  // .part bytes count too
+  u.inUse.store(false);
+}
+
+// ---- AsyncTCP side ----
+// Hand the block being filled to the worker and switch to the other one
+static bool postBlock(UploadCtx& u) {
+  UploadBlock& b = u.blocks[u.cur];
+  if (!b.len) return true;
+  b.busy.store(true);
+  if (!FsWorker::post(writeBlockJob, &b, kPostWaitMs)) {
+    b.busy.store(false);
+    failUpload(u, 503, "fs busy");
+    return false;
+  }
+  u.cur ^= 1;
+  return true;
+}
+
+// The block about to be filled may still be on its way to flash. Waiting
+// here is the back-pressure point; it only happens when the flash has
+// fallen two blocks behind the network.
+static UploadBlock* fillBlock(UploadCtx& u) {
+  UploadBlock& b = u.blocks[u.cur];
+  const unsigned long start = millis();
+  while (b.busy.load()) {
+    if (millis() - start > kPostWaitMs) { failUpload(u, 503, "fs busy"); return nullptr; }
+    xSemaphoreTake(u.blockFreed, pdMS_TO_TICKS(50));
+  }
+  return &b;
+}
+
+// Blocks are cut so each write ends on an XS_UPLOAD_BUF boundary of the
+// file (resumed uploads start mid-block).
+static bool appendUpload(UploadCtx& u, const uint8_t* data, size_t len) {
+  while (len) {
+    UploadBlock* b = fillBlock(u);
+    if (!b) return false;
+    const size_t onFlash = u.offset + u.written - b->len;
+    const size_t target  = XS_UPLOAD_BUF - (onFlash % XS_UPLOAD_BUF);
+    size_t take = target - b->len;
+    if (take > len) take = len;
+    memcpy(b->data + b->len, data, take);
+    b->len += take;
+    u.written += take;
+    data += take;
+    len -= take;
+    if (b->len == target && !postBlock(u)) return false;
+  }
+  return true;
+}
+
+// Request answered or client gone: queue what is buffered (kept for a
+// resume) and let the worker close the file and free the context. The
+// close must not be dropped, so this waits for queue space.
+static void releaseUpload(UploadCtx* u) {
+  if (u->ok) postBlock(*u);
+  u->req = nullptr;
+  if (!FsWorker::post(closeUploadJob, u, portMAX_DELAY)) {
+    FsWorker::Guard g;  // worker not running: nothing else is queued
+    closeUploadJob(u);
+  }
+}
+
+static void beginUpload(UploadCtx& u, AsyncWebServerRequest* request, const String& filename) {
+  // Close our file if this client goes away mid-transfer
+  request->onDisconnect([request]() {
+    if (UploadCtx* c = findUpload(request)) releaseUpload(c);
+  });
+
+  // Get the slot (boot or eject)
+  if (!request->hasParam("slot")) {
+    failUpload(u, 400, "slot param"); return;
+  }
+  u.slotPath = slotToPath(request->getParam("slot")->value());
+  if (!u.slotPath) {
+    failUpload(u, 400, "bad slot"); return;
+  }
+  if (slotBusy(u.slotPath, &u)) {
+    failUpload(u, 409, "slot busy"); return;
+  }
+  u.ownsSlot = true;
+  sidePath(u.slotPath, ".part", u.partPath, sizeof(u.partPath));
+
+  // Check file extension - must be .mp3
+  String lower = filename;
+  lower.toLowerCase();
+  if (!lower.endsWith(".mp3")) {
+    failUpload(u, 400, "only .mp3 files allowed"); return;
+  }
+
+  if (request->hasParam("offset")) u.offset   = (size_t)request->getParam("offset")->value().toInt();
+  if (request->hasParam("size"))   u.expected = (size_t)request->getParam("size")->value().toInt();
+  if (request->hasParam("sha256")) {
+    u.hasSha = Sha256::fromHex(request->getParam("sha256")->value().c_str(), u.sha);
+    if (!u.hasSha) { failUpload(u, 400, "bad sha256"); return; }
+  }
+  if (request->hasParam("t"))      u.clientTime = (uint32_t)request->getParam("t")->value().toInt();
+  if (u.expected > kMaxUploadBytes) {
+    failUpload(u, 400, "file too large"); return;
+  }
+  u.contentLength = request->contentLength();
+
+  Serial.printf("[FileMan] Upload to %s starting (original: %s)\n", u.slotPath, filename.c_str());
+  if (!FsWorker::post(beginUploadJob, &u, kPostWaitMs)) failUpload(u, 503, "fs busy");
+}
+
+static void handleUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
+  TRACE_SCOPE_ARG("upload_chunk", len);
+  UploadCtx* u = findUpload(request);
+  if (index == 0 && !u) {
+    u = claimUpload(request);
+    if (!u) {
+      Serial.println("[FileMan] Upload rejected: too many concurrent uploads");
+      return;  // answered with 503 once the body has been drained
     }
+    beginUpload(*u, request, filename);
   }
+  if (!u || u->done) return;  // rejected, or an extra file part
 
-  if (ok && len) {
-    if (written + len > kMaxUploadBytes) { 
-      ok = false; 
-      err = "file too large"; 
-    } else if (out.write(data, len) != len) { 
-      ok = false; 
-      err = "write failed"; 
+  if (u->ok && len) {
+    const size_t pos = u->offset + u->written;
+    if (pos + len > kMaxUploadBytes || (u->expected && pos + len > u->expected)) {
+      failUpload(*u, 400, "file too large");
     } else {
-      written += len;
+      appendUpload(*u, data, len);
     }
   }
 
   if (final) {
-    if (out) {
-      out.close();
-      if (ok) {
-        Serial.printf("[FileMan] Upload complete: %u bytes written to %s\n", 
-                     written, targetPath.c_str());
-      }
-    }
-    handleUploadCompleted(request, ok, ok ? nullptr : err.c_str());
-    targetPath = ""; 
-    written = 0; 
-    ok = true; 
-    err = "";
+    u->done = true;
+    if (u->ok) postBlock(*u);
+  }
+}
+
+// Called once the whole request body has been received. The result job is
+// queued behind the last block, so it sees the complete file.
+static void handleUploadRequest(AsyncWebServerRequest* request) {
+  UploadCtx* u = findUpload(request);
+  if (!u) {
+    if (hasFilePart(request)) WebJson::sendError(request, 503, "too many uploads");
+    else                      WebJson::sendError(request, 400, "no file");
+    return;
   }
+  if (!u->done) {
+    u->done = true;
+    if (u->ok) postBlock(*u);
+  }
+  FsWorker::replyJson(request, uploadResultJson, nullptr, u);
+  releaseUpload(u);
+}
+
+// GET /api/upload/status?slot= : bytes of an interrupted upload on flash,
+// or live progress if an upload to that slot is running
+static int partStatusJson(JsonWriter& j, const char* p, void*) {
+  char part[24];
+  sidePath(p, ".part", part, sizeof(part));
+  j.beginObject().kv("ok", true).kv("busy", false).kv("offset", (uint32_t)fileSize(part)).endObject();
+  return 200;
+}
+
+static void handleUploadStatus(AsyncWebServerRequest* req) {
+  if (!req->hasParam("slot")) { WebJson::sendError(req, 400, "slot param"); return; }
+  const char* p = slotToPath(req->getParam("slot")->value());
+  if (!p) { WebJson::sendError(req, 400, "bad slot"); return; }
+
+  const UploadCtx* active = nullptr;
+  for (auto& u : g_uploads) if (u.req && u.slotPath == p && u.ok) active = &u;
+  if (!active) {
+    FsWorker::replyJson(req, partStatusJson, p);
+    return;
+  }
+
+  WebJson::Reply j;
+  j.beginObject().kv("ok", true).kv("busy", true)
+   .kv("offset", (uint32_t)active->offset)
+   .kv("received", (uint32_t)(active->offset + active->written))
+   .kv("expected", (uint32_t)active->expected)
+   .endObject();
+  j.send(req);
 }
 
 static void handleVolGet(AsyncWebServerRequest* req) {
-  int percent = (int)round((g_volume / 255.0f) * 100.0f);
-  if (percent < 0) percent = 0;
-  if (percent > 100) percent = 100;
-  String body = String("{\"vol\":") + String((int)g_volume) +
-                ",\"percent\":" + String(percent) + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  WebJson::Reply j;
+  j.beginObject().kv("vol", (int)g_volume).kv("percent", volToPercent(g_volume)).endObject();
+  j.send(req);
 }
 
 static void handleVolSet(AsyncWebServerRequest* req) {
-  // accept query (?val=), x-www-form-urlencoded (val), or JSON {"val":N}
+  // accept query (?val=), x-www-form-urlencoded (val), or JSON body {"val":N}
   // NOTE: val is still in RAW 0..255 units from the UI (we convert there)
   int vParsed = -1;
 
   if (req->hasParam("val")) {
     vParsed = req->getParam("val")->value().toInt();
-  } else if (req->hasParam("plain")) {
-    const String body = req->getParam("plain")->value();
-    vParsed = parseJsonIntField(body, "val", -1);
+  } else if (const VolBody* body = WebJson::parsedBody<VolBody>(req)) {
+    if (body->has) vParsed = (int)body->val;
   }
 
   if (vParsed < 0) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"val param\"}");
+    WebJson::sendError(req, 400, "val param");
     return;
   }
 
@@ -553,15 +997,9 @@ static void handleVolSet(AsyncWebServerRequest* req) {
   AudioPlayer::setVolume((uint8_t)vParsed);
   fmVolumeWrite((uint8_t)vParsed);   // persist volume (throttled)
 
-  int percent = (int)round((vParsed / 255.0f) * 100.0f);
-  if (percent < 0) percent = 0;
-  if (percent > 100) percent = 100;
-
-  String body = String("{\"ok\":true,\"vol\":") + String(vParsed) +
-                ",\"percent\":" + String(percent) + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  WebJson::Reply j;
+  j.beginObject().kv("ok", true).kv("vol", vParsed).kv("percent", volToPercent(vParsed)).endObject();
+  j.send(req);
 }
 
 // -------------- REST: play/stop --------------
@@ -569,30 +1007,30 @@ static void handleVolSet(AsyncWebServerRequest* req) {
 // from the Arduino loop task. This avoids cross-task heap races.
 static void handlePlay(AsyncWebServerRequest* req) {
   if (!req->hasParam("slot")) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"slot param\"}");
+    WebJson::sendError(req, 400, "slot param");
     return;
   }
-  String slot = req->getParam("slot")->value();
-  String path = slotToPath(slot);
-  if (!path.length()) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"bad slot\"}");
+  const String& slot = req->getParam("slot")->value();
+  const char* path = slotToPath(slot);
+  if (!path) {
+    WebJson::sendError(req, 400, "bad slot");
     return;
   }
 
   // CHECK: Boot sound enabled flag
   if (slot == "boot" && !g_bootEnabled) {
-    req->send(200, "application/json", "{\"ok\":false,\"err\":\"boot sound disabled\"}");
+    WebJson::sendError(req, 200, "boot sound disabled");
     return;
   }
 
   // CHECK: Eject sound enabled flag
   if (slot == "eject" && !g_ejectEnabled) {
-    req->send(200, "application/json", "{\"ok\":false,\"err\":\"eject sound disabled\"}");
+    WebJson::sendError(req, 200, "eject sound disabled");
     return;
   }
 
-  if (!SPIFFS.exists(path)) {
-    req->send(404, "application/json", "{\"ok\":false,\"err\":\"missing file\"}");
+  if (!SoundIndex::exists(path)) {
+    WebJson::sendError(req, 404, "missing file");
     return;
   }
 
@@ -600,53 +1038,49 @@ static void handlePlay(AsyncWebServerRequest* req) {
   if (slot == "boot")      AudioPlayer::enqueue(AudioPlayer::Cmd::PlayBoot);
   else /* eject */         AudioPlayer::enqueue(AudioPlayer::Cmd::PlayEject);
 
-  req->send(200, "application/json", "{\"ok\":true}");
+  WebJson::sendOk(req);
 }
 
 static void handleStop(AsyncWebServerRequest* req) {
   AudioPlayer::enqueue(AudioPlayer::Cmd::Stop);
-  req->send(200, "application/json", "{\"ok\":true}");
+  WebJson::sendOk(req);
 }
 
 // -------------- REST: boot/eject sound prefs --------------
+static void sendPref(AsyncWebServerRequest* req, bool withOk, bool enabled) {
+  WebJson::Reply j;
+  j.beginObject();
+  if (withOk) j.kv("ok", true);
+  j.kv("enabled", enabled).endObject();
+  j.send(req);
+}
+
 static void handleBootPrefGet(AsyncWebServerRequest* req) {
-  String body = String("{\"enabled\":") + (g_bootEnabled ? "true" : "false") + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  sendPref(req, false, g_bootEnabled);
 }
 
 static void handleBootPrefSet(AsyncWebServerRequest* req) {
   if (!req->hasParam("enabled")) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"enabled param\"}");
+    WebJson::sendError(req, 400, "enabled param");
     return;
   }
   const bool en = (req->getParam("enabled")->value().toInt() != 0);
   fmBootSoundWrite(en);
-  String body = String("{\"ok\":true,\"enabled\":") + (en ? "true" : "false") + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  sendPref(req, true, en);
 }
 
 static void handleEjectPrefGet(AsyncWebServerRequest* req) {
-  String body = String("{\"enabled\":") + (g_ejectEnabled ? "true" : "false") + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  sendPref(req, false, g_ejectEnabled);
 }
 
 static void handleEjectPrefSet(AsyncWebServerRequest* req) {
   if (!req->hasParam("enabled")) {
-    req->send(400, "application/json", "{\"ok\":false,\"err\":\"enabled param\"}");
+    WebJson::sendError(req, 400, "enabled param");
     return;
   }
   const bool en = (req->getParam("enabled")->value().toInt() != 0);
   fmEjectSoundWrite(en);
-  String body = String("{\"ok\":true,\"enabled\":") + (en ? "true" : "false") + "}";
-  auto* resp = req->beginResponse(200, "application/json", body);
-  addNoStore(resp);
-  req->send(resp);
+  sendPref(req, true, en);
 }
 
 // -------------- Route registration --------------
@@ -663,15 +1097,20 @@ static void registerRoutes(AsyncWebServer& server) {
   server.on("/api/download", HTTP_GET,  [](AsyncWebServerRequest* r){ handleDownload(r); });
   server.on("/api/delete",   HTTP_POST, [](AsyncWebServerRequest* r){ handleDelete(r);   });
 
-  // Upload (multipart). Response is sent in upload handler at final=true.
+  server.on("/api/upload/status", HTTP_GET, [](AsyncWebServerRequest* r){ handleUploadStatus(r); });
+  // Upload (multipart). Response is sent once the body is complete.
   server.on("/api/upload", HTTP_POST,
-    [](AsyncWebServerRequest* request){ /* response is sent in upload callback */ },
+    [](AsyncWebServerRequest* request){ handleUploadRequest(request); },
     handleUpload
   );
 
   // Volume + audio control
   server.on("/api/vol",        HTTP_GET,  [](AsyncWebServerRequest* r){ handleVolGet(r);      });
-  server.on("/api/vol",        HTTP_POST, [](AsyncWebServerRequest* r){ handleVolSet(r);      });
+  server.on("/api/vol",        HTTP_POST, [](AsyncWebServerRequest* r){ handleVolSet(r);      },
+    nullptr,
+    [](AsyncWebServerRequest* r, uint8_t* data, size_t len, size_t index, size_t total){
+      WebJson::feedBody<VolBody>(r, data, len, index, total, onVolField);
+    });
   server.on("/api/play",       HTTP_GET,  [](AsyncWebServerRequest* r){ handlePlay(r);        });
   server.on("/api/stop",       HTTP_POST, [](AsyncWebServerRequest* r){ handleStop(r);        });
 
@@ -684,7 +1123,18 @@ static void registerRoutes(AsyncWebServer& server) {
 
 namespace FileMan {
   void begin() {
-    SPIFFS.begin(true);
+    {
+      FsWorker::Guard g;
+      SPIFFS.begin(true);
+      recoverSlotSwaps();
+      SoundIndex::begin();
+    }
+
+    for (auto& u : g_uploads) {
+      u.blockFreed = xSemaphoreCreateBinary();
+      u.blocks[0].owner = &u;
+      u.blocks[1].owner = &u;
+    }
 
     // Load cached prefs once
     fmPrefsReadAll();
@@ -698,4 +1148,31 @@ namespace FileMan {
     AsyncWebServer& server = WiFiMgr::getServer();
     registerRoutes(server);
   }
+
+  bool uploading() {
+    for (auto& u : g_uploads) if (u.inUse.load()) return true;
+    return false;
+  }
+
+  void applySettings(int volume, int bootEnabled, int ejectEnabled) {
+    TRACE_SCOPE("nvs_write");
+    Preferences p;
+    if (!p.begin("xsound", /*ro=*/false)) return;
+    if (volume >= 0) {
+      g_volume = (uint8_t)(volume > 255 ? 255 : volume);
+      p.putUChar("volume", g_volume);
+      AudioPlayer::setVolume(g_volume);
+    }
+    if (bootEnabled >= 0) {
+      g_bootEnabled = bootEnabled != 0;
+      p.putBool("boot_enabled", g_bootEnabled);
+      AudioPlayer::setBootEnabled(g_bootEnabled);
+    }
+    if (ejectEnabled >= 0) {
+      g_ejectEnabled = ejectEnabled != 0;
+      p.putBool("eject_enabled", g_ejectEnabled);
+      AudioPlayer::setEjectEnabled(g_ejectEnabled);
+    }
+    p.end();
+  }
 }
@@ -5,4 +5,15 @@ namespace FileMan {
   // Register the /files UI and REST endpoints on the shared server.
   // SPIFFS will be (re)mounted if needed.
   void begin();
+
+  // Flash lock held: swap a complete "<slot>.part" into the slot
+  // (.part -> .new -> slot; a swap cut short is finished at boot)
+  bool commitPart(const char* slotPath, const char* partPath);
+
+  // Provisioned defaults (sound bank); -1 leaves a setting as it is.
+  // Persisted at once, without the volume write throttle.
+  void applySettings(int volume, int bootEnabled, int ejectEnabled);
+
+  // A sound upload is in progress (or still being finished on the worker)
+  bool uploading();
 }
@@ -0,0 +1,385 @@
+#include "fs_worker.h"
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <new>
+
+#include "diag.h"
+#include "trace.h"
+
+// -------- Settings --------
+#ifndef XS_FS_QUEUE
+  #define XS_FS_QUEUE 24       // pending jobs (uploads keep up to ~5 each)
+#endif
+#ifndef XS_FS_JOBS
+  #define XS_FS_JOBS 6         // JSON replies in flight
+#endif
+
+static const uint32_t    kStack        = 6144;
+static const UBaseType_t kPriority     = 1;    // same as loop(): never preempts playback
+static const uint32_t    kInlineWaitMs = 20;   // handler waits this long before deferring
+static const size_t      kJsonMax      = 512;
+static const size_t      kStreamChunk  = 2048;
+
+static const char* kJsonType = "application/json";
+static const char* kBusyJson = "{\"ok\":false,\"err\":\"fs busy\"}";
+
+struct Item {
+  FsWorker::Fn fn;
+  void* arg;
+};
+
+static QueueHandle_t     g_queue = nullptr;
+static SemaphoreHandle_t g_flash = nullptr;
+static TaskHandle_t      g_task  = nullptr;
+static std::atomic<uint32_t> g_jobsRun{0};
+static std::atomic<uint32_t> g_queueFull{0};
+
+// -------------- Worker --------------
+static void workerTask(void*) {
+  Item it;
+  for (;;) {
+    if (xQueueReceive(g_queue, &it, portMAX_DELAY) != pdTRUE) continue;
+    xSemaphoreTakeRecursive(g_flash, portMAX_DELAY);
+    {
+      TRACE_SCOPE("fs_job");
+      it.fn(it.arg);
+    }
+    xSemaphoreGiveRecursive(g_flash);
+    g_jobsRun++;
+  }
+}
+
+// Wait (bounded) for a flag the worker sets, woken by sem after each step
+static bool waitFor(const std::atomic<bool>& flag, SemaphoreHandle_t sem, uint32_t ms) {
+  const TickType_t until = xTaskGetTickCount() + pdMS_TO_TICKS(ms);
+  while (!flag.load()) {
+    const TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(until - now) <= 0) return false;
+    xSemaphoreTake(sem, until - now);
+  }
+  return true;
+}
+
+// -------------- JSON jobs --------------
+// Fixed slots shared by the job (worker side) and its response; refs counts
+// both, and the slot is free again at 0 whichever side lets go last.
+struct JsonJob {
+  std::atomic<uint8_t> refs{0};
+  std::atomic<bool>    done{false};
+  SemaphoreHandle_t    sem = nullptr;
+  FsWorker::JsonFn     fn = nullptr;
+  const char*          path = nullptr;
+  void*                ctx = nullptr;
+  int                  code = 200;
+  size_t               len = 0;
+  char                 json[kJsonMax];
+};
+
+static JsonJob g_jobs[XS_FS_JOBS];
+
+static JsonJob* claimJob() {
+  for (auto& j : g_jobs) {
+    uint8_t expected = 0;
+    if (!j.refs.compare_exchange_strong(expected, 2)) continue;
+    j.done.store(false);
+    xSemaphoreTake(j.sem, 0);  // clear a stale wake-up
+    return &j;
+  }
+  return nullptr;
+}
+
+static void dropJob(JsonJob* j) {
+  j->refs.fetch_sub(1);
+}
+
+static void runJsonJob(void* arg) {
+  auto* j = static_cast<JsonJob*>(arg);
+  JsonWriter w(j->json, sizeof(j->json));
+  j->code = j->fn(w, j->path, j->ctx);
+  if (w.overflow()) {
+    w.reset();
+    w.beginObject().kv("ok", false).kv("err", "response too large").endObject();
+    j->code = 500;
+  }
+  j->len = w.length();
+  j->done.store(true);
+  xSemaphoreGive(j->sem);
+  dropJob(j);
+}
+
+// Holds its headers back (state stays RESPONSE_SETUP) until the job is done;
+// AsyncWebServer keeps calling _ack() from its poll timer until then.
+class DeferredJsonResponse : public AsyncAbstractResponse {
+public:
+  explicit DeferredJsonResponse(JsonJob* job) : _job(job), _read(0) {
+    _code = 200;
+    _contentType = kJsonType;
+  }
+  ~DeferredJsonResponse() { dropJob(_job); }
+
+  bool _sourceValid() const override { return true; }
+
+  void _respond(AsyncWebServerRequest* request) override {
+    if (_job->done.load()) start(request);
+  }
+
+  size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override {
+    if (_state == RESPONSE_SETUP) {
+      if (_job->done.load()) start(request);
+      return 0;
+    }
+    return AsyncAbstractResponse::_ack(request, len, time);
+  }
+
+  size_t _fillBuffer(uint8_t* data, size_t maxLen) override {
+    size_t left = _contentLength - _read;
+    if (left > maxLen) left = maxLen;
+    memcpy(data, _job->json + _read, left);
+    _read += left;
+    return left;
+  }
+
+private:
+  void start(AsyncWebServerRequest* request) {
+    _code = _job->code;
+    _contentLength = _job->len;
+    addHeader("Cache-Control", "no-store");
+    AsyncAbstractResponse::_respond(request);
+  }
+
+  JsonJob* _job;
+  size_t   _read;
+};
+
+// -------------- File streams --------------
+// Two chunks read ahead on the worker while TCP drains the other one. The
+// file handle is only used on the worker (the close falls back to the
+// caller under the flash lock if the queue is full).
+struct FileStream {
+  std::atomic<uint8_t> refs{1};   // response + each queued job
+  std::atomic<bool>    opened{false};
+  std::atomic<bool>    ready[2];
+  SemaphoreHandle_t    sem = nullptr;
+  const char*          path = nullptr;
+  File                 f;
+  bool                 exists = false;
+  size_t               size = 0;
+  size_t               len[2] = {0, 0};
+  uint8_t              buf[2][kStreamChunk];
+  uint8_t              next = 0;   // worker: buffer the next read goes into
+
+  FileStream() { ready[0].store(false); ready[1].store(false); }
+};
+
+static void freeStream(FileStream* s) {
+  XS_FREE_NOTE(Web, sizeof(FileStream));
+  if (s->f) s->f.close();
+  if (s->sem) vSemaphoreDelete(s->sem);
+  delete s;
+}
+
+static void closeStreamJob(void* arg) {
+  freeStream(static_cast<FileStream*>(arg));
+}
+
+// Last reference closes the file, on the worker when possible
+static void dropStream(FileStream* s) {
+  if (s->refs.fetch_sub(1) != 1) return;
+  if (FsWorker::onWorker() || !s->f || !FsWorker::post(closeStreamJob, s)) {
+    FsWorker::Guard g;
+    freeStream(s);
+  }
+}
+
+static void readChunk(FileStream* s) {
+  const uint8_t k = s->next;
+  s->len[k] = s->f ? s->f.read(s->buf[k], kStreamChunk) : 0;
+  s->next ^= 1;
+  s->ready[k].store(true);
+}
+
+static void openStreamJob(void* arg) {
+  auto* s = static_cast<FileStream*>(arg);
+  if (s->refs.load() > 1) {   // response still wants it
+    s->f = SPIFFS.open(s->path, "r");
+    s->exists = (bool)s->f;
+    s->size = s->exists ? s->f.size() : 0;
+    if (s->exists) { readChunk(s); readChunk(s); }
+  }
+  s->opened.store(true);
+  xSemaphoreGive(s->sem);
+  dropStream(s);
+}
+
+static void readStreamJob(void* arg) {
+  auto* s = static_cast<FileStream*>(arg);
+  if (s->refs.load() > 1) readChunk(s);
+  xSemaphoreGive(s->sem);
+  dropStream(s);
+}
+
+class FileStreamResponse : public AsyncAbstractResponse {
+public:
+  FileStreamResponse(FileStream* s, const char* type, const char* disposition)
+    : _s(s), _type(type), _disposition(disposition) {
+    _code = 200;
+  }
+  ~FileStreamResponse() { dropStream(_s); }
+
+  // A short read (file changed under us) aborts the connection
+  bool _sourceValid() const override { return !_broken; }
+
+  void _respond(AsyncWebServerRequest* request) override {
+    if (_s->opened.load()) start(request);
+  }
+
+  size_t _ack(AsyncWebServerRequest* request, size_t len, uint32_t time) override {
+    if (_state == RESPONSE_SETUP) {
+      if (_s->opened.load()) start(request);
+      return 0;
+    }
+    return AsyncAbstractResponse::_ack(request, len, time);
+  }
+
+  size_t _fillBuffer(uint8_t* data, size_t maxLen) override {
+    if (!_s->exists) {
+      size_t n = strlen(kNotFound) - _off;
+      if (n > maxLen) n = maxLen;
+      memcpy(data, kNotFound + _off, n);
+      _off += n;
+      return n;
+    }
+    const uint8_t k = _cur;
+    if (!waitFor(_s->ready[k], _s->sem, kInlineWaitMs)) return RESPONSE_TRY_AGAIN;
+    if (_s->len[k] == 0) { _broken = true; return RESPONSE_TRY_AGAIN; }
+
+    size_t n = _s->len[k] - _off;
+    if (n > maxLen) n = maxLen;
+    memcpy(data, _s->buf[k] + _off, n);
+    _off += n;
+    if (_off == _s->len[k]) {
+      // Chunk drained: refill it if the file has more to give
+      _s->ready[k].store(false);
+      _off = 0;
+      _cur ^= 1;
+      if (_requested < _s->size) {
+        _s->refs++;
+        if (FsWorker::post(readStreamJob, _s, kInlineWaitMs)) _requested += kStreamChunk;
+        else { _s->refs--; _broken = true; }
+      }
+    }
+    return n;
+  }
+
+private:
+  static constexpr const char* kNotFound = "{\"ok\":false,\"err\":\"not found\"}";
+
+  void start(AsyncWebServerRequest* request) {
+    if (_s->exists) {
+      _contentType = _type;
+      _contentLength = _s->size;
+      if (_disposition) addHeader("Content-Disposition", _disposition);
+    } else {
+      _code = 404;
+      _contentType = kJsonType;
+      _contentLength = strlen(kNotFound);
+    }
+    addHeader("Cache-Control", "no-store");
+    AsyncAbstractResponse::_respond(request);
+  }
+
+  FileStream* _s;
+  const char* _type;
+  const char* _disposition;
+  uint8_t     _cur = 0;
+  size_t      _off = 0;
+  size_t      _requested = 2 * kStreamChunk;   // read ahead by the open job
+  bool        _broken = false;
+};
+
+namespace FsWorker {
+
+  void begin() {
+    if (g_task) return;
+    g_flash = xSemaphoreCreateRecursiveMutex();
+    g_queue = xQueueCreate(XS_FS_QUEUE, sizeof(Item));
+    for (auto& j : g_jobs) j.sem = xSemaphoreCreateBinary();
+    if (!g_flash || !g_queue ||
+        xTaskCreate(workerTask, "fs_worker", kStack, nullptr, kPriority, &g_task) != pdPASS) {
+      Serial.println("[FsWorker] Failed to start");
+      g_task = nullptr;
+      return;
+    }
+    Serial.println("[FsWorker] Started");
+  }
+
+  bool post(Fn fn, void* arg, uint32_t waitMs) {
+    if (!g_task) return false;
+    Item it{fn, arg};
+    if (xQueueSend(g_queue, &it, pdMS_TO_TICKS(waitMs)) == pdTRUE) return true;
+    g_queueFull++;
+    return false;
+  }
+
+  bool onWorker() {
+    return g_task && xTaskGetCurrentTaskHandle() == g_task;
+  }
+
+  void lock()   { if (g_flash) xSemaphoreTakeRecursive(g_flash, portMAX_DELAY); }
+  void unlock() { if (g_flash) xSemaphoreGiveRecursive(g_flash); }
+
+  void yieldLock() {
+    unlock();
+    taskYIELD();
+    lock();
+  }
+
+  void replyJson(AsyncWebServerRequest* req, JsonFn fn, const char* path, void* ctx) {
+    JsonJob* j = claimJob();
+    if (!j) {
+      req->send_P(503, kJsonType, (const uint8_t*)kBusyJson, strlen(kBusyJson));
+      return;
+    }
+    j->fn = fn; j->path = path; j->ctx = ctx;
+    if (!post(runJsonJob, j)) {
+      j->refs.store(0);
+      req->send_P(503, kJsonType, (const uint8_t*)kBusyJson, strlen(kBusyJson));
+      return;
+    }
+    // Most jobs take a few ms: answer inline rather than via the poll timer
+    waitFor(j->done, j->sem, kInlineWaitMs);
+    req->send(new DeferredJsonResponse(j));
+  }
+
+  void sendFile(AsyncWebServerRequest* req, const char* path, const char* contentType,
+                const char* disposition) {
+    auto* s = new (std::nothrow) FileStream();
+    if (s) s->sem = xSemaphoreCreateBinary();
+    if (!s || !s->sem) {
+      delete s;
+      req->send_P(503, kJsonType, (const uint8_t*)kBusyJson, strlen(kBusyJson));
+      return;
+    }
+    XS_ALLOC_NOTE(Web, sizeof(FileStream));
+    s->path = path;
+    s->refs++;
+    if (!post(openStreamJob, s)) {
+      s->refs.store(1);
+      dropStream(s);
+      req->send_P(503, kJsonType, (const uint8_t*)kBusyJson, strlen(kBusyJson));
+      return;
+    }
+    waitFor(s->opened, s->sem, kInlineWaitMs);
+    req->send(new FileStreamResponse(s, contentType, disposition));
+  }
+
+  uint32_t jobsRun()   { return g_jobsRun.load(); }
+  uint32_t queueFull() { return g_queueFull.load(); }
+}
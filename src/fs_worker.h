@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include "json_writer.h"
+
+// Filesystem worker: one task that does the SPIFFS work for the web side.
+// - Jobs run one at a time in FIFO order, so web-initiated flash access is
+//   serialized and never runs inside an AsyncTCP callback.
+// - Tasks that read SPIFFS directly (playback in the loop task) take the
+//   same flash lock around each access; the worker holds it per job.
+// - Web handlers are answered asynchronously: replyJson()/sendFile() hand
+//   AsyncWebServer a response that is filled in once the job has run.
+namespace FsWorker {
+
+  // Call once after SPIFFS.begin(), before any route can fire.
+  void begin();
+
+  // -------- Raw jobs --------
+  typedef void (*Fn)(void* arg);
+
+  // Queue fn(arg) on the worker. waitMs bounds the wait for a free queue
+  // slot; false if it stayed full or the worker is not running.
+  bool post(Fn fn, void* arg, uint32_t waitMs = 0);
+
+  bool onWorker();
+
+  // -------- Flash lock (recursive) --------
+  void lock();
+  void unlock();
+  // Worker only, at job top level: let other flash users in between the
+  // steps of a long job (e.g. re-hashing a large file).
+  void yieldLock();
+
+  class Guard {
+  public:
+    Guard() { lock(); }
+    ~Guard() { unlock(); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+  };
+
+  // -------- Web glue --------
+  // Builds a JSON reply on the worker; returns the HTTP status.
+  typedef int (*JsonFn)(JsonWriter& out, const char* path, void* ctx);
+
+  // Answer req with fn's JSON. Sent at once if the job finishes within a few
+  // ms; otherwise the response is held (nothing sent yet) until it has run.
+  // The job runs even if the client goes away. 503 if the worker is busy.
+  void replyJson(AsyncWebServerRequest* req, JsonFn fn, const char* path, void* ctx = nullptr);
+
+  // Stream a file that is opened and read ahead on the worker.
+  // 404 JSON if it does not exist.
+  void sendFile(AsyncWebServerRequest* req, const char* path, const char* contentType,
+                const char* disposition = nullptr);
+
+  // Diagnostics
+  uint32_t jobsRun();
+  uint32_t queueFull();
+}
@@ -0,0 +1,363 @@
+#include "json_reader.h"
+
+#include <string.h>
+
+static bool isWs(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+static bool isNumChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// -------------- Number grammar --------------
+// -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?, one char at a time
+enum NumPhase : uint8_t { NumMinus, NumZero, NumInt, NumDot, NumFrac, NumExp, NumExpSign, NumExpInt };
+
+static bool numStart(uint8_t& ph, char c) {
+  if (c == '-') ph = NumMinus;
+  else if (c == '0') ph = NumZero;
+  else if (c >= '1' && c <= '9') ph = NumInt;
+  else return false;
+  return true;
+}
+
+static bool numNext(uint8_t& ph, char c) {
+  const bool digit = c >= '0' && c <= '9';
+  switch (ph) {
+    case NumMinus:   return numStart(ph, c) && ph != NumMinus;
+    case NumZero:
+    case NumInt:
+      if (digit && ph == NumInt) return true;
+      if (c == '.') { ph = NumDot; return true; }
+      if (c == 'e' || c == 'E') { ph = NumExp; return true; }
+      return false;
+    case NumDot:     if (digit) { ph = NumFrac; return true; } return false;
+    case NumFrac:
+      if (digit) return true;
+      if (c == 'e' || c == 'E') { ph = NumExp; return true; }
+      return false;
+    case NumExp:
+      if (c == '+' || c == '-') { ph = NumExpSign; return true; }
+      // fallthrough
+    case NumExpSign: if (digit) { ph = NumExpInt; return true; } return false;
+    case NumExpInt:  return digit;
+    default:         return false;
+  }
+}
+
+static bool numComplete(uint8_t ph) {
+  return ph == NumZero || ph == NumInt || ph == NumFrac || ph == NumExpInt;
+}
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// -------------- Event helpers --------------
+bool JsonReader::Event::keyIs(const char* k) const {
+  return key && strcmp(key, k) == 0;
+}
+
+bool JsonReader::Event::toInt(long& out) const {
+  if (type != Type::Number || len == 0) return false;
+  size_t i = 0;
+  bool neg = false;
+  if (val[0] == '-' || val[0] == '+') { neg = (val[0] == '-'); i++; }
+  if (i >= len) return false;
+  long v = 0;
+  for (; i < len; ++i) {
+    const char c = val[i];
+    if (c < '0' || c > '9') return false;  // fractions/exponents are not integers
+    if (v > 100000000L) return false;       // sanity bound, well inside 32 bits
+    v = v * 10 + (c - '0');
+  }
+  out = neg ? -v : v;
+  return true;
+}
+
+bool JsonReader::Event::toBool(bool& out) const {
+  if (type == Type::True)  { out = true;  return true; }
+  if (type == Type::False) { out = false; return true; }
+  long v;
+  if (toInt(v)) { out = (v != 0); return true; }
+  return false;
+}
+
+bool JsonReader::Event::copyTo(char* dst, size_t cap) const {
+  if (!cap) return false;
+  if (type != Type::String && type != Type::Number) { dst[0] = '\0'; return false; }
+  const bool fits = len < cap;
+  const size_t n = fits ? len : cap - 1;
+  memcpy(dst, val, n);
+  dst[n] = '\0';
+  return fits;
+}
+
+// -------------- Reader --------------
+void JsonReader::reset(Handler h, void* ctx) {
+  _handler = h;
+  _ctx = ctx;
+  _state = State::Value;
+  _depth = 0;
+  _objMask = 0;
+  _stringIsKey = false;
+  _zc = false;
+  _zcStart = nullptr;
+  _tokLen = 0;
+  _esc = 0;
+  _uacc = 0;
+  _hiSurrogate = 0;
+  _lit = nullptr;
+  _litPos = 0;
+  _litType = Type::Null;
+  _num = 0;
+  _key[0] = '\0';
+  _keyValid = true;
+}
+
+bool JsonReader::tokAppend(const char* s, size_t n) {
+  if (_tokLen + n > kTokenMax) { _state = State::Error; return false; }
+  memcpy(_tok + _tokLen, s, n);
+  _tokLen += n;
+  return true;
+}
+
+bool JsonReader::tokAppendCodepoint(uint32_t cp) {
+  char b[4];
+  size_t n;
+  if (cp < 0x80)         { b[0] = (char)cp; n = 1; }
+  else if (cp < 0x800)   { b[0] = (char)(0xC0 | (cp >> 6)); b[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+  else if (cp < 0x10000) { b[0] = (char)(0xE0 | (cp >> 12)); b[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                           b[2] = (char)(0x80 | (cp & 0x3F)); n = 3; }
+  else                   { b[0] = (char)(0xF0 | (cp >> 18)); b[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                           b[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); b[3] = (char)(0x80 | (cp & 0x3F)); n = 4; }
+  return tokAppend(b, n);
+}
+
+// Move a pending zero-copy slice into the scratch buffer (before an escape,
+// or because the chunk it points into is about to go away).
+void JsonReader::spill(const char* end) {
+  if (!_zc) return;
+  _zc = false;
+  tokAppend(_zcStart, (size_t)(end - _zcStart));
+}
+
+void JsonReader::emit(Type t, const char* val, size_t len) {
+  if (!_handler) return;
+  Event ev;
+  ev.type  = t;
+  ev.depth = _depth;
+  ev.key   = (inObject() && _keyValid) ? _key : "";
+  ev.val   = val;
+  ev.len   = len;
+  _handler(_ctx, ev);
+}
+
+void JsonReader::emitToken(Type t) {
+  emit(t, _tok, _tokLen);
+}
+
+bool JsonReader::endNumber(const char* val, size_t len) {
+  if (!numComplete(_num)) { _state = State::Error; return false; }
+  emit(Type::Number, val, len);
+  return endValue();
+}
+
+bool JsonReader::endValue() {
+  _state = _depth ? State::Next : State::Done;
+  return true;
+}
+
+bool JsonReader::beginContainer(bool isObject) {
+  if (_depth >= kMaxDepth) { _state = State::Error; return false; }
+  emit(isObject ? Type::BeginObject : Type::BeginArray, nullptr, 0);
+  if (isObject) _objMask |= (1u << _depth);
+  else          _objMask &= ~(1u << _depth);
+  _depth++;
+  return true;
+}
+
+bool JsonReader::endContainer(bool isObject) {
+  if (!_depth || inObject() != isObject) { _state = State::Error; return false; }
+  _depth--;
+  emit(isObject ? Type::EndObject : Type::EndArray, nullptr, 0);
+  return endValue();
+}
+
+// Consumes one or more bytes at data[i]; advances i.
+bool JsonReader::step(const char* data, size_t len, size_t& i) {
+  const char c = data[i];
+
+  switch (_state) {
+    case State::InString: {
+      if (_esc == 0) {
+        // Fast path: run to the next quote/backslash/control char
+        size_t j = i;
+        while (j < len && data[j] != '"' && data[j] != '\\' && (uint8_t)data[j] >= 0x20) j++;
+        if (!_zc && j > i && !tokAppend(data + i, j - i)) return false;
+        i = j;
+        if (i >= len) return true;
+
+        const char d = data[i];
+        if ((uint8_t)d < 0x20) { _state = State::Error; return false; }
+        if (d == '\\') { spill(data + i); _esc = 1; i++; return _state != State::Error; }
+
+        // Closing quote
+        if (_hiSurrogate) { _hiSurrogate = 0; if (!tokAppendCodepoint(0xFFFD)) return false; }
+        const char* v = _zc ? _zcStart : _tok;
+        const size_t n = _zc ? (size_t)(data + i - _zcStart) : _tokLen;
+        _zc = false;
+        i++;
+        if (_stringIsKey) {
+          _keyValid = n < kKeyMax;
+          if (_keyValid) { memcpy(_key, v, n); _key[n] = '\0'; }
+          _state = State::Colon;
+          return true;
+        }
+        emit(Type::String, v, n);
+        return endValue();
+      }
+
+      if (_esc == 1) {
+        char out = 0;
+        switch (c) {
+          case '"': case '\\': case '/': out = c; break;
+          case 'b': out = '\b'; break;
+          case 'f': out = '\f'; break;
+          case 'n': out = '\n'; break;
+          case 'r': out = '\r'; break;
+          case 't': out = '\t'; break;
+          case 'u': _esc = 2; _uacc = 0; i++; return true;
+          default: _state = State::Error; return false;
+        }
+        if (_hiSurrogate) { _hiSurrogate = 0; if (!tokAppendCodepoint(0xFFFD)) return false; }
+        _esc = 0;
+        i++;
+        return tokAppend(&out, 1);
+      }
+
+      // \uXXXX
+      const int h = hexVal(c);
+      if (h < 0) { _state = State::Error; return false; }
+      _uacc = (_uacc << 4) | (uint32_t)h;
+      i++;
+      if (++_esc < 6) return true;
+      _esc = 0;
+      if (_uacc >= 0xD800 && _uacc <= 0xDBFF) {
+        if (_hiSurrogate && !tokAppendCodepoint(0xFFFD)) return false;
+        _hiSurrogate = _uacc;
+        return true;
+      }
+      if (_uacc >= 0xDC00 && _uacc <= 0xDFFF) {
+        if (!_hiSurrogate) return tokAppendCodepoint(0xFFFD);
+        const uint32_t cp = 0x10000 + ((_hiSurrogate - 0xD800) << 10) + (_uacc - 0xDC00);
+        _hiSurrogate = 0;
+        return tokAppendCodepoint(cp);
+      }
+      if (_hiSurrogate) { _hiSurrogate = 0; if (!tokAppendCodepoint(0xFFFD)) return false; }
+      return tokAppendCodepoint(_uacc);
+    }
+
+    case State::InNumber: {
+      if (isNumChar(c)) {
+        if (!numNext(_num, c)) { _state = State::Error; return false; }
+        if (!_zc && !tokAppend(&c, 1)) return false;
+        i++;
+        return true;
+      }
+      // Delimiter: finish the number and let the delimiter be re-processed
+      const char* v = _zc ? _zcStart : _tok;
+      const size_t n = _zc ? (size_t)(data + i - _zcStart) : _tokLen;
+      _zc = false;
+      return endNumber(v, n);
+    }
+
+    case State::InLiteral: {
+      if (c != _lit[_litPos]) { _state = State::Error; return false; }
+      i++;
+      if (_lit[++_litPos] == '\0') {
+        emit(_litType, nullptr, 0);
+        return endValue();
+      }
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  // Structural states: whitespace is insignificant
+  if (isWs(c)) { i++; return true; }
+  i++;
+
+  switch (_state) {
+    case State::FirstValue:
+      // ']' only here, not after ',': "[1,]" is not JSON
+      if (c == ']') return endContainer(false);
+      // fallthrough
+    case State::Value:
+      if (c == '{') { if (!beginContainer(true)) return false; _state = State::FirstKey; return true; }
+      if (c == '[') { if (!beginContainer(false)) return false; _state = State::FirstValue; return true; }
+      if (c == '"') {
+        _stringIsKey = false;
+        _state = State::InString;
+        _zc = true; _zcStart = data + i; _tokLen = 0; _esc = 0;
+        return true;
+      }
+      if (numStart(_num, c)) {
+        _state = State::InNumber;
+        _zc = true; _zcStart = data + i - 1; _tokLen = 0;
+        return true;
+      }
+      if (c == 't') { _lit = "true";  _litType = Type::True;  _litPos = 1; _state = State::InLiteral; return true; }
+      if (c == 'f') { _lit = "false"; _litType = Type::False; _litPos = 1; _state = State::InLiteral; return true; }
+      if (c == 'n') { _lit = "null";  _litType = Type::Null;  _litPos = 1; _state = State::InLiteral; return true; }
+      break;
+
+    case State::FirstKey:
+      if (c == '}') return endContainer(true);
+      // fallthrough
+    case State::Key:
+      if (c == '"') {
+        _stringIsKey = true;
+        _state = State::InString;
+        _zc = true; _zcStart = data + i; _tokLen = 0; _esc = 0;
+        return true;
+      }
+      break;
+
+    case State::Colon:
+      if (c == ':') { _state = State::Value; return true; }
+      break;
+
+    case State::Next:
+      if (c == ',') { _state = inObject() ? State::Key : State::Value; return true; }
+      if (c == '}') return endContainer(true);
+      if (c == ']') return endContainer(false);
+      break;
+
+    case State::Done:
+    default:
+      break;
+  }
+
+  _state = State::Error;
+  return false;
+}
+
+bool JsonReader::feed(const char* data, size_t len) {
+  if (_state == State::Error) return false;
+  size_t i = 0;
+  while (i < len) {
+    if (!step(data, len, i) || _state == State::Error) { _state = State::Error; return false; }
+  }
+  // The caller's buffer is only valid for this call
+  if (_state == State::InString || _state == State::InNumber) spill(data + len);
+  return _state != State::Error;
+}
+
+bool JsonReader::finish() {
+  if (_state == State::InNumber) endNumber(_tok, _tokLen);
+  if (_state != State::Done) _state = State::Error;
+  return _state == State::Done;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental JSON tokenizer (SAX style) for request bodies.
+// - Fed with arbitrary chunks (e.g. AsyncWebServer onBody pieces).
+// - Never allocates. Scalars that sit inside one chunk without escapes are
+//   handed out as slices of the caller's buffer; anything split across
+//   chunks or containing escapes is assembled in a small fixed scratch.
+// - Bounded: tokens longer than kTokenMax or nesting deeper than kMaxDepth
+//   fail the parse instead of growing. A key that does not fit kKeyMax
+//   (with its NUL) is reported as "", so no field matches its value.
+// - Numbers are checked against the JSON grammar ("1-2", "-", "01" fail).
+class JsonReader {
+public:
+  static const size_t  kTokenMax = 128;
+  static const size_t  kKeyMax   = 32;
+  static const uint8_t kMaxDepth = 16;
+
+  enum class Type : uint8_t {
+    String, Number, True, False, Null,
+    BeginObject, EndObject, BeginArray, EndArray
+  };
+
+  struct Event {
+    Type        type;
+    uint8_t     depth;  // depth of the value: 1 = member of the top-level object
+    const char* key;    // member name when inside an object, "" otherwise
+    const char* val;    // scalar text (unescaped for strings); not NUL-terminated
+    size_t      len;
+
+    bool keyIs(const char* k) const;
+    bool isString() const { return type == Type::String; }
+    // Number -> integer (false if not an integer in range)
+    bool toInt(long& out) const;
+    bool toBool(bool& out) const;
+    // Copy a string/number into dst (NUL-terminated). False if it did not fit.
+    bool copyTo(char* dst, size_t cap) const;
+  };
+
+  typedef void (*Handler)(void* ctx, const Event& ev);
+
+  JsonReader() { reset(nullptr, nullptr); }
+  JsonReader(Handler h, void* ctx) { reset(h, ctx); }
+
+  void reset(Handler h, void* ctx);
+  // Returns false once the input is known to be invalid.
+  bool feed(const char* data, size_t len);
+  // Call after the last chunk; true if exactly one complete value was read.
+  bool finish();
+
+  bool failed() const { return _state == State::Error; }
+  bool complete() const { return _state == State::Done; }
+
+private:
+  enum class State : uint8_t {
+    Value,        // expecting a value
+    FirstValue,   // after '[': value or ']'
+    FirstKey,     // after '{': key or '}'
+    Key,          // after ',' in an object: key
+    Colon,        // after a key
+    Next,         // after a value: ',' or closing bracket
+    InString,
+    InNumber,
+    InLiteral,
+    Done,
+    Error
+  };
+
+  bool step(const char* data, size_t len, size_t& i);
+  bool endNumber(const char* val, size_t len);
+  bool endValue();
+  bool beginContainer(bool isObject);
+  bool endContainer(bool isObject);
+  void emit(Type t, const char* val, size_t len);
+  void emitToken(Type t);
+  bool tokAppend(const char* s, size_t n);
+  bool tokAppendCodepoint(uint32_t cp);
+  void spill(const char* end);
+  bool inObject() const { return _depth && (_objMask & (1u << (_depth - 1))); }
+
+  Handler  _handler;
+  void*    _ctx;
+
+  State    _state;
+  uint8_t  _depth;
+  uint16_t _objMask;       // bit per depth: container is an object
+  bool     _stringIsKey;
+
+  // Current token: zero-copy slice while _zc is set, scratch otherwise
+  bool        _zc;
+  const char* _zcStart;
+  char        _tok[kTokenMax];
+  size_t      _tokLen;
+
+  // String escapes
+  uint8_t  _esc;           // 0 = none, 1 = after '\', 2..5 = \u hex digits
+  uint32_t _uacc;
+  uint32_t _hiSurrogate;
+
+  // Number grammar: where in -int.frac e+exp the last char was
+  uint8_t  _num;
+
+  // Literal matching (true/false/null)
+  const char* _lit;
+  uint8_t     _litPos;
+  Type        _litType;
+
+  char   _key[kKeyMax];
+  bool   _keyValid;
+};
@@ -0,0 +1,213 @@
+#include "json_writer.h"
+
+#include <string.h>
+
+static const char kHex[] = "0123456789abcdef";
+
+JsonWriter::JsonWriter(char* buf, size_t cap) : _buf(buf), _cap(cap) {
+  reset();
+}
+
+void JsonWriter::reset() {
+  _len = 0;
+  _depth = 0;
+  _first = 1;
+  _afterKey = false;
+  _overflow = (_buf == nullptr || _cap == 0);
+  if (!_overflow) _buf[0] = '\0';
+}
+
+void JsonWriter::rollback(const Mark& m) {
+  _len = m.len;
+  _depth = m.depth;
+  _first = m.first;
+  _afterKey = m.afterKey;
+  _overflow = false;
+  if (_buf && _cap) _buf[_len] = '\0';
+}
+
+// -------------- Raw output --------------
+void JsonWriter::put(char c) {
+  if (_overflow) return;
+  if (_len + 1 >= _cap) { _overflow = true; return; }
+  _buf[_len++] = c;
+  _buf[_len] = '\0';
+}
+
+void JsonWriter::put(const char* s, size_t n) {
+  if (_overflow) return;
+  if (_len + n >= _cap) { _overflow = true; return; }
+  memcpy(_buf + _len, s, n);
+  _len += n;
+  _buf[_len] = '\0';
+}
+
+// Comma handling: nothing before the first element of a container or
+// directly after a key, ',' otherwise.
+void JsonWriter::separator() {
+  if (_afterKey) { _afterKey = false; return; }
+  const uint32_t bit = 1u << _depth;
+  if (_first & bit) { _first &= ~bit; return; }
+  put(',');
+}
+
+// -------------- Structure --------------
+JsonWriter& JsonWriter::beginObject() {
+  separator();
+  put('{');
+  if (_depth + 1 < kMaxDepth) { _depth++; _first |= (1u << _depth); }
+  else _overflow = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  if (_depth) _depth--;
+  put('}');
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  separator();
+  put('[');
+  if (_depth + 1 < kMaxDepth) { _depth++; _first |= (1u << _depth); }
+  else _overflow = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  if (_depth) _depth--;
+  put(']');
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* k) {
+  separator();
+  put('"');
+  putEscaped(k, strlen(k));
+  put('"');
+  put(':');
+  _afterKey = true;
+  return *this;
+}
+
+// -------------- Values --------------
+// Escapes quotes, backslash and control chars. Valid UTF-8 passes through;
+// stray bytes (e.g. Latin-1 SSIDs) become U+FFFD so the output stays valid JSON.
+void JsonWriter::putEscaped(const char* s, size_t n) {
+  const uint8_t* p = (const uint8_t*)s;
+  size_t i = 0;
+  while (i < n && !_overflow) {
+    const uint8_t c = p[i];
+    if (c < 0x80) {
+      switch (c) {
+        case '"':  put("\\\"", 2); break;
+        case '\\': put("\\\\", 2); break;
+        case '\n': put("\\n", 2);  break;
+        case '\r': put("\\r", 2);  break;
+        case '\t': put("\\t", 2);  break;
+        case '\b': put("\\b", 2);  break;
+        case '\f': put("\\f", 2);  break;
+        default:
+          if (c < 0x20) {
+            const char esc[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF] };
+            put(esc, 6);
+          } else {
+            put((char)c);
+          }
+          break;
+      }
+      i++;
+      continue;
+    }
+
+    // Multi-byte UTF-8: validate lead byte + continuation bytes
+    size_t need = 0;
+    if      ((c & 0xE0) == 0xC0 && c >= 0xC2) need = 1;
+    else if ((c & 0xF0) == 0xE0)              need = 2;
+    else if ((c & 0xF8) == 0xF0 && c <= 0xF4) need = 3;
+
+    bool valid = need && (i + need < n);
+    for (size_t k = 1; valid && k <= need; ++k) {
+      if ((p[i + k] & 0xC0) != 0x80) valid = false;
+    }
+    if (valid) {
+      put(s + i, need + 1);
+      i += need + 1;
+    } else {
+      put("\\ufffd", 6);
+      i++;
+    }
+  }
+}
+
+JsonWriter& JsonWriter::value(const char* s) {
+  if (!s) return null();
+  return value(s, strlen(s));
+}
+
+JsonWriter& JsonWriter::value(const char* s, size_t n) {
+  separator();
+  put('"');
+  putEscaped(s, n);
+  put('"');
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+  separator();
+  if (b) put("true", 4); else put("false", 5);
+  return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+  separator();
+  put("null", 4);
+  return *this;
+}
+
+JsonWriter& JsonWriter::raw(const char* s) {
+  separator();
+  put(s, strlen(s));
+  return *this;
+}
+
+JsonWriter& JsonWriter::writeUInt(unsigned long long v) {
+  char tmp[24];
+  size_t n = 0;
+  do { tmp[n++] = (char)('0' + (v % 10)); v /= 10; } while (v);
+  separator();
+  while (n) put(tmp[--n]);
+  return *this;
+}
+
+JsonWriter& JsonWriter::writeInt(long long v) {
+  if (v >= 0) return writeUInt((unsigned long long)v);
+  separator();
+  put('-');
+  _afterKey = true;  // suppress the separator inside writeUInt
+  return writeUInt(0ULL - (unsigned long long)v);
+}
+
+// Fixed-point formatting without printf (newlib's float printf may allocate).
+JsonWriter& JsonWriter::value(double v, uint8_t decimals) {
+  if (v != v || v > 1e15 || v < -1e15) return null();  // NaN / out of range
+  if (decimals > 6) decimals = 6;
+
+  unsigned long long scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+
+  const bool neg = v < 0;
+  const unsigned long long fixed = (unsigned long long)((neg ? -v : v) * (double)scale + 0.5);
+  const unsigned long long whole = fixed / scale;
+  unsigned long long frac = fixed % scale;
+
+  if (neg && fixed) { separator(); put('-'); _afterKey = true; }
+  writeUInt(whole);
+  if (decimals) {
+    char tmp[8];
+    for (int i = decimals - 1; i >= 0; --i) { tmp[i] = (char)('0' + (frac % 10)); frac /= 10; }
+    put('.');
+    put(tmp, decimals);
+  }
+  return *this;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Streaming JSON writer over a caller-owned buffer.
+// - Never allocates; commas and nesting are tracked internally.
+// - Strings are escaped (quotes, backslash, control chars, invalid UTF-8).
+// - If the buffer fills up, output stops and overflow() becomes true.
+class JsonWriter {
+public:
+  JsonWriter(char* buf, size_t cap);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+  JsonWriter& key(const char* k);
+
+  JsonWriter& value(const char* s);
+  JsonWriter& value(const char* s, size_t n);
+  JsonWriter& value(bool b);
+  JsonWriter& value(double v, uint8_t decimals = 2);
+  JsonWriter& null();
+  // Pre-formatted JSON fragment (written as-is)
+  JsonWriter& raw(const char* s);
+
+  // Any integer type (int, uint32_t, size_t, uint64_t, ...)
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, JsonWriter&>::type
+  value(T v) { return writeInt((long long)v); }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, JsonWriter&>::type
+  value(T v) { return writeUInt((unsigned long long)v); }
+
+  // "key":value shorthand
+  template <typename T>
+  JsonWriter& kv(const char* k, T v) { key(k); return value(v); }
+  JsonWriter& kv(const char* k, double v, uint8_t decimals) { key(k); return value(v, decimals); }
+
+  // Checkpoint / rollback, e.g. to drop a list element that did not fit.
+  struct Mark { size_t len; uint8_t depth; uint32_t first; bool afterKey; };
+  Mark mark() const { return Mark{_len, _depth, _first, _afterKey}; }
+  void rollback(const Mark& m);
+
+  const char* c_str() const { return _buf; }
+  size_t length() const { return _len; }
+  size_t capacity() const { return _cap; }
+  bool overflow() const { return _overflow; }
+  void reset();
+
+private:
+  static const uint8_t kMaxDepth = 16;
+
+  JsonWriter& writeInt(long long v);
+  JsonWriter& writeUInt(unsigned long long v);
+  void separator();
+  void put(char c);
+  void put(const char* s, size_t n);
+  void putEscaped(const char* s, size_t n);
+
+  char*    _buf;
+  size_t   _cap;
+  size_t   _len = 0;
+  uint8_t  _depth = 0;
+  uint32_t _first = 1;       // bit per depth: next element is the first one
+  bool     _afterKey = false;
+  bool     _overflow = false;
+};
@@ -0,0 +1,101 @@
+#include "loop_prof.h"
+
+#include <ESPAsyncWebServer.h>
+
+#include <atomic>
+
+#include "wifimgr.h"
+#include "web_json.h"
+
+struct SubStats {
+  uint32_t count;
+  uint64_t total;    // cycles
+  uint32_t max;      // cycles
+  uint32_t hist[LoopProf::kBuckets];
+};
+
+static const char* kSubNames[] = { "audio", "wifi", "led", "eject", "mdns", "loop", "gap" };
+
+static SubStats g_stats[(size_t)LoopProf::Sub::Count];
+static uint32_t g_lastEnd = 0;       // cycle count at the end of the last iteration
+static bool     g_haveLast = false;
+static unsigned long g_sinceMs = 0;
+static std::atomic<bool> g_resetReq{false};
+
+static uint32_t cyclesToUs(uint32_t c) {
+  const uint32_t mhz = getCpuFrequencyMhz();
+  return mhz ? c / mhz : c;
+}
+
+static uint8_t bucketOf(uint32_t us) {
+  const uint8_t b = us ? (uint8_t)(32 - __builtin_clz(us)) : 0;
+  return b < LoopProf::kBuckets ? b : LoopProf::kBuckets - 1;
+}
+
+static void resetStats() {
+  memset(g_stats, 0, sizeof(g_stats));
+  g_haveLast = false;
+  g_sinceMs = millis();
+}
+
+// -------------- REST: loopstats --------------
+// Read from the AsyncTCP task while the loop task writes: a value may be one
+// sample stale, which is fine for a profiler.
+static void handleLoopStats(AsyncWebServerRequest* req) {
+  const uint32_t mhz = getCpuFrequencyMhz();
+  WebJson::Reply j;
+  j.beginObject();
+  j.kv("cpu_mhz", mhz);
+  j.kv("since_ms", (uint32_t)(millis() - g_sinceMs));
+  j.key("subs").beginObject();
+  for (size_t i = 0; i < (size_t)LoopProf::Sub::Count; ++i) {
+    const SubStats& s = g_stats[i];
+    const uint32_t avg = s.count ? (uint32_t)(s.total / s.count) : 0;
+    j.key(kSubNames[i]).beginObject()
+     .kv("count", s.count)
+     .kv("avg_us", cyclesToUs(avg))
+     .kv("max_us", cyclesToUs(s.max))
+     .kv("total_ms", (uint32_t)(mhz ? s.total / (mhz * 1000ULL) : 0));
+    // Trailing empty buckets are left out to keep the reply small
+    uint8_t used = LoopProf::kBuckets;
+    while (used && !s.hist[used - 1]) used--;
+    j.key("hist").beginArray();
+    for (uint8_t b = 0; b < used; ++b) j.value(s.hist[b]);
+    j.endArray();
+    j.endObject();
+  }
+  j.endObject();
+  j.endObject();
+  j.send(req);
+
+  // Cleared by the loop task at the start of its next iteration
+  if (req->hasParam("reset") && req->getParam("reset")->value() == "1") g_resetReq = true;
+}
+
+namespace LoopProf {
+
+  void begin() {
+    resetStats();
+    AsyncWebServer& server = WiFiMgr::getServer();
+    server.on("/api/loopstats", HTTP_GET, [](AsyncWebServerRequest* r){ handleLoopStats(r); });
+  }
+
+  void record(Sub sub, uint32_t c) {
+    SubStats& s = g_stats[(size_t)sub];
+    s.count++;
+    s.total += c;
+    if (c > s.max) s.max = c;
+    s.hist[bucketOf(cyclesToUs(c))]++;
+  }
+
+  Frame::Frame() : _t0(cycles()) {
+    if (g_resetReq.exchange(false)) resetStats();
+    if (g_haveLast) record(Sub::Gap, _t0 - g_lastEnd);
+  }
+
+  Frame::~Frame() {
+    g_lastEnd = cycles();
+    g_haveLast = true;
+    record(Sub::Loop, g_lastEnd - _t0);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_cpu.h>
+
+// Main-loop profiler: CPU-cycle timing around each subsystem call in
+// loop(), with count / total / max and a log2 histogram per subsystem.
+// GET /api/loopstats reports it; ?reset=1 clears after reporting.
+// Recording happens on the loop task only.
+#ifndef XS_LOOP_PROF
+  #define XS_LOOP_PROF 1
+#endif
+
+namespace LoopProf {
+
+  enum class Sub : uint8_t { Audio = 0, WiFi, Led, Eject, Mdns, Loop, Gap, Count };
+
+  // Histogram bucket b holds durations of [2^(b-1), 2^b) us; bucket 0 is < 1 us
+  static const uint8_t kBuckets = 18;
+
+  // Registers the route on the shared server
+  void begin();
+
+  inline uint32_t cycles() { return esp_cpu_get_cycle_count(); }
+  void record(Sub s, uint32_t cycles);
+
+  // Times one whole loop() iteration and the gap since the previous one
+  // (time spent outside loop(), e.g. in other tasks). Applies pending resets.
+  class Frame {
+  public:
+    Frame();
+    ~Frame();
+  private:
+    uint32_t _t0;
+  };
+
+  class Scope {
+  public:
+    explicit Scope(Sub s) : _s(s), _t0(cycles()) {}
+    ~Scope() { record(_s, cycles() - _t0); }
+  private:
+    Sub      _s;
+    uint32_t _t0;
+  };
+}
+
+#if XS_LOOP_PROF
+  #define XS_LOOP_FRAME()  LoopProf::Frame _xsFrame
+  #define XS_PROF(sub)     LoopProf::Scope _xsProf(LoopProf::Sub::sub)
+#else
+  #define XS_LOOP_FRAME()  ((void)0)
+  #define XS_PROF(sub)     ((void)0)
+#endif
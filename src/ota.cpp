@@ -0,0 +1,677 @@
+#include "ota.h"
+
+#include <Update.h>
+#include <SPIFFS.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "rom/miniz.h"      // ROM tinfl: no inflate code in the app image
+#include "esp_rom_crc.h"
+
+#include "web_json.h"
+#include "sha256.h"
+#include "trace.h"
+#include "ota_delta.h"
+#include "sound_bank.h"
+#include "bank_install.h"
+#include "sound_index.h"
+#include "fs_worker.h"
+#include "audio_player.h"
+
+#include <algorithm>
+#include <new>
+
+static const size_t  kDictSize = TINFL_LZ_DICT_SIZE;   // deflate window, used as a ring
+static const uint8_t kGzMagic0 = 0x1F;                  // app images start with 0xE9
+static const size_t  kBaseChunk = 512;                   // base hash read size (AsyncTCP stack)
+static const uint32_t kPostWaitMs = 2000;
+
+// gzip header flags (RFC 1952)
+static const uint8_t kFHcrc    = 0x02;
+static const uint8_t kFExtra   = 0x04;
+static const uint8_t kFName    = 0x08;
+static const uint8_t kFComment = 0x10;
+
+// -------------- Page (progress + client-driven reboot) --------------
+static const char OTA_PAGE[] PROGMEM = R"html(
+<!DOCTYPE html><html><head><meta charset="utf-8">
+<meta name="viewport" content="width=device-width,initial-scale=1,viewport-fit=cover">
+<title>OTA Update</title>
+<style>
+  :root{--bg:#111;--card:#222;--ink:#EEE;--mut:#AAB;--btn:#2563eb;--ok:#2ea043;--err:#d32}
+  *{box-sizing:border-box} html,body{height:100%}
+  body{background:var(--bg);color:var(--ink);font-family:system-ui,Segoe UI,Roboto,Arial;margin:0}
+  .wrap{min-height:100%;display:flex;align-items:center;justify-content:center;padding:env(safe-area-inset-top) 12px env(safe-area-inset-bottom)}
+  .box{width:100%;max-width:520px;margin:16px auto;background:var(--card);padding:18px 16px;border-radius:12px;box-shadow:0 8px 20px #0008}
+  h2{margin:0 0 12px}
+  .row{display:grid;grid-template-columns:1fr;gap:10px}
+  input[type=file],button{width:100%;margin:.25rem 0;padding:.7rem .8rem;border-radius:9px;border:1px solid #555;background:#111;color:var(--ink);font-size:1rem}
+  button{background:var(--btn);border:0;color:#fff;cursor:pointer}
+  .status{margin-top:10px;color:var(--mut)}
+  .bar{height:12px;background:#0c1222;border:1px solid #334;border-radius:999px;overflow:hidden}
+  .fill{height:100%;width:0%}
+  .ok{background:linear-gradient(90deg,#28a745,#3ddc84)}
+  .up{background:linear-gradient(90deg,#4c7cff,#7aa4ff)}
+  .err{background:linear-gradient(90deg,#d32,#f55)}
+  .msg{margin-top:8px;font-size:.95rem}
+</style></head>
+<body>
+<div class="wrap">
+  <div class="box">
+    <h2>OTA Update</h2>
+    <div class="row">
+      <input id="fw" type="file" accept=".bin,.gz,.xsd">
+      <button id="go">Upload & Flash</button>
+      <div class="bar"><div id="fill" class="fill up"></div></div>
+      <div id="msg" class="msg">Select a firmware <code>.bin</code>, a patch from <code>xsdelta</code> (<code>.xsd</code>), or a gzip of either, and click "Upload & Flash".</div>
+      <input id="fsf" type="file" accept=".bin,.gz,.xsb">
+      <button id="fsgo">Upload Sounds / Filesystem</button>
+      <div class="msg">A sound bank (<code>.xsb</code>) replaces the sounds it contains; a SPIFFS image replaces the whole filesystem and reboots.</div>
+      <div class="row">
+        <button onclick="location.href='/'">⟵ Back to WiFi Setup</button>
+        <button onclick="location.href='/files'">File Manager</button>
+        <button onclick="reboot()" style="background:#a22">Reboot</button>
+      </div>
+      <div id="status" class="status"></div>
+    </div>
+  </div>
+</div>
+<script>
+(function(){
+  const fw   = document.getElementById('fw');
+  const btn  = document.getElementById('go');
+  const fsf  = document.getElementById('fsf');
+  const fsBtn = document.getElementById('fsgo');
+  const fill = document.getElementById('fill');
+  const msg  = document.getElementById('msg');
+  const status = document.getElementById('status');
+
+  function setFill(p, cls){
+    fill.style.width = (Math.max(0,Math.min(100,p))|0) + '%';
+    fill.className = 'fill ' + (cls||'up');
+  }
+  function reboot(){
+    fetch('/reboot',{method:'POST'}).catch(()=>0);
+    setTimeout(()=>location.reload(), 2500);
+  }
+  function pingUntilUp(path, cb){
+    let tries = 0;
+    const t = setInterval(()=>{
+      fetch(path, {cache:'no-store'}).then(r=>{ if (r.ok) { clearInterval(t); cb(true); } })
+      .catch(()=>{});
+      if (++tries > 180) { clearInterval(t); cb(false); }
+    }, 1000);
+  }
+
+  async function sha256Hex(f){
+    // crypto.subtle only exists on secure origins; skip verification otherwise
+    if(!(window.crypto && crypto.subtle)) return '';
+    try{
+      const d = await crypto.subtle.digest('SHA-256', await f.arrayBuffer());
+      return Array.from(new Uint8Array(d)).map(b=>b.toString(16).padStart(2,'0')).join('');
+    }catch(e){ return ''; }
+  }
+  // Flashed image size: the gzip ISIZE trailer, or the file itself
+  async function imageSize(f){
+    const head = new Uint8Array(await f.slice(0,2).arrayBuffer());
+    if (f.size < 18 || head[0] !== 0x1f || head[1] !== 0x8b) return f.size;
+    return new DataView(await f.slice(-4).arrayBuffer()).getUint32(0, true);
+  }
+
+  async function send(f, url){
+    msg.textContent = 'Preparing...';
+    let q = 'size=' + await imageSize(f);
+    const sha = await sha256Hex(f);
+    if (sha) q += '&sha256=' + sha;
+
+    msg.textContent = 'Uploading...';
+    status.textContent = '';
+    setFill(0, 'up');
+
+    const xhr = new XMLHttpRequest();
+    xhr.open('POST', url + '?' + q, true);
+    xhr.responseType = 'text';
+
+    xhr.upload.onprogress = function(ev){
+      if (ev.lengthComputable) {
+        const pc = ev.total ? (ev.loaded * 100 / ev.total) : 0;
+        setFill(pc, 'up');
+      }
+    };
+
+    xhr.onerror = function(){
+      setFill(100, 'err');
+      msg.textContent = 'Upload failed (network error).';
+    };
+
+    xhr.onload = function(){
+      let ok = xhr.status>=200 && xhr.status<300, j = {};
+      try { j = JSON.parse(xhr.responseText||'{}'); ok = ok && !!j.ok; } catch(e){}
+      if (ok && j.files) {
+        setFill(100, 'ok');
+        msg.textContent = 'Installed ' + j.files.map(x=>x.path).join(', ') + (j.gzip ? ' from gzip' : '') +
+                          ' in ' + (j.ms/1000).toFixed(1) + ' s (' + j.kBps + ' KB/s).';
+      } else if (ok) {
+        setFill(100, 'ok');
+        msg.textContent = (j.fs ? 'Filesystem written' : 'Flashed OK') + ' (' + Math.round(j.bytes/1024) + ' KB' + (j.delta ? ' patched' : '') + (j.gzip ? ' from gzip' : '') +
+                          ' in ' + (j.ms/1000).toFixed(1) + ' s, ' + j.kBps + ' KB/s). Rebooting device...';
+        status.textContent = 'Waiting for device to come back online...';
+        fetch('/reboot',{method:'POST'}).catch(()=>0);
+        pingUntilUp('/ping', function(up){
+          status.textContent = up ? 'Device is back online. You may open File Manager.' :
+                                    'Device did not respond in time. Power-cycle if needed.';
+        });
+      } else {
+        setFill(100, 'err');
+        msg.textContent = 'Flash failed' + (j.err ? ': ' + j.err : '.');
+        status.textContent = xhr.responseText || ('HTTP '+xhr.status);
+      }
+    };
+
+    const form = new FormData();
+    form.append('file', f, f.name);
+    xhr.send(form);
+  }
+
+  btn.onclick = function(){
+    const f = fw.files && fw.files[0];
+    if(!f){ msg.textContent = 'Please select a firmware file first.'; return; }
+    send(f, '/ota');
+  };
+  fsBtn.onclick = function(){
+    const f = fsf.files && fsf.files[0];
+    if(!f){ msg.textContent = 'Please select a sound bank or filesystem image first.'; return; }
+    send(f, '/ota/fs');
+  };
+
+  window.reboot = reboot;
+})();
+</script>
+</body></html>
+)html";
+
+// -------------- Upload state --------------
+// Upload callbacks all run on the AsyncTCP task, so one context is enough
+enum class Stage : uint8_t { Raw, GzFixed, GzExtraLen, GzExtra, GzName, GzComment, GzHcrc, GzBody, GzTrailer, GzDone };
+// Where an upload goes: /ota -> app slot, /ota/fs -> data partition
+enum class Target : uint8_t { App, Data };
+// What the (inflated) stream turned out to be, from its first bytes
+enum class Kind  : uint8_t { Unknown, Image, Patch, FsImage, Bank };
+
+struct OtaCtx {
+  AsyncWebServerRequest* req = nullptr;   // owner of the update in progress
+  Target   target = Target::App;
+  Stage    stage = Stage::Raw;
+  Kind     kind = Kind::Unknown;
+  uint8_t  magic[4];                      // /ota/fs: first bytes, until the kind is known
+  uint8_t  magicLen = 0;
+  bool     gzip = false;
+  bool     failed = false;
+  int      code = 0;
+  const char* err = nullptr;
+
+  size_t   expected = 0;                  // ?size= (inflated), 0 = unknown
+  uint32_t received = 0;                  // uploaded bytes
+  uint32_t inflated = 0;                  // gzip output (image or patch)
+  uint32_t flashed = 0;                   // bytes handed to Update
+  unsigned long startedAt = 0;
+  uint32_t elapsedMs = 0;
+
+  // gzip framing
+  uint8_t  hdr[10];
+  uint8_t  hdrLen = 0;
+  uint8_t  flags = 0;
+  uint16_t skip = 0;                      // FEXTRA payload / FHCRC bytes left
+  uint8_t  trailer[8];
+  uint8_t  trailerLen = 0;
+  uint32_t crc = 0;
+  tinfl_decompressor* inf = nullptr;
+  uint8_t* dict = nullptr;
+  size_t   dictOfs = 0;
+
+  // delta patch against the running slot
+  DeltaPatch* delta = nullptr;
+  const esp_partition_t* base = nullptr;
+  Sha256   outHash;                       // patched image, vs the patch header
+
+  // data partition
+  bool     fsUnmounted = false;           // SPIFFS taken down for an image write
+  bool     bankOpen = false;              // BankInstall owes a commit() or abort()
+
+  bool     hasSha = false;
+  uint8_t  sha[Sha256::kSize];
+  Sha256   hash;                          // uploaded bytes, vs ?sha256=
+};
+
+static OtaCtx g;
+
+// Buffers live until the reply (or disconnect): fail() can be reached from
+// inside the inflate loop or a patch callback, so it must not free them
+static void freeBuffers() {
+  free(g.inf);  g.inf = nullptr;
+  free(g.dict); g.dict = nullptr;
+  delete g.delta; g.delta = nullptr;
+}
+
+static void fail(int code, const char* err) {
+  if (g.failed) return;
+  g.failed = true;
+  g.code = code;
+  g.err = err;
+  if (Update.isRunning()) Update.abort();
+  Serial.printf("[OTA] Failed: %s\n", err);
+}
+
+// Failed or abandoned upload: undo whatever was started
+static void release() {
+  if (Update.isRunning()) Update.abort();
+  if (g.bankOpen) { BankInstall::abort(); g.bankOpen = false; }
+  if (g.fsUnmounted) {
+    // Intact unless the image write got going; then only a good image fixes it
+    FsWorker::Guard lock;
+    if (!SPIFFS.begin(false)) Serial.println("[OTA] SPIFFS does not mount after failed image write");
+    g.fsUnmounted = false;
+  }
+  freeBuffers();
+  g.req = nullptr;
+}
+
+static bool flash(uint8_t* p, size_t n) {
+  TRACE_SCOPE("ota_write");
+  if (Update.write(p, n) != n) {
+    Update.printError(Serial);
+    fail(500, Update.errorString());
+    return false;
+  }
+  g.flashed += n;
+  return true;
+}
+
+static uint32_t rd32le(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// -------------- Delta patch --------------
+// The base is the running slot as flashed; its first baseSize bytes must
+// hash to the patch's base digest before anything is written
+static bool onPatchHeader(void*, const DeltaPatch::Header& h) {
+  g.base = esp_ota_get_running_partition();
+  if (!g.base || h.baseSize > g.base->size) { fail(409, "patch base larger than running slot"); return false; }
+
+  TRACE_SCOPE("ota_base_hash");
+  const unsigned long t0 = millis();
+  Sha256 hash;
+  uint8_t buf[kBaseChunk];
+  for (uint32_t off = 0; off < h.baseSize; off += sizeof(buf)) {
+    const size_t k = std::min<size_t>(sizeof(buf), h.baseSize - off);
+    if (esp_partition_read(g.base, off, buf, k) != ESP_OK) { fail(500, "base read failed"); return false; }
+    hash.update(buf, k);
+  }
+  uint8_t digest[Sha256::kSize];
+  hash.finish(digest);
+  if (memcmp(digest, h.baseSha, sizeof(digest)) != 0) { fail(409, "patch is for a different base image"); return false; }
+
+  Serial.printf("[OTA] Patch: base %u bytes verified in %lu ms, new image %u bytes\n",
+                (unsigned)h.baseSize, (unsigned long)(millis() - t0), (unsigned)h.newSize);
+  if (!Update.begin(h.newSize)) {
+    Update.printError(Serial);
+    fail(413, Update.errorString());
+    return false;
+  }
+  g.outHash.reset();
+  return true;
+}
+
+static bool readBase(void*, uint32_t off, uint8_t* out, size_t len) {
+  return esp_partition_read(g.base, off, out, len) == ESP_OK;
+}
+
+static bool writePatched(void*, uint8_t* data, size_t len) {
+  g.outHash.update(data, len);
+  return flash(data, len);
+}
+
+// -------------- Data partition --------------
+static void markStaleJob(void*) { SoundIndex::markStale(); }
+
+// Raw SPIFFS image: unmount first so nothing reads or writes the old
+// filesystem while it is overwritten; the index is rebuilt on the next boot
+static bool startFsImage() {
+  AudioPlayer::stop();
+  {
+    FsWorker::Guard lock;   // waits out a job or playback read in flight
+    SPIFFS.end();
+  }
+  g.fsUnmounted = true;
+  if (!FsWorker::post(markStaleJob, nullptr, kPostWaitMs)) { fail(503, "fs busy"); return false; }
+  if (!Update.begin(g.expected ? g.expected : UPDATE_SIZE_UNKNOWN, U_SPIFFS)) {
+    Update.printError(Serial);
+    fail(g.expected ? 413 : 500, Update.errorString());
+    return false;
+  }
+  Serial.println("[OTA] Writing filesystem image; reboot when done");
+  return true;
+}
+
+static bool startBank() {
+  if (!BankInstall::begin()) { fail(409, "sound bank still being installed"); return false; }
+  g.bankOpen = true;
+  return true;
+}
+
+static bool toBank(const uint8_t* p, size_t n) {
+  if (BankInstall::write(p, n)) return true;
+  int code = 503;
+  const char* err = "fs busy";
+  BankInstall::failure(code, err);
+  fail(code, err);
+  return false;
+}
+
+// -------------- Dispatch --------------
+static bool sink(uint8_t* p, size_t n) {
+  switch (g.kind) {
+    case Kind::Image:
+    case Kind::FsImage:
+      return flash(p, n);
+    case Kind::Patch:
+      if (!g.delta->feed(p, n)) { fail(400, g.delta->error()); return false; }
+      return true;
+    case Kind::Bank:
+      return toBank(p, n);
+    default:
+      return false;
+  }
+}
+
+// /ota: "XSD1" is a patch, anything else goes to Update as an image (which
+// checks the 0xE9 magic). One byte decides, so nothing is held back.
+static bool startApp(const uint8_t* p) {
+  if (p[0] == 'X') {
+    g.kind = Kind::Patch;
+    g.delta = new (std::nothrow) DeltaPatch();
+    if (!g.delta) { fail(503, "no memory for patch"); return false; }
+    g.delta->reset(onPatchHeader, readBase, writePatched, nullptr);
+    return true;
+  }
+  g.kind = Kind::Image;
+  if (!Update.begin(g.expected ? g.expected : UPDATE_SIZE_UNKNOWN)) {
+    Update.printError(Serial);
+    fail(g.expected ? 413 : 500, Update.errorString());
+    return false;
+  }
+  return true;
+}
+
+// /ota/fs: a SPIFFS image can start with anything, so the whole 4-byte
+// magic is collected before deciding
+static bool startData() {
+  if (DeltaPatch::isPatch(g.magic, sizeof(g.magic))) { fail(400, "firmware patch: use /ota"); return false; }
+  if (SoundBank::isBank(g.magic, sizeof(g.magic))) {
+    g.kind = Kind::Bank;
+    return startBank();
+  }
+  g.kind = Kind::FsImage;
+  return startFsImage();
+}
+
+// Every byte of the (inflated) upload comes through here
+static bool emit(uint8_t* p, size_t n) {
+  if (g.kind == Kind::Unknown) {
+    if (g.target == Target::App) {
+      if (!startApp(p)) return false;
+    } else {
+      while (g.magicLen < sizeof(g.magic) && n) { g.magic[g.magicLen++] = *p++; n--; }
+      if (g.magicLen < sizeof(g.magic)) return true;
+      if (!startData() || !sink(g.magic, sizeof(g.magic))) return false;
+      if (!n) return true;
+    }
+  }
+  return sink(p, n);
+}
+
+// Inflates into the ring dictionary and flashes each produced span.
+// Returns input bytes consumed; the stage moves to GzTrailer at stream end.
+static size_t inflateChunk(const uint8_t* p, size_t n) {
+  size_t used = 0;
+  for (;;) {
+    size_t inSz = n - used;
+    size_t outSz = kDictSize - g.dictOfs;
+    const tinfl_status st = tinfl_decompress(g.inf, p + used, &inSz, g.dict, g.dict + g.dictOfs, &outSz,
+                                             TINFL_FLAG_HAS_MORE_INPUT);
+    used += inSz;
+    if (outSz) {
+      uint8_t* out = g.dict + g.dictOfs;
+      g.crc = esp_rom_crc32_le(g.crc, out, outSz);
+      g.inflated += outSz;
+      if (!emit(out, outSz)) return used;
+      g.dictOfs = (g.dictOfs + outSz) & (kDictSize - 1);
+    }
+    if (st == TINFL_STATUS_DONE) { g.stage = Stage::GzTrailer; return used; }
+    if (st < 0) { fail(400, "bad gzip data"); return used; }
+    if (st == TINFL_STATUS_NEEDS_MORE_INPUT) return used;   // all input taken
+    // HAS_MORE_OUTPUT: ring is full, go round again
+  }
+}
+
+// gzip member framing (RFC 1952) around the deflate stream, byte by byte so
+// a header split across TCP chunks is fine
+static void feedGzip(const uint8_t* p, size_t n) {
+  size_t i = 0;
+  while (i < n && !g.failed) {
+    switch (g.stage) {
+      case Stage::GzFixed:
+        g.hdr[g.hdrLen++] = p[i++];
+        if (g.hdrLen < sizeof(g.hdr)) break;
+        if (g.hdr[1] != 0x8B || g.hdr[2] != 8) { fail(400, "not a gzip deflate stream"); break; }
+        g.flags = g.hdr[3];
+        g.hdrLen = 0;
+        g.stage = (g.flags & kFExtra) ? Stage::GzExtraLen : Stage::GzName;
+        break;
+      case Stage::GzExtraLen:
+        g.hdr[g.hdrLen++] = p[i++];
+        if (g.hdrLen < 2) break;
+        g.skip = (uint16_t)(g.hdr[0] | (g.hdr[1] << 8));
+        g.stage = Stage::GzExtra;
+        break;
+      case Stage::GzExtra: {
+        const size_t k = std::min<size_t>(g.skip, n - i);
+        i += k; g.skip -= k;
+        if (!g.skip) g.stage = Stage::GzName;
+        break;
+      }
+      case Stage::GzName:
+        if (!(g.flags & kFName) || p[i++] == 0) g.stage = Stage::GzComment;
+        break;
+      case Stage::GzComment:
+        if (!(g.flags & kFComment) || p[i++] == 0) {
+          g.skip = (g.flags & kFHcrc) ? 2 : 0;
+          g.stage = Stage::GzHcrc;
+        }
+        break;
+      case Stage::GzHcrc:
+        if (g.skip) { g.skip--; i++; break; }
+        g.stage = Stage::GzBody;
+        break;
+      case Stage::GzBody:
+        i += inflateChunk(p + i, n - i);
+        break;
+      case Stage::GzTrailer:
+        g.trailer[g.trailerLen++] = p[i++];
+        if (g.trailerLen == sizeof(g.trailer)) g.stage = Stage::GzDone;
+        break;
+      case Stage::GzDone:
+        return;   // trailing bytes (padding / concatenated members) ignored
+      default:
+        return;
+    }
+  }
+}
+
+static void beginOta(AsyncWebServerRequest* request, Target target, const String& filename, const uint8_t* first) {
+  g.req = request;
+  g.target = target;
+  g.stage = Stage::Raw;
+  g.kind = Kind::Unknown;
+  g.magicLen = 0;
+  g.failed = false;
+  g.code = 0;
+  g.err = nullptr;
+  g.expected = request->hasParam("size") ? (size_t)request->getParam("size")->value().toInt() : 0;
+  g.received = g.inflated = g.flashed = 0;
+  g.elapsedMs = 0;
+  g.startedAt = millis();
+  g.hdrLen = g.trailerLen = 0;
+  g.crc = 0;
+  g.dictOfs = 0;
+  g.hash.reset();
+  g.hasSha = false;
+
+  // Abort the half-written update if this client goes away
+  request->onDisconnect([request]() {
+    if (g.req == request) {
+      Serial.println("[OTA] Client gone, update aborted");
+      release();
+    }
+  });
+
+  if (request->hasParam("sha256")) {
+    g.hasSha = Sha256::fromHex(request->getParam("sha256")->value().c_str(), g.sha);
+    if (!g.hasSha) { fail(400, "bad sha256"); return; }
+  }
+
+  g.gzip = first[0] == kGzMagic0;
+  if (g.gzip) {
+    g.inf  = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    g.dict = (uint8_t*)malloc(kDictSize);
+    if (!g.inf || !g.dict) { fail(503, "no memory for inflate"); return; }
+    tinfl_init(g.inf);
+    g.stage = Stage::GzFixed;
+  }
+
+  Serial.printf("[OTA] Starting: %s -> %s (%s, image %u bytes)\n", filename.c_str(),
+                target == Target::App ? "app" : "data", g.gzip ? "gzip" : "raw", (unsigned)g.expected);
+}
+
+// Everything that must hold before the image is marked bootable
+static void finishOta() {
+  g.elapsedMs = (uint32_t)(millis() - g.startedAt);
+  if (g.gzip) {
+    if (g.stage != Stage::GzDone) { fail(400, "truncated gzip"); return; }
+    if (rd32le(g.trailer) != g.crc)       { fail(400, "gzip crc mismatch"); return; }
+    if (rd32le(g.trailer + 4) != g.inflated) { fail(400, "gzip size mismatch"); return; }
+  }
+  if (g.kind == Kind::Unknown) { fail(400, g.magicLen ? "upload too short" : "empty upload"); return; }
+  if (g.kind == Kind::Patch) {
+    if (!g.delta->done()) { fail(400, "truncated patch"); return; }
+    uint8_t digest[Sha256::kSize];
+    g.outHash.finish(digest);
+    if (memcmp(digest, g.delta->header().newSha, sizeof(digest)) != 0) { fail(400, "patched image sha256 mismatch"); return; }
+  } else if (g.kind != Kind::Bank && g.expected && g.flashed != g.expected) {
+    fail(400, "size mismatch"); return;
+  }
+  if (g.hasSha) {
+    uint8_t digest[Sha256::kSize];
+    g.hash.finish(digest);
+    if (memcmp(digest, g.sha, sizeof(digest)) != 0) { fail(400, "sha256 mismatch"); return; }
+  }
+  // Bank entries were checked one by one; the swap happens on the worker
+  if (g.kind == Kind::Bank) return;
+  // Known size (patch header or ?size=): the image must be complete
+  if (!Update.end(g.kind == Kind::Image && g.expected == 0)) {
+    Update.printError(Serial);
+    fail(500, Update.errorString());
+    return;
+  }
+  Serial.printf("[OTA] Finished: %u bytes flashed from %u received in %lu ms\n",
+                (unsigned)g.flashed, (unsigned)g.received, (unsigned long)g.elapsedMs);
+}
+
+static void handleUpload(AsyncWebServerRequest* request, Target target, const String& filename,
+                         size_t index, uint8_t* data, size_t len, bool final) {
+  if (index == 0) {
+    if (g.req && g.req != request) return;   // answered with 409 below
+    if (!len) return;
+    beginOta(request, target, filename, data);
+  }
+  if (g.req != request || g.failed) return;
+
+  if (len) {
+    g.received += len;
+    if (g.hasSha) g.hash.update(data, len);
+    if (g.gzip) feedGzip(data, len);
+    else        emit(data, len);
+  }
+  if (final && !g.failed) finishOta();
+}
+
+static void handleDone(AsyncWebServerRequest* request) {
+  if (g.req != request) {
+    if (g.req) WebJson::sendError(request, 409, "update in progress");
+    else       WebJson::sendError(request, 400, "no file");
+    return;
+  }
+  if (g.failed) {
+    WebJson::sendError(request, g.code ? g.code : 500, g.err ? g.err : "fail");
+    release();
+    return;
+  }
+  if (g.kind == Kind::Bank) {
+    // Answered by the worker once every slot is swapped in
+    BankInstall::commit(request, BankInstall::Transfer{ g.received, g.elapsedMs, g.gzip });
+    g.bankOpen = false;
+    freeBuffers();
+    g.req = nullptr;
+    return;
+  }
+  const uint32_t ms = g.elapsedMs ? g.elapsedMs : 1;
+  WebJson::Reply j;
+  j.beginObject()
+   .kv("ok", true)
+   .kv("bytes", g.flashed)
+   .kv("received", g.received)
+   .kv("gzip", g.gzip)
+   .kv("delta", g.kind == Kind::Patch)
+   .kv("fs", g.kind == Kind::FsImage)
+   .kv("ms", g.elapsedMs)
+   .kv("kBps", (uint32_t)((uint64_t)g.received / ms))   // bytes per ms, as /api/bench
+   .kv("sha256", g.hasSha)
+   .endObject();
+  j.send(request);
+  Serial.println("[OTA] Update uploaded OK; client will reboot device.");
+  freeBuffers();
+  g.fsUnmounted = false;   // stays down until the reboot
+  g.req = nullptr;
+}
+
+namespace Ota {
+
+  void registerRoutes(AsyncWebServer& server) {
+    // Optional firmware info
+    server.on("/fw", HTTP_GET, [](AsyncWebServerRequest* req){
+      String v = String("TypeD/") + String(__DATE__) + " " + String(__TIME__);
+      req->send(200, "text/plain", v);
+    });
+
+    // OTA page
+    server.on("/ota", HTTP_GET, [](AsyncWebServerRequest* req){
+      req->send_P(200, "text/html", OTA_PAGE);
+    });
+
+    // Data partition: SPIFFS image or XSB1 sound bank. Before /ota, which
+    // would otherwise take /ota/fs too (a route matches the URLs below it).
+    server.on("/ota/fs", HTTP_POST,
+      [](AsyncWebServerRequest* r){ handleDone(r); },
+      [](AsyncWebServerRequest* r, String fn, size_t idx, uint8_t* d, size_t l, bool fin){
+        handleUpload(r, Target::Data, fn, idx, d, l, fin);
+      });
+
+    // OTA upload/flash (streamed), JSON reply; client triggers /reboot
+    server.on("/ota", HTTP_POST,
+      [](AsyncWebServerRequest* r){ handleDone(r); },
+      [](AsyncWebServerRequest* r, String fn, size_t idx, uint8_t* d, size_t l, bool fin){
+        handleUpload(r, Target::App, fn, idx, d, l, fin);
+      });
+  }
+
+  bool busy() { return g.req != nullptr; }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Firmware update over HTTP. POST /ota takes a multipart upload of a raw
+// app image or a gzip of one (sniffed from the first byte, not the name);
+// gzip is inflated chunk by chunk straight into Update.write(), so the
+// compressed file never has to fit anywhere.
+//   ?size=<n>      size of the (inflated) image: passed to Update.begin and
+//                  required to match exactly; UPDATE_SIZE_UNKNOWN without it
+//   ?sha256=<hex>  digest of the uploaded file bytes, checked before
+//                  Update.end() so a mismatch never becomes bootable
+// gzip streams are also checked against their own CRC32/ISIZE trailer.
+//
+// The (inflated) stream may also be an "XSD1" delta patch against the
+// running slot (tools/xsdelta, format in ota_delta.h). The base hash is
+// checked against the running partition before Update.begin(newSize), and
+// the patched output against the new-image hash before Update.end();
+// ?size= is ignored for patches since the header carries it.
+//
+// POST /ota/fs takes the same framing (gzip, ?size=, ?sha256=) for the data
+// partition: an "XSB1" sound bank (sound_bank.h) is unpacked into the slots
+// by BankInstall, anything else is written as a raw SPIFFS image with SPIFFS
+// unmounted; the sound index is then rebuilt on the next boot.
+// One update at a time; a second upload gets 409.
+namespace Ota {
+
+  // Registers /fw, GET /ota (page), POST /ota and POST /ota/fs
+  void registerRoutes(AsyncWebServer& server);
+
+  bool busy();
+}
@@ -0,0 +1,119 @@
+#include "ota_delta.h"
+
+#include <string.h>
+
+static const uint8_t kMagic[4] = { 'X', 'S', 'D', '1' };
+
+static uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool DeltaPatch::isPatch(const uint8_t* p, size_t len) {
+  return len >= sizeof(kMagic) && memcmp(p, kMagic, sizeof(kMagic)) == 0;
+}
+
+void DeltaPatch::reset(OnHeader onHeader, ReadBase readBase, Write write, void* ctx) {
+  _onHeader = onHeader;
+  _readBase = readBase;
+  _write = write;
+  _ctx = ctx;
+  _state = State::Header;
+  _err = nullptr;
+  memset(&_hdr, 0, sizeof(_hdr));
+  _accLen = 0;
+  _oldPos = 0;
+  _newPos = 0;
+  _left = 0;
+  _extraLen = 0;
+  _seek = 0;
+}
+
+bool DeltaPatch::fail(const char* err) {
+  if (_state != State::Error) _err = err;
+  _state = State::Error;
+  return false;
+}
+
+// After the extra run: apply the seek, then the next block or the end
+bool DeltaPatch::endBlock() {
+  _oldPos += _seek;
+  if (_oldPos < 0 || _oldPos > (int64_t)_hdr.baseSize) return fail("patch seeks outside base");
+  _state = _newPos == _hdr.newSize ? State::Done : State::Ctrl;
+  return true;
+}
+
+bool DeltaPatch::feed(const uint8_t* p, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    switch (_state) {
+      case State::Header: {
+        const size_t k = kHeaderSize - _accLen < n - i ? kHeaderSize - _accLen : n - i;
+        memcpy(_acc + _accLen, p + i, k);
+        _accLen += k; i += k;
+        if (_accLen < kHeaderSize) break;
+        if (!isPatch(_acc, _accLen)) return fail("not a patch");
+        _hdr.baseSize = rd32(_acc + 4);
+        _hdr.newSize  = rd32(_acc + 8);
+        memcpy(_hdr.baseSha, _acc + 12, 32);
+        memcpy(_hdr.newSha,  _acc + 44, 32);
+        if (!_hdr.baseSize || !_hdr.newSize) return fail("empty image in patch");
+        if (_onHeader && !_onHeader(_ctx, _hdr)) return fail("patch rejected");
+        _accLen = 0;
+        _state = State::Ctrl;
+        break;
+      }
+
+      case State::Ctrl: {
+        const size_t k = kCtrlSize - _accLen < n - i ? kCtrlSize - _accLen : n - i;
+        memcpy(_acc + _accLen, p + i, k);
+        _accLen += k; i += k;
+        if (_accLen < kCtrlSize) break;
+        _accLen = 0;
+        const uint32_t diffLen = rd32(_acc);
+        _extraLen = rd32(_acc + 4);
+        _seek     = (int32_t)rd32(_acc + 8);
+        const uint32_t room = _hdr.newSize - _newPos;
+        if (diffLen > room || _extraLen > room - diffLen) return fail("patch overruns image");
+        if (_oldPos + diffLen > (int64_t)_hdr.baseSize) return fail("patch reads past base");
+        if (!diffLen && !_extraLen && !_seek) return fail("empty patch block");
+        _left = diffLen;
+        if (_left) _state = State::Diff;
+        else if (_extraLen) { _left = _extraLen; _state = State::Extra; }
+        else if (!endBlock()) return false;
+        break;
+      }
+
+      case State::Diff: {
+        size_t k = n - i < _left ? n - i : _left;
+        if (k > kBlock) k = kBlock;
+        if (!_readBase(_ctx, (uint32_t)_oldPos, _base, k)) return fail("base read failed");
+        for (size_t j = 0; j < k; ++j) _out[j] = (uint8_t)(_base[j] + p[i + j]);
+        if (!_write(_ctx, _out, k)) return fail("write failed");
+        i += k; _left -= k;
+        _oldPos += k; _newPos += k;
+        if (_left) break;
+        if (_extraLen) { _left = _extraLen; _state = State::Extra; }
+        else if (!endBlock()) return false;
+        break;
+      }
+
+      case State::Extra: {
+        size_t k = n - i < _left ? n - i : _left;
+        if (k > kBlock) k = kBlock;
+        memcpy(_out, p + i, k);
+        if (!_write(_ctx, _out, k)) return fail("write failed");
+        i += k; _left -= k;
+        _newPos += k;
+        if (!_left && !endBlock()) return false;
+        break;
+      }
+
+      case State::Done:
+        return fail("trailing data after patch");
+
+      case State::Error:
+        return false;
+    }
+  }
+  return _state != State::Error;
+}
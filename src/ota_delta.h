@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming applier for "XSD1" binary patches (bsdiff-style), produced on
+// the host by tools/xsdelta. Fed with arbitrary chunks of the patch; reads
+// the base image through a callback and hands out the new image in order,
+// so neither image has to be in RAM. Plain C++: the host tool links the
+// same code to check every patch it writes.
+//
+// Layout (little-endian):
+//   "XSD1"  u32 baseSize  u32 newSize  u8 baseSha[32]  u8 newSha[32]
+//   then blocks until newSize bytes have been produced:
+//     u32 diffLen  u32 extraLen  i32 seek
+//     diffLen bytes   added (mod 256) to base[oldPos..], oldPos += diffLen
+//     extraLen bytes  copied as-is
+//     oldPos += seek
+// Hashes are only carried here; checking them is up to the caller.
+class DeltaPatch {
+public:
+  static const size_t kHeaderSize = 76;
+  static const size_t kCtrlSize   = 12;
+  static const size_t kBlock      = 256;   // base bytes read per callback
+
+  struct Header {
+    uint32_t baseSize;
+    uint32_t newSize;
+    uint8_t  baseSha[32];
+    uint8_t  newSha[32];
+  };
+
+  // Return false to stop the patch (the caller records why)
+  typedef bool (*OnHeader)(void* ctx, const Header& h);
+  typedef bool (*ReadBase)(void* ctx, uint32_t offset, uint8_t* out, size_t len);
+  typedef bool (*Write)(void* ctx, uint8_t* data, size_t len);
+
+  // True if the bytes start with the patch magic (needs 4 bytes)
+  static bool isPatch(const uint8_t* p, size_t len);
+
+  DeltaPatch() { reset(nullptr, nullptr, nullptr, nullptr); }
+  void reset(OnHeader onHeader, ReadBase readBase, Write write, void* ctx);
+
+  // Returns false once the patch is known to be bad (see error())
+  bool feed(const uint8_t* data, size_t len);
+
+  bool done() const { return _state == State::Done; }
+  const char* error() const { return _err; }
+  const Header& header() const { return _hdr; }
+  uint32_t produced() const { return _newPos; }
+
+private:
+  enum class State : uint8_t { Header, Ctrl, Diff, Extra, Done, Error };
+
+  bool fail(const char* err);
+  bool endBlock();
+
+  OnHeader _onHeader;
+  ReadBase _readBase;
+  Write    _write;
+  void*    _ctx;
+
+  State    _state;
+  const char* _err;
+  Header   _hdr;
+  uint8_t  _acc[kHeaderSize];   // header / control bytes split across chunks
+  size_t   _accLen;
+  int64_t  _oldPos;
+  uint32_t _newPos;
+  uint32_t _left;               // bytes left in the current diff/extra run
+  uint32_t _extraLen;
+  int32_t  _seek;
+  uint8_t  _base[kBlock];
+  uint8_t  _out[kBlock];
+};
@@ -0,0 +1,53 @@
+#include "sha256.h"
+
+#include <string.h>
+
+Sha256::Sha256() {
+  mbedtls_sha256_init(&_ctx);
+  mbedtls_sha256_starts(&_ctx, /*is224=*/0);
+}
+
+Sha256::~Sha256() {
+  mbedtls_sha256_free(&_ctx);
+}
+
+void Sha256::reset() {
+  mbedtls_sha256_free(&_ctx);
+  mbedtls_sha256_init(&_ctx);
+  mbedtls_sha256_starts(&_ctx, /*is224=*/0);
+}
+
+void Sha256::update(const void* data, size_t len) {
+  if (len) mbedtls_sha256_update(&_ctx, (const unsigned char*)data, len);
+}
+
+void Sha256::finish(uint8_t out[kSize]) {
+  mbedtls_sha256_finish(&_ctx, out);
+}
+
+static int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool Sha256::fromHex(const char* hex, uint8_t out[kSize]) {
+  if (!hex || strlen(hex) != kSize * 2) return false;
+  for (size_t i = 0; i < kSize; ++i) {
+    const int hi = hexNibble(hex[2 * i]);
+    const int lo = hexNibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
+
+void Sha256::toHex(const uint8_t in[kSize], char out[kSize * 2 + 1]) {
+  static const char kHex[] = "0123456789abcdef";
+  for (size_t i = 0; i < kSize; ++i) {
+    out[2 * i]     = kHex[in[i] >> 4];
+    out[2 * i + 1] = kHex[in[i] & 0xF];
+  }
+  out[kSize * 2] = '\0';
+}
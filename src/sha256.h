@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mbedtls/sha256.h"
+
+// Thin streaming SHA-256 wrapper (mbedtls) plus hex helpers.
+class Sha256 {
+public:
+  static const size_t kSize = 32;
+
+  Sha256();
+  ~Sha256();
+  Sha256(const Sha256&) = delete;
+  Sha256& operator=(const Sha256&) = delete;
+
+  void reset();
+  void update(const void* data, size_t len);
+  void finish(uint8_t out[kSize]);
+
+  // 64 hex chars -> 32 bytes. False on bad length/characters.
+  static bool fromHex(const char* hex, uint8_t out[kSize]);
+  // 32 bytes -> 64 lowercase hex chars + NUL
+  static void toHex(const uint8_t in[kSize], char out[kSize * 2 + 1]);
+
+private:
+  mbedtls_sha256_context _ctx;
+};
@@ -0,0 +1,91 @@
+#include "sound_bank.h"
+
+#include <string.h>
+
+static const uint8_t kMagic[4] = { 'X', 'S', 'B', '1' };
+
+static uint32_t rd32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool SoundBank::isBank(const uint8_t* p, size_t len) {
+  return len >= sizeof(kMagic) && memcmp(p, kMagic, sizeof(kMagic)) == 0;
+}
+
+void SoundBank::reset(OnEntry onEntry, OnData onData, OnEnd onEnd, void* ctx) {
+  _onEntry = onEntry;
+  _onData = onData;
+  _onEnd = onEnd;
+  _ctx = ctx;
+  _state = State::Header;
+  _err = nullptr;
+  _accLen = 0;
+  _count = 0;
+  _index = 0;
+  _left = 0;
+  memset(&_entry, 0, sizeof(_entry));
+}
+
+bool SoundBank::fail(const char* err) {
+  if (_state != State::Error) _err = err;
+  _state = State::Error;
+  return false;
+}
+
+bool SoundBank::endEntry() {
+  if (_onEnd && !_onEnd(_ctx, _entry)) return fail("entry rejected");
+  _state = ++_index == _count ? State::Done : State::Entry;
+  return true;
+}
+
+bool SoundBank::feed(const uint8_t* p, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    switch (_state) {
+      case State::Header: {
+        const size_t k = kHeaderSize - _accLen < n - i ? kHeaderSize - _accLen : n - i;
+        memcpy(_acc + _accLen, p + i, k);
+        _accLen += k; i += k;
+        if (_accLen < kHeaderSize) break;
+        if (!isBank(_acc, _accLen)) return fail("not a sound bank");
+        _count = _acc[4];
+        if (!_count || _count > kMaxEntries) return fail("bad entry count");
+        _accLen = 0;
+        _state = State::Entry;
+        break;
+      }
+
+      case State::Entry: {
+        const size_t k = kEntrySize - _accLen < n - i ? kEntrySize - _accLen : n - i;
+        memcpy(_acc + _accLen, p + i, k);
+        _accLen += k; i += k;
+        if (_accLen < kEntrySize) break;
+        _accLen = 0;
+        if (_acc[0] != '/' || memchr(_acc, 0, kPathMax) == nullptr) return fail("bad entry path");
+        memcpy(_entry.path, _acc, kPathMax);
+        _entry.size = rd32(_acc + kPathMax);
+        memcpy(_entry.sha, _acc + kPathMax + 4, sizeof(_entry.sha));
+        if (_onEntry && !_onEntry(_ctx, _entry)) return fail("entry rejected");
+        _left = _entry.size;
+        _state = State::Data;
+        if (!_left && !endEntry()) return false;
+        break;
+      }
+
+      case State::Data: {
+        const size_t k = n - i < _left ? n - i : _left;
+        if (_onData && !_onData(_ctx, p + i, k)) return fail("write failed");
+        i += k; _left -= k;
+        if (!_left && !endEntry()) return false;
+        break;
+      }
+
+      case State::Done:
+        return fail("trailing data after bank");
+
+      case State::Error:
+        return false;
+    }
+  }
+  return _state != State::Error;
+}
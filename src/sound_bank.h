@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// "XSB1" sound bank: every sound slot in one file, so a unit is provisioned
+// with a single upload (POST /ota/fs). Streaming parser only; what happens
+// to each entry's bytes is up to the callbacks. Plain C++ so host tools can
+// share it.
+//
+// Layout (little-endian):
+//   "XSB1"  u8 count  u8 reserved[3]
+//   count times:
+//     char path[24] (NUL-padded, e.g. "/boot.mp3")  u32 size  u8 sha256[32]
+//     size bytes of file data
+// Entries are sound slots ("/boot.mp3", "/eject.mp3") plus, optionally,
+// kSettingsPath: a small JSON object of default settings
+// ({"volume":0..255,"boot_enabled":bool,"eject_enabled":bool}).
+// Hashes are only carried here; checking them is up to the caller.
+class SoundBank {
+public:
+  static const size_t  kHeaderSize = 8;
+  static const size_t  kEntrySize  = 60;
+  static const size_t  kPathMax    = 24;
+  static const uint8_t kMaxEntries = 8;
+  static const size_t  kSettingsMax = 512;
+  static constexpr char kSettingsPath[] = "/settings.json";
+
+  struct Entry {
+    char     path[kPathMax];   // always NUL-terminated
+    uint32_t size;
+    uint8_t  sha[32];
+  };
+
+  // Return false to stop the bank (the caller records why)
+  typedef bool (*OnEntry)(void* ctx, const Entry& e);
+  typedef bool (*OnData)(void* ctx, const uint8_t* data, size_t len);
+  typedef bool (*OnEnd)(void* ctx, const Entry& e);
+
+  // True if the bytes start with the bank magic (needs 4 bytes)
+  static bool isBank(const uint8_t* p, size_t len);
+
+  SoundBank() { reset(nullptr, nullptr, nullptr, nullptr); }
+  void reset(OnEntry onEntry, OnData onData, OnEnd onEnd, void* ctx);
+
+  // Returns false once the bank is known to be bad (see error())
+  bool feed(const uint8_t* data, size_t len);
+
+  bool done() const { return _state == State::Done; }
+  const char* error() const { return _err; }
+  uint8_t count() const { return _count; }
+
+private:
+  enum class State : uint8_t { Header, Entry, Data, Done, Error };
+
+  bool fail(const char* err);
+  bool endEntry();
+
+  OnEntry  _onEntry;
+  OnData   _onData;
+  OnEnd    _onEnd;
+  void*    _ctx;
+
+  State    _state;
+  const char* _err;
+  uint8_t  _acc[kEntrySize];   // header / entry bytes split across chunks
+  size_t   _accLen;
+  uint8_t  _count;
+  uint8_t  _index;
+  uint32_t _left;
+  Entry    _entry;
+};
@@ -0,0 +1,309 @@
+#include "sound_index.h"
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+
+#include "sha256.h"
+
+// -------- Settings --------
+static const char* kIndexPath = "/sound.idx";
+static const char* kPaths[]   = { "/boot.mp3", "/eject.mp3" };
+static const size_t kSlots    = sizeof(kPaths) / sizeof(kPaths[0]);
+static const char* kStaleKey  = "idx_stale";   // "xsound" NVS namespace
+
+// On-disk layout: header + Info[kSlots]. Any change to Info changes
+// infoSize, which invalidates old files (they are simply rebuilt).
+struct IndexHeader {
+  char     magic[4];     // "XSI1"
+  uint16_t infoSize;
+  uint8_t  slots;
+  uint8_t  reserved;
+};
+
+static SoundIndex::Info  g_info[kSlots];
+static SoundIndex::Usage g_usage{0, 0};
+static portMUX_TYPE      g_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Writers are serialized by the flash lock, so one scratch buffer will do
+static uint8_t g_scratch[1024];
+
+static int slotOf(const char* path) {
+  if (!path) return -1;
+  for (size_t i = 0; i < kSlots; ++i) {
+    if (strcmp(path, kPaths[i]) == 0) return (int)i;
+  }
+  return -1;
+}
+
+static void publish(size_t slot, const SoundIndex::Info& info) {
+  portENTER_CRITICAL(&g_mux);
+  g_info[slot] = info;
+  portEXIT_CRITICAL(&g_mux);
+}
+
+// -------------- MP3 probing --------------
+// Layer III only (all the decoder plays). Reads the ID3v2 header, the first
+// frame header (+ Xing/Info/VBRI frame count) and the ID3v1 tag; no decode.
+static const uint16_t kRateV1[]  = {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320};
+static const uint16_t kRateV2[]  = {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160};
+static const uint32_t kSrateV1[] = {44100, 48000, 32000};
+
+static uint32_t be32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+struct FrameHdr {
+  bool     mpeg1;
+  uint32_t sampleRate;
+  uint16_t bitrate;   // kbps
+  uint8_t  channels;
+  uint32_t length;    // bytes
+};
+
+static bool parseFrame(const uint8_t* p, FrameHdr& h) {
+  if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+  const uint8_t ver   = (p[1] >> 3) & 3;  // 0 = 2.5, 2 = 2, 3 = 1
+  const uint8_t layer = (p[1] >> 1) & 3;  // 1 = III
+  const uint8_t bri   = p[2] >> 4;
+  const uint8_t sri   = (p[2] >> 2) & 3;
+  if (ver == 1 || layer != 1 || bri == 0 || bri == 15 || sri == 3) return false;
+
+  h.mpeg1      = (ver == 3);
+  h.sampleRate = kSrateV1[sri] >> (ver == 3 ? 0 : ver == 2 ? 1 : 2);
+  h.bitrate    = h.mpeg1 ? kRateV1[bri] : kRateV2[bri];
+  h.channels   = ((p[3] >> 6) == 3) ? 1 : 2;
+  h.length     = (h.mpeg1 ? 144000u : 72000u) * h.bitrate / h.sampleRate + ((p[2] >> 1) & 1);
+  return true;
+}
+
+static void probeMp3(File& f, SoundIndex::Info& info) {
+  const size_t size = f.size();
+
+  // Skip an ID3v2 tag (syncsafe size, optional footer)
+  size_t start = 0;
+  uint8_t id3[10];
+  f.seek(0);
+  if (f.read(id3, sizeof(id3)) == sizeof(id3) && memcmp(id3, "ID3", 3) == 0) {
+    start = 10 + (((size_t)(id3[6] & 0x7F) << 21) | ((size_t)(id3[7] & 0x7F) << 14) |
+                  ((size_t)(id3[8] & 0x7F) << 7)  |  (size_t)(id3[9] & 0x7F));
+    if (id3[5] & 0x10) start += 10;
+  }
+
+  size_t end = size;
+  uint8_t tag[3];
+  if (size >= start + 128 && f.seek(size - 128) && f.read(tag, 3) == 3 && memcmp(tag, "TAG", 3) == 0) {
+    end -= 128;
+  }
+
+  if (!f.seek(start)) return;
+  const size_t n = f.read(g_scratch, sizeof(g_scratch));
+
+  // First frame whose successor (if it is in the buffer) also parses
+  FrameHdr h;
+  size_t at = 0;
+  bool found = false;
+  for (; at + 4 <= n; ++at) {
+    if (!parseFrame(g_scratch + at, h)) continue;
+    FrameHdr next;
+    if (at + h.length + 4 > n || parseFrame(g_scratch + at + h.length, next)) { found = true; break; }
+  }
+  if (!found) return;
+
+  info.sampleRate = h.sampleRate;
+  info.channels   = h.channels;
+  const size_t audioBytes = end > start + at ? end - start - at : 0;
+
+  // VBR headers carry the frame count
+  uint32_t frames = 0;
+  const size_t side = h.mpeg1 ? (h.channels == 1 ? 17 : 32) : (h.channels == 1 ? 9 : 17);
+  const uint8_t* x = g_scratch + at + 4 + side;
+  const uint8_t* v = g_scratch + at + 4 + 32;
+  if (x + 12 <= g_scratch + n && (memcmp(x, "Xing", 4) == 0 || memcmp(x, "Info", 4) == 0)) {
+    if (be32(x + 4) & 1) frames = be32(x + 8);
+    info.vbr = (x[0] == 'X');
+  } else if (v + 18 <= g_scratch + n && memcmp(v, "VBRI", 4) == 0) {
+    frames = be32(v + 14);
+    info.vbr = true;
+  }
+
+  const uint32_t spf = h.mpeg1 ? 1152 : 576;
+  if (frames) {
+    info.durationMs = (uint32_t)((uint64_t)frames * spf * 1000 / h.sampleRate);
+    info.bitrate = info.durationMs ? (uint16_t)((uint64_t)audioBytes * 8 / info.durationMs) : h.bitrate;
+  } else {
+    info.bitrate = h.bitrate;
+    info.durationMs = (uint32_t)((uint64_t)audioBytes * 8 / h.bitrate);  // bits / kbps = ms
+  }
+}
+
+static bool hashFile(File& f, uint8_t out[SoundIndex::kShaSize]) {
+  Sha256 hash;
+  size_t left = f.size();
+  if (!f.seek(0)) return false;
+  while (left) {
+    const size_t n = f.read(g_scratch, left < sizeof(g_scratch) ? left : sizeof(g_scratch));
+    if (!n) return false;
+    hash.update(g_scratch, n);
+    left -= n;
+  }
+  hash.finish(out);
+  return true;
+}
+
+// Fresh entry for a slot from its file (exists = false if there is none)
+static SoundIndex::Info scan(const char* path, const uint8_t* sha, uint32_t uploaded) {
+  SoundIndex::Info info;
+  memset(&info, 0, sizeof(info));
+  File f = SPIFFS.open(path, "r");
+  if (!f) return info;
+  info.exists = true;
+  info.size = f.size();
+  info.uploaded = uploaded;
+  probeMp3(f, info);
+  if (sha) {
+    memcpy(info.sha, sha, SoundIndex::kShaSize);
+    info.hasSha = true;
+  } else {
+    info.hasSha = hashFile(f, info.sha);
+  }
+  f.close();
+  return info;
+}
+
+// -------------- Persistence --------------
+static bool load(SoundIndex::Info* out) {
+  File f = SPIFFS.open(kIndexPath, "r");
+  if (!f) return false;
+  IndexHeader h;
+  const bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+                  memcmp(h.magic, "XSI1", 4) == 0 &&
+                  h.infoSize == sizeof(SoundIndex::Info) && h.slots == kSlots &&
+                  f.read((uint8_t*)out, sizeof(SoundIndex::Info) * kSlots) == sizeof(SoundIndex::Info) * kSlots;
+  f.close();
+  return ok;
+}
+
+static void save() {
+  SoundIndex::Info snap[kSlots];
+  portENTER_CRITICAL(&g_mux);
+  memcpy(snap, g_info, sizeof(snap));
+  portEXIT_CRITICAL(&g_mux);
+
+  IndexHeader h;
+  memcpy(h.magic, "XSI1", 4);
+  h.infoSize = sizeof(SoundIndex::Info);
+  h.slots = kSlots;
+  h.reserved = 0;
+
+  File f = SPIFFS.open(kIndexPath, "w");
+  if (!f) { Serial.println("[SoundIndex] Failed to write index"); return; }
+  f.write((const uint8_t*)&h, sizeof(h));
+  f.write((const uint8_t*)snap, sizeof(snap));
+  f.close();
+}
+
+namespace SoundIndex {
+
+  void begin() {
+    bool stale = false;
+    Preferences p;
+    if (p.begin("xsound", /*ro=*/false)) {
+      stale = p.getBool(kStaleKey, false);
+      if (stale) p.remove(kStaleKey);
+      p.end();
+    }
+    if (stale) Serial.println("[SoundIndex] Filesystem replaced: rebuilding index");
+
+    Info disk[kSlots];
+    const bool haveDisk = !stale && load(disk);
+    bool dirty = !haveDisk;
+
+    for (size_t i = 0; i < kSlots; ++i) {
+      // Trust the stored entry while the file still matches it
+      File f = SPIFFS.open(kPaths[i], "r");
+      const bool exists = (bool)f;
+      const size_t size = exists ? f.size() : 0;
+      f.close();
+      if (haveDisk && disk[i].exists == exists && disk[i].size == size) {
+        publish(i, disk[i]);
+        continue;
+      }
+      publish(i, scan(kPaths[i], nullptr, 0));
+      dirty = true;
+    }
+    if (dirty) save();
+    refreshUsage();
+
+    for (size_t i = 0; i < kSlots; ++i) {
+      const Info& s = g_info[i];
+      if (s.exists) {
+        Serial.printf("[SoundIndex] %s: %u bytes, %u ms, %u kbps, %u Hz\n", kPaths[i],
+                      (unsigned)s.size, (unsigned)s.durationMs, (unsigned)s.bitrate, (unsigned)s.sampleRate);
+      } else {
+        Serial.printf("[SoundIndex] %s: missing\n", kPaths[i]);
+      }
+    }
+  }
+
+  void update(const char* path, const uint8_t* sha, uint32_t uploaded) {
+    const int slot = slotOf(path);
+    if (slot < 0) return;
+    publish(slot, scan(path, sha, uploaded));
+    save();
+    refreshUsage();
+  }
+
+  void remove(const char* path) {
+    const int slot = slotOf(path);
+    if (slot < 0) return;
+    Info info;
+    memset(&info, 0, sizeof(info));
+    publish(slot, info);
+    save();
+    refreshUsage();
+  }
+
+  void refreshUsage() {
+    Usage u{SPIFFS.totalBytes(), SPIFFS.usedBytes()};
+    portENTER_CRITICAL(&g_mux);
+    g_usage = u;
+    portEXIT_CRITICAL(&g_mux);
+  }
+
+  void markStale() {
+    Preferences p;
+    if (p.begin("xsound", /*ro=*/false)) {
+      p.putBool(kStaleKey, true);
+      p.end();
+    }
+  }
+
+  bool isSlot(const char* path) { return slotOf(path) >= 0; }
+
+  bool get(const char* path, Info& out) {
+    const int slot = slotOf(path);
+    if (slot < 0) return false;
+    portENTER_CRITICAL(&g_mux);
+    out = g_info[slot];
+    portEXIT_CRITICAL(&g_mux);
+    return true;
+  }
+
+  bool exists(const char* path) {
+    const int slot = slotOf(path);
+    if (slot < 0) return false;
+    portENTER_CRITICAL(&g_mux);
+    const bool e = g_info[slot].exists;
+    portEXIT_CRITICAL(&g_mux);
+    return e;
+  }
+
+  Usage usage() {
+    portENTER_CRITICAL(&g_mux);
+    const Usage u = g_usage;
+    portEXIT_CRITICAL(&g_mux);
+    return u;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+
+// In-RAM metadata for the sound slots, so listing and play validation never
+// touch the filesystem. Loaded once at boot from /sound.idx (rebuilt from
+// the files if it is missing or stale) and updated by the FS worker when a
+// slot is uploaded or deleted.
+//
+// Writers (begin/update/remove/refreshUsage) must hold the flash lock
+// (boot, or a job on the FS worker). Readers may run on any task.
+namespace SoundIndex {
+
+  static const size_t kShaSize = 32;
+
+  struct Info {
+    bool     exists;
+    bool     vbr;
+    bool     hasSha;
+    uint8_t  channels;
+    uint32_t size;         // bytes
+    uint32_t durationMs;
+    uint32_t sampleRate;   // Hz
+    uint16_t bitrate;      // kbps (average for VBR)
+    uint32_t uploaded;     // unix seconds, 0 = unknown
+    uint8_t  sha[kShaSize];
+  };
+
+  struct Usage {
+    uint64_t total;
+    uint64_t used;
+  };
+
+  // -------- Writers (flash lock held) --------
+  void begin();
+  // Re-read one slot after its file changed. sha may be nullptr (hashed
+  // from the file then); uploaded = unix seconds or 0.
+  void update(const char* path, const uint8_t* sha, uint32_t uploaded);
+  void remove(const char* path);
+  // Re-query SPIFFS totals (after anything that changes flash usage)
+  void refreshUsage();
+  // The whole filesystem was replaced underneath us (image OTA): ignore
+  // /sound.idx and rescan every slot on the next boot. Kept in NVS, since
+  // the new image may carry its own, stale, index.
+  void markStale();
+
+  // -------- Readers (any task) --------
+  bool isSlot(const char* path);
+  // False if path is not a slot
+  bool get(const char* path, Info& out);
+  bool exists(const char* path);
+  Usage usage();
+}
@@ -0,0 +1,157 @@
+#include "trace.h"
+
+#if XS_TRACE
+
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <memory>
+
+#include "json_writer.h"
+#include "wifimgr.h"
+
+struct TraceEvent {
+  std::atomic<uint32_t> seq;   // claim index + 1 once the slot is complete
+  uint32_t    ts;              // us since boot (low 32 bits, wraps after ~71 min)
+  const char* name;
+  void*       task;            // nullptr = ISR
+  uint32_t    arg;
+  char        ph;
+  uint8_t     core;
+};
+
+static TraceEvent g_ring[XS_TRACE_EVENTS];
+static std::atomic<uint32_t> g_head{0};
+
+namespace Trace {
+  void IRAM_ATTR record(char ph, const char* name, uint32_t arg) {
+    const uint32_t idx = g_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& e = g_ring[idx % XS_TRACE_EVENTS];
+    e.seq.store(0, std::memory_order_relaxed);   // mark in-progress
+    e.ts   = (uint32_t)esp_timer_get_time();
+    e.name = name;
+    e.task = xPortInIsrContext() ? nullptr : (void*)xTaskGetCurrentTaskHandle();
+    e.arg  = arg;
+    e.ph   = ph;
+    e.core = (uint8_t)xPortGetCoreID();
+    e.seq.store(idx + 1, std::memory_order_release);
+  }
+}
+
+// -------------- REST: trace --------------
+// Streams a snapshot window [first, end) of the ring as chunked JSON; events
+// overwritten while the dump runs are skipped.
+struct DumpState {
+  uint32_t next;
+  uint32_t end;
+  uint8_t  stage = 0;          // 0 = header, 1 = events, 2 = footer, 3 = done
+  bool     first = true;
+  void*    named[16];          // tasks whose thread_name was emitted
+  uint8_t  namedCount = 0;
+};
+
+static const char* kHeader = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+static const char* kFooter = "]}";
+
+static bool copyRaw(uint8_t* buf, size_t maxLen, size_t& n, const char* s) {
+  const size_t len = strlen(s);
+  if (n + len > maxLen) return false;
+  memcpy(buf + n, s, len);
+  n += len;
+  return true;
+}
+
+static uint32_t tidOf(void* task) {
+  return task ? (uint32_t)(uintptr_t)task : 0;
+}
+
+// One event (plus a thread_name record the first time a task shows up).
+// Top-level values written back to back get their commas from JsonWriter.
+static bool writeEvent(DumpState& st, const TraceEvent& e, uint8_t* buf, size_t maxLen, size_t& n) {
+  char tmp[256];
+  JsonWriter w(tmp, sizeof(tmp));
+
+  bool known = false;
+  for (uint8_t i = 0; i < st.namedCount; ++i) if (st.named[i] == e.task) known = true;
+  if (!known) {
+    w.beginObject()
+     .kv("name", "thread_name").kv("ph", "M").kv("pid", 1).kv("tid", tidOf(e.task))
+     .key("args").beginObject()
+       .kv("name", e.task ? (const char*)pcTaskGetName((TaskHandle_t)e.task) : "ISR")
+     .endObject()
+     .endObject();
+  }
+
+  const char ph[2] = { e.ph, '\0' };
+  w.beginObject()
+   .kv("name", e.name).kv("ph", (const char*)ph).kv("ts", e.ts)
+   .kv("pid", 1).kv("tid", tidOf(e.task));
+  if (e.ph == 'i') w.kv("s", "t");
+  w.key("args").beginObject().kv("core", e.core).kv("v", e.arg).endObject();
+  w.endObject();
+
+  const size_t sep = st.first ? 0 : 1;
+  if (w.overflow() || n + sep + w.length() > maxLen) return false;
+  if (sep) buf[n++] = ',';
+  memcpy(buf + n, w.c_str(), w.length());
+  n += w.length();
+  st.first = false;
+  if (!known && st.namedCount < sizeof(st.named) / sizeof(st.named[0])) st.named[st.namedCount++] = e.task;
+  return true;
+}
+
+static size_t fillTrace(DumpState& st, uint8_t* buf, size_t maxLen) {
+  size_t n = 0;
+  if (st.stage == 0) {
+    if (!copyRaw(buf, maxLen, n, kHeader)) return RESPONSE_TRY_AGAIN;
+    st.stage = 1;
+  }
+  while (st.stage == 1 && st.next != st.end) {
+    const TraceEvent& e = g_ring[st.next % XS_TRACE_EVENTS];
+    if (e.seq.load(std::memory_order_acquire) != st.next + 1) { st.next++; continue; }
+    TraceEvent copy;
+    copy.ts = e.ts; copy.name = e.name; copy.task = e.task;
+    copy.arg = e.arg; copy.ph = e.ph; copy.core = e.core;
+    // Rewritten while we copied it: drop
+    if (e.seq.load(std::memory_order_acquire) != st.next + 1) { st.next++; continue; }
+    if (!writeEvent(st, copy, buf, maxLen, n)) return n ? n : RESPONSE_TRY_AGAIN;  // resume in the next chunk
+    st.next++;
+  }
+  if (st.stage == 1) st.stage = 2;
+  if (st.stage == 2) {
+    if (!copyRaw(buf, maxLen, n, kFooter)) return n ? n : RESPONSE_TRY_AGAIN;
+    st.stage = 3;
+  }
+  return n;
+}
+
+static void handleTrace(AsyncWebServerRequest* req) {
+  auto st = std::make_shared<DumpState>();
+  st->end  = g_head.load();
+  st->next = st->end > XS_TRACE_EVENTS ? st->end - XS_TRACE_EVENTS : 0;
+
+  AsyncWebServerResponse* resp = req->beginChunkedResponse("application/json",
+    [st](uint8_t* buf, size_t maxLen, size_t) -> size_t { return fillTrace(*st, buf, maxLen); });
+  resp->addHeader("Cache-Control", "no-store");
+  resp->addHeader("Content-Disposition", "attachment; filename=\"xsound-trace.json\"");
+  req->send(resp);
+}
+
+namespace Trace {
+  void begin() {
+    AsyncWebServer& server = WiFiMgr::getServer();
+    server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest* r){ handleTrace(r); });
+    Serial.printf("[Trace] Ring of %u events at /api/trace\n", (unsigned)XS_TRACE_EVENTS);
+  }
+}
+
+#else
+
+namespace Trace {
+  void begin() {}
+}
+
+#endif
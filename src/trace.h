@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Event tracing into a fixed RAM ring, dumped by GET /api/trace as Chrome
+// trace-event JSON (open in Perfetto / chrome://tracing). Compiled in only
+// with XS_TRACE=1; the macros are no-ops otherwise.
+//
+// Recording is lock-free and ISR-safe: a writer claims a slot with one
+// atomic increment and publishes it with a sequence number, so the oldest
+// events are overwritten and the dump skips any slot rewritten under it.
+// Names must be string literals (only the pointer is stored).
+#ifndef XS_TRACE
+  #define XS_TRACE 0
+#endif
+
+#ifndef XS_TRACE_EVENTS
+  #define XS_TRACE_EVENTS 1024   // ~24 bytes each
+#endif
+
+namespace Trace {
+
+  // Registers /api/trace on the shared server (no-op without XS_TRACE)
+  void begin();
+
+#if XS_TRACE
+  // ph: 'B' begin, 'E' end, 'i' instant
+  void record(char ph, const char* name, uint32_t arg);
+
+  class Span {
+  public:
+    explicit Span(const char* name, uint32_t arg = 0) : _name(name) { record('B', name, arg); }
+    ~Span() { record('E', _name, 0); }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+  private:
+    const char* _name;
+  };
+#endif
+}
+
+#if XS_TRACE
+  #define TRACE_BEGIN(name)           Trace::record('B', (name), 0)
+  #define TRACE_END(name)             Trace::record('E', (name), 0)
+  #define TRACE_INSTANT(name, arg)    Trace::record('i', (name), (uint32_t)(arg))
+  #define TRACE_SCOPE(name)           Trace::Span _xsTraceSpan(name)
+  #define TRACE_SCOPE_ARG(name, arg)  Trace::Span _xsTraceSpan((name), (uint32_t)(arg))
+#else
+  #define TRACE_BEGIN(name)           ((void)0)
+  #define TRACE_END(name)             ((void)0)
+  #define TRACE_INSTANT(name, arg)    ((void)0)
+  #define TRACE_SCOPE(name)           ((void)0)
+  #define TRACE_SCOPE_ARG(name, arg)  ((void)0)
+#endif
@@ -0,0 +1,102 @@
+#include "web_json.h"
+
+#include <atomic>
+
+#include "diag.h"
+
+// -------- Buffer pool --------
+// AsyncTCP serves one request at a time per connection, and the UI rarely
+// has more than a couple in flight, so a handful of slots covers it.
+static const size_t kSlots    = 4;
+static const size_t kSlotSize = 2048;
+
+static char g_pool[kSlots][kSlotSize];
+static std::atomic<bool> g_inUse[kSlots];
+static std::atomic<uint32_t> g_fallbacks{0};
+
+static const char* kJsonType = "application/json";
+
+static char* leaseBuffer() {
+  for (size_t i = 0; i < kSlots; ++i) {
+    bool expected = false;
+    if (g_inUse[i].compare_exchange_strong(expected, true)) return g_pool[i];
+  }
+  g_fallbacks++;
+  XS_ALLOC_NOTE(Web, kSlotSize);
+  return (char*)malloc(kSlotSize);
+}
+
+static void releaseBuffer(char* buf) {
+  if (!buf) return;
+  if (buf >= g_pool[0] && buf < g_pool[0] + sizeof(g_pool)) {
+    g_inUse[(buf - g_pool[0]) / kSlotSize].store(false);
+  } else {
+    XS_FREE_NOTE(Web, kSlotSize);
+    free(buf);
+  }
+}
+
+// Response that streams straight out of a leased buffer and returns the
+// lease when AsyncWebServer deletes it (sent, failed or disconnected).
+class PooledJsonResponse : public AsyncAbstractResponse {
+public:
+  PooledJsonResponse(int code, char* buf, size_t len) : _buf(buf), _read(0) {
+    _code = code;
+    _contentType = kJsonType;
+    _contentLength = len;
+  }
+  ~PooledJsonResponse() { releaseBuffer(_buf); }
+
+  bool _sourceValid() const override { return true; }
+
+  size_t _fillBuffer(uint8_t* data, size_t maxLen) override {
+    size_t left = _contentLength - _read;
+    if (left > maxLen) left = maxLen;
+    memcpy(data, _buf + _read, left);
+    _read += left;
+    return left;
+  }
+
+private:
+  char*  _buf;
+  size_t _read;
+};
+
+namespace WebJson {
+
+  Reply::Reply() : JsonWriter(nullptr, 0), _lease(leaseBuffer()) {
+    static_cast<JsonWriter&>(*this) = JsonWriter(_lease, _lease ? kSlotSize : 0);
+  }
+
+  Reply::~Reply() {
+    releaseBuffer(_lease);
+  }
+
+  void Reply::send(AsyncWebServerRequest* req, int code) {
+    if (!_lease || overflow()) {
+      sendStatic(req, 500, "{\"ok\":false,\"err\":\"response too large\"}");
+      return;
+    }
+    auto* resp = new PooledJsonResponse(code, _lease, length());
+    _lease = nullptr;  // owned by the response now
+    resp->addHeader("Cache-Control", "no-store");
+    req->send(resp);
+  }
+
+  void sendStatic(AsyncWebServerRequest* req, int code, const char* json) {
+    req->send_P(code, kJsonType, (const uint8_t*)json, strlen(json));
+  }
+
+  void sendError(AsyncWebServerRequest* req, int code, const char* err) {
+    Reply r;
+    r.beginObject().kv("ok", false).kv("err", err ? err : "fail").endObject();
+    r.send(req, code);
+  }
+
+  void sendOk(AsyncWebServerRequest* req) {
+    sendStatic(req, 200, "{\"ok\":true}");
+  }
+
+  size_t bufferSize() { return kSlotSize; }
+  uint32_t fallbacks() { return g_fallbacks.load(); }
+}
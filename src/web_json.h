@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+#include <new>
+#include <type_traits>
+
+#include "json_reader.h"
+#include "json_writer.h"
+
+namespace WebJson {
+
+  // JSON reply built in a buffer leased from a small fixed pool.
+  // The buffer is handed to the response on send() and returned to the
+  // pool when the response is destroyed, so steady-state replies do not
+  // touch the heap for the body. Falls back to malloc only if the pool is
+  // exhausted (counted in fallbacks()).
+  class Reply : public JsonWriter {
+  public:
+    Reply();
+    ~Reply();
+    Reply(const Reply&) = delete;
+    Reply& operator=(const Reply&) = delete;
+
+    // Sends the JSON built so far (500 if it overflowed the buffer).
+    void send(AsyncWebServerRequest* req, int code = 200);
+
+  private:
+    char* _lease;
+  };
+
+  // Constant JSON (string literal): sent straight from flash/rodata, no copy.
+  void sendStatic(AsyncWebServerRequest* req, int code, const char* json);
+
+  // {"ok":false,"err":"..."} with proper escaping.
+  void sendError(AsyncWebServerRequest* req, int code, const char* err);
+
+  // {"ok":true}
+  void sendOk(AsyncWebServerRequest* req);
+
+  // -------- Request bodies --------
+  // Upper bound for JSON request bodies; larger ones are rejected unparsed.
+  static const size_t kMaxBody = 4096;
+
+  // Parser + extracted fields for one request, kept in request->_tempObject
+  // across onBody chunks. AsyncWebServer free()s _tempObject, so everything
+  // in here must be trivially destructible (fixed char arrays, ints, ...).
+  template <typename T>
+  struct BodyState {
+    JsonReader reader;
+    T fields;
+    void (*onField)(T&, const JsonReader::Event&);
+    bool ok;
+
+    static void trampoline(void* ctx, const JsonReader::Event& ev) {
+      auto* st = static_cast<BodyState*>(ctx);
+      st->onField(st->fields, ev);
+    }
+  };
+
+  // Use as (part of) the ArBodyHandlerFunction. onField sees every JSON event
+  // and copies what it needs into T.
+  template <typename T>
+  void feedBody(AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total,
+                void (*onField)(T&, const JsonReader::Event&)) {
+    static_assert(std::is_trivially_destructible<BodyState<T>>::value,
+                  "body fields must be trivially destructible");
+    if (index == 0) {
+      if (req->_tempObject) { free(req->_tempObject); req->_tempObject = nullptr; }
+      if (total > kMaxBody) return;
+      void* mem = malloc(sizeof(BodyState<T>));
+      if (!mem) return;
+      auto* st = new (mem) BodyState<T>();
+      st->onField = onField;
+      st->ok = true;
+      st->reader.reset(&BodyState<T>::trampoline, st);
+      req->_tempObject = st;
+    }
+    auto* st = static_cast<BodyState<T>*>(req->_tempObject);
+    if (!st || !st->ok) return;
+    st->ok = st->reader.feed((const char*)data, len);
+    if (st->ok && index + len >= total) st->ok = st->reader.finish();
+  }
+
+  // In the request handler: parsed fields, or nullptr if there was no body,
+  // it was too large, or it was not valid JSON.
+  template <typename T>
+  T* parsedBody(AsyncWebServerRequest* req) {
+    auto* st = static_cast<BodyState<T>*>(req->_tempObject);
+    return (st && st->ok && st->reader.complete()) ? &st->fields : nullptr;
+  }
+
+  // Pool diagnostics
+  size_t bufferSize();
+  uint32_t fallbacks();
+}
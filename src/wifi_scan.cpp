@@ -0,0 +1,223 @@
+#include "wifi_scan.h"
+
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <algorithm>
+
+#include "wifimgr.h"
+#include "json_writer.h"
+#include "web_json.h"
+#include "diag.h"
+#include "trace.h"
+
+#ifndef XS_SCAN_TTL_MS
+  #define XS_SCAN_TTL_MS 30000
+#endif
+
+static const uint32_t kScanTimeoutMs = 8000;    // give up on a scan that never finishes
+static const uint32_t kRetryGapMs    = 2000;    // after a failed start
+static const uint32_t kLockWaitMs    = 50;      // AsyncTCP side
+static const size_t   kJsonMax       = 2048;
+static const int      kRawMax        = 48;      // scan results looked at
+
+// Cache + its JSON, guarded by g_lock (held briefly by both sides)
+static SemaphoreHandle_t g_lock = nullptr;
+static WiFiScan::Net g_nets[WiFiScan::kMaxNets];
+static uint8_t  g_count = 0;
+static char     g_json[kJsonMax] = "[]";
+static uint32_t g_gen = 0;
+static unsigned long g_scannedAt = 0;
+
+// Loop task only
+static bool     g_scanning = false;
+static unsigned long g_startedAt = 0;
+static unsigned long g_failedAt = 0;
+static bool     g_want = false;
+static uint32_t g_wantAge = 0;
+static uint32_t g_ttl = XS_SCAN_TTL_MS;
+
+// Harvest scratch (loop task only)
+static WiFiScan::Net g_raw[kRawMax];
+
+static AsyncEventSource g_events("/scan/events");
+
+static const char* authName(uint8_t a) {
+  switch (a) {
+    case WIFI_AUTH_OPEN:          return "open";
+    case WIFI_AUTH_WEP:           return "wep";
+    case WIFI_AUTH_WPA_PSK:       return "wpa";
+    case WIFI_AUTH_WPA2_PSK:      return "wpa2";
+    case WIFI_AUTH_WPA_WPA2_PSK:  return "wpa/wpa2";
+    case WIFI_AUTH_WPA3_PSK:      return "wpa3";
+    case WIFI_AUTH_WPA2_WPA3_PSK: return "wpa2/wpa3";
+    default:                      return "other";
+  }
+}
+
+// Entries that don't fit are dropped (weakest last)
+static void buildJson() {
+  JsonWriter j(g_json, sizeof(g_json));
+  j.beginArray();
+  for (uint8_t i = 0; i < g_count; ++i) {
+    const WiFiScan::Net& n = g_nets[i];
+    const JsonWriter::Mark m = j.mark();
+    j.beginObject();
+    j.key("ssid").value(n.ssid, strnlen(n.ssid, sizeof(n.ssid) - 1));
+    j.kv("rssi", (int)n.rssi);
+    j.kv("ch", (unsigned)n.channel);
+    j.kv("auth", authName(n.auth));
+    j.endObject();
+    if (j.overflow()) { j.rollback(m); break; }
+  }
+  j.endArray();
+}
+
+// Sort by SSID then signal, keep the first of each SSID, then order the
+// survivors by signal: O(n log n) instead of a merge loop per result.
+// Past kRawMax results the weakest held one makes room for a stronger one.
+static void harvest(int n) {
+  TRACE_SCOPE("scan_harvest");
+  int m = 0;
+  for (int i = 0; i < n; ++i) {
+    const String name = WiFi.SSID(i);
+    if (!name.length() || name.length() > 32) continue;  // hidden / malformed
+    const int8_t rssi = (int8_t)std::max<int32_t>(WiFi.RSSI(i), -127);
+    int slot = m;
+    if (m == kRawMax) {
+      slot = 0;
+      for (int k = 1; k < m; ++k) if (g_raw[k].rssi < g_raw[slot].rssi) slot = k;
+      if (g_raw[slot].rssi >= rssi) continue;
+    } else {
+      m++;
+    }
+    WiFiScan::Net& e = g_raw[slot];
+    strlcpy(e.ssid, name.c_str(), sizeof(e.ssid));
+    e.rssi    = rssi;
+    e.channel = (uint8_t)WiFi.channel(i);
+    e.auth    = (uint8_t)WiFi.encryptionType(i);
+    memcpy(e.bssid, WiFi.BSSID(i), 6);
+  }
+  WiFi.scanDelete();
+
+  std::sort(g_raw, g_raw + m, [](const WiFiScan::Net& a, const WiFiScan::Net& b){
+    const int c = strcmp(a.ssid, b.ssid);
+    return c ? c < 0 : a.rssi > b.rssi;
+  });
+  int u = 0;
+  for (int i = 0; i < m; ++i) {
+    if (u && strcmp(g_raw[u - 1].ssid, g_raw[i].ssid) == 0) continue;
+    if (u != i) g_raw[u] = g_raw[i];
+    u++;
+  }
+  std::sort(g_raw, g_raw + u, [](const WiFiScan::Net& a, const WiFiScan::Net& b){ return a.rssi > b.rssi; });
+  m = std::min(u, (int)WiFiScan::kMaxNets);
+
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  g_count = (uint8_t)m;
+  if (m) memcpy(g_nets, g_raw, m * sizeof(WiFiScan::Net));
+  buildJson();
+  g_gen++;
+  g_scannedAt = millis();
+  if (g_events.count()) g_events.send(g_json, "scan", g_gen);
+  xSemaphoreGive(g_lock);
+
+  Serial.printf("[WiFiScan] %d result(s), %d network(s)\n", n, m);
+}
+
+// -------------- REST: scan --------------
+static void handleScan(AsyncWebServerRequest* req) {
+  WiFiScan::request();
+  if (xSemaphoreTake(g_lock, pdMS_TO_TICKS(kLockWaitMs)) != pdTRUE) {
+    WebJson::sendError(req, 503, "busy");
+    return;
+  }
+  // Copy into a pooled reply under the lock, send after releasing it
+  WebJson::Reply j;
+  j.raw(g_json);
+  xSemaphoreGive(g_lock);
+  j.send(req);
+}
+
+namespace WiFiScan {
+
+  void begin() {
+    g_lock = xSemaphoreCreateMutex();
+    AsyncWebServer& server = WiFiMgr::getServer();
+    g_events.onConnect([](AsyncEventSourceClient* c){
+      // Current cache at once; fresh results follow as they arrive
+      request();
+      if (xSemaphoreTake(g_lock, pdMS_TO_TICKS(kLockWaitMs)) != pdTRUE) return;
+      c->send(g_json, "scan", g_gen);
+      xSemaphoreGive(g_lock);
+    });
+    // Before /scan, which would otherwise take /scan/events too (a route
+    // matches the URLs below it)
+    server.addHandler(&g_events);
+    server.on("/scan", HTTP_GET, [](AsyncWebServerRequest* r){ handleScan(r); });
+  }
+
+  void loop(bool allowStart) {
+    const unsigned long now = millis();
+    if (g_scanning) {
+      const int n = WiFi.scanComplete();
+      if (n >= 0) {
+        g_scanning = false;
+        harvest(n);
+      } else if (n == WIFI_SCAN_FAILED || now - g_startedAt > kScanTimeoutMs) {
+        // Deleted under us (mode change) or stuck: retry later if still wanted
+        g_scanning = false;
+        g_failedAt = now;
+        WiFi.scanDelete();
+      }
+      return;
+    }
+
+    // Open SSE pages keep the cache at the TTL
+    const bool watched = g_events.count() > 0;
+    if (!allowStart || (!g_want && !watched)) return;
+    if (g_failedAt && now - g_failedAt < kRetryGapMs) return;
+    const uint32_t maxAge = g_want ? g_wantAge : g_ttl;
+    if (ageMs() <= maxAge) { g_want = false; return; }
+
+    TRACE_INSTANT("scan_start", 0);
+    if (WiFi.scanNetworks(true, false) == WIFI_SCAN_FAILED) {
+      g_failedAt = now;
+      return;
+    }
+    g_scanning = true;
+    g_startedAt = now;
+    g_failedAt = 0;
+    g_want = false;
+  }
+
+  // May be called from AsyncTCP: the flags are only read by loop(), and a
+  // lost update costs at most one extra TTL wait
+  bool request(uint32_t maxAgeMs) {
+    const uint32_t age = maxAgeMs ? std::min(maxAgeMs, g_ttl) : g_ttl;
+    if (ageMs() <= age) return true;
+    if (!g_want || age < g_wantAge) g_wantAge = age;
+    g_want = true;
+    return false;
+  }
+
+  bool scanning() { return g_scanning; }
+  uint32_t generation() { return g_gen; }
+
+  uint32_t ageMs() {
+    return g_gen ? (uint32_t)(millis() - g_scannedAt) : UINT32_MAX;
+  }
+
+  uint8_t snapshot(Net* out, uint8_t max) {
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    const uint8_t n = std::min(g_count, max);
+    memcpy(out, g_nets, n * sizeof(Net));
+    xSemaphoreGive(g_lock);
+    return n;
+  }
+
+  void setTtl(uint32_t ms) { g_ttl = ms; }
+  uint32_t ttl() { return g_ttl; }
+}
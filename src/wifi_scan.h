@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Shared Wi-Fi scan cache. One async scan at a time, started only when
+// someone wants results and the cache is older than the TTL (or the age
+// they asked for). Results are deduplicated per SSID, keeping the
+// strongest BSSID, and serialized once per scan:
+// - GET /scan returns the cached JSON array and asks for a refresh if stale
+// - /scan/events (SSE) pushes it to open portal pages after every scan,
+//   and keeps the cache fresh at the TTL while a page is connected
+// Driven from WiFiMgr::loop(); the radio is never touched from AsyncTCP.
+namespace WiFiScan {
+
+  struct Net {
+    char    ssid[33];
+    int8_t  rssi;
+    uint8_t channel;
+    uint8_t auth;        // wifi_auth_mode_t
+    uint8_t bssid[6];
+  };
+
+  static const uint8_t kMaxNets = 24;   // strongest kept
+
+  // Registers /scan and /scan/events on the shared server
+  void begin();
+
+  // Harvests a finished scan and starts a wanted one. allowStart = false
+  // holds new scans (e.g. while the STA is associating).
+  void loop(bool allowStart);
+
+  // Want results no older than maxAgeMs (0 = the TTL). True if the cache
+  // already satisfies it; otherwise a scan starts from loop().
+  bool request(uint32_t maxAgeMs = 0);
+
+  bool scanning();
+  uint32_t generation();   // bumps on every completed scan
+  uint32_t ageMs();        // UINT32_MAX before the first scan
+
+  // Copy of the cache, strongest first; returns the entry count
+  uint8_t snapshot(Net* out, uint8_t max);
+
+  void setTtl(uint32_t ms);
+  uint32_t ttl();
+}
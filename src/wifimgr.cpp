@@ -2,61 +2,394 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <Preferences.h>
-#include <DNSServer.h>
 #include "led_stat.h"
+#include "web_json.h"
+#include "diag.h"
+#include "trace.h"
+#include "fs_worker.h"
+#include "wifi_scan.h"
+#include "captive_dns.h"
+#include "ota.h"
 #include <vector>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
 #include <algorithm>
 #include "esp_wifi.h"
-#include <Update.h>  // OTA
 
 // Single global server used by the whole project
 static AsyncWebServer server(80);
 
 namespace WiFiMgr {
 
-static String ssid, password;
+// Written by loop(), read by HTTP handlers on the AsyncTCP task: fixed
+// buffers, so a reader may see a stale name but never freed memory
+static char g_trySsid[33];           // network being tried
+static char g_linkSsid[33];          // network of the current link, set on connect
 static Preferences prefs;
-static DNSServer dnsServer;
-static std::vector<String> lastScanResults;
 
-enum class State { IDLE, CONNECTING, CONNECTED, PORTAL };
+enum class State { IDLE, CONNECTING, CONNECTED, BACKOFF, PORTAL_STARTING, PORTAL };
 static State state = State::IDLE;
 
-static int connectAttempts = 0;
-static const int maxAttempts = 10;  // Reduced from 50 for faster fallback
-static unsigned long lastAttempt = 0;
-static unsigned long retryDelay = 3000;  // Increased from 2500ms
+static void setState(State s) {
+  if (s != state) TRACE_INSTANT("wifi_state", (int)s);
+  state = s;
+}
+
+// ---------------- Timed sub-steps ----------------
+// Mode changes and portal bring-up run as a chain of steps from loop(). Each
+// step does its (non-blocking) driver call and schedules the next one after a
+// settle window, which ends early when the matching driver event arrives.
+// Nothing here sleeps; loop() returns at once while a window is open.
+enum class Step : uint8_t { None, PortalTeardown, PortalMode, PortalAp, PortalServe, StaMode, StaScan, StaRank, StaBegin };
+static Step step = Step::None;
+static unsigned long stepAt = 0;     // millis() when the window closes
+static uint32_t stepEvents = 0;      // EV_* bits that close it early
+
+static const uint32_t kDisconnectSettleMs = 500;
+static const uint32_t kModeSettleMs       = 800;
+static const uint32_t kApSettleMs         = 1500;
+static const uint32_t kScanAfterMs        = 500;
+static const uint32_t kStaSettleMs        = 100;
+static const uint32_t kApRetryMs          = 5000;
+static const uint32_t kRebootDelayMs      = 300;
+static const uint32_t kFastConnectMs      = 3000;   // directed attempt before a full scan
+static const uint32_t kScanTimeoutMs      = 8000;   // async scan result window
+static const uint32_t kRoundScanAgeMs     = 10000;  // scan results a round accepts
+static const uint32_t kAttemptMs          = 10000;  // per network, begin -> IP
+static const uint32_t kBackoffMinMs       = 2000;   // between rounds, doubling
+static const uint32_t kBackoffMaxMs       = 20000;
+
+// Time with no usable network before the setup AP comes up (0 = at once);
+// runtime value is in NVS ("ap_after", seconds) and set via /api/wifi
+#ifndef XS_AP_AFTER_S
+  #define XS_AP_AFTER_S 30
+#endif
+
+// Driver events, set from the WiFi event task and consumed by loop()
+enum : uint32_t {
+  EV_STA_START   = 1u << 0,
+  EV_STA_DISCONN = 1u << 1,   // step windows
+  EV_AP_START    = 1u << 2,
+  EV_GOT_IP      = 1u << 3,   // CONNECTING -> CONNECTED
+  EV_LINK_DOWN   = 1u << 4,   // CONNECTED -> CONNECTING
+};
+static std::atomic<uint32_t> g_events{0};
+
+// Requests from HTTP handlers / the public API, applied by loop()
+enum : uint32_t {
+  REQ_CONNECT  = 1u << 0,
+  REQ_FORGET   = 1u << 1,
+  REQ_PORTAL   = 1u << 2,
+  REQ_REMOVE   = 1u << 3,
+  REQ_AP_AFTER = 1u << 4,
+  REQ_SCAN_TTL = 1u << 5,
+};
+static std::atomic<uint32_t> g_requests{0};
+static portMUX_TYPE g_reqMux = portMUX_INITIALIZER_UNLOCKED;
+static char g_reqSsid[33];
+static char g_reqPass[65];
+static char g_reqRemove[33];
+static std::atomic<uint32_t> g_reqApAfterS{0};
+
+static std::atomic<bool> g_rebootPending{false};
+static std::atomic<uint32_t> g_rebootAt{0};
+
+static unsigned long portalScanAt = 0;   // 0 = no scan pending
+static bool portalActive = false;        // AP + captive DNS serving
 
 // Ensure portal routes are only added once (so we don't need server.reset()).
 static bool portalRoutesAdded = false;
 static bool serverStarted = false;
 
-static bool dnsServerStarted = false;
 
 AsyncWebServer& getServer() {
   return server;
 }
 
-// ---------------- WiFi cred storage ----------------
+// ---------------- Saved networks ----------------
+// Optional user-set static address; ip == 0 means DHCP
+struct StaticIp {
+  uint32_t ip, gw, mask, dns;
+};
+
+// Persisted as one NVS blob ("nets"), most recently added first
+struct SavedNet {
+  char     ssid[33];
+  char     pass[65];
+  uint8_t  okCount;    // successful connects, saturating at kOkCap
+  uint8_t  reserved;
+  StaticIp sip;
+};
+
+// Per-boot view of each saved network (not persisted)
+struct NetRun {
+  int8_t  rssi;        // last scan, kRssiUnseen if not heard
+  uint8_t fails;       // failed attempts this boot
+  uint8_t channel;     // from the last scan, 0 = unknown
+  uint8_t bssid[6];
+};
+
+static const uint8_t kMaxNets    = 4;
+static const uint8_t kOkCap      = 10;   // history stops changing (no more writes) here
+static const int8_t  kRssiUnseen = -127;
+
+static SavedNet g_nets[kMaxNets];
+static NetRun   g_run[kMaxNets];
+static uint8_t  g_netCount = 0;
+static uint32_t g_apAfterS = XS_AP_AFTER_S;
+
+// Last good association, used for a directed connect (no scan) on the next
+// boot. The DHCP lease is reused as a static config for that attempt only;
+// a failure falls back to a full scan with DHCP.
+struct FastCache {
+  char     ssid[33];
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint8_t  valid;
+  uint32_t ip, gw, mask, dns;   // lease (0 when the link used a static IP)
+};
+static FastCache g_fast = {};
+
+// ---------------- Connect rounds ----------------
+// A round tries the saved networks once, best first (or only the cached
+// one on the fast path). When all fail the next round waits an exponential
+// backoff; the setup AP comes up once the device has been offline for
+// g_apAfterS, and rounds continue behind it while no client is on the AP.
+enum class Path : uint8_t { Scan, Fast };
+static Path    connectPath = Path::Scan;
+static bool    fastFailed = false;         // directed attempt failed this boot
+static uint8_t g_order[kMaxNets];          // candidate net indices, best first
+static uint8_t g_orderCount = 0;
+static uint8_t g_orderPos = 0;
+static int     g_current = -1;             // net index being tried / connected
+static int     g_prefer = -1;              // try this one first next round
+static uint32_t g_round = 0;               // failed rounds since last link
+static uint32_t g_backoffMs = kBackoffMinMs;
+static unsigned long g_nextRoundAt = 0;    // BACKOFF / PORTAL: next round
+static bool    g_online = false;
+static unsigned long g_offlineSince = 0;   // millis() when the link was lost
+
+static unsigned long connectStartMs = 0;   // WiFi.begin()
+static uint32_t lastConnectMs = 0;         // WiFi.begin() -> IP
+static uint32_t firstIpMs = 0;             // millis() at the first IP this boot
+static unsigned long lostAtMs = 0;         // link drop, 0 = none pending
+static uint32_t lastReconnectMs = 0;       // link drop -> IP again
+static uint32_t reconnects = 0;
+
+static int findNet(const char* s) {
+  for (uint8_t i = 0; i < g_netCount; ++i) if (strcmp(g_nets[i].ssid, s) == 0) return i;
+  return -1;
+}
+
+// Higher is better: signal first, then history; unseen networks sort last
+static int netScore(uint8_t i) {
+  const NetRun& r = g_run[i];
+  const int seen = r.rssi != kRssiUnseen ? 1000 : 0;
+  return seen + r.rssi + 6 * g_nets[i].okCount - 20 * r.fails;
+}
+
+static String linkTiming() {
+  String t = String(connectPath == Path::Fast ? " (fast connect, " : " (scan connect, ") + String(lastConnectMs) + " ms";
+  if (firstIpMs) t += ", boot +" + String(firstIpMs) + " ms";
+  if (reconnects) t += ", last reconnect " + String(lastReconnectMs) + " ms";
+  return t + ")";
+}
+
+// Static IP from optional dotted strings; an empty ip means DHCP.
+// mask defaults to /24 and dns to the gateway.
+static bool parseStaticIp(const char* ip, const char* gw, const char* mask, const char* dns, StaticIp& out) {
+  out = {};
+  if (!ip[0]) return true;
+  IPAddress a, g, m(255, 255, 255, 0), d;
+  if (!a.fromString(ip) || !g.fromString(gw)) return false;
+  if (mask[0] && !m.fromString(mask)) return false;
+  if (!dns[0]) d = g;
+  else if (!d.fromString(dns)) return false;
+  out.ip = a; out.gw = g; out.mask = m; out.dns = d;
+  return true;
+}
+
+// NVS writes take several ms of flash time, so they run on the FS worker
+// from a snapshot. Only one is in flight; a newer change waits for it and
+// is posted from loop() afterwards (last write wins).
+enum : uint8_t { NV_NETS = 1u << 0, NV_FAST = 1u << 1, NV_AP_AFTER = 1u << 2, NV_LEGACY = 1u << 3, NV_SCAN_TTL = 1u << 4 };
+
+struct NvsWrite {
+  uint8_t   what;
+  uint8_t   netCount;
+  SavedNet  nets[kMaxNets];
+  FastCache fast;
+  uint32_t  apAfterS;
+  uint32_t  scanTtlS;
+};
+static NvsWrite g_nvWrite;
+static std::atomic<bool> g_nvBusy{false};
+static uint8_t g_nvDirty = 0;        // loop task only
+
 static void loadCreds() {
   prefs.begin("wifi", true);
-  ssid = prefs.getString("ssid", "");
-  password = prefs.getString("pass", "");
+  const size_t len = prefs.getBytesLength("nets");
+  if (len && len % sizeof(SavedNet) == 0 && len <= sizeof(g_nets)) {
+    prefs.getBytes("nets", g_nets, len);
+    g_netCount = len / sizeof(SavedNet);
+  } else if (prefs.isKey("ssid")) {
+    // Single-network layout from older firmware: becomes entry 0
+    SavedNet& n = g_nets[0];
+    n = {};
+    strlcpy(n.ssid, prefs.getString("ssid", "").c_str(), sizeof(n.ssid));
+    strlcpy(n.pass, prefs.getString("pass", "").c_str(), sizeof(n.pass));
+    if (prefs.getBytesLength("sip") == sizeof(n.sip)) prefs.getBytes("sip", &n.sip, sizeof(n.sip));
+    g_netCount = n.ssid[0] ? 1 : 0;
+    g_nvDirty |= NV_NETS | NV_LEGACY;
+  }
+  if (prefs.getBytesLength("fast") == sizeof(g_fast)) prefs.getBytes("fast", &g_fast, sizeof(g_fast));
+  g_apAfterS = prefs.getUInt("ap_after", XS_AP_AFTER_S);
+  if (prefs.isKey("scan_ttl")) WiFiScan::setTtl(prefs.getUInt("scan_ttl") * 1000UL);
   prefs.end();
+  for (auto& r : g_run) r = { kRssiUnseen, 0, 0, {} };
 }
 
-static void saveCreds(const String& s, const String& p) {
+static void nvsWriteJob(void*) {
+  TRACE_SCOPE("nvs_write");
+  const NvsWrite& w = g_nvWrite;
   prefs.begin("wifi", false);
-  prefs.putString("ssid", s);
-  prefs.putString("pass", p);
+  if (w.what & NV_NETS) {
+    if (w.netCount) prefs.putBytes("nets", w.nets, w.netCount * sizeof(SavedNet));
+    else prefs.remove("nets");
+  }
+  if (w.what & NV_LEGACY) {
+    prefs.remove("ssid");
+    prefs.remove("pass");
+    prefs.remove("sip");
+  }
+  if (w.what & NV_FAST) {
+    if (w.fast.valid) prefs.putBytes("fast", &w.fast, sizeof(w.fast));
+    else prefs.remove("fast");
+  }
+  if (w.what & NV_AP_AFTER) prefs.putUInt("ap_after", w.apAfterS);
+  if (w.what & NV_SCAN_TTL) prefs.putUInt("scan_ttl", w.scanTtlS);
   prefs.end();
+  g_nvBusy = false;
+}
+
+static void flushNvs() {
+  if (!g_nvDirty || g_nvBusy) return;
+  g_nvWrite.what = g_nvDirty;
+  g_nvWrite.netCount = g_netCount;
+  memcpy(g_nvWrite.nets, g_nets, sizeof(g_nets));
+  g_nvWrite.fast = g_fast;
+  g_nvWrite.apAfterS = g_apAfterS;
+  g_nvWrite.scanTtlS = WiFiScan::ttl() / 1000;
+  g_nvBusy = true;
+  if (FsWorker::post(nvsWriteJob, nullptr)) {
+    g_nvDirty = 0;
+  } else {
+    g_nvBusy = false;  // queue full: retry next loop()
+  }
+}
+
+// Add or update a network and make it the next one tried. A full list
+// drops the entry with the least history.
+static int saveNet(const char* s, const char* p, const StaticIp& sip) {
+  int i = findNet(s);
+  if (i < 0) {
+    if (g_netCount < kMaxNets) {
+      i = g_netCount++;
+    } else {
+      i = 0;
+      for (uint8_t k = 1; k < g_netCount; ++k) if (g_nets[k].okCount <= g_nets[i].okCount) i = k;
+    }
+    g_nets[i] = {};
+    g_run[i] = { kRssiUnseen, 0, 0, {} };
+    strlcpy(g_nets[i].ssid, s, sizeof(g_nets[i].ssid));
+  }
+  strlcpy(g_nets[i].pass, p, sizeof(g_nets[i].pass));
+  g_nets[i].sip = sip;
+  g_run[i].fails = 0;
+  // The cached association may belong to the old password / address
+  if (strcmp(g_fast.ssid, s) == 0) { g_fast = {}; g_nvDirty |= NV_FAST; }
+  g_nvDirty |= NV_NETS;
+  flushNvs();
+  return i;
+}
+
+static void removeNet(int i) {
+  if (i < 0 || i >= g_netCount) return;
+  if (strcmp(g_fast.ssid, g_nets[i].ssid) == 0) { g_fast = {}; g_nvDirty |= NV_FAST; }
+  for (int k = i; k + 1 < g_netCount; ++k) { g_nets[k] = g_nets[k + 1]; g_run[k] = g_run[k + 1]; }
+  g_netCount--;
+  if (g_current == i) g_current = -1;
+  else if (g_current > i) g_current--;
+  g_prefer = -1;
+  g_nvDirty |= NV_NETS;
+  flushNvs();
 }
 
 static void clearCreds() {
-  prefs.begin("wifi", false);
-  prefs.remove("ssid");
-  prefs.remove("pass");
-  prefs.end();
+  g_netCount = 0;
+  g_current = g_prefer = -1;
+  g_fast = {};
+  g_nvDirty |= NV_NETS | NV_FAST;
+  flushNvs();
+}
+
+// Called on every connect; writes only when the association or history
+// changed, since the device is power-cycled constantly.
+static void rememberLink(bool leaseValid) {
+  if (g_current < 0) return;
+  SavedNet& n = g_nets[g_current];
+  if (n.okCount < kOkCap) { n.okCount++; g_nvDirty |= NV_NETS; }
+  g_run[g_current].fails = 0;
+
+  FastCache c = {};
+  strlcpy(c.ssid, n.ssid, sizeof(c.ssid));
+  WiFi.BSSID(c.bssid);
+  c.channel = (uint8_t)WiFi.channel();
+  c.valid = 1;
+  if (leaseValid) {
+    c.ip   = WiFi.localIP();
+    c.gw   = WiFi.gatewayIP();
+    c.mask = WiFi.subnetMask();
+    c.dns  = WiFi.dnsIP(0);
+  }
+  if (memcmp(&c, &g_fast, sizeof(c)) != 0) {
+    g_fast = c;
+    g_nvDirty |= NV_FAST;
+  }
+  flushNvs();
+}
+
+// ---------------- Events / requests ----------------
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_START:        g_events |= EV_STA_START; break;
+    case ARDUINO_EVENT_WIFI_AP_START:         g_events |= EV_AP_START; break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:       g_events |= EV_GOT_IP; break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: g_events |= EV_STA_DISCONN | EV_LINK_DOWN; break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:      g_events |= EV_LINK_DOWN; break;
+    default: break;
+  }
+}
+
+static bool takeEvent(uint32_t ev) {
+  return (g_events.fetch_and(~ev) & ev) != 0;
+}
+
+// Called from AsyncTCP: copy the creds and let loop() do the rest
+static StaticIp g_reqStatic;
+
+static void requestConnect(const char* s, const char* p, const StaticIp& sip) {
+  portENTER_CRITICAL(&g_reqMux);
+  strlcpy(g_reqSsid, s, sizeof(g_reqSsid));
+  strlcpy(g_reqPass, p, sizeof(g_reqPass));
+  g_reqStatic = sip;
+  portEXIT_CRITICAL(&g_reqMux);
+  g_requests |= REQ_CONNECT;
+}
+
+static void scheduleRebootIn(uint32_t ms) {
+  g_rebootAt = millis() + ms;
+  g_rebootPending = true;
 }
 
 // --------------- AP/Portal helpers -----------------
@@ -68,191 +401,45 @@ static void setAPConfig() {
   );
 }
 
-// ===== OTA HTML (progress + client-driven reboot) =====
-static const char OTA_PAGE[] PROGMEM = R"html(
-<!DOCTYPE html><html><head><meta charset="utf-8">
-<meta name="viewport" content="width=device-width,initial-scale=1,viewport-fit=cover">
-<title>OTA Update</title>
-<style>
-  :root{--bg:#111;--card:#222;--ink:#EEE;--mut:#AAB;--btn:#2563eb;--ok:#2ea043;--err:#d32}
-  *{box-sizing:border-box} html,body{height:100%}
-  body{background:var(--bg);color:var(--ink);font-family:system-ui,Segoe UI,Roboto,Arial;margin:0}
-  .wrap{min-height:100%;display:flex;align-items:center;justify-content:center;padding:env(safe-area-inset-top) 12px env(safe-area-inset-bottom)}
-  .box{width:100%;max-width:520px;margin:16px auto;background:var(--card);padding:18px 16px;border-radius:12px;box-shadow:0 8px 20px #0008}
-  h2{margin:0 0 12px}
-  .row{display:grid;grid-template-columns:1fr;gap:10px}
-  input[type=file],button{width:100%;margin:.25rem 0;padding:.7rem .8rem;border-radius:9px;border:1px solid #555;background:#111;color:var(--ink);font-size:1rem}
-  button{background:var(--btn);border:0;color:#fff;cursor:pointer}
-  .status{margin-top:10px;color:var(--mut)}
-  .bar{height:12px;background:#0c1222;border:1px solid #334;border-radius:999px;overflow:hidden}
-  .fill{height:100%;width:0%}
-  .ok{background:linear-gradient(90deg,#28a745,#3ddc84)}
-  .up{background:linear-gradient(90deg,#4c7cff,#7aa4ff)}
-  .err{background:linear-gradient(90deg,#d32,#f55)}
-  .msg{margin-top:8px;font-size:.95rem}
-</style></head>
-<body>
-<div class="wrap">
-  <div class="box">
-    <h2>OTA Update</h2>
-    <div class="row">
-      <input id="fw" type="file" accept=".bin,.bin.gz">
-      <button id="go">Upload & Flash</button>
-      <div class="bar"><div id="fill" class="fill up"></div></div>
-      <div id="msg" class="msg">Select a firmware <code>.bin</code> (or <code>.bin.gz</code>) and click "Upload & Flash".</div>
-      <div class="row">
-        <button onclick="location.href='/'">⟵ Back to WiFi Setup</button>
-        <button onclick="location.href='/files'">File Manager</button>
-        <button onclick="reboot()" style="background:#a22">Reboot</button>
-      </div>
-      <div id="status" class="status"></div>
-    </div>
-  </div>
-</div>
-<script>
-(function(){
-  const fw   = document.getElementById('fw');
-  const btn  = document.getElementById('go');
-  const fill = document.getElementById('fill');
-  const msg  = document.getElementById('msg');
-  const status = document.getElementById('status');
-
-  function setFill(p, cls){
-    fill.style.width = (Math.max(0,Math.min(100,p))|0) + '%';
-    fill.className = 'fill ' + (cls||'up');
-  }
-  function reboot(){
-    fetch('/reboot',{method:'POST'}).catch(()=>0);
-    setTimeout(()=>location.reload(), 2500);
-  }
-  function pingUntilUp(path, cb){
-    let tries = 0;
-    const t = setInterval(()=>{
-      fetch(path, {cache:'no-store'}).then(r=>{ if (r.ok) { clearInterval(t); cb(true); } })
-      .catch(()=>{});
-      if (++tries > 180) { clearInterval(t); cb(false); }
-    }, 1000);
-  }
-
-  btn.onclick = function(){
-    const f = fw.files && fw.files[0];
-    if(!f){ msg.textContent = 'Please select a firmware file first.'; return; }
-
-    msg.textContent = 'Uploading...';
-    status.textContent = '';
-    setFill(0, 'up');
-
-    const xhr = new XMLHttpRequest();
-    xhr.open('POST', '/ota', true);
-    xhr.responseType = 'text';
-
-    xhr.upload.onprogress = function(ev){
-      if (ev.lengthComputable) {
-        const pc = ev.total ? (ev.loaded * 100 / ev.total) : 0;
-        setFill(pc, 'up');
-      }
-    };
-
-    xhr.onerror = function(){
-      setFill(100, 'err');
-      msg.textContent = 'Upload failed (network error).';
-    };
-
-    xhr.onload = function(){
-      let ok = xhr.status>=200 && xhr.status<300;
-      try { const j = JSON.parse(xhr.responseText||'{}'); ok = ok && !!j.ok; } catch(e){}
-      if (ok) {
-        setFill(100, 'ok');
-        msg.textContent = 'Flashed OK. Rebooting device...';
-        status.textContent = 'Waiting for device to come back online...';
-        fetch('/reboot',{method:'POST'}).catch(()=>0);
-        pingUntilUp('/ping', function(up){
-          status.textContent = up ? 'Device is back online. You may open File Manager.' :
-                                    'Device did not respond in time. Power-cycle if needed.';
-        });
-      } else {
-        setFill(100, 'err');
-        msg.textContent = 'Flash failed.';
-        status.textContent = xhr.responseText || ('HTTP '+xhr.status);
-      }
-    };
-
-    const form = new FormData();
-    form.append('firmware', f, f.name);
-    xhr.send(form);
-  };
-
-  window.reboot = reboot;
-})();
-</script>
-</body></html>
-)html";
-
 // ===== OTA route registration =====
 static void registerOTARoutes() {
-  // Optional firmware info
-  server.on("/fw", HTTP_GET, [](AsyncWebServerRequest* req){
-    String v = String("TypeD/") + String(__DATE__) + " " + String(__TIME__);
-    req->send(200, "text/plain", v);
-  });
-
-  // OTA page
-  server.on("/ota", HTTP_GET, [](AsyncWebServerRequest* req){
-    req->send_P(200, "text/html", OTA_PAGE);
-  });
-
-  // OTA upload/flash (streamed), JSON reply; client triggers /reboot
-  server.on(
-    "/ota",
-    HTTP_POST,
-    [](AsyncWebServerRequest* request){
-      const bool ok = !Update.hasError();
-      if (ok) {
-        String msg = "{\"ok\":true,\"bytes\":" + String(Update.progress()) + "}";
-        request->send(200, "application/json", msg);
-        Serial.println("[OTA] Update uploaded OK; client will reboot device.");
-      } else {
-        request->send(500, "application/json", "{\"ok\":false}");
-        Serial.println("[OTA] Update failed.");
-      }
-    },
-    [](AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final){
-      if (index == 0) {
-        Serial.printf("[OTA] Starting: %s\n", filename.c_str());
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-          Update.printError(Serial);
-        }
-      }
-      if (len) {
-        if (Update.write(data, len) != len) {
-          Update.printError(Serial);
-        }
-      }
-      if (final) {
-        if (!Update.end(true)) {
-          Update.printError(Serial);
-        } else {
-          Serial.printf("[OTA] Finished: %u bytes\n", (unsigned)(index + len));
-        }
-      }
-    }
-  );
+  // /fw, /ota page and the streamed update itself
+  Ota::registerRoutes(server);
 
   // Reboot endpoint (client calls this after success)
+  // The restart itself happens in loop() once the reply has had time to go out
   server.on("/reboot", HTTP_POST, [](AsyncWebServerRequest* req){
     req->send(200, "text/plain", "Rebooting...");
     Serial.println("[OTA] Reboot requested");
-    auto t = millis() + 300; while (millis() < t) { delay(1); }
-    ESP.restart();
+    scheduleRebootIn(kRebootDelayMs);
   });
   server.on("/reboot", HTTP_GET, [](AsyncWebServerRequest* req){
     req->send(200, "text/plain", "Rebooting...");
     Serial.println("[OTA] Reboot requested (GET)");
-    auto t = millis() + 300; while (millis() < t) { delay(1); }
-    ESP.restart();
+    scheduleRebootIn(kRebootDelayMs);
   });
 }
 
+// /save body: {"ssid":"...","pass":"..."} in any key order, escapes allowed
+// Optional "ip","gw","mask","dns" set a static address (DHCP when absent)
+struct SaveBody {
+  char ssid[33];   // 802.11 max 32 bytes
+  char pass[65];   // WPA2 max 64 chars
+  char ip[16], gw[16], mask[16], dns[16];
+  bool tooLong;
+  bool badIp;
+};
+
+static void onSaveField(SaveBody& b, const JsonReader::Event& ev) {
+  if (ev.depth != 1 || !ev.isString()) return;
+  if (ev.keyIs("ssid"))      b.tooLong |= !ev.copyTo(b.ssid, sizeof(b.ssid));
+  else if (ev.keyIs("pass")) b.tooLong |= !ev.copyTo(b.pass, sizeof(b.pass));
+  else if (ev.keyIs("ip"))   b.badIp   |= !ev.copyTo(b.ip, sizeof(b.ip));
+  else if (ev.keyIs("gw"))   b.badIp   |= !ev.copyTo(b.gw, sizeof(b.gw));
+  else if (ev.keyIs("mask")) b.badIp   |= !ev.copyTo(b.mask, sizeof(b.mask));
+  else if (ev.keyIs("dns"))  b.badIp   |= !ev.copyTo(b.dns, sizeof(b.dns));
+}
+
 static void addPortalRoutesOnce() {
   if (portalRoutesAdded) return;
   portalRoutesAdded = true;
@@ -308,6 +495,13 @@ static void addPortalRoutesOnce() {
       <input type="text" id="ssid" placeholder="SSID">
       <label>Password</label>
       <input type="password" id="pass" placeholder="WiFi Password">
+      <details>
+        <summary class="status">Static IP (optional)</summary>
+        <input type="text" id="ip" placeholder="IP address (blank = DHCP)">
+        <input type="text" id="gw" placeholder="Gateway">
+        <input type="text" id="mask" placeholder="Netmask (255.255.255.0)">
+        <input type="text" id="dns" placeholder="DNS (defaults to gateway)">
+      </details>
       <button type="button" onclick="save()" class="btn-primary">Connect & Save</button>
       <button type="button" onclick="forget()" class="btn-danger">Forget WiFi</button>
       <div class="links">
@@ -319,22 +513,27 @@ static void addPortalRoutesOnce() {
   </div>
   </div>
 <script>
+  // Results are pushed over /scan/events after each scan; /scan is only
+  // fetched once up front (and as the fallback without EventSource).
+  function showNets(list) {
+    let dd = document.getElementById('ssidDropdown');
+    let cur = dd.value;
+    dd.innerHTML = '';
+    let def = document.createElement('option');
+    def.value = '';
+    def.text = list.length ? 'Please select a network' : 'No networks found';
+    dd.appendChild(def);
+    list.forEach(n => {
+      let opt = document.createElement('option');
+      opt.value = n.ssid;
+      opt.text = n.ssid + '  (' + n.rssi + ' dBm, ch ' + n.ch + (n.auth === 'open' ? ', open' : '') + ')';
+      dd.appendChild(opt);
+    });
+    dd.value = cur;
+    dd.onchange = function(){ document.getElementById('ssid').value = dd.value; };
+  }
   function scan() {
-    fetch('/scan',{cache:'no-store'}).then(r => r.json()).then(list => {
-      let dd = document.getElementById('ssidDropdown');
-      dd.innerHTML = '';
-      let def = document.createElement('option');
-      def.value = '';
-      def.text = list.length ? 'Please select a network' : 'No networks found';
-      dd.appendChild(def);
-      list.forEach(name => {
-        let opt = document.createElement('option');
-        opt.value = name;
-        opt.text = name;
-        dd.appendChild(opt);
-      });
-      dd.onchange = function(){ document.getElementById('ssid').value = dd.value; };
-    }).catch(() => {
+    fetch('/scan',{cache:'no-store'}).then(r => r.json()).then(showNets).catch(() => {
       let dd = document.getElementById('ssidDropdown');
       dd.innerHTML = '';
       let opt = document.createElement('option');
@@ -343,16 +542,29 @@ static void addPortalRoutesOnce() {
       dd.appendChild(opt);
     });
   }
-  setInterval(scan, 3000);
-  window.onload = scan;
+  let poll = 0;
+  window.onload = function(){
+    scan();
+    if (window.EventSource) {
+      let es = new EventSource('/scan/events');
+      es.addEventListener('scan', e => { try { showNets(JSON.parse(e.data)); } catch (_) {} });
+      // Stream down or refused: poll until it comes back
+      es.onerror = () => { if (!poll) poll = setInterval(scan, 3000); };
+      es.onopen = () => { clearInterval(poll); poll = 0; };
+    } else {
+      setInterval(scan, 3000);
+    }
+  };
 
   function save() {
     let ssid = document.getElementById('ssid').value;
     let pass = document.getElementById('pass').value;
+    let body = {ssid:ssid,pass:pass};
+    ['ip','gw','mask','dns'].forEach(k => { let v = document.getElementById(k).value.trim(); if (v) body[k] = v; });
     fetch('/save',{
       method:'POST',
       headers:{'Content-Type':'application/json','Cache-Control':'no-store'},
-      body:JSON.stringify({ssid:ssid,pass:pass})
+      body:JSON.stringify(body)
     }).then(r=>r.text()).then(t=>{ document.getElementById('status').innerText=t; }).catch(()=>{
       document.getElementById('status').innerText='Error sending credentials';
     });
@@ -377,9 +589,11 @@ static void addPortalRoutesOnce() {
   server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request){
     String stat;
     if (WiFi.status() == WL_CONNECTED)
-      stat = "Connected to " + WiFi.SSID() + " - IP: " + WiFi.localIP().toString();
+      stat = "Connected to " + WiFi.SSID() + " - IP: " + WiFi.localIP().toString() + linkTiming();
     else if (state == State::CONNECTING)
-      stat = "Connecting to " + ssid + "...";
+      stat = String("Connecting to ") + g_trySsid + "...";
+    else if (state == State::BACKOFF)
+      stat = getStatus();
     else
       stat = "In portal mode";
     AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", stat);
@@ -396,133 +610,68 @@ static void addPortalRoutesOnce() {
       request->send(400, "text/plain", "SSID missing");
       return;
     }
-    
-    // Disconnect and clear before new attempt
-    WiFi.disconnect(true);
-    delay(100);
-    
-    saveCreds(ss, pw);
-    ssid = ss; password = pw;
-    
-    // Use STA mode for connection attempts
-    WiFi.mode(WIFI_STA);
-    delay(100);
-    
-    WiFi.begin(ssid.c_str(), password.c_str());
-    state = State::CONNECTING;
-    connectAttempts = 0;
-    lastAttempt = millis();
-    
-    AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", "Connecting to: " + ssid);
+    if (ss.length() > 32 || pw.length() > 64) {
+      request->send(400, "text/plain", "SSID or password too long");
+      return;
+    }
+    auto opt = [request](const char* k) -> String {
+      return request->hasParam(k) ? request->getParam(k)->value() : String();
+    };
+    StaticIp sip;
+    if (!parseStaticIp(opt("ip").c_str(), opt("gw").c_str(), opt("mask").c_str(), opt("dns").c_str(), sip)) {
+      request->send(400, "text/plain", "Bad static IP");
+      return;
+    }
+
+    // Saved and applied by loop()
+    requestConnect(ss.c_str(), pw.c_str(), sip);
+
+    AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", "Connecting to: " + ss);
     resp->addHeader("Cache-Control", "no-store");
     request->send(resp);
   });
 
   // ---------- Save creds (POST JSON body) ----------
   server.on("/save", HTTP_POST,
-    [](AsyncWebServerRequest *request){},
-    NULL,
-    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t) {
-      String body; body.reserve(len ? len : 64);
-      for (size_t i=0;i<len;i++) body += (char)data[i];
-      // crude parse: {"ssid":"...","pass":"..."}
-      int ssidStart = body.indexOf("\"ssid\":\"") + 8;
-      int ssidEnd   = body.indexOf("\"", ssidStart);
-      int passStart = body.indexOf("\"pass\":\"") + 8;
-      int passEnd   = body.indexOf("\"", passStart);
-      String newSsid = (ssidStart >= 8 && ssidEnd > ssidStart) ? body.substring(ssidStart, ssidEnd) : "";
-      String newPass = (passStart >= 8 && passEnd > passStart) ? body.substring(passStart, passEnd) : "";
+    [](AsyncWebServerRequest *request){
+      const SaveBody* body = WebJson::parsedBody<SaveBody>(request);
+      if (!body) {
+        request->send(400, "text/plain", "Bad request");
+        return;
+      }
+      if (body->tooLong) {
+        request->send(400, "text/plain", "SSID or password too long");
+        return;
+      }
+      String newSsid = body->ssid;
       
       if (newSsid.length() == 0) {
         request->send(400, "text/plain", "SSID missing");
         return;
       }
-      
-      // Disconnect and clear before new attempt
-      WiFi.disconnect(true);
-      delay(100);
-      
-      saveCreds(newSsid, newPass);
-      ssid = newSsid; password = newPass;
-      
-      // Use STA mode for connection attempts
-      WiFi.mode(WIFI_STA);
-      delay(100);
-      
-      WiFi.begin(newSsid.c_str(), newPass.c_str());
-      state = State::CONNECTING;
-      connectAttempts = 0;
-      lastAttempt = millis();
-      
-      AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", "Connecting to: " + newSsid);
-      resp->addHeader("Cache-Control", "no-store");
-      request->send(resp);
-      Serial.printf("[WiFiMgr] Received new creds. SSID: %s\n", newSsid.c_str());
-    }
-  );
-
-  // ---------- Scan: return de-duped, RSSI-sorted names ----------
-  server.on("/scan", HTTP_GET, [](AsyncWebServerRequest *request){
-    int n = WiFi.scanComplete();
 
-    // Start async scan if not running yet
-    if (n == -2) {
-      // async=true, show_hidden=true (passive=false keeps it quick)
-      WiFi.scanNetworks(true, true);
-    }
-
-    if (n >= 0) {
-      struct Net { String name; int32_t rssi; };
-      std::vector<Net> nets;
-      nets.reserve(n);
-
-      // Build unique set by SSID, keep strongest RSSI
-      for (int i = 0; i < n; ++i) {
-        String name = WiFi.SSID(i);
-        if (!name.length()) continue; // ignore hidden/empty SSIDs
-        int32_t rssi = WiFi.RSSI(i);
-
-        bool merged = false;
-        for (auto &it : nets) {
-          if (it.name == name) {
-            if (rssi > it.rssi) it.rssi = rssi;
-            merged = true;
-            break;
-          }
-        }
-        if (!merged) nets.push_back({name, rssi});
+      StaticIp sip;
+      if (body->badIp || !parseStaticIp(body->ip, body->gw, body->mask, body->dns, sip)) {
+        request->send(400, "text/plain", "Bad static IP");
+        return;
       }
 
-      // sort by strongest first
-      std::sort(nets.begin(), nets.end(), [](const Net& a, const Net& b){ return a.rssi > b.rssi; });
-
-      lastScanResults.clear();
-      lastScanResults.reserve(nets.size());
-      for (auto &it : nets) lastScanResults.push_back(it.name);
+      // Saved and applied by loop()
+      requestConnect(body->ssid, body->pass, sip);
 
-      WiFi.scanDelete();
-      // Immediately kick off a new async scan so results stay fresh
-      WiFi.scanNetworks(true, true);
-    }
-
-    // Return cached (or just-updated) names only
-    String json = "[";
-    for (size_t i=0; i<lastScanResults.size(); ++i) {
-      if (i) json += ",";
-      json += "\"" + lastScanResults[i] + "\"";
+      AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", "Connecting to: " + newSsid);
+      resp->addHeader("Cache-Control", "no-store");
+      request->send(resp);
+    },
+    NULL,
+    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+      WebJson::feedBody<SaveBody>(request, data, len, index, total, onSaveField);
     }
-    json += "]";
-    AsyncWebServerResponse* resp = request->beginResponse(200, "application/json", json);
-    resp->addHeader("Cache-Control", "no-store");
-    request->send(resp);
-  });
+  );
 
   // ---------- Forget ----------
   server.on("/forget", HTTP_GET, [](AsyncWebServerRequest *request){
-    clearCreds();
-    ssid = ""; password = "";
-    WiFi.disconnect();
-    state = State::PORTAL;
+    forgetWiFi();
     AsyncWebServerResponse* resp = request->beginResponse(200, "text/plain", "WiFi credentials cleared.");
     resp->addHeader("Cache-Control", "no-store");
     request->send(resp);
@@ -551,109 +700,422 @@ static void addPortalRoutesOnce() {
   });
 }
 
-static void startPortal() {
+static void stopPortal() {
+  CaptiveDns::stop();
+  portalActive = false;
+  portalScanAt = 0;
+  // Don't stop server - keep it running for /files etc
+}
+
+static bool portalUp() {
+  return portalActive;
+}
+
+static void schedule(Step s, uint32_t waitMs, uint32_t events = 0) {
+  step = s;
+  stepAt = millis() + waitMs;
+  stepEvents = events;
+}
+
+static uint32_t g_scanGen = 0;   // WiFiScan generation when the round asked
+
+static bool stepDue() {
+  if (step == Step::None) return false;
+  if ((long)(millis() - stepAt) >= 0) return true;
+  if (step == Step::StaRank && WiFiScan::generation() != g_scanGen) return true;
+  return stepEvents && (g_events.load() & stepEvents);
+}
+
+// Portal bring-up: teardown -> AP_STA mode -> softAP -> DNS + routes -> scan
+static void beginPortal(uint32_t settleMs) {
   Serial.println("[WiFiMgr] Starting portal mode");
-  
-  // Only stop DNS if it was actually started
-  if (dnsServerStarted) {
-    Serial.println("[WiFiMgr] Stopping existing DNS server...");
-    dnsServer.stop();
-    dnsServerStarted = false;
-    delay(100);
+  setState(State::PORTAL_STARTING);
+  schedule(Step::PortalTeardown, settleMs);
+}
+
+// Start a round: [STA mode ->] scan -> rank -> begin per candidate. Rounds
+// run behind a live portal keep AP_STA (staMode = false).
+static void beginRound(bool staMode) {
+  setState(State::CONNECTING);
+  g_orderCount = g_orderPos = 0;
+  const int fast = (g_fast.valid && !fastFailed) ? findNet(g_fast.ssid) : -1;
+  if (fast >= 0 && (g_prefer < 0 || g_prefer == fast)) {
+    g_order[0] = (uint8_t)fast;
+    g_orderCount = 1;
+    g_prefer = -1;
+    connectPath = Path::Fast;
+  } else {
+    connectPath = Path::Scan;
   }
-  
-  // Stop any ongoing scans
-  Serial.println("[WiFiMgr] Cleaning up scans...");
-  WiFi.scanDelete();
-  delay(100);
-  
-  // Disconnect cleanly
-  Serial.println("[WiFiMgr] Disconnecting WiFi...");
-  WiFi.disconnect(false);
-  delay(500);
-  
-  // Set AP_STA mode directly (don't use WIFI_OFF)
-  Serial.println("[WiFiMgr] Setting AP_STA mode...");
-  WiFi.mode(WIFI_AP_STA);
-  delay(800);
-  
-  // Configure AP settings BEFORE starting it
-  Serial.println("[WiFiMgr] Configuring AP...");
-  setAPConfig();
-  
-  // Conservative TX power
-  esp_wifi_set_max_tx_power(60);
-  delay(100);
-  
-  // Start the AP
-  Serial.println("[WiFiMgr] Starting AP...");
-  bool apok = WiFi.softAP("X-Sound Setup", "", 6, 0, 4);
-  if (!apok) {
-    Serial.println("[WiFiMgr] ERROR: softAP failed!");
-    return;
+  const Step first = connectPath == Path::Fast ? Step::StaBegin : Step::StaScan;
+  if (staMode) {
+    stopPortal();
+    schedule(Step::StaMode, kStaSettleMs, EV_STA_DISCONN);
+  } else {
+    schedule(first, 0);
   }
-  
-  Serial.printf("[WiFiMgr] softAP started, IP: %s\n", WiFi.softAPIP().toString().c_str());
-  delay(1500);
-  
-  LedStat::setStatus(LedStatus::Portal);
-  
-  // Only start DNS server AFTER AP is confirmed working
-  IPAddress apIP = WiFi.softAPIP();
-  if (apIP == IPAddress(0, 0, 0, 0)) {
-    Serial.println("[WiFiMgr] ERROR: AP IP is 0.0.0.0!");
-    return;
+}
+
+static void roundFailed() {
+  g_round++;
+  g_current = -1;
+  g_nextRoundAt = millis() + g_backoffMs;
+  Serial.printf("[WiFiMgr] No network (round %u), next try in %u ms\n", (unsigned)g_round, (unsigned)g_backoffMs);
+  g_backoffMs = std::min(g_backoffMs * 2, kBackoffMaxMs);
+
+  if (portalUp()) {
+    setState(State::PORTAL);
+  } else if (millis() - g_offlineSince >= g_apAfterS * 1000UL) {
+    Serial.printf("[WiFiMgr] Offline for %u s, bringing up the setup AP\n", (unsigned)((millis() - g_offlineSince) / 1000));
+    LedStat::setStatus(LedStatus::WifiFailed);
+    beginPortal(0);
+  } else {
+    LedStat::setStatus(LedStatus::WifiFailed);
+    setState(State::BACKOFF);
   }
-  
-  Serial.println("[WiFiMgr] Starting DNS server...");
-  dnsServer.start(53, "*", apIP);
-  dnsServerStarted = true;  // Mark as started
-  delay(200);
-
-  // Register routes ONCE
-  Serial.println("[WiFiMgr] Adding portal routes...");
-  addPortalRoutesOnce();
-  
-  // Start web server ONLY if not already started
+}
+
+// Read the scan, refresh per-network RSSI/BSSID and order the candidates
+static void rankNetworks() {
+  for (uint8_t i = 0; i < g_netCount; ++i) {
+    g_run[i].rssi = kRssiUnseen;
+    g_run[i].channel = 0;
+  }
+  // The scan cache already holds the strongest BSSID per SSID
+  WiFiScan::Net seen[WiFiScan::kMaxNets];
+  const uint8_t n = WiFiScan::snapshot(seen, WiFiScan::kMaxNets);
+  for (uint8_t k = 0; k < n; ++k) {
+    const int i = findNet(seen[k].ssid);
+    if (i < 0) continue;
+    g_run[i].rssi = std::max<int8_t>(seen[k].rssi, kRssiUnseen + 1);
+    g_run[i].channel = seen[k].channel;
+    memcpy(g_run[i].bssid, seen[k].bssid, 6);
+  }
+
+  // Unseen networks are still tried (hidden SSIDs, missed beacons), last
+  // Insertion sort: at most kMaxNets entries
+  auto before = [](uint8_t a, uint8_t b) {
+    if ((int)a == g_prefer) return true;
+    if ((int)b == g_prefer) return false;
+    return netScore(a) > netScore(b);
+  };
+  g_orderCount = 0;
+  for (uint8_t i = 0; i < g_netCount && i < kMaxNets; ++i) {
+    uint8_t k = g_orderCount++;
+    for (; k > 0 && before(i, g_order[k - 1]); --k) g_order[k] = g_order[k - 1];
+    g_order[k] = i;
+  }
+  g_prefer = -1;
+  g_orderPos = 0;
+}
+
+static void runStep() {
+  const Step s = step;
+  step = Step::None;
+  // Events from before this step's driver call don't count for its window
+  g_events &= ~(EV_STA_START | EV_STA_DISCONN | EV_AP_START);
+
+  switch (s) {
+    case Step::PortalTeardown: {
+      stopPortal();
+      WiFi.scanDelete();
+      const bool wasUp = WiFi.status() == WL_CONNECTED;
+      WiFi.disconnect(false);
+      schedule(Step::PortalMode, wasUp ? kDisconnectSettleMs : 0, EV_STA_DISCONN);
+      break;
+    }
+    case Step::PortalMode:
+      // Set AP_STA mode directly (don't use WIFI_OFF)
+      WiFi.mode(WIFI_AP_STA);
+      schedule(Step::PortalAp, kModeSettleMs, EV_AP_START | EV_STA_START);
+      break;
+
+    case Step::PortalAp: {
+      // Configure AP settings BEFORE starting it
+      setAPConfig();
+      esp_wifi_set_max_tx_power(60);  // Conservative TX power
+      if (!WiFi.softAP("X-Sound Setup", "", 6, 0, 4)) {
+        Serial.println("[WiFiMgr] ERROR: softAP failed! Retrying...");
+        LedStat::setStatus(LedStatus::WifiFailed);
+        schedule(Step::PortalTeardown, kApRetryMs);
+        break;
+      }
+      schedule(Step::PortalServe, kApSettleMs, EV_AP_START);
+      break;
+    }
+    case Step::PortalServe: {
+      // Only start DNS server AFTER AP is confirmed working
+      IPAddress apIP = WiFi.softAPIP();
+      if (apIP == IPAddress(0, 0, 0, 0)) {
+        Serial.println("[WiFiMgr] ERROR: AP IP is 0.0.0.0! Retrying...");
+        schedule(Step::PortalTeardown, kApRetryMs);
+        break;
+      }
+      Serial.printf("[WiFiMgr] softAP started, IP: %s\n", apIP.toString().c_str());
+      LedStat::setStatus(LedStatus::Portal);
+
+      CaptiveDns::start(apIP);  // answered from the UDP callback, not loop()
+      portalActive = true;
+
+      addPortalRoutesOnce();
+      if (!serverStarted) {
+        server.begin();
+        serverStarted = true;
+      }
+      setState(State::PORTAL);
+      Serial.println("[WiFiMgr] Portal mode ready");
+
+      // Start scan LAST, after everything else is stable
+      portalScanAt = millis() + kScanAfterMs;
+      if (!portalScanAt) portalScanAt = 1;
+      // Saved networks keep being retried behind the portal
+      if ((long)(g_nextRoundAt - portalScanAt) < 0) g_nextRoundAt = millis() + g_backoffMs;
+      break;
+    }
+    case Step::StaMode:
+      // Use STA-only mode for connection
+      WiFi.mode(WIFI_STA);
+      schedule(connectPath == Path::Fast ? Step::StaBegin : Step::StaScan, kStaSettleMs, EV_STA_START);
+      break;
+
+    case Step::StaScan:
+      // Recent cached results will do; otherwise wait for the next scan
+      g_scanGen = WiFiScan::generation();
+      schedule(Step::StaRank, WiFiScan::request(kRoundScanAgeMs) ? 0 : kScanTimeoutMs);
+      break;
+
+    case Step::StaRank:
+      rankNetworks();
+      schedule(Step::StaBegin, 0);
+      break;
+
+    case Step::StaBegin: {
+      if (g_orderPos >= g_orderCount) {
+        roundFailed();
+        break;
+      }
+      const uint8_t i = g_order[g_orderPos];
+      const SavedNet& n = g_nets[i];
+      const NetRun& r = g_run[i];
+      const bool fast = connectPath == Path::Fast;
+      g_current = i;
+      strlcpy(g_trySsid, n.ssid, sizeof(g_trySsid));
+      g_events &= ~(EV_GOT_IP | EV_LINK_DOWN);
+
+      if (n.sip.ip) {
+        WiFi.config(IPAddress(n.sip.ip), IPAddress(n.sip.gw), IPAddress(n.sip.mask), IPAddress(n.sip.dns));
+      } else if (fast && g_fast.ip) {
+        WiFi.config(IPAddress(g_fast.ip), IPAddress(g_fast.gw), IPAddress(g_fast.mask), IPAddress(g_fast.dns));
+      } else {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));  // DHCP
+      }
+      // Directed (known channel + BSSID, no scan) whenever we know where it is
+      if (fast) {
+        WiFi.begin(n.ssid, n.pass, g_fast.channel, g_fast.bssid);
+      } else if (r.channel) {
+        WiFi.begin(n.ssid, n.pass, r.channel, r.bssid);
+      } else {
+        WiFi.begin(n.ssid, n.pass);
+      }
+      Serial.printf("[WiFiMgr] Trying %s (%u/%u, rssi %d, %s)\n", n.ssid,
+                    (unsigned)(g_orderPos + 1), (unsigned)g_orderCount, (int)r.rssi,
+                    fast ? "fast" : "scan");
+      connectStartMs = millis();
+      break;
+    }
+
+    case Step::None:
+    default:
+      break;
+  }
+}
+
+static void onConnected() {
+  strlcpy(g_linkSsid, g_trySsid, sizeof(g_linkSsid));
+  setState(State::CONNECTED);
+  g_events &= ~EV_LINK_DOWN;
+  stopPortal();  // Stop DNS server
+  if (WiFi.getMode() == WIFI_AP_STA) WiFi.mode(WIFI_STA);  // setup AP no longer needed
+
+  lastConnectMs = millis() - connectStartMs;
+  if (!firstIpMs) firstIpMs = millis();
+  if (lostAtMs) {
+    lastReconnectMs = millis() - lostAtMs;
+    reconnects++;
+    lostAtMs = 0;
+  }
+  g_online = true;
+  g_round = 0;
+  g_backoffMs = kBackoffMinMs;
+  if (g_current >= 0) {
+    g_run[g_current].rssi = (int8_t)WiFi.RSSI();
+    // The lease is only worth caching when DHCP handed it out
+    rememberLink(!g_nets[g_current].sip.ip);
+  }
+
+  Serial.println("[WiFiMgr] WiFi connected!");
+  Serial.print("[WiFiMgr] IP Address: ");
+  Serial.println(WiFi.localIP());
+  Serial.printf("[WiFiMgr] RSSI: %d dBm\n", WiFi.RSSI());
+  Serial.printf("[WiFiMgr] Time to IP: %u ms after WiFi.begin, %u ms after boot (%s)\n",
+                (unsigned)lastConnectMs, (unsigned)millis(),
+                connectPath == Path::Fast ? "fast connect" : "scan connect");
+  if (reconnects && lastReconnectMs) {
+    Serial.printf("[WiFiMgr] Reconnected after %u ms\n", (unsigned)lastReconnectMs);
+  }
+
+  LedStat::setStatus(LedStatus::WifiConnected);
+
+  // Ensure web server is accessible
   if (!serverStarted) {
-    Serial.println("[WiFiMgr] Starting web server...");
+    addPortalRoutesOnce();
     server.begin();
     serverStarted = true;
-    delay(200);
   }
-  
-  state = State::PORTAL;
-  Serial.println("[WiFiMgr] Portal mode ready");
+}
+
+static void applyRequests() {
+  const uint32_t req = g_requests.exchange(0);
+  if (!req) return;
 
-  // Start scan LAST, after everything else is stable
-  delay(500);
-  Serial.println("[WiFiMgr] Starting network scan...");
-  WiFi.scanNetworks(true, true);
+  if (req & REQ_AP_AFTER) {
+    g_apAfterS = g_reqApAfterS;
+    g_nvDirty |= NV_AP_AFTER;
+    flushNvs();
+  }
+  if (req & REQ_SCAN_TTL) {
+    g_nvDirty |= NV_SCAN_TTL;
+    flushNvs();
+  }
+  if (req & REQ_REMOVE) {
+    char s[sizeof(g_reqRemove)];
+    portENTER_CRITICAL(&g_reqMux);
+    memcpy(s, g_reqRemove, sizeof(s));
+    portEXIT_CRITICAL(&g_reqMux);
+    removeNet(findNet(s));
+  }
+  if (req & REQ_CONNECT) {
+    char s[sizeof(g_reqSsid)], p[sizeof(g_reqPass)];
+    StaticIp sip;
+    portENTER_CRITICAL(&g_reqMux);
+    memcpy(s, g_reqSsid, sizeof(s));
+    memcpy(p, g_reqPass, sizeof(p));
+    sip = g_reqStatic;
+    portEXIT_CRITICAL(&g_reqMux);
+    Serial.printf("[WiFiMgr] Received new creds. SSID: %s\n", s);
+    g_prefer = saveNet(s, p, sip);
+    g_round = 0;
+    g_backoffMs = kBackoffMinMs;
+    // Disconnect before the new attempt
+    WiFi.disconnect(false);
+    beginRound(true);
+    return;  // a connect supersedes portal requests made in the same pass
+  }
+  if (req & REQ_FORGET) {
+    Serial.println("[WiFiMgr] Forgetting WiFi credentials");
+    clearCreds();
+    beginPortal(0);
+  } else if (req & REQ_PORTAL) {
+    Serial.println("[WiFiMgr] Manual portal restart requested");
+    beginPortal(0);
+  }
 }
 
-static void stopPortal() {
-  if (dnsServerStarted) {
-    dnsServer.stop();
-    dnsServerStarted = false;
+// ---------------- REST: /api/wifi ----------------
+// Read from the AsyncTCP task while loop() updates: values may be one
+// iteration stale. SSIDs stay NUL-terminated within their buffers.
+const char* stateName() {
+  switch (state) {
+    case State::CONNECTING:      return "connecting";
+    case State::CONNECTED:       return "connected";
+    case State::BACKOFF:         return "backoff";
+    case State::PORTAL_STARTING: return "portal_starting";
+    case State::PORTAL:          return "portal";
+    case State::IDLE:
+    default:                     return "idle";
   }
-  // Don't stop server - keep it running for /files etc
 }
 
-static void tryConnect() {
-  if (ssid.length() > 0) {
-    Serial.printf("[WiFiMgr] Attempting to connect to: %s\n", ssid.c_str());
-    
-    // Use STA-only mode for connection
-    WiFi.mode(WIFI_STA);
-    delay(100);
-    
-    WiFi.begin(ssid.c_str(), password.c_str());
-    state = State::CONNECTING;
-    connectAttempts = 0;
-    lastAttempt = millis();
-  } else {
-    startPortal();
+static void handleWifiStatus(AsyncWebServerRequest* req) {
+  const bool up = isConnected();
+  char linkSsid[sizeof(g_linkSsid)];
+  memcpy(linkSsid, g_linkSsid, sizeof(linkSsid));
+  linkSsid[sizeof(linkSsid) - 1] = '\0';
+  WebJson::Reply j;
+  j.beginObject();
+  j.kv("state", stateName());
+  if (up) {
+    j.kv("ssid", (const char*)linkSsid);
+    j.kv("ip", WiFi.localIP().toString().c_str());
+    j.kv("rssi", (int)WiFi.RSSI());
+    j.kv("path", connectPath == Path::Fast ? "fast" : "scan");
+  }
+  j.kv("connect_ms", lastConnectMs);
+  j.kv("first_ip_ms", firstIpMs);
+  j.kv("reconnects", reconnects);
+  j.kv("last_reconnect_ms", lastReconnectMs);
+  j.kv("offline_ms", g_online ? 0u : (uint32_t)(millis() - g_offlineSince));
+  j.kv("round", g_round);
+  j.kv("backoff_ms", g_backoffMs);
+  j.kv("ap_after_s", g_apAfterS);
+  j.kv("scan_ttl_s", WiFiScan::ttl() / 1000);
+  j.kv("scan_age_ms", WiFiScan::ageMs());
+  const CaptiveDns::Stats d = CaptiveDns::stats();
+  j.key("dns").beginObject()
+   .kv("running", CaptiveDns::running())
+   .kv("queries", d.queries)
+   .kv("answered", d.answered)
+   .kv("empty", d.empty)
+   .kv("dropped", d.dropped)
+   .kv("send_fail", d.sendFail)
+   .endObject();
+  j.key("nets").beginArray();
+  for (uint8_t i = 0; i < g_netCount; ++i) {
+    const SavedNet& n = g_nets[i];
+    const NetRun& r = g_run[i];
+    j.beginObject();
+    j.key("ssid").value(n.ssid, strnlen(n.ssid, sizeof(n.ssid) - 1));
+    j.key("rssi");
+    if (r.rssi == kRssiUnseen) j.null(); else j.value((int)r.rssi);
+    j.kv("ok", (unsigned)n.okCount);
+    j.kv("fails", (unsigned)r.fails);
+    j.kv("static", n.sip.ip != 0);
+    j.kv("score", netScore(i));
+    j.endObject();
+  }
+  j.endArray();
+  j.endObject();
+  j.send(req);
+}
+
+// POST /api/wifi?ap_after=<s>, ?scan_ttl=<s> and/or ?remove=<ssid>
+static void handleWifiConfig(AsyncWebServerRequest* req) {
+  bool any = false;
+  if (req->hasParam("ap_after")) {
+    const long v = req->getParam("ap_after")->value().toInt();
+    if (v < 0 || v > 86400) { WebJson::sendError(req, 400, "ap_after out of range"); return; }
+    g_reqApAfterS = (uint32_t)v;
+    g_requests |= REQ_AP_AFTER;
+    any = true;
+  }
+  if (req->hasParam("scan_ttl")) {
+    const long v = req->getParam("scan_ttl")->value().toInt();
+    if (v < 1 || v > 3600) { WebJson::sendError(req, 400, "scan_ttl out of range"); return; }
+    WiFiScan::setTtl((uint32_t)v * 1000UL);
+    g_requests |= REQ_SCAN_TTL;  // persisted from loop()
+    any = true;
+  }
+  if (req->hasParam("remove")) {
+    const String& s = req->getParam("remove")->value();
+    if (!s.length() || s.length() > 32) { WebJson::sendError(req, 400, "bad ssid"); return; }
+    portENTER_CRITICAL(&g_reqMux);
+    strlcpy(g_reqRemove, s.c_str(), sizeof(g_reqRemove));
+    portEXIT_CRITICAL(&g_reqMux);
+    g_requests |= REQ_REMOVE;
+    any = true;
   }
+  if (!any) { WebJson::sendError(req, 400, "nothing to do"); return; }
+  WebJson::sendOk(req);
 }
 
 // ---------------- Public API ----------------
@@ -665,6 +1127,7 @@ void begin() {
   WiFi.setSleep(false);  // Disable WiFi sleep for reliability
   WiFi.setAutoReconnect(true);
   WiFi.persistent(false);  // Don't save credentials to flash each time
+  WiFi.onEvent(onWiFiEvent);
   
 #ifdef CONFIG_IDF_TARGET_ESP32S3
   // Set minimum auth mode for better compatibility
@@ -675,83 +1138,100 @@ void begin() {
 #endif
 
   loadCreds();
+  flushNvs();  // migrates the old single-network keys
+  g_offlineSince = millis();
+
+  WiFiScan::begin();
+  server.on("/api/wifi", HTTP_GET, [](AsyncWebServerRequest* r){ handleWifiStatus(r); });
+  server.on("/api/wifi", HTTP_POST, [](AsyncWebServerRequest* r){ handleWifiConfig(r); });
   
-  if (ssid.length() > 0) {
-    // Try STA-only mode first for saved credentials
-    Serial.println("[WiFiMgr] Found saved credentials, attempting connection...");
-    tryConnect();
+  if (g_netCount > 0) {
+    Serial.printf("[WiFiMgr] %u saved network(s), attempting connection...\n", (unsigned)g_netCount);
+    beginRound(true);
   } else {
     // No credentials, start portal
     Serial.println("[WiFiMgr] No saved credentials, starting portal...");
-    startPortal();
+    beginPortal(0);
   }
 }
 
 void loop() {
-  // Always process DNS requests if portal is active
-  if (state == State::PORTAL) {
-    dnsServer.processNextRequest();
+  XS_HEAP_SCOPE(WiFi);
+
+  if (g_rebootPending && (long)(millis() - g_rebootAt.load()) >= 0) {
+    ESP.restart();
   }
 
+  flushNvs();
+  applyRequests();
+  // No new scans while an association is in flight or the AP is coming up
+  WiFiScan::loop(!(state == State::CONNECTING && step == Step::None) && state != State::PORTAL_STARTING);
+  if (stepDue()) runStep();
+
   switch (state) {
     case State::CONNECTING: {
-      if (WiFi.status() == WL_CONNECTED) {
-        state = State::CONNECTED;
-        stopPortal();  // Stop DNS server
-        
-        Serial.println("[WiFiMgr] WiFi connected!");
-        Serial.print("[WiFiMgr] IP Address: ");
-        Serial.println(WiFi.localIP());
-        Serial.printf("[WiFiMgr] RSSI: %d dBm\n", WiFi.RSSI());
-        
-        LedStat::setStatus(LedStatus::WifiConnected);
-        
-        // Ensure web server is accessible
-        if (!serverStarted) {
-          addPortalRoutesOnce();
-          server.begin();
-          serverStarted = true;
-        }
-      } else if (millis() - lastAttempt > retryDelay) {
-        connectAttempts++;
-        Serial.printf("[WiFiMgr] Connection attempt %d/%d (WiFi status: %d)\n", 
-                      connectAttempts, maxAttempts, WiFi.status());
-        
-        if (connectAttempts >= maxAttempts) {
-          Serial.println("[WiFiMgr] Max connection attempts reached, will start portal");
-          LedStat::setStatus(LedStatus::WifiFailed);
-          
-          // Give system a moment to stabilize before switching modes
-          delay(500);
-          
-          state = State::PORTAL;
-          startPortal();
-        } else {
-          // Retry connection
-          lastAttempt = millis();
-        }
+      if (step != Step::None) break;  // still scanning / bringing STA up
+      const uint32_t elapsed = millis() - connectStartMs;
+      if (takeEvent(EV_GOT_IP) || WiFi.status() == WL_CONNECTED) {
+        onConnected();
+      } else if (connectPath == Path::Fast && (takeEvent(EV_STA_DISCONN) || elapsed > kFastConnectMs)) {
+        // Cached AP moved or lease refused: scan + DHCP for the rest of this boot
+        Serial.println("[WiFiMgr] Fast connect failed, falling back to full scan");
+        fastFailed = true;
+        connectPath = Path::Scan;
+        WiFi.disconnect(false);
+        schedule(Step::StaScan, kStaSettleMs, EV_STA_DISCONN);
+      } else if (takeEvent(EV_STA_DISCONN) || elapsed > kAttemptMs) {
+        // Not found / refused ends it early; the timeout covers a silent DHCP
+        Serial.printf("[WiFiMgr] No IP from %s after %u ms (WiFi status: %d)\n",
+                      g_trySsid, (unsigned)elapsed, WiFi.status());
+        if (g_current >= 0 && g_run[g_current].fails < 255) g_run[g_current].fails++;
+        g_orderPos++;
+        WiFi.disconnect(false);
+        schedule(Step::StaBegin, kStaSettleMs, EV_STA_DISCONN);
       }
       break;
     }
     
     case State::CONNECTED: {
-      // Monitor connection and reconnect if lost
-      if (WiFi.status() != WL_CONNECTED) {
+      // Monitor connection; the same network is retried first (directed)
+      if (takeEvent(EV_LINK_DOWN) || WiFi.status() != WL_CONNECTED) {
         Serial.println("[WiFiMgr] Lost connection, attempting reconnect...");
-        state = State::CONNECTING;
-        connectAttempts = 0;
-        lastAttempt = millis();
-        WiFi.begin(ssid.c_str(), password.c_str());
+        lostAtMs = millis();
+        g_offlineSince = millis();
+        g_online = false;
+        g_prefer = g_current;
+        fastFailed = false;
         LedStat::setStatus(LedStatus::Booting);
+        beginRound(false);
+      }
+      break;
+    }
+
+    case State::BACKOFF: {
+      if (millis() - g_offlineSince >= g_apAfterS * 1000UL) {
+        Serial.println("[WiFiMgr] Still offline, bringing up the setup AP");
+        beginPortal(0);
+      } else if ((long)(millis() - g_nextRoundAt) >= 0) {
+        beginRound(false);
       }
       break;
     }
     
     case State::PORTAL: {
-      // Portal mode - nothing special to do
+      if (portalScanAt && (long)(millis() - portalScanAt) >= 0) {
+        portalScanAt = 0;
+        Serial.println("[WiFiMgr] Starting network scan...");
+        WiFiScan::request();
+      } else if (g_netCount && !portalScanAt && WiFi.softAPgetStationNum() == 0 &&
+                 (long)(millis() - g_nextRoundAt) >= 0) {
+        // Nobody is using the portal: try the saved networks again
+        beginRound(false);
+      }
       break;
     }
-    
+
+    case State::PORTAL_STARTING:  // driven by the step chain above
     case State::IDLE:
     default:
       break;
@@ -759,19 +1239,15 @@ void loop() {
 }
 
 void restartPortal() {
-  Serial.println("[WiFiMgr] Manual portal restart requested");
-  state = State::PORTAL;
-  startPortal();
+  g_requests |= REQ_PORTAL;
 }
 
 void forgetWiFi() {
-  Serial.println("[WiFiMgr] Forgetting WiFi credentials");
-  clearCreds();
-  ssid = "";
-  password = "";
-  WiFi.disconnect(true);
-  state = State::PORTAL;
-  startPortal();
+  g_requests |= REQ_FORGET;
+}
+
+void scheduleReboot(uint32_t delayMs) {
+  scheduleRebootIn(delayMs);
 }
 
 bool isConnected() {
@@ -780,10 +1256,17 @@ bool isConnected() {
 
 String getStatus() {
   if (isConnected()) {
-    return "Connected to: " + ssid + " (IP: " + WiFi.localIP().toString() + ")";
+    return String("Connected to: ") + g_linkSsid + " (IP: " + WiFi.localIP().toString() + ")" + linkTiming();
   }
   if (state == State::CONNECTING) {
-    return "Connecting to: " + ssid + " (attempt " + String(connectAttempts) + "/" + String(maxAttempts) + ")";
+    return String("Connecting to: ") + g_trySsid + " (network " + String(g_orderPos + 1) + "/" + String(g_orderCount) +
+           ", round " + String(g_round + 1) + ")";
+  }
+  if (state == State::BACKOFF) {
+    return "No network, retrying in " + String((long)(g_nextRoundAt - millis()) / 1000 + 1) + " s";
+  }
+  if (state == State::PORTAL_STARTING) {
+    return "Starting portal";
   }
   if (state == State::PORTAL) {
     return "Portal mode active";
@@ -791,4 +1274,4 @@ String getStatus() {
   return "Not connected";
 }
 
-} // namespace WiFiMgr
\ No newline at end of file
+} // namespace WiFiMgr
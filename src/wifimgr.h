@@ -8,10 +8,17 @@ namespace WiFiMgr {
     // Expose the shared server so other modules (e.g., fileman) can add routes.
     AsyncWebServer& getServer();
 
+    // Everything below returns at once: mode changes, portal bring-up and
+    // credential writes are carried out step by step from loop().
     void begin();
     void loop();
     void restartPortal();
     void forgetWiFi();
+    // Restart from loop() after delayMs (lets a pending HTTP reply go out)
+    void scheduleReboot(uint32_t delayMs);
     bool isConnected();
     String getStatus();
+    // As "state" in GET /api/wifi: idle, connecting, connected, backoff,
+    // portal_starting, portal
+    const char* stateName();
 }
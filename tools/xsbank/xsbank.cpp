@@ -0,0 +1,434 @@
+// xsbank — build an "XSB1" sound bank for X-Sound (host tool).
+//
+//   g++ -O2 -std=c++17 -I../../src -o xsbank xsbank.cpp ../../src/sound_bank.cpp
+//   ./xsbank <clips-dir> <bank.cfg> <out.xsb> [-x <export-dir>]
+//
+// Upload out.xsb (or a gzip of it) at /ota under "Sounds / Filesystem", or
+// POST it to /ota/fs. -x also writes the processed MP3s to a directory, for
+// building a raw SPIFFS image with mkspiffs instead.
+//
+// bank.cfg (INI; '#' comments):
+//   [boot]                  # or [eject]
+//   file = startup.mp3      # relative to <clips-dir>
+//   trim_start_ms = 120     # whole frames (26 ms at 44.1 kHz) are cut
+//   trim_end_ms = 0
+//   gain_db = -3            # 1.5 dB steps
+//   [settings]              # device defaults, all optional
+//   volume = 200            # 0..255
+//   boot_enabled = true
+//   eject_enabled = true
+//
+// Nothing is decoded: trims drop whole frames, gain moves each granule's
+// global_gain (as mp3gain does), and a fresh Xing/Info frame with frame
+// count, byte count and a 100-entry seek TOC is put in front, which is what
+// the firmware's index reads for duration and bitrate. The first frame
+// after a start trim may come out silent (its bit reservoir was cut away).
+
+#include "sound_bank.h"
+#include "../common/sha256.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+
+// -------------- MP3 frames (Layer III) --------------
+static const uint16_t kRateV1[]  = {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320};
+static const uint16_t kRateV2[]  = {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160};
+static const uint32_t kSrateV1[] = {44100, 48000, 32000};
+
+struct Frame {
+  size_t   off, len;
+  bool     mpeg1;
+  bool     crc;          // 16-bit CRC after the header
+  bool     mono;
+  uint8_t  ver;          // header bits: 0 = 2.5, 2 = 2, 3 = 1
+  uint8_t  rateIdx;
+  uint32_t sampleRate;
+};
+
+static bool parseFrame(const uint8_t* p, size_t avail, size_t off, Frame& f) {
+  if (avail < 4 || p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+  const uint8_t ver   = (p[1] >> 3) & 3;
+  const uint8_t layer = (p[1] >> 1) & 3;
+  const uint8_t bri   = p[2] >> 4;
+  const uint8_t sri   = (p[2] >> 2) & 3;
+  if (ver == 1 || layer != 1 || bri == 0 || bri == 15 || sri == 3) return false;
+  f.off        = off;
+  f.ver        = ver;
+  f.mpeg1      = ver == 3;
+  f.crc        = !(p[1] & 1);
+  f.mono       = (p[3] >> 6) == 3;
+  f.rateIdx    = bri;
+  f.sampleRate = kSrateV1[sri] >> (ver == 3 ? 0 : ver == 2 ? 1 : 2);
+  const uint32_t kbps = f.mpeg1 ? kRateV1[bri] : kRateV2[bri];
+  f.len = (f.mpeg1 ? 144000u : 72000u) * kbps / f.sampleRate + ((p[2] >> 1) & 1);
+  return f.len >= 4 + (f.crc ? 2 : 0);
+}
+
+static size_t sideInfoLen(const Frame& f) {
+  return f.mpeg1 ? (f.mono ? 17 : 32) : (f.mono ? 9 : 17);
+}
+
+static uint32_t samplesPerFrame(const Frame& f) { return f.mpeg1 ? 1152 : 576; }
+
+static bool isTagFrame(const Bytes& d, const Frame& f) {
+  const size_t x = f.off + 4 + sideInfoLen(f);
+  const size_t v = f.off + 4 + 32;
+  if (x + 4 <= f.off + f.len && (!memcmp(&d[x], "Xing", 4) || !memcmp(&d[x], "Info", 4))) return true;
+  return v + 4 <= f.off + f.len && !memcmp(&d[v], "VBRI", 4);
+}
+
+// Audio frames of the file. ID3v2/ID3v1/APE tags and junk between frames
+// are skipped; a frame counts only if the next one (or EOF) follows it.
+static bool scanFrames(const Bytes& d, std::vector<Frame>& out, std::string& err) {
+  size_t pos = 0;
+  if (d.size() >= 10 && !memcmp(d.data(), "ID3", 3)) {
+    pos = 10 + (((size_t)(d[6] & 0x7F) << 21) | ((size_t)(d[7] & 0x7F) << 14) |
+                ((size_t)(d[8] & 0x7F) << 7)  |  (size_t)(d[9] & 0x7F));
+    if (d[5] & 0x10) pos += 10;
+  }
+  const Frame* first = nullptr;
+  while (pos + 4 <= d.size()) {
+    if (!memcmp(&d[pos], "TAG", 3) || (pos + 8 <= d.size() && !memcmp(&d[pos], "APETAGEX", 8))) break;
+    Frame f;
+    if (!parseFrame(&d[pos], d.size() - pos, pos, f) || pos + f.len > d.size()) { ++pos; continue; }
+    Frame next;
+    const size_t n = pos + f.len;
+    const bool chained = n + 4 > d.size() || parseFrame(&d[n], d.size() - n, n, next) ||
+                         !memcmp(&d[n], "TAG", 3) || (n + 8 <= d.size() && !memcmp(&d[n], "APETAGEX", 8));
+    if (!chained || (first && (f.ver != first->ver || f.sampleRate != first->sampleRate))) { ++pos; continue; }
+    out.push_back(f);
+    first = &out.front();
+    pos = n;
+  }
+  if (!out.empty() && isTagFrame(d, out.front())) out.erase(out.begin());
+  if (out.empty()) { err = "no MPEG Layer III frames"; return false; }
+  return true;
+}
+
+// -------------- Gain (global_gain, 1.5 dB per step) --------------
+static uint32_t getBits(const uint8_t* p, size_t bit, int n) {
+  uint32_t v = 0;
+  for (int i = 0; i < n; ++i, ++bit) v = (v << 1) | ((p[bit >> 3] >> (7 - (bit & 7))) & 1);
+  return v;
+}
+
+static void putBits(uint8_t* p, size_t bit, int n, uint32_t v) {
+  for (int i = n - 1; i >= 0; --i, ++bit) {
+    const uint8_t m = (uint8_t)(0x80 >> (bit & 7));
+    if ((v >> i) & 1) p[bit >> 3] |= m; else p[bit >> 3] &= (uint8_t)~m;
+  }
+}
+
+// CRC-16 (0x8005) over header bytes 2..3 and the side info, as in ISO 11172-3
+static uint16_t frameCrc(const uint8_t* frame, size_t side) {
+  uint16_t crc = 0xFFFF;
+  auto feed = [&](uint8_t b) {
+    for (int i = 7; i >= 0; --i) {
+      const bool top = ((crc >> 15) & 1) != (((b >> i) & 1) != 0);
+      crc = (uint16_t)(crc << 1);
+      if (top) crc ^= 0x8005;
+    }
+  };
+  feed(frame[2]); feed(frame[3]);
+  for (size_t i = 0; i < side; ++i) feed(frame[6 + i]);
+  return crc;
+}
+
+// Returns how many granules hit the 0/255 limit
+static unsigned applyGain(Bytes& d, const Frame& f, int steps) {
+  uint8_t* fr = &d[f.off];
+  uint8_t* side = fr + 4 + (f.crc ? 2 : 0);
+  const int nch = f.mono ? 1 : 2;
+  size_t bit = f.mpeg1 ? 9 + (f.mono ? 5 : 3) + 4 * nch : 8 + (f.mono ? 1 : 2);
+  const int granules = f.mpeg1 ? 2 : 1;
+  const size_t stride = f.mpeg1 ? 59 : 63;
+  unsigned clipped = 0;
+  for (int gr = 0; gr < granules; ++gr) {
+    for (int ch = 0; ch < nch; ++ch, bit += stride) {
+      const int g = (int)getBits(side, bit + 21, 8) + steps;
+      if (g < 0 || g > 255) clipped++;
+      putBits(side, bit + 21, 8, (uint32_t)std::min(255, std::max(0, g)));
+    }
+  }
+  if (f.crc) {
+    const uint16_t c = frameCrc(fr, sideInfoLen(f));
+    fr[4] = (uint8_t)(c >> 8);
+    fr[5] = (uint8_t)c;
+  }
+  return clipped;
+}
+
+// -------------- Xing/Info frame --------------
+static void put32be(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+// Same stream parameters as the audio, no CRC, no padding; the bitrate is
+// raised if the smallest frame cannot hold the tag.
+static Bytes infoFrame(const Bytes& d, const std::vector<Frame>& frames, size_t audioBytes, bool vbr) {
+  const Frame& a = frames.front();
+  const size_t side = sideInfoLen(a);
+  const size_t need = 4 + side + 4 + 4 + 4 + 4 + 100;
+  uint8_t hdr[4] = { d[a.off], (uint8_t)(d[a.off + 1] | 1), (uint8_t)(d[a.off + 2] & ~0x02), d[a.off + 3] };
+  Frame f;
+  for (uint8_t bri = a.rateIdx;; ++bri) {
+    hdr[2] = (uint8_t)((hdr[2] & 0x0F) | (bri << 4));
+    if (parseFrame(hdr, 4, 0, f) && f.len >= need) break;
+    if (bri == 14) { f.len = 0; break; }
+  }
+  if (!f.len) return Bytes();
+
+  Bytes out(f.len, 0);
+  memcpy(out.data(), hdr, 4);
+  uint8_t* tag = out.data() + 4 + side;
+  memcpy(tag, vbr ? "Xing" : "Info", 4);
+  put32be(tag + 4, 0x7);                          // frames, bytes, TOC
+  put32be(tag + 8, (uint32_t)frames.size());
+  const size_t total = f.len + audioBytes;
+  put32be(tag + 12, (uint32_t)total);
+  // TOC: file position (1/256ths) at each percent of the duration
+  size_t at = f.len, fi = 0;
+  for (int i = 0; i < 100; ++i) {
+    const size_t target = frames.size() * i / 100;
+    for (; fi < target; ++fi) at += frames[fi].len;
+    tag[16 + i] = (uint8_t)std::min<size_t>(255, at * 256 / total);
+  }
+  return out;
+}
+
+// -------------- Config --------------
+struct Clip {
+  bool        used = false;
+  std::string file;
+  double      trimStartMs = 0, trimEndMs = 0, gainDb = 0;
+};
+
+struct Config {
+  Clip boot, eject;
+  long volume = -1;
+  int  bootEnabled = -1, ejectEnabled = -1;
+};
+
+static std::string trim(const std::string& s) {
+  const size_t a = s.find_first_not_of(" \t\r\n");
+  if (a == std::string::npos) return "";
+  return s.substr(a, s.find_last_not_of(" \t\r\n") - a + 1);
+}
+
+static bool parseBool(const std::string& v, int& out) {
+  if (v == "true" || v == "1" || v == "yes" || v == "on")  { out = 1; return true; }
+  if (v == "false" || v == "0" || v == "no" || v == "off") { out = 0; return true; }
+  return false;
+}
+
+static bool readConfig(const char* path, Config& c) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); return false; }
+  char line[512];
+  std::string section;
+  int ln = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    ++ln;
+    std::string s = line;
+    const size_t hash = s.find('#');
+    if (hash != std::string::npos) s.resize(hash);
+    s = trim(s);
+    if (s.empty()) continue;
+    if (s.front() == '[' && s.back() == ']') {
+      section = trim(s.substr(1, s.size() - 2));
+      if (section != "boot" && section != "eject" && section != "settings") {
+        fprintf(stderr, "%s:%d: unknown section [%s]\n", path, ln, section.c_str());
+        ok = false;
+      }
+      continue;
+    }
+    const size_t eq = s.find('=');
+    if (eq == std::string::npos || section.empty()) {
+      fprintf(stderr, "%s:%d: expected key = value inside a section\n", path, ln);
+      ok = false; break;
+    }
+    const std::string k = trim(s.substr(0, eq)), v = trim(s.substr(eq + 1));
+    char* end = nullptr;
+    const double num = strtod(v.c_str(), &end);
+    const bool isNum = !v.empty() && end && *end == '\0';
+    if (section == "settings") {
+      if (k == "volume" && isNum && num >= 0 && num <= 255) c.volume = (long)num;
+      else if (k == "boot_enabled" && parseBool(v, c.bootEnabled)) {}
+      else if (k == "eject_enabled" && parseBool(v, c.ejectEnabled)) {}
+      else { fprintf(stderr, "%s:%d: bad setting '%s'\n", path, ln, k.c_str()); ok = false; }
+      continue;
+    }
+    Clip& clip = section == "boot" ? c.boot : c.eject;
+    clip.used = true;
+    if (k == "file") clip.file = v;
+    else if (k == "trim_start_ms" && isNum && num >= 0) clip.trimStartMs = num;
+    else if (k == "trim_end_ms" && isNum && num >= 0)   clip.trimEndMs = num;
+    else if (k == "gain_db" && isNum && std::fabs(num) <= 30) clip.gainDb = num;
+    else { fprintf(stderr, "%s:%d: bad key '%s'\n", path, ln, k.c_str()); ok = false; }
+  }
+  fclose(f);
+  for (const Clip* clip : { &c.boot, &c.eject }) {
+    if (ok && clip->used && clip->file.empty()) { fprintf(stderr, "%s: clip section without file =\n", path); ok = false; }
+  }
+  return ok;
+}
+
+// -------------- Clip processing --------------
+static bool readFile(const std::string& path, Bytes& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  const bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+static bool writeFile(const std::string& path, const Bytes& data) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+static bool buildClip(const std::string& dir, const char* slot, const Clip& c, Bytes& out) {
+  const std::string path = dir + "/" + c.file;
+  Bytes src;
+  if (!readFile(path, src)) { perror(path.c_str()); return false; }
+  std::vector<Frame> frames;
+  std::string err;
+  if (!scanFrames(src, frames, err)) { fprintf(stderr, "%s: %s\n", path.c_str(), err.c_str()); return false; }
+
+  const Frame& f0 = frames.front();
+  const double frameMs = 1000.0 * samplesPerFrame(f0) / f0.sampleRate;
+  const size_t cutHead = (size_t)std::lround(c.trimStartMs / frameMs);
+  const size_t cutTail = (size_t)std::lround(c.trimEndMs / frameMs);
+  if (cutHead + cutTail >= frames.size()) { fprintf(stderr, "%s: trim removes every frame\n", path.c_str()); return false; }
+  frames.erase(frames.end() - cutTail, frames.end());
+  frames.erase(frames.begin(), frames.begin() + cutHead);
+
+  const int steps = (int)std::lround(c.gainDb / (20.0 * std::log10(std::pow(2.0, 0.25))));
+  unsigned clipped = 0;
+  if (steps) for (const Frame& f : frames) clipped += applyGain(src, f, steps);
+
+  size_t audioBytes = 0;
+  bool vbr = false;
+  for (const Frame& f : frames) { audioBytes += f.len; vbr |= f.rateIdx != f0.rateIdx; }
+  const Bytes info = infoFrame(src, frames, audioBytes, vbr);
+  if (info.empty()) { fprintf(stderr, "%s: no bitrate leaves room for the Info frame\n", path.c_str()); return false; }
+
+  out = info;
+  for (const Frame& f : frames) out.insert(out.end(), src.begin() + f.off, src.begin() + f.off + f.len);
+
+  const double ms = frames.size() * frameMs;
+  printf("%-6s %s: %zu frames, %.0f ms, %u Hz %s, %.0f kbps%s, trim %zu+%zu frames, gain %+d steps (%+.1f dB)%s, %zu -> %zu bytes\n",
+         slot, c.file.c_str(), frames.size(), ms, (unsigned)f0.sampleRate, f0.mono ? "mono" : "stereo",
+         audioBytes * 8.0 / ms, vbr ? " VBR" : "", cutHead, cutTail, steps, steps * 1.505,
+         clipped ? " CLIPPED" : "", src.size(), out.size());
+  if (clipped) fprintf(stderr, "%s: %u granule(s) hit the gain limit\n", path.c_str(), clipped);
+  return true;
+}
+
+// -------------- Bank --------------
+struct Entry { std::string path; Bytes data; };
+
+static void putEntry(Bytes& bank, const Entry& e) {
+  uint8_t hdr[SoundBank::kEntrySize] = {0};
+  memcpy(hdr, e.path.c_str(), std::min(e.path.size(), SoundBank::kPathMax - 1));
+  const uint32_t n = (uint32_t)e.data.size();
+  for (int i = 0; i < 4; ++i) hdr[SoundBank::kPathMax + i] = (uint8_t)(n >> (8 * i));
+  sha256(e.data, hdr + SoundBank::kPathMax + 4);
+  bank.insert(bank.end(), hdr, hdr + sizeof(hdr));
+  bank.insert(bank.end(), e.data.begin(), e.data.end());
+}
+
+// Re-read the bank with the firmware's parser, checking every hash
+struct Check { Bytes cur; const std::vector<Entry>* want; size_t n; bool ok; };
+
+static bool cEntry(void* ctx, const SoundBank::Entry&) { static_cast<Check*>(ctx)->cur.clear(); return true; }
+static bool cData(void* ctx, const uint8_t* p, size_t len) {
+  Bytes& b = static_cast<Check*>(ctx)->cur;
+  b.insert(b.end(), p, p + len);
+  return true;
+}
+static bool cEnd(void* ctx, const SoundBank::Entry& e) {
+  Check& c = *static_cast<Check*>(ctx);
+  uint8_t h[32];
+  sha256(c.cur, h);
+  const Entry& w = (*c.want)[c.n++];
+  c.ok = c.ok && !memcmp(h, e.sha, 32) && w.path == e.path && w.data == c.cur;
+  return c.ok;
+}
+
+static bool verifyBank(const Bytes& bank, const std::vector<Entry>& entries) {
+  Check c{ {}, &entries, 0, true };
+  SoundBank p;
+  p.reset(cEntry, cData, cEnd, &c);
+  for (size_t i = 0; i < bank.size(); i += 1460) {
+    if (!p.feed(bank.data() + i, std::min<size_t>(1460, bank.size() - i))) {
+      fprintf(stderr, "xsbank: self-check failed: %s\n", p.error());
+      return false;
+    }
+  }
+  if (!p.done() || !c.ok || c.n != entries.size()) { fprintf(stderr, "xsbank: self-check failed\n"); return false; }
+  return true;
+}
+
+// -------------- main --------------
+int main(int argc, char** argv) {
+  const char* exportDir = nullptr;
+  if (argc == 6 && !strcmp(argv[4], "-x")) exportDir = argv[5];
+  else if (argc != 4) {
+    fprintf(stderr, "usage: xsbank <clips-dir> <bank.cfg> <out.xsb> [-x <export-dir>]\n");
+    return 2;
+  }
+  Config cfg;
+  if (!readConfig(argv[2], cfg)) return 1;
+
+  // Slot paths as in SoundIndex
+  std::vector<Entry> entries;
+  const struct { const char* name; const char* path; const Clip* clip; } slots[] = {
+    { "boot",  "/boot.mp3",  &cfg.boot  },
+    { "eject", "/eject.mp3", &cfg.eject },
+  };
+  for (const auto& s : slots) {
+    if (!s.clip->used) continue;
+    Entry e{ s.path, {} };
+    if (!buildClip(argv[1], s.name, *s.clip, e.data)) return 1;
+    entries.push_back(std::move(e));
+  }
+
+  if (cfg.volume >= 0 || cfg.bootEnabled >= 0 || cfg.ejectEnabled >= 0) {
+    std::string j = "{";
+    if (cfg.volume >= 0) j += "\"volume\":" + std::to_string(cfg.volume);
+    if (cfg.bootEnabled >= 0)  j += std::string(j.size() > 1 ? "," : "") + "\"boot_enabled\":" + (cfg.bootEnabled ? "true" : "false");
+    if (cfg.ejectEnabled >= 0) j += std::string(j.size() > 1 ? "," : "") + "\"eject_enabled\":" + (cfg.ejectEnabled ? "true" : "false");
+    j += "}";
+    entries.push_back(Entry{ SoundBank::kSettingsPath, Bytes(j.begin(), j.end()) });
+    printf("settings %s\n", j.c_str());
+  }
+  if (entries.empty()) { fprintf(stderr, "xsbank: nothing to put in the bank\n"); return 1; }
+
+  Bytes bank = { 'X', 'S', 'B', '1', (uint8_t)entries.size(), 0, 0, 0 };
+  for (const Entry& e : entries) putEntry(bank, e);
+  if (!verifyBank(bank, entries)) return 1;
+  if (!writeFile(argv[3], bank)) { perror(argv[3]); return 1; }
+  printf("%s: %zu entries, %zu bytes\n", argv[3], entries.size(), bank.size());
+
+  if (exportDir) {
+    mkdir(exportDir, 0755);
+    for (const Entry& e : entries) {
+      if (e.path == SoundBank::kSettingsPath) continue;   // bank only
+      const std::string p = std::string(exportDir) + e.path;
+      if (!writeFile(p, e.data)) { perror(p.c_str()); return 1; }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+// xsdelta — build an "XSD1" delta patch for X-Sound OTA (host tool).
+//
+//   g++ -O2 -std=c++17 -I../../src -o xsdelta xsdelta.cpp ../../src/ota_delta.cpp
+//   ./xsdelta old.bin new.bin update.xsd
+//   gzip -9 -k update.xsd            # upload update.xsd.gz at /ota
+//
+// old.bin must be the image the unit is running (the build that is on it
+// now); the device refuses a patch whose base hash does not match its slot.
+// Matching follows bsdiff (suffix array over the base, approximate match
+// extension), but blocks are written inline as ctrl/diff/extra so the
+// device can apply them while the upload streams in. Diff bytes are mostly
+// zero, which is what gzip removes. Every patch is applied again here with
+// the device's own DeltaPatch code and compared before it is written.
+
+#include "ota_delta.h"
+#include "../common/sha256.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// -------------- Suffix array (prefix doubling) --------------
+// sa[0] is the empty suffix, as bsdiff's search expects
+static std::vector<int32_t> suffixArray(const Bytes& s) {
+  const int32_t n = (int32_t)s.size();
+  std::vector<int32_t> sa(n + 1), rank(n + 1), tmp(n + 1);
+  for (int32_t i = 0; i <= n; ++i) { sa[i] = i; rank[i] = i < n ? s[i] + 1 : 0; }
+  for (int32_t k = 1;; k <<= 1) {
+    auto key2 = [&](int32_t i) { return i + k <= n ? rank[i + k] : -1; };
+    auto less = [&](int32_t a, int32_t b) {
+      return rank[a] != rank[b] ? rank[a] < rank[b] : key2(a) < key2(b);
+    };
+    std::sort(sa.begin(), sa.end(), less);
+    tmp[sa[0]] = 0;
+    for (int32_t i = 1; i <= n; ++i) tmp[sa[i]] = tmp[sa[i - 1]] + (less(sa[i - 1], sa[i]) ? 1 : 0);
+    rank.swap(tmp);
+    if (rank[sa[n]] == n) break;
+  }
+  return sa;
+}
+
+static int32_t matchLen(const uint8_t* a, int32_t an, const uint8_t* b, int32_t bn) {
+  int32_t i = 0;
+  while (i < an && i < bn && a[i] == b[i]) ++i;
+  return i;
+}
+
+// Longest match of nw[0..nn) in the base, via binary search on the array
+static int32_t search(const std::vector<int32_t>& sa, const Bytes& old, const uint8_t* nw, int32_t nn,
+                      int32_t st, int32_t en, int32_t* pos) {
+  const int32_t on = (int32_t)old.size();
+  while (en - st >= 2) {
+    const int32_t x = st + (en - st) / 2;
+    const int32_t cmpLen = std::min(on - sa[x], nn);
+    if (memcmp(old.data() + sa[x], nw, cmpLen) < 0) st = x; else en = x;
+  }
+  const int32_t x = matchLen(old.data() + sa[st], on - sa[st], nw, nn);
+  const int32_t y = matchLen(old.data() + sa[en], on - sa[en], nw, nn);
+  if (x > y) { *pos = sa[st]; return x; }
+  *pos = sa[en]; return y;
+}
+
+// -------------- Patch writer --------------
+static void put32(Bytes& b, uint32_t v) {
+  for (int i = 0; i < 4; ++i) b.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static Bytes makePatch(const Bytes& old, const Bytes& nw) {
+  Bytes out = { 'X', 'S', 'D', '1' };
+  put32(out, (uint32_t)old.size());
+  put32(out, (uint32_t)nw.size());
+  uint8_t h[32];
+  sha256(old, h); out.insert(out.end(), h, h + 32);
+  sha256(nw, h);  out.insert(out.end(), h, h + 32);
+
+  const std::vector<int32_t> sa = suffixArray(old);
+  const int32_t on = (int32_t)old.size(), nn = (int32_t)nw.size();
+  int32_t scan = 0, len = 0, pos = 0, lastScan = 0, lastPos = 0, lastOffset = 0;
+
+  while (scan < nn) {
+    int32_t oldScore = 0;
+    int32_t scsc = scan += len;
+    for (; scan < nn; ++scan) {
+      len = search(sa, old, nw.data() + scan, nn - scan, 0, on, &pos);
+      for (; scsc < scan + len; ++scsc)
+        if (scsc + lastOffset < on && old[scsc + lastOffset] == nw[scsc]) ++oldScore;
+      if ((len == oldScore && len != 0) || len > oldScore + 8) break;
+      if (scan + lastOffset < on && old[scan + lastOffset] == nw[scan]) --oldScore;
+    }
+    if (len == oldScore && scan != nn) continue;
+
+    // Extend the previous match forward and this one backward
+    int32_t s = 0, sf = 0, lenF = 0;
+    for (int32_t i = 0; lastScan + i < scan && lastPos + i < on;) {
+      if (old[lastPos + i] == nw[lastScan + i]) ++s;
+      ++i;
+      if (s * 2 - i > sf * 2 - lenF) { sf = s; lenF = i; }
+    }
+    int32_t lenB = 0;
+    if (scan < nn) {
+      int32_t sb = 0;
+      s = 0;
+      for (int32_t i = 1; scan >= lastScan + i && pos >= i; ++i) {
+        if (old[pos - i] == nw[scan - i]) ++s;
+        if (s * 2 - i > sb * 2 - lenB) { sb = s; lenB = i; }
+      }
+    }
+    if (lastScan + lenF > scan - lenB) {
+      const int32_t overlap = (lastScan + lenF) - (scan - lenB);
+      int32_t ss = 0, lenS = 0;
+      s = 0;
+      for (int32_t i = 0; i < overlap; ++i) {
+        if (nw[lastScan + lenF - overlap + i] == old[lastPos + lenF - overlap + i]) ++s;
+        if (nw[scan - lenB + i] == old[pos - lenB + i]) --s;
+        if (s > ss) { ss = s; lenS = i + 1; }
+      }
+      lenF += lenS - overlap;
+      lenB -= lenS;
+    }
+
+    const int32_t extra = (scan - lenB) - (lastScan + lenF);
+    const int32_t seek  = (pos - lenB) - (lastPos + lenF);
+    put32(out, (uint32_t)lenF);
+    put32(out, (uint32_t)extra);
+    put32(out, (uint32_t)seek);
+    for (int32_t i = 0; i < lenF; ++i) out.push_back((uint8_t)(nw[lastScan + i] - old[lastPos + i]));
+    out.insert(out.end(), nw.begin() + lastScan + lenF, nw.begin() + lastScan + lenF + extra);
+
+    lastScan = scan - lenB;
+    lastPos = pos - lenB;
+    lastOffset = pos - scan;
+  }
+  return out;
+}
+
+// -------------- Self-check with the device applier --------------
+struct Verify { const Bytes* old; Bytes out; };
+
+static bool vRead(void* ctx, uint32_t off, uint8_t* out, size_t len) {
+  const Bytes& old = *static_cast<Verify*>(ctx)->old;
+  if (off + len > old.size()) return false;
+  memcpy(out, old.data() + off, len);
+  return true;
+}
+
+static bool vWrite(void* ctx, uint8_t* data, size_t len) {
+  Bytes& out = static_cast<Verify*>(ctx)->out;
+  out.insert(out.end(), data, data + len);
+  return true;
+}
+
+static bool verify(const Bytes& old, const Bytes& nw, const Bytes& patch) {
+  Verify v{ &old, {} };
+  DeltaPatch d;
+  d.reset(nullptr, vRead, vWrite, &v);
+  // Odd chunk size, like TCP segments that split headers and blocks
+  for (size_t i = 0; i < patch.size(); i += 1460) {
+    if (!d.feed(patch.data() + i, std::min<size_t>(1460, patch.size() - i))) {
+      fprintf(stderr, "xsdelta: self-check failed: %s\n", d.error());
+      return false;
+    }
+  }
+  if (!d.done() || v.out != nw) {
+    fprintf(stderr, "xsdelta: self-check failed: output differs\n");
+    return false;
+  }
+  return true;
+}
+
+// -------------- main --------------
+static bool readFile(const char* path, Bytes& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  const bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 4) {
+    fprintf(stderr, "usage: xsdelta <running.bin> <new.bin> <out.xsd>\n");
+    return 2;
+  }
+  Bytes old, nw;
+  if (!readFile(argv[1], old)) { perror(argv[1]); return 1; }
+  if (!readFile(argv[2], nw))  { perror(argv[2]); return 1; }
+  if (old.empty() || nw.empty()) { fprintf(stderr, "xsdelta: empty image\n"); return 1; }
+
+  const Bytes patch = makePatch(old, nw);
+  if (!verify(old, nw, patch)) return 1;
+
+  FILE* f = fopen(argv[3], "wb");
+  if (!f || fwrite(patch.data(), 1, patch.size(), f) != patch.size() || fclose(f) != 0) {
+    perror(argv[3]);
+    return 1;
+  }
+  printf("%s: %zu -> %zu bytes, patch %zu bytes (gzip it before upload)\n",
+         argv[3], old.size(), nw.size(), patch.size());
+  return 0;
+}